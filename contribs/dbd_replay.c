@@ -0,0 +1,216 @@
+/*****************************************************************************\
+ *  dbd_replay.c - replay the messages slurmctld saved for the SlurmDBD
+ *****************************************************************************
+ *  Build from the top of a configured SLURM build directory with:
+ *    cc -DHAVE_CONFIG_H -I. -I<slurm source> -o dbd_replay \
+ *       <slurm source>/contribs/dbd_replay.c src/api/.libs/libslurm.a \
+ *       -Wl,--export-dynamic -lpthread -ldl
+ *  and run it as SlurmUser with SLURM_CONF pointing to a slurm.conf which
+ *  uses the SlurmDBD to be measured:
+ *    ./dbd_replay <StateSaveLocation>/dbd.messages [messages per frame]
+ *
+ *  The messages, as saved in dbd.messages by slurmctld when it could not
+ *  reach the SlurmDBD, are sent as DBD_SEND_MULT_MSG frames of 1000 messages
+ *  each by default, the way the slurmctld agent sends its backlog, waiting
+ *  for the reply to each frame. The time the SlurmDBD took to store them is
+ *  reported. The file must have been written by the same SLURM version.
+ *  Replaying a copy against a scratch database is the way to compare the
+ *  throughput of storage plugin changes.
+ *****************************************************************************
+ *  Copyright (C) 2015 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "src/common/list.h"
+#include "src/common/pack.h"
+#include "src/common/slurm_protocol_api.h"
+#include "src/common/slurmdbd_defs.h"
+#include "src/common/xmalloc.h"
+
+#define DBD_MAGIC	0xDEAD3219	/* as in src/common/slurmdbd_defs.c */
+#define MAX_DBD_MSG_LEN	16384
+#define FRAME_SIZE	1000
+
+/* Read one record of dbd.messages, RET NULL at the end or on error */
+static Buf _read_rec(FILE *fp)
+{
+	uint32_t size, magic;
+	char *data;
+
+	if (fread(&size, sizeof(size), 1, fp) != 1)
+		return NULL;
+	if (size > MAX_DBD_MSG_LEN) {
+		fprintf(stderr, "bad record size %u\n", size);
+		return NULL;
+	}
+	data = xmalloc(size);
+	if ((fread(data, 1, size, fp) != size) ||
+	    (fread(&magic, sizeof(magic), 1, fp) != 1) ||
+	    (magic != DBD_MAGIC)) {
+		fprintf(stderr, "truncated or corrupted record\n");
+		xfree(data);
+		return NULL;
+	}
+	return create_buf(data, size);
+}
+
+/* RET count of leading messages of the frame the SlurmDBD stored */
+static int _ack_cnt(slurmdbd_msg_t *resp)
+{
+	dbd_list_msg_t *list_msg = resp->data;
+	dbd_rc_msg_t *rc_msg;
+	ListIterator itr;
+	Buf buffer;
+	uint16_t msg_type;
+	int cnt = 0;
+
+	if (resp->msg_type != DBD_GOT_MULT_MSG)
+		return 0;
+	itr = list_iterator_create(list_msg->my_list);
+	while ((buffer = list_next(itr))) {
+		set_buf_offset(buffer, 0);
+		if ((unpack16(&msg_type, buffer) != SLURM_SUCCESS) ||
+		    (msg_type != DBD_RC) ||
+		    (slurmdbd_unpack_rc_msg(&rc_msg, SLURM_PROTOCOL_VERSION,
+					    buffer) != SLURM_SUCCESS))
+			break;
+		msg_type = rc_msg->return_code;
+		slurmdbd_free_rc_msg(rc_msg);
+		if (msg_type != SLURM_SUCCESS)
+			break;
+		cnt++;
+	}
+	list_iterator_destroy(itr);
+	return cnt;
+}
+
+static double _now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + (tv.tv_usec / 1000000.0);
+}
+
+int main(int argc, char *argv[])
+{
+	int frame_size = FRAME_SIZE, cnt, ack, rec_cnt = 0, fail_cnt = 0;
+	int frame_cnt = 0;
+	char *ver_str = NULL, cur_ver_str[16];
+	uint32_t ver_len;
+	double start, frame_start, max_frame = 0.0;
+	slurmdbd_msg_t req, resp;
+	dbd_list_msg_t list_msg;
+	Buf buffer;
+	FILE *fp;
+
+	if ((argc < 2) || (argc > 3) ||
+	    ((argc == 3) && ((frame_size = atoi(argv[2])) < 1))) {
+		fprintf(stderr, "Usage: %s <dbd.messages> "
+			"[messages per frame]\n", argv[0]);
+		exit(1);
+	}
+	if (!(fp = fopen(argv[1], "r"))) {
+		perror(argv[1]);
+		exit(1);
+	}
+
+	/* The first record holds the version the messages were packed with */
+	snprintf(cur_ver_str, sizeof(cur_ver_str), "VER%d",
+		 SLURM_PROTOCOL_VERSION);
+	if (!(buffer = _read_rec(fp)) ||
+	    (unpackstr_xmalloc(&ver_str, &ver_len, buffer) != SLURM_SUCCESS) ||
+	    !ver_str || strcmp(ver_str, cur_ver_str)) {
+		fprintf(stderr, "%s: not written with %s\n", argv[1],
+			cur_ver_str);
+		exit(1);
+	}
+	xfree(ver_str);
+	free_buf(buffer);
+
+	if (slurm_open_slurmdbd_conn(NULL, NULL, true) != SLURM_SUCCESS) {
+		fprintf(stderr, "can not open SlurmDBD connection: %m\n");
+		exit(1);
+	}
+
+	req.msg_type = DBD_SEND_MULT_MSG;
+	req.data = &list_msg;
+	memset(&list_msg, 0, sizeof(dbd_list_msg_t));
+	start = _now();
+	do {
+		list_msg.my_list = list_create(slurmdbd_free_buffer);
+		for (cnt = 0; cnt < frame_size; cnt++) {
+			if (!(buffer = _read_rec(fp)))
+				break;
+			set_buf_offset(buffer, size_buf(buffer));
+			list_enqueue(list_msg.my_list, buffer);
+		}
+		if (cnt) {
+			frame_start = _now();
+			if (slurm_send_recv_slurmdbd_msg(
+				    SLURM_PROTOCOL_VERSION, &req, &resp)
+			    != SLURM_SUCCESS) {
+				fprintf(stderr, "DBD_SEND_MULT_MSG failed: "
+					"%m\n");
+				exit(1);
+			}
+			max_frame = MAX(max_frame, _now() - frame_start);
+			ack = _ack_cnt(&resp);
+			if (resp.msg_type == DBD_GOT_MULT_MSG)
+				slurmdbd_free_list_msg(resp.data);
+			else
+				slurmdbd_free_rc_msg(resp.data);
+			rec_cnt += cnt;
+			fail_cnt += cnt - ack;
+			frame_cnt++;
+		}
+		list_destroy(list_msg.my_list);
+	} while (cnt == frame_size);
+	start = _now() - start;
+	fclose(fp);
+	slurm_close_slurmdbd_conn();
+
+	printf("%d messages in %d frames in %.3f seconds, %.0f messages/sec, "
+	       "slowest frame %.3f seconds\n", rec_cnt, frame_cnt, start,
+	       start ? (rec_cnt / start) : 0.0, max_frame);
+	if (fail_cnt)
+		printf("%d messages were not stored\n", fail_cnt);
+	exit(fail_cnt ? 1 : 0);
+}
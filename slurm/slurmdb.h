@@ -644,6 +644,12 @@ typedef struct {
 	uint32_t wckeyid;
 } slurmdb_job_rec_t;
 
+/* Called by slurmdb_jobs_get_cb() with each chunk of slurmdb_job_rec_t's
+ * as it comes in.  The List and its records are freed once the callback
+ * returns.  Return SLURM_SUCCESS to be handed the next chunk, anything
+ * else stops the query. */
+typedef int (*slurmdb_job_list_cb_t) (List job_list, void *arg);
+
 typedef struct {
 	char *description;
 	uint32_t id;
@@ -1253,6 +1259,16 @@ extern List slurmdb_events_get(void *db_conn,
  */
 extern List slurmdb_jobs_get(void *db_conn, slurmdb_job_cond_t *job_cond);
 
+/*
+ * get info from the storage a chunk at a time instead of all at once
+ * IN:  slurmdb_job_cond_t *
+ * IN:  callback - handed each chunk of slurmdb_job_rec_t *'s in order
+ * IN:  arg - passed through to callback
+ * RET: SLURM_SUCCESS or error code
+ */
+extern int slurmdb_jobs_get_cb(void *db_conn, slurmdb_job_cond_t *job_cond,
+			       slurmdb_job_list_cb_t callback, void *arg);
+
 /*
  * get info from the storage
  * IN:  slurmdb_assoc_cond_t *
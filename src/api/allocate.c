@@ -421,6 +421,50 @@ slurm_job_step_create (job_step_create_request_msg_t *req,
 	return SLURM_PROTOCOL_SUCCESS ;
 }
 
+/*
+ * slurm_job_step_create_bulk - create several job steps with one RPC
+ * IN req - description of the job step requests, created in array order
+ * OUT resp - one return code and, on success, one step response per request
+ * RET 0 on success, otherwise return -1 and set errno to indicate the error
+ * NOTE: individual steps may fail even if the RPC succeeds, check the
+ *	per step error_code
+ * NOTE: at most MAX_STEP_BULK steps may be requested at once
+ * NOTE: free the response using slurm_free_job_step_create_bulk_response_msg
+ */
+int
+slurm_job_step_create_bulk(job_step_create_bulk_request_msg_t *req,
+			   job_step_create_bulk_response_msg_t **resp)
+{
+	slurm_msg_t req_msg, resp_msg;
+
+	if ((req->step_cnt == 0) || (req->step_cnt > MAX_STEP_BULK))
+		slurm_seterrno_ret(EINVAL);
+
+	slurm_msg_t_init(&req_msg);
+	slurm_msg_t_init(&resp_msg);
+	req_msg.msg_type = REQUEST_JOB_STEP_CREATE_BULK;
+	req_msg.data     = req;
+
+	if (slurm_send_recv_controller_msg(&req_msg, &resp_msg) < 0)
+		return SLURM_ERROR;
+
+	switch (resp_msg.msg_type) {
+	case RESPONSE_SLURM_RC:
+		if (_handle_rc_msg(&resp_msg) < 0)
+			return SLURM_PROTOCOL_ERROR;
+		*resp = NULL;
+		break;
+	case RESPONSE_JOB_STEP_CREATE_BULK:
+		*resp = (job_step_create_bulk_response_msg_t *) resp_msg.data;
+		break;
+	default:
+		slurm_seterrno_ret(SLURM_UNEXPECTED_MSG_ERROR);
+		break;
+	}
+
+	return SLURM_PROTOCOL_SUCCESS;
+}
+
 /*
  * slurm_allocation_lookup - retrieve info for an existing resource allocation
  * IN jobid - job allocation identifier
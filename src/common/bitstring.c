@@ -97,6 +97,276 @@
 #define	bit_decl(name, nbits) \
 	(name)[_bitstr_words(nbits)] = { BITSTR_MAGIC_STACK, (nbits) }
 
+/* unsigned form of a bitstr_t word, for shifts and bit scans */
+#ifdef USE_64BIT_BITSTR
+typedef uint64_t ubitstr_t;
+#else
+typedef uint32_t ubitstr_t;
+#endif
+
+/* bits in one word of a bitstr */
+#define BITSTR_WORD_BITS	((bitoff_t) (sizeof(bitstr_t) * 8))
+
+/* mask of the bits in use within the last word of a bitstr of nbits bits */
+#ifdef SLURM_BIGENDIAN
+#define _bit_tail_mask(nbits) (((nbits) & BITSTR_MAXPOS) ?		\
+	(~(ubitstr_t) 0 << (BITSTR_WORD_BITS - ((nbits) & BITSTR_MAXPOS))) : \
+	~(ubitstr_t) 0)
+#else
+#define _bit_tail_mask(nbits) (((nbits) & BITSTR_MAXPOS) ?		\
+	(((ubitstr_t) 1 << ((nbits) & BITSTR_MAXPOS)) - 1) :		\
+	~(ubitstr_t) 0)
+#endif
+
+/* The POPCNT instruction is used when the CPU supports it, the portable
+ * hamming weight code otherwise. The test is made once at run time, so
+ * the same binary works on older x86 processors. */
+#if defined(__GNUC__) && \
+    ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 8))) && \
+    (defined(__x86_64__) || defined(__i386__))
+#  define BITSTR_POPCNT_DISPATCH 1
+#endif
+
+#if !defined(USE_64BIT_BITSTR)
+/*
+ * Returns the hamming weight (i.e. the number of bits set) in a word.
+ * NOTE: This routine borrowed from Linux 2.4.9 <linux/bitops.h>.
+ */
+static uint32_t
+hweight(uint32_t w)
+{
+	uint32_t res;
+
+	res = (w   & 0x55555555) + ((w >> 1)    & 0x55555555);
+	res = (res & 0x33333333) + ((res >> 2)  & 0x33333333);
+	res = (res & 0x0F0F0F0F) + ((res >> 4)  & 0x0F0F0F0F);
+	res = (res & 0x00FF00FF) + ((res >> 8)  & 0x00FF00FF);
+	res = (res & 0x0000FFFF) + ((res >> 16) & 0x0000FFFF);
+
+	return res;
+}
+#else
+/*
+ * A 64 bit version crafted from 32-bit one borrowed above.
+ */
+static uint64_t
+hweight(uint64_t w)
+{
+	uint64_t res;
+
+	res = (w   & 0x5555555555555555) + ((w >> 1)    & 0x5555555555555555);
+	res = (res & 0x3333333333333333) + ((res >> 2)  & 0x3333333333333333);
+	res = (res & 0x0F0F0F0F0F0F0F0F) + ((res >> 4)  & 0x0F0F0F0F0F0F0F0F);
+	res = (res & 0x00FF00FF00FF00FF) + ((res >> 8)  & 0x00FF00FF00FF00FF);
+	res = (res & 0x0000FFFF0000FFFF) + ((res >> 16) & 0x0000FFFF0000FFFF);
+	res = (res & 0x00000000FFFFFFFF) + ((res >> 32) & 0x00000000FFFFFFFF);
+
+	return res;
+}
+#endif /* !USE_64BIT_BITSTR */
+
+/* Number of bits set in a word */
+static inline int32_t _word_count(ubitstr_t w)
+{
+#if defined(__GNUC__) && defined(USE_64BIT_BITSTR)
+	return __builtin_popcountll(w);
+#elif defined(__GNUC__)
+	return __builtin_popcount(w);
+#else
+	return hweight(w);
+#endif
+}
+
+/* Position within a word of its first bit set, w must be non-zero */
+static inline int32_t _word_ffs(ubitstr_t w)
+{
+#if defined(__GNUC__) && defined(USE_64BIT_BITSTR) && !defined(SLURM_BIGENDIAN)
+	return __builtin_ctzll(w);
+#elif defined(__GNUC__) && !defined(SLURM_BIGENDIAN)
+	return __builtin_ctz(w);
+#elif defined(__GNUC__) && defined(USE_64BIT_BITSTR)
+	return __builtin_clzll(w);
+#elif defined(__GNUC__)
+	return __builtin_clz(w);
+#else
+	int32_t pos;
+
+	for (pos = 0; !(w & (ubitstr_t) _bit_mask(pos)); pos++)
+		;
+	return pos;
+#endif
+}
+
+/* Position within a word of its last bit set, w must be non-zero */
+static inline int32_t _word_fls(ubitstr_t w)
+{
+#if defined(__GNUC__) && defined(USE_64BIT_BITSTR) && !defined(SLURM_BIGENDIAN)
+	return BITSTR_MAXPOS - __builtin_clzll(w);
+#elif defined(__GNUC__) && !defined(SLURM_BIGENDIAN)
+	return BITSTR_MAXPOS - __builtin_clz(w);
+#elif defined(__GNUC__) && defined(USE_64BIT_BITSTR)
+	return BITSTR_MAXPOS - __builtin_ctzll(w);
+#elif defined(__GNUC__)
+	return BITSTR_MAXPOS - __builtin_ctz(w);
+#else
+	int32_t pos;
+
+	for (pos = BITSTR_MAXPOS; !(w & (ubitstr_t) _bit_mask(pos)); pos--)
+		;
+	return pos;
+#endif
+}
+
+/*
+ * Word kernels for counting bits: count the bits set in w1, in (w1 & w2),
+ * or store (w1 & w2) in w1 and count its bits. Two 32-bit words are
+ * counted at a time as one 64-bit value.
+ */
+static inline int32_t _count_words(const bitstr_t *w1, int32_t nwords)
+{
+	int32_t count = 0, i = 0;
+#if defined(__GNUC__) && !defined(USE_64BIT_BITSTR)
+	uint64_t pair;
+
+	for ( ; (i + 1) < nwords; i += 2) {
+		memcpy(&pair, &w1[i], sizeof(pair));
+		count += __builtin_popcountll(pair);
+	}
+#endif
+	for ( ; i < nwords; i++)
+		count += _word_count((ubitstr_t) w1[i]);
+	return count;
+}
+
+static inline int32_t _count_and_words(const bitstr_t *w1, const bitstr_t *w2,
+				       int32_t nwords)
+{
+	int32_t count = 0, i = 0;
+#if defined(__GNUC__) && !defined(USE_64BIT_BITSTR)
+	uint64_t pair1, pair2;
+
+	for ( ; (i + 1) < nwords; i += 2) {
+		memcpy(&pair1, &w1[i], sizeof(pair1));
+		memcpy(&pair2, &w2[i], sizeof(pair2));
+		count += __builtin_popcountll(pair1 & pair2);
+	}
+#endif
+	for ( ; i < nwords; i++)
+		count += _word_count((ubitstr_t) (w1[i] & w2[i]));
+	return count;
+}
+
+static inline int32_t _and_count_words(bitstr_t *w1, const bitstr_t *w2,
+				       int32_t nwords)
+{
+	int32_t count = 0, i;
+
+	for (i = 0; i < nwords; i++) {
+		w1[i] &= w2[i];
+		count += _word_count((ubitstr_t) w1[i]);
+	}
+	return count;
+}
+
+#ifdef BITSTR_POPCNT_DISPATCH
+static int have_popcnt = -1;
+
+static inline int _use_popcnt(void)
+{
+	if (have_popcnt == -1)
+		have_popcnt = __builtin_cpu_supports("popcnt") ? 1 : 0;
+	return have_popcnt;
+}
+
+__attribute__((target("popcnt")))
+static int32_t _count_words_popcnt(const bitstr_t *w1, int32_t nwords)
+{
+	return _count_words(w1, nwords);
+}
+
+__attribute__((target("popcnt")))
+static int32_t _count_and_words_popcnt(const bitstr_t *w1, const bitstr_t *w2,
+				       int32_t nwords)
+{
+	return _count_and_words(w1, w2, nwords);
+}
+
+__attribute__((target("popcnt")))
+static int32_t _and_count_words_popcnt(bitstr_t *w1, const bitstr_t *w2,
+				       int32_t nwords)
+{
+	return _and_count_words(w1, w2, nwords);
+}
+#endif
+
+/* Count the bits set in the first nwords words of w1 */
+static int32_t _bit_count_words(const bitstr_t *w1, int32_t nwords)
+{
+#ifdef BITSTR_POPCNT_DISPATCH
+	if (_use_popcnt())
+		return _count_words_popcnt(w1, nwords);
+#endif
+	return _count_words(w1, nwords);
+}
+
+/* Count the bits set in both w1 and w2 in their first nwords words */
+static int32_t _bit_count_and_words(const bitstr_t *w1, const bitstr_t *w2,
+				    int32_t nwords)
+{
+#ifdef BITSTR_POPCNT_DISPATCH
+	if (_use_popcnt())
+		return _count_and_words_popcnt(w1, w2, nwords);
+#endif
+	return _count_and_words(w1, w2, nwords);
+}
+
+/* w1 &= w2 over the first nwords words, return the bits left set in w1 */
+static int32_t _bit_and_count_words(bitstr_t *w1, const bitstr_t *w2,
+				    int32_t nwords)
+{
+#ifdef BITSTR_POPCNT_DISPATCH
+	if (_use_popcnt())
+		return _and_count_words_popcnt(w1, w2, nwords);
+#endif
+	return _and_count_words(w1, w2, nwords);
+}
+
+/* Find the first run of n bits set (set == true) or clear in b */
+static bitoff_t _bit_nff(bitstr_t *b, int32_t n, bool set)
+{
+	bitoff_t bit, start, nbits = _bitstr_bits(b);
+	int32_t cnt = 0, word, nwords = _bitstr_words(nbits), wbits;
+	ubitstr_t valid, w;
+
+	for (word = BITSTR_OVERHEAD; word < nwords; word++) {
+		start = (word - BITSTR_OVERHEAD) << BITSTR_SHIFT;
+		wbits = MIN(BITSTR_WORD_BITS, nbits - start);
+		valid = (word == (nwords - 1)) ?
+			_bit_tail_mask(nbits) : ~(ubitstr_t) 0;
+		w = set ? (ubitstr_t) b[word] : ~(ubitstr_t) b[word];
+		w &= valid;
+		if (w == 0) {			/* run broken by whole word */
+			cnt = 0;
+			continue;
+		}
+		if (w == valid) {		/* run extended by whole word */
+			if ((cnt + wbits) >= n)
+				return start - cnt;
+			cnt += wbits;
+			continue;
+		}
+		for (bit = start; bit < (start + wbits); bit++) {
+			if (!(w & (ubitstr_t) _bit_mask(bit))) {
+				cnt = 0;
+			} else if (++cnt >= n) {
+				return bit - (cnt - 1);
+			}
+		}
+	}
+
+	return -1;
+}
+
 /*
  * Define slurm-specific aliases for use by plugins, see slurm_xlator.h
  * for details.
@@ -115,6 +385,8 @@ strong_alias(bit_free,		slurm_bit_free);
 strong_alias(bit_realloc,	slurm_bit_realloc);
 strong_alias(bit_size,		slurm_bit_size);
 strong_alias(bit_and,		slurm_bit_and);
+strong_alias(bit_and_not,	slurm_bit_and_not);
+strong_alias(bit_and_set_count,	slurm_bit_and_set_count);
 strong_alias(bit_not,		slurm_bit_not);
 strong_alias(bit_or,		slurm_bit_or);
 strong_alias(bit_set_count,	slurm_bit_set_count);
@@ -125,6 +397,7 @@ strong_alias(bit_nset_max_count,slurm_bit_nset_max_count);
 strong_alias(bit_rotate_copy,	slurm_bit_rotate_copy);
 strong_alias(bit_rotate,	slurm_bit_rotate);
 strong_alias(bit_fmt,		slurm_bit_fmt);
+strong_alias(bit_fmt_full,	slurm_bit_fmt_full);
 strong_alias(bit_unfmt,		slurm_bit_unfmt);
 strong_alias(bitfmt2int,	slurm_bitfmt2int);
 strong_alias(bit_fmt_hexmask,	slurm_bit_fmt_hexmask);
@@ -135,6 +408,7 @@ strong_alias(bit_fls,		slurm_bit_fls);
 strong_alias(bit_fill_gaps,	slurm_bit_fill_gaps);
 strong_alias(bit_super_set,	slurm_bit_super_set);
 strong_alias(bit_overlap,	slurm_bit_overlap);
+strong_alias(bit_overlap_any,	slurm_bit_overlap_any);
 strong_alias(bit_equal,		slurm_bit_equal);
 strong_alias(bit_copy,		slurm_bit_copy);
 strong_alias(bit_pick_cnt,	slurm_bit_pick_cnt);
@@ -142,6 +416,10 @@ strong_alias(bit_nffc,		slurm_bit_nffc);
 strong_alias(bit_noc,		slurm_bit_noc);
 strong_alias(bit_nffs,		slurm_bit_nffs);
 strong_alias(bit_copybits,	slurm_bit_copybits);
+strong_alias(bit_scratch_alloc,	slurm_bit_scratch_alloc);
+strong_alias(bit_scratch_copy,	slurm_bit_scratch_copy);
+strong_alias(bit_scratch_free,	slurm_bit_scratch_free);
+strong_alias(bit_scratch_purge,	slurm_bit_scratch_purge);
 strong_alias(bit_get_bit_num,	slurm_bit_get_bit_num);
 strong_alias(bit_get_pos_num,	slurm_bit_get_pos_num);
 
@@ -203,6 +481,109 @@ bit_free(bitstr_t *b)
 	xfree(b);
 }
 
+/*
+ * Scratch bitmaps are the short lived node and core bitmaps which the
+ * schedulers build and discard for every placement test. Rather than going
+ * back to malloc() each time, bitmaps released with bit_scratch_free() are
+ * kept in a small pool and handed out again to the next request for a
+ * bitmap of the same size. The oldest entry is evicted once the pool is
+ * full, so bitmaps of a stale size (e.g. after reconfiguration) age out.
+ */
+#define BITSTR_SCRATCH_CNT	16
+static pthread_mutex_t bit_scratch_lock = PTHREAD_MUTEX_INITIALIZER;
+static bitstr_t *bit_scratch_pool[BITSTR_SCRATCH_CNT];
+static int bit_scratch_cnt = 0;
+
+/* Remove a bitmap of nbits bits from the scratch pool, NULL if none */
+static bitstr_t *_bit_scratch_get(bitoff_t nbits)
+{
+	bitstr_t *b = NULL;
+	int i;
+
+	slurm_mutex_lock(&bit_scratch_lock);
+	for (i = bit_scratch_cnt - 1; i >= 0; i--) {
+		if (_bitstr_bits(bit_scratch_pool[i]) != nbits)
+			continue;
+		b = bit_scratch_pool[i];
+		bit_scratch_cnt--;
+		memmove(&bit_scratch_pool[i], &bit_scratch_pool[i + 1],
+			(bit_scratch_cnt - i) * sizeof(bitstr_t *));
+		break;
+	}
+	slurm_mutex_unlock(&bit_scratch_lock);
+
+	return b;
+}
+
+/*
+ * Allocate a scratch bitstring, release with bit_scratch_free().
+ *   nbits (IN)		valid bits in new bitstring, initialized to all clear
+ *   RETURN		new bitstring
+ */
+bitstr_t *
+bit_scratch_alloc(bitoff_t nbits)
+{
+	bitstr_t *new = _bit_scratch_get(nbits);
+
+	if (!new)
+		return bit_alloc(nbits);
+	memset(&new[BITSTR_OVERHEAD], 0,
+	       (_bitstr_words(nbits) - BITSTR_OVERHEAD) * sizeof(bitstr_t));
+	return new;
+}
+
+/*
+ * Return a scratch copy of the supplied bitmap, release with
+ * bit_scratch_free().
+ */
+bitstr_t *
+bit_scratch_copy(bitstr_t *b)
+{
+	bitstr_t *new;
+
+	_assert_bitstr_valid(b);
+	new = _bit_scratch_get(_bitstr_bits(b));
+	if (!new)
+		return bit_copy(b);
+	bit_copybits(new, b);
+	return new;
+}
+
+/*
+ * Return a bitstring to the scratch pool. Any bitstring may be released
+ * here, not only those obtained from bit_scratch_alloc/copy().
+ *   b (IN/OUT)	bitstr to be released
+ */
+void
+bit_scratch_free(bitstr_t *b)
+{
+	bitstr_t *old = NULL;
+
+	_assert_bitstr_valid(b);
+	slurm_mutex_lock(&bit_scratch_lock);
+	if (bit_scratch_cnt == BITSTR_SCRATCH_CNT) {
+		old = bit_scratch_pool[0];
+		bit_scratch_cnt--;
+		memmove(&bit_scratch_pool[0], &bit_scratch_pool[1],
+			bit_scratch_cnt * sizeof(bitstr_t *));
+	}
+	bit_scratch_pool[bit_scratch_cnt++] = b;
+	slurm_mutex_unlock(&bit_scratch_lock);
+
+	if (old)
+		bit_free(old);
+}
+
+/* Free all bitstrings held in the scratch pool */
+void
+bit_scratch_purge(void)
+{
+	slurm_mutex_lock(&bit_scratch_lock);
+	while (bit_scratch_cnt > 0)
+		bit_free(bit_scratch_pool[--bit_scratch_cnt]);
+	slurm_mutex_unlock(&bit_scratch_lock);
+}
+
 /*
  * Return the number of possible bits in a bitstring.
  *   b (IN)		bitstring to check
@@ -330,26 +711,22 @@ bit_clear_all(bitstr_t *b)
 bitoff_t
 bit_ffc(bitstr_t *b)
 {
-	bitoff_t bit = 0, value = -1;
+	bitoff_t bit, nbits;
+	int32_t word, nwords;
+	ubitstr_t w;
 
 	_assert_bitstr_valid(b);
 
-	while (bit < _bitstr_bits(b) && value == -1) {
-		int32_t word = _bit_word(bit);
-
-		if (b[word] == BITSTR_MAXPOS) {
-			bit += sizeof(bitstr_t)*8;
+	nbits = _bitstr_bits(b);
+	nwords = _bitstr_words(nbits);
+	for (word = BITSTR_OVERHEAD; word < nwords; word++) {
+		w = ~(ubitstr_t) b[word];
+		if (w == 0)
 			continue;
-		}
-		while (bit < _bitstr_bits(b) && _bit_word(bit) == word) {
-			if (!bit_test(b, bit)) {
-				value = bit;
-				break;
-			}
-			bit++;
-		}
+		bit = ((word - BITSTR_OVERHEAD) << BITSTR_SHIFT) + _word_ffs(w);
+		return (bit < nbits) ? bit : -1;
 	}
-	return value;
+	return -1;
 }
 
 /* Find the first n contiguous bits clear in b.
@@ -360,26 +737,10 @@ bit_ffc(bitstr_t *b)
 bitoff_t
 bit_nffc(bitstr_t *b, int32_t n)
 {
-	bitoff_t value = -1;
-	bitoff_t bit;
-	int32_t cnt = 0;
-
 	_assert_bitstr_valid(b);
 	assert(n > 0 && n < _bitstr_bits(b));
 
-	for (bit = 0; bit < _bitstr_bits(b); bit++) {
-		if (bit_test(b, bit)) {		/* fail */
-			cnt = 0;
-		} else {
-			cnt++;
-			if (cnt >= n) {
-				value = bit - (cnt - 1);
-				break;
-			}
-		}
-	}
-
-	return value;
+	return _bit_nff(b, n, false);
 }
 
 /* Find n contiguous bits clear in b starting at some offset.
@@ -439,26 +800,10 @@ bit_noc(bitstr_t *b, int32_t n, int32_t seed)
 bitoff_t
 bit_nffs(bitstr_t *b, int32_t n)
 {
-	bitoff_t value = -1;
-	bitoff_t bit;
-	int32_t cnt = 0;
-
 	_assert_bitstr_valid(b);
 	assert(n > 0 && n <= _bitstr_bits(b));
 
-	for (bit = 0; bit <= _bitstr_bits(b) - n; bit++) {
-		if (!bit_test(b, bit)) {	/* fail */
-			cnt = 0;
-		} else {
-			cnt++;
-			if (cnt >= n) {
-				value = bit - (cnt - 1);
-				break;
-			}
-		}
-	}
-
-	return value;
+	return _bit_nff(b, n, true);
 }
 
 /*
@@ -469,26 +814,21 @@ bit_nffs(bitstr_t *b, int32_t n)
 bitoff_t
 bit_ffs(bitstr_t *b)
 {
-	bitoff_t bit = 0, value = -1;
+	bitoff_t bit, nbits;
+	int32_t word, nwords;
 
 	_assert_bitstr_valid(b);
 
-	while (bit < _bitstr_bits(b) && value == -1) {
-		int32_t word = _bit_word(bit);
-
-		if (b[word] == 0) {
-			bit += sizeof(bitstr_t)*8;
+	nbits = _bitstr_bits(b);
+	nwords = _bitstr_words(nbits);
+	for (word = BITSTR_OVERHEAD; word < nwords; word++) {
+		if (b[word] == 0)
 			continue;
-		}
-		while (bit < _bitstr_bits(b) && _bit_word(bit) == word) {
-			if (bit_test(b, bit)) {
-				value = bit;
-				break;
-			}
-			bit++;
-		}
+		bit = ((word - BITSTR_OVERHEAD) << BITSTR_SHIFT) +
+		      _word_ffs((ubitstr_t) b[word]);
+		return (bit < nbits) ? bit : -1;
 	}
-	return value;
+	return -1;
 }
 
 /*
@@ -499,39 +839,28 @@ bit_ffs(bitstr_t *b)
 bitoff_t
 bit_fls(bitstr_t *b)
 {
-	bitoff_t bit, value = -1;
+	bitoff_t nbits;
 	int32_t word;
+	ubitstr_t w;
 
 	_assert_bitstr_valid(b);
 
-	if (_bitstr_bits(b) == 0)	/* empty bitstring */
+	nbits = _bitstr_bits(b);
+	if (nbits == 0)		/* empty bitstring */
 		return -1;
 
-	bit = _bitstr_bits(b) - 1;	/* zero origin */
-
-	while (bit >= 0 && 		/* test partitial words */
-		(_bit_word(bit) == _bit_word(bit + 1))) {
-		if (bit_test(b, bit)) {
-			value = bit;
-			break;
-		}
-		bit--;
-	}
-	while (bit >= 0 && value == -1) {	/* test whole words */
-		word = _bit_word(bit);
-		if (b[word] == 0) {
-			bit -= sizeof(bitstr_t) * 8;
-			continue;
-		}
-		while (bit >= 0) {
-			if (bit_test(b, bit)) {
-				value = bit;
-				break;
-			}
-			bit--;
+	word = _bitstr_words(nbits) - 1;
+	w = (ubitstr_t) b[word] & _bit_tail_mask(nbits);
+	while (1) {
+		if (w != 0) {
+			return ((word - BITSTR_OVERHEAD) << BITSTR_SHIFT) +
+			       _word_fls(w);
 		}
+		if (--word < BITSTR_OVERHEAD)
+			break;
+		w = (ubitstr_t) b[word];
 	}
-	return value;
+	return -1;
 }
 
 /*
@@ -561,15 +890,15 @@ bit_fill_gaps(bitstr_t *b)
 int
 bit_super_set(bitstr_t *b1, bitstr_t *b2)
 {
-	bitoff_t bit;
+	int32_t word, nwords;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8) {
-		if (b1[_bit_word(bit)] != (b1[_bit_word(bit)] &
-		                           b2[_bit_word(bit)]))
+	nwords = _bitstr_words(_bitstr_bits(b1));
+	for (word = BITSTR_OVERHEAD; word < nwords; word++) {
+		if (b1[word] & ~b2[word])
 			return 0;
 	}
 
@@ -582,7 +911,7 @@ bit_super_set(bitstr_t *b1, bitstr_t *b2)
 extern int
 bit_equal(bitstr_t *b1, bitstr_t *b2)
 {
-	bitoff_t bit;
+	int32_t word, nwords;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
@@ -590,8 +919,9 @@ bit_equal(bitstr_t *b1, bitstr_t *b2)
 	if (_bitstr_bits(b1) != _bitstr_bits(b2))
 		return 0;
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8) {
-		if (b1[_bit_word(bit)] != b2[_bit_word(bit)])
+	nwords = _bitstr_words(_bitstr_bits(b1));
+	for (word = BITSTR_OVERHEAD; word < nwords; word++) {
+		if (b1[word] != b2[word])
 			return 0;
 	}
 
@@ -608,14 +938,62 @@ bit_equal(bitstr_t *b1, bitstr_t *b2)
 void
 bit_and(bitstr_t *b1, bitstr_t *b2)
 {
-	bitoff_t bit;
+	int32_t word, nwords;
+
+	_assert_bitstr_valid(b1);
+	_assert_bitstr_valid(b2);
+	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
+
+	nwords = _bitstr_words(_bitstr_bits(b1));
+	for (word = BITSTR_OVERHEAD; word < nwords; word++)
+		b1[word] &= b2[word];
+}
+
+/*
+ * b1 &= ~b2
+ *   b1 (IN/OUT)	first string
+ *   b2 (IN)		second bitstring
+ */
+void
+bit_and_not(bitstr_t *b1, bitstr_t *b2)
+{
+	int32_t word, nwords;
+
+	_assert_bitstr_valid(b1);
+	_assert_bitstr_valid(b2);
+	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
+
+	nwords = _bitstr_words(_bitstr_bits(b1));
+	for (word = BITSTR_OVERHEAD; word < nwords; word++)
+		b1[word] &= ~b2[word];
+}
+
+/*
+ * b1 &= b2, then count the bits left set in b1
+ *   b1 (IN/OUT)	first string
+ *   b2 (IN)		second bitstring
+ *   RETURN		count of bits set in b1 after the AND
+ */
+int32_t
+bit_and_set_count(bitstr_t *b1, bitstr_t *b2)
+{
+	bitoff_t nbits;
+	int32_t count, full;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8)
-		b1[_bit_word(bit)] &= b2[_bit_word(bit)];
+	nbits = _bitstr_bits(b1);
+	full = nbits >> BITSTR_SHIFT;
+	count = _bit_and_count_words(&b1[BITSTR_OVERHEAD],
+				     &b2[BITSTR_OVERHEAD], full);
+	if (nbits & BITSTR_MAXPOS) {
+		b1[BITSTR_OVERHEAD + full] &= b2[BITSTR_OVERHEAD + full];
+		count += _word_count((ubitstr_t) b1[BITSTR_OVERHEAD + full] &
+				     _bit_tail_mask(nbits));
+	}
+	return count;
 }
 
 /*
@@ -625,12 +1003,13 @@ bit_and(bitstr_t *b1, bitstr_t *b2)
 void
 bit_not(bitstr_t *b)
 {
-	bitoff_t bit;
+	int32_t word, nwords;
 
 	_assert_bitstr_valid(b);
 
-	for (bit = 0; bit < _bitstr_bits(b); bit += sizeof(bitstr_t)*8)
-		b[_bit_word(bit)] = ~b[_bit_word(bit)];
+	nwords = _bitstr_words(_bitstr_bits(b));
+	for (word = BITSTR_OVERHEAD; word < nwords; word++)
+		b[word] = ~b[word];
 }
 
 /*
@@ -641,14 +1020,15 @@ bit_not(bitstr_t *b)
 void
 bit_or(bitstr_t *b1, bitstr_t *b2)
 {
-	bitoff_t bit;
+	int32_t word, nwords;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8)
-		b1[_bit_word(bit)] |= b2[_bit_word(bit)];
+	nwords = _bitstr_words(_bitstr_bits(b1));
+	for (word = BITSTR_OVERHEAD; word < nwords; word++)
+		b1[word] |= b2[word];
 }
 
 
@@ -687,44 +1067,6 @@ bit_copybits(bitstr_t *dest, bitstr_t *src)
 	memcpy(&dest[BITSTR_OVERHEAD], &src[BITSTR_OVERHEAD], len);
 }
 
-#if !defined(USE_64BIT_BITSTR)
-/*
- * Returns the hamming weight (i.e. the number of bits set) in a word.
- * NOTE: This routine borrowed from Linux 2.4.9 <linux/bitops.h>.
- */
-static uint32_t
-hweight(uint32_t w)
-{
-	uint32_t res;
-
-	res = (w   & 0x55555555) + ((w >> 1)    & 0x55555555);
-	res = (res & 0x33333333) + ((res >> 2)  & 0x33333333);
-	res = (res & 0x0F0F0F0F) + ((res >> 4)  & 0x0F0F0F0F);
-	res = (res & 0x00FF00FF) + ((res >> 8)  & 0x00FF00FF);
-	res = (res & 0x0000FFFF) + ((res >> 16) & 0x0000FFFF);
-
-	return res;
-}
-#else
-/*
- * A 64 bit version crafted from 32-bit one borrowed above.
- */
-static uint64_t
-hweight(uint64_t w)
-{
-	uint64_t res;
-
-	res = (w   & 0x5555555555555555) + ((w >> 1)    & 0x5555555555555555);
-	res = (res & 0x3333333333333333) + ((res >> 2)  & 0x3333333333333333);
-	res = (res & 0x0F0F0F0F0F0F0F0F) + ((res >> 4)  & 0x0F0F0F0F0F0F0F0F);
-	res = (res & 0x00FF00FF00FF00FF) + ((res >> 8)  & 0x00FF00FF00FF00FF);
-	res = (res & 0x0000FFFF0000FFFF) + ((res >> 16) & 0x0000FFFF0000FFFF);
-	res = (res & 0x00000000FFFFFFFF) + ((res >> 32) & 0x00000000FFFFFFFF);
-
-	return res;
-}
-#endif /* !USE_64BIT_BITSTR */
-
 /*
  * Count the number of bits set in bitstring.
  *   b (IN)		bitstring to check
@@ -733,19 +1075,17 @@ hweight(uint64_t w)
 int32_t
 bit_set_count(bitstr_t *b)
 {
-	int32_t count = 0;
-	bitoff_t bit, bit_cnt;
-	int32_t word_size = sizeof(bitstr_t) * 8;
+	bitoff_t nbits;
+	int32_t count, full;
 
 	_assert_bitstr_valid(b);
 
-	bit_cnt = _bitstr_bits(b);
-	for (bit = 0; (bit + word_size) <= bit_cnt; bit += word_size) {
-		count += hweight(b[_bit_word(bit)]);
-	}
-	for ( ; bit < bit_cnt; bit++) {
-		if (bit_test(b, bit))
-			count++;
+	nbits = _bitstr_bits(b);
+	full = nbits >> BITSTR_SHIFT;
+	count = _bit_count_words(&b[BITSTR_OVERHEAD], full);
+	if (nbits & BITSTR_MAXPOS) {
+		count += _word_count((ubitstr_t) b[BITSTR_OVERHEAD + full] &
+				     _bit_tail_mask(nbits));
 	}
 	return count;
 }
@@ -773,8 +1113,10 @@ bit_set_count_range(bitstr_t *b, int32_t start, int32_t end)
 		if (bit_test(b, bit))
 			count++;
 	}
-	for (; (bit + word_size) <= end ; bit += word_size) {
-		count += hweight(b[_bit_word(bit)]);
+	if ((bit + word_size) <= end) {
+		count += _bit_count_words(&b[_bit_word(bit)],
+					  (end - bit) >> BITSTR_SHIFT);
+		bit += ((end - bit) >> BITSTR_SHIFT) << BITSTR_SHIFT;
 	}
 	for ( ; bit < end; bit++) {
 		if (bit_test(b, bit))
@@ -790,28 +1132,52 @@ bit_set_count_range(bitstr_t *b, int32_t start, int32_t end)
 extern int32_t
 bit_overlap(bitstr_t *b1, bitstr_t *b2)
 {
-	int32_t count = 0;
-	bitoff_t bit, bit_cnt;
-	int32_t word_size = sizeof(bitstr_t) * 8;
+	bitoff_t nbits;
+	int32_t count, full;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	bit_cnt = _bitstr_bits(b1);
-	for (bit = 0; bit < bit_cnt; bit += word_size) {
-		if ((bit + word_size - 1) >= bit_cnt)
-			break;
-		count += hweight(b1[_bit_word(bit)] & b2[_bit_word(bit)]);
+	nbits = _bitstr_bits(b1);
+	full = nbits >> BITSTR_SHIFT;
+	count = _bit_count_and_words(&b1[BITSTR_OVERHEAD],
+				     &b2[BITSTR_OVERHEAD], full);
+	if (nbits & BITSTR_MAXPOS) {
+		count += _word_count((ubitstr_t) (b1[BITSTR_OVERHEAD + full] &
+						  b2[BITSTR_OVERHEAD + full]) &
+				     _bit_tail_mask(nbits));
 	}
-	for ( ; bit < bit_cnt; bit++) {
-		if (bit_test(b1, bit) && bit_test(b2, bit))
-			count++;
-	}
-
 	return count;
 }
 
+/*
+ * return 1 if any bit set in b1 is also set in b2, 0 otherwise
+ * Stops at the first common bit, use in place of bit_overlap() when
+ * the count is not needed
+ */
+extern int
+bit_overlap_any(bitstr_t *b1, bitstr_t *b2)
+{
+	bitoff_t nbits;
+	int32_t word, full;
+
+	_assert_bitstr_valid(b1);
+	_assert_bitstr_valid(b2);
+	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
+
+	nbits = _bitstr_bits(b1);
+	full = (nbits >> BITSTR_SHIFT) + BITSTR_OVERHEAD;
+	for (word = BITSTR_OVERHEAD; word < full; word++) {
+		if (b1[word] & b2[word])
+			return 1;
+	}
+	if ((nbits & BITSTR_MAXPOS) &&
+	    ((ubitstr_t) (b1[full] & b2[full]) & _bit_tail_mask(nbits)))
+		return 1;
+	return 0;
+}
+
 /*
  * Count the number of bits clear in bitstring.
  *   b (IN)		bitstring to check
@@ -1057,6 +1423,64 @@ bit_fmt(char *str, int32_t len, bitstr_t *b)
 	return str;
 }
 
+/*
+ * Convert to range string format, e.g. 0-5,42, with no length limit.
+ * Words with all bits clear or all bits set are skipped whole, so the
+ * time taken depends upon the number of ranges rather than bitmap size.
+ *   b (IN)		bitstring to format
+ *   RETURN		formatted string, caller must xfree
+ */
+char *
+bit_fmt_full(bitstr_t *b)
+{
+	bitoff_t bit = 0, start, nbits;
+	int32_t len = 0, size = 64, ret;
+	char *str;
+
+	_assert_bitstr_valid(b);
+	nbits = _bitstr_bits(b);
+	str = xmalloc(size);
+	while (bit < nbits) {
+		if (((bit & BITSTR_MAXPOS) == 0) && (b[_bit_word(bit)] == 0)) {
+			bit += BITSTR_MAXPOS + 1;
+			continue;
+		}
+		if (!bit_test(b, bit)) {
+			bit++;
+			continue;
+		}
+		start = bit++;
+		while (bit < nbits) {
+			if (((bit & BITSTR_MAXPOS) == 0) &&
+			    ((bit + BITSTR_MAXPOS) < nbits) &&
+			    (b[_bit_word(bit)] == (bitstr_t) -1)) {
+				bit += BITSTR_MAXPOS + 1;
+				continue;
+			}
+			if (!bit_test(b, bit))
+				break;
+			bit++;
+		}
+		/* Bits start through (bit - 1) are set */
+		if ((size - len) < 64) {
+			size *= 2;
+			xrealloc(str, size);
+		}
+		if (start == (bit - 1)) {
+			ret = snprintf(str + len, size - len,
+				       BITSTR_SINGLE_FMT, start);
+		} else {
+			ret = snprintf(str + len, size - len,
+				       BITSTR_RANGE_FMT, start, bit - 1);
+		}
+		assert((ret > 0) && (ret < (size - len)));
+		len += ret;
+	}
+	if (len > 0)
+		str[len - 1] = '\0';	/* zap trailing comma */
+	return str;
+}
+
 /*
  * Convert range string format, e.g. "0-5,42" to bitmap
  * Ret 0 on success, -1 on error
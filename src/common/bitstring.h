@@ -124,7 +124,13 @@ bitoff_t bit_noc(bitstr_t *b, int32_t n, int32_t seed);
 void	bit_free(bitstr_t *b);
 bitstr_t *bit_realloc(bitstr_t *b, bitoff_t nbits);
 bitoff_t bit_size(bitstr_t *b);
+bitstr_t *bit_scratch_alloc(bitoff_t nbits);
+bitstr_t *bit_scratch_copy(bitstr_t *b);
+void	bit_scratch_free(bitstr_t *b);
+void	bit_scratch_purge(void);
 void	bit_and(bitstr_t *b1, bitstr_t *b2);
+void	bit_and_not(bitstr_t *b1, bitstr_t *b2);
+int32_t	bit_and_set_count(bitstr_t *b1, bitstr_t *b2);
 void	bit_not(bitstr_t *b);
 void	bit_or(bitstr_t *b1, bitstr_t *b2);
 int32_t	bit_set_count(bitstr_t *b);
@@ -135,6 +141,7 @@ int32_t	bit_nset_max_count(bitstr_t *b);
 bitstr_t *bit_rotate_copy(bitstr_t *b1, int32_t n, bitoff_t nbits);
 void	bit_rotate(bitstr_t *b1, int32_t n);
 char	*bit_fmt(char *str, int32_t len, bitstr_t *b);
+char	*bit_fmt_full(bitstr_t *b);
 int	bit_unfmt(bitstr_t *b, char *str);
 int32_t	*bitfmt2int (char *bit_str_ptr);
 char *  inx2bitfmt (int32_t *inx);
@@ -147,6 +154,7 @@ bitoff_t bit_fls(bitstr_t *b);
 void	bit_fill_gaps(bitstr_t *b);
 int	bit_super_set(bitstr_t *b1, bitstr_t *b2);
 int     bit_overlap(bitstr_t *b1, bitstr_t *b2);
+int     bit_overlap_any(bitstr_t *b1, bitstr_t *b2);
 int     bit_equal(bitstr_t *b1, bitstr_t *b2);
 void    bit_copybits(bitstr_t *dest, bitstr_t *src);
 bitstr_t *bit_copy(bitstr_t *b);
@@ -160,5 +168,11 @@ int32_t	bit_get_pos_num(bitstr_t *b, bitoff_t pos);
 		_X	= NULL; 	\
 	} while (0)
 
+#define FREE_NULL_SCRATCH_BITMAP(_X)		\
+	do {					\
+		if (_X) bit_scratch_free (_X);	\
+		_X	= NULL; 		\
+	} while (0)
+
 
 #endif /* !_BITSTRING_H_ */
@@ -0,0 +1,262 @@
+/*****************************************************************************\
+ *  id_hash.c - hash table of pointers keyed by 64-bit integer IDs
+ *****************************************************************************
+ *  Copyright (C) 2015 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "src/common/id_hash.h"
+#include "src/common/xassert.h"
+#include "src/common/xmalloc.h"
+
+#define ID_HASH_MAGIC		0x1d4a5e
+/* Smallest table size, must be a power of two */
+#define ID_HASH_MIN_SIZE	64
+/* Slots of the old table to move with each add or remove while resizing */
+#define ID_HASH_MOVE_CNT	32
+
+typedef struct {
+	uint64_t key;
+	void *item;		/* NULL if empty, id_hash_deleted if removed */
+} id_hash_slot_t;
+
+struct id_hash {
+#ifndef NDEBUG
+	int magic;
+#endif
+	uint32_t count;		/* items in slots */
+	uint32_t size;		/* slot count, a power of two */
+	id_hash_slot_t *slots;
+	uint32_t old_count;	/* items not yet moved from old_slots */
+	uint32_t old_inx;	/* next old_slots index to move */
+	uint32_t old_size;
+	id_hash_slot_t *old_slots; /* table being resized, or NULL */
+};
+
+/* Marks a removed or moved entry of old_slots. Probes of the old table must
+ * continue past such slots, but it never receives new entries. */
+static char id_hash_deleted;
+#define ID_HASH_DELETED ((void *) &id_hash_deleted)
+
+static inline uint32_t _slot_inx(uint64_t key, uint32_t size)
+{
+	/* Mix the bits so sequential IDs do not form long probe runs */
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+	return (uint32_t) key & (size - 1);
+}
+
+/* RET index of the slot holding key or -1 if not found */
+static int64_t _find_slot(id_hash_slot_t *slots, uint32_t size, uint64_t key)
+{
+	uint32_t inx = _slot_inx(key, size);
+
+	while (slots[inx].item) {
+		if ((slots[inx].key == key) &&
+		    (slots[inx].item != ID_HASH_DELETED))
+			return inx;
+		inx = (inx + 1) & (size - 1);
+	}
+	return -1;
+}
+
+/* Insert a key known not to be present in the new table */
+static void _insert_slot(id_hash_t *table, uint64_t key, void *item)
+{
+	uint32_t inx = _slot_inx(key, table->size);
+
+	while (table->slots[inx].item)
+		inx = (inx + 1) & (table->size - 1);
+	table->slots[inx].key  = key;
+	table->slots[inx].item = item;
+	table->count++;
+}
+
+/* Remove the entry at slot inx of the new table, shifting back later
+ * entries of the same probe run so that no tombstone is needed */
+static void _delete_slot(id_hash_t *table, uint32_t inx)
+{
+	uint32_t mask = table->size - 1, next = inx, home;
+
+	while (1) {
+		next = (next + 1) & mask;
+		if (!table->slots[next].item)
+			break;
+		home = _slot_inx(table->slots[next].key, table->size);
+		/* Move the entry unless its home slot lies cyclically
+		 * within (inx, next] */
+		if ((inx <= next) ?
+		    ((home <= inx) || (home > next)) :
+		    ((home <= inx) && (home > next))) {
+			table->slots[inx] = table->slots[next];
+			inx = next;
+		}
+	}
+	table->slots[inx].item = NULL;
+	table->count--;
+}
+
+/* Move up to cnt slots of the old table into the new table */
+static void _move_old_slots(id_hash_t *table, uint32_t cnt)
+{
+	id_hash_slot_t *slot;
+
+	while (table->old_slots && cnt--) {
+		slot = &table->old_slots[table->old_inx++];
+		if (slot->item && (slot->item != ID_HASH_DELETED)) {
+			_insert_slot(table, slot->key, slot->item);
+			slot->item = ID_HASH_DELETED;
+			table->old_count--;
+		}
+		if (table->old_inx >= table->old_size) {
+			xfree(table->old_slots);
+			table->old_size = 0;
+			table->old_count = 0;
+		}
+	}
+}
+
+/* Start moving all entries into a table of twice the size */
+static void _grow(id_hash_t *table)
+{
+	/* Finish any resize in progress */
+	if (table->old_slots)
+		_move_old_slots(table, table->old_size);
+
+	table->old_slots = table->slots;
+	table->old_size  = table->size;
+	table->old_count = table->count;
+	table->old_inx   = 0;
+	table->size     *= 2;
+	table->slots     = xmalloc(sizeof(id_hash_slot_t) * table->size);
+	table->count     = 0;
+}
+
+extern id_hash_t *id_hash_init(uint32_t count)
+{
+	id_hash_t *table = xmalloc(sizeof(id_hash_t));
+	uint64_t size = ID_HASH_MIN_SIZE;
+
+	/* Keep the table at most 3/4 full */
+	while ((size * 3 / 4) < count)
+		size *= 2;
+	table->size  = size;
+	table->slots = xmalloc(sizeof(id_hash_slot_t) * table->size);
+	xassert(table->magic = ID_HASH_MAGIC);
+
+	return table;
+}
+
+extern void id_hash_free(id_hash_t *table)
+{
+	if (!table)
+		return;
+	xassert(table->magic == ID_HASH_MAGIC);
+	xassert(table->magic = ~ID_HASH_MAGIC);
+	xfree(table->old_slots);
+	xfree(table->slots);
+	xfree(table);
+}
+
+extern void *id_hash_add(id_hash_t *table, uint64_t key, void *item)
+{
+	void *old_item = NULL;
+	int64_t inx;
+
+	xassert(table->magic == ID_HASH_MAGIC);
+	xassert(item);
+
+	_move_old_slots(table, ID_HASH_MOVE_CNT);
+	if ((inx = _find_slot(table->slots, table->size, key)) >= 0) {
+		old_item = table->slots[inx].item;
+		table->slots[inx].item = item;
+		return old_item;
+	}
+	if (table->old_slots &&
+	    ((inx = _find_slot(table->old_slots, table->old_size, key)) >= 0)) {
+		old_item = table->old_slots[inx].item;
+		table->old_slots[inx].item = ID_HASH_DELETED;
+		table->old_count--;
+	}
+
+	if (((uint64_t) table->count + table->old_count + 1) * 4 >
+	    ((uint64_t) table->size * 3))
+		_grow(table);
+	_insert_slot(table, key, item);
+
+	return old_item;
+}
+
+extern void *id_hash_find(id_hash_t *table, uint64_t key)
+{
+	int64_t inx;
+
+	xassert(table->magic == ID_HASH_MAGIC);
+
+	if ((inx = _find_slot(table->slots, table->size, key)) >= 0)
+		return table->slots[inx].item;
+	if (table->old_slots &&
+	    ((inx = _find_slot(table->old_slots, table->old_size, key)) >= 0))
+		return table->old_slots[inx].item;
+	return NULL;
+}
+
+extern void *id_hash_remove(id_hash_t *table, uint64_t key)
+{
+	void *item = NULL;
+	int64_t inx;
+
+	xassert(table->magic == ID_HASH_MAGIC);
+
+	_move_old_slots(table, ID_HASH_MOVE_CNT);
+	if ((inx = _find_slot(table->slots, table->size, key)) >= 0) {
+		item = table->slots[inx].item;
+		_delete_slot(table, inx);
+	} else if (table->old_slots &&
+		   ((inx = _find_slot(table->old_slots, table->old_size,
+				      key)) >= 0)) {
+		item = table->old_slots[inx].item;
+		table->old_slots[inx].item = ID_HASH_DELETED;
+		table->old_count--;
+	}
+
+	return item;
+}
+
+extern uint32_t id_hash_count(id_hash_t *table)
+{
+	xassert(table->magic == ID_HASH_MAGIC);
+
+	return table->count + table->old_count;
+}
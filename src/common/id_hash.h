@@ -0,0 +1,82 @@
+/*****************************************************************************\
+ *  id_hash.h - hash table of pointers keyed by 64-bit integer IDs
+ *****************************************************************************
+ *  Copyright (C) 2015 SchedMD LLC.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <http://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _ID_HASH_H
+#define _ID_HASH_H
+
+#if HAVE_CONFIG_H
+#  include "config.h"
+#  if HAVE_INTTYPES_H
+#    include <inttypes.h>
+#  else
+#    if HAVE_STDINT_H
+#      include <stdint.h>
+#    endif
+#  endif  /* HAVE_INTTYPES_H */
+#else   /* !HAVE_CONFIG_H */
+#  include <inttypes.h>
+#endif  /*  HAVE_CONFIG_H */
+
+/*
+ * An open addressing (linear probing) hash table mapping unique 64-bit keys
+ * to non-NULL pointers. The table doubles in size as it fills, moving a few
+ * entries from the old table with each subsequent add or remove so that no
+ * single operation pays for rehashing the whole table.
+ *
+ * The table has no internal locking, callers must serialize updates.
+ */
+typedef struct id_hash id_hash_t;
+
+/* Create a table sized for at least "count" entries without resizing */
+extern id_hash_t *id_hash_init(uint32_t count);
+
+/* Free a table, the items it references are not freed */
+extern void id_hash_free(id_hash_t *table);
+
+/* Add item with the given key, replacing any item with the same key.
+ * RET the replaced item or NULL */
+extern void *id_hash_add(id_hash_t *table, uint64_t key, void *item);
+
+/* RET the item with the given key or NULL if not found */
+extern void *id_hash_find(id_hash_t *table, uint64_t key);
+
+/* Remove the item with the given key.
+ * RET the removed item or NULL if not found */
+extern void *id_hash_remove(id_hash_t *table, uint64_t key);
+
+/* RET the number of items in the table */
+extern uint32_t id_hash_count(id_hash_t *table);
+
+#endif /* !_ID_HASH_H */
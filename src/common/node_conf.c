@@ -73,6 +73,8 @@
 #include "src/common/slurm_acct_gather_energy.h"
 #include "src/common/slurm_ext_sensors.h"
 #include "src/common/slurm_topology.h"
+#include "src/common/strnatcmp.h"
+#include "src/common/working_cluster.h"
 #include "src/common/xassert.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
@@ -91,19 +93,62 @@ int node_record_count = 0;		/* count in node_record_table_ptr */
 uint16_t *cr_node_num_cores = NULL;
 uint32_t *cr_node_cores_offset = NULL;
 
+/* A run of consecutive node records named <prefix><number>, with numbers
+ * increasing by one. Built by rehash_node() so that node_name2bitmap() can
+ * map a range such as "tux[1-1024]" onto a bit range without expanding it
+ * into host names. */
+typedef struct node_name_run {
+	char *prefix;		/* node name less its numeric suffix */
+	int prefix_len;
+	uint16_t width;		/* suffix digit count if zero padded, else 0 */
+	uint32_t first_num;	/* numeric suffix of first node in run */
+	uint32_t last_num;	/* numeric suffix of last node in run */
+	int first_inx;		/* node table index of first node in run */
+	int prefix_id;		/* rank of prefix in hostlist sort order */
+	uint16_t print_width;	/* digits hostlist prints for the prefix */
+} node_name_run_t;
+
+/* Output state of _bitmap2node_name_fast() */
+typedef struct node_name_enc {
+	char *buf;
+	int size;
+	int len;
+	int prefix_id;		/* prefix of the open bracket, -1 if none */
+	int bracket_pos;	/* offset of its '[' in buf */
+	int range_cnt;		/* ranges written into the open bracket */
+	bool single;		/* first of those ranges is a single node */
+} node_name_enc_t;
+
+static node_name_run_t *node_name_runs = NULL;
+static int node_name_run_cnt = 0;
+static struct node_record *node_name_runs_table = NULL;
+static int node_name_runs_rec_cnt = 0;
+/* Run indexes in node table order and in hostlist sort order, set only if
+ * bitmap2node_name() can be built from the runs (see _build_node_name_enc) */
+static int *node_name_runs_by_inx = NULL;
+static int *node_name_runs_by_name = NULL;
+
 static void	_add_config_feature(char *feature, bitstr_t *node_bitmap);
+static char *	_bitmap2node_name_fast(bitstr_t *bitmap, bool sort);
 static int	_build_single_nodeline_info(slurm_conf_node_t *node_ptr,
 					    struct config_record *config_ptr);
 static int	_delete_config_record (void);
 #if _DEBUG
 static void	_dump_hash (void);
 #endif
+static void	_build_node_name_enc(void);
+static void	_build_node_name_runs(void);
 static struct node_record *_find_alias_node_record (char *name);
 static struct node_record *_find_node_record (char *name, bool test_alias);
+static void	_free_node_name_runs(void);
 static void	_list_delete_config (void *config_entry);
 static void	_list_delete_feature (void *feature_entry);
 static int	_list_find_config (void *config_entry, void *key);
 static int	_list_find_feature (void *feature_entry, void *key);
+static bool	_node_name2bitmap_fast(char *node_names, bitstr_t *bitmap);
+static bool	_set_node_name_range(bitstr_t *bitmap, char *prefix,
+				     int prefix_len, uint32_t lo, uint32_t hi,
+				     uint16_t width);
 
 
 static void _add_config_feature(char *feature, bitstr_t *node_bitmap)
@@ -479,6 +524,117 @@ hostlist_t bitmap2hostlist (bitstr_t *bitmap) {
 
 }
 
+/* Make room in the encoder buffer for at least len more bytes */
+static void _enc_reserve(node_name_enc_t *enc, int len)
+{
+	if ((enc->len + len) < enc->size)
+		return;
+	while ((enc->len + len) >= enc->size)
+		enc->size *= 2;
+	xrealloc_nz(enc->buf, enc->size);
+}
+
+/* Close the open bracket, dropping it if it holds only one node */
+static void _enc_close(node_name_enc_t *enc)
+{
+	char *bracket;
+
+	if (enc->prefix_id == -1)
+		return;
+	if ((enc->range_cnt == 1) && enc->single) {
+		bracket = enc->buf + enc->bracket_pos;
+		memmove(bracket, bracket + 1, enc->len - enc->bracket_pos - 1);
+		enc->len--;
+	} else
+		enc->buf[enc->len++] = ']';
+	enc->prefix_id = -1;
+}
+
+/* Append the nodes named <run prefix><lo..hi> as hostlist would print them:
+ * ranges with a common prefix share one bracketed list */
+static void _enc_range(node_name_enc_t *enc, node_name_run_t *run,
+		       uint32_t lo, uint32_t hi)
+{
+	_enc_reserve(enc, run->prefix_len + 32);
+	if (enc->prefix_id == run->prefix_id) {
+		enc->buf[enc->len++] = ',';
+	} else {
+		_enc_close(enc);
+		if (enc->len)
+			enc->buf[enc->len++] = ',';
+		memcpy(enc->buf + enc->len, run->prefix, run->prefix_len);
+		enc->len += run->prefix_len;
+		enc->bracket_pos = enc->len;
+		enc->buf[enc->len++] = '[';
+		enc->prefix_id = run->prefix_id;
+		enc->range_cnt = 0;
+		enc->single = (lo == hi);
+	}
+	enc->len += sprintf(enc->buf + enc->len, "%0*u",
+			    (int) run->print_width, lo);
+	if (hi > lo) {
+		enc->len += sprintf(enc->buf + enc->len, "-%0*u",
+				    (int) run->print_width, hi);
+	}
+	enc->range_cnt++;
+}
+
+/*
+ * _bitmap2node_name_fast - build the same string as
+ *	hostlist_ranged_string_xmalloc() would for the nodes in bitmap,
+ *	working directly from the node name runs rather than a hostlist
+ * RET xmalloc'ed string or NULL if the runs can not be used
+ */
+static char *_bitmap2node_name_fast(bitstr_t *bitmap, bool sort)
+{
+	node_name_enc_t enc;
+	node_name_run_t *run, *range_run = NULL;
+	int *order;
+	int first_bit, last_bit, i, k, start, end;
+	uint32_t num, lo = 0, hi = 0;
+
+	if (!node_name_runs_by_inx ||
+	    (node_name_runs_table != node_record_table_ptr) ||
+	    (node_name_runs_rec_cnt != node_record_count) ||
+	    (slurmdb_setup_cluster_name_dims() > 1) || is_cray_system())
+		return NULL;
+	if ((first_bit = bit_ffs(bitmap)) == -1)
+		return NULL;
+	last_bit = bit_fls(bitmap);
+
+	enc.size = 256;
+	enc.buf = xmalloc_nz(enc.size);
+	enc.len = 0;
+	enc.prefix_id = -1;
+	order = sort ? node_name_runs_by_name : node_name_runs_by_inx;
+	for (k = 0; k < node_name_run_cnt; k++) {
+		run = &node_name_runs[order[k]];
+		start = run->first_inx;
+		end = start + (run->last_num - run->first_num);
+		if ((end < first_bit) || (start > last_bit))
+			continue;
+		for (i = MAX(start, first_bit); i <= MIN(end, last_bit); i++) {
+			if (!bit_test(bitmap, i))
+				continue;
+			num = run->first_num + (i - start);
+			if (range_run && (num == (hi + 1)) &&
+			    (range_run->prefix_id == run->prefix_id)) {
+				hi = num;
+				continue;
+			}
+			if (range_run)
+				_enc_range(&enc, range_run, lo, hi);
+			range_run = run;
+			lo = hi = num;
+		}
+	}
+	_enc_range(&enc, range_run, lo, hi);
+	_enc_close(&enc);
+	enc.buf[enc.len] = '\0';
+
+	return enc.buf;
+}
+
 /*
  * bitmap2node_name_sortable - given a bitmap, build a list of comma
  *	separated node names. names may include regular expressions
@@ -494,6 +650,8 @@ char * bitmap2node_name_sortable (bitstr_t *bitmap, bool sort)
 	hostlist_t hl;
 	char *buf;
 
+	if (bitmap && (buf = _bitmap2node_name_fast(bitmap, sort)))
+		return buf;
 	hl = bitmap2hostlist (bitmap);
 	if (hl == NULL)
 		return xstrdup("");
@@ -920,6 +1078,7 @@ extern void node_fini2 (void)
 	}
 
 	xhash_free(node_hash_table);
+	_free_node_name_runs();
 	node_ptr = node_record_table_ptr;
 	for (i=0; i< node_record_count; i++, node_ptr++)
 		purge_node_rec(node_ptr);
@@ -929,6 +1088,224 @@ extern void node_fini2 (void)
 }
 
 
+/* Return the number of decimal digits needed to print num */
+static uint16_t _num_digits(uint32_t num)
+{
+	uint16_t digits = 1;
+
+	while (num >= 10) {
+		num /= 10;
+		digits++;
+	}
+	return digits;
+}
+
+/* Return the smallest number printed with at least width digits */
+static uint32_t _min_num_of_width(uint16_t width)
+{
+	uint32_t num = 1;
+
+	if (width <= 1)
+		return 0;
+	while (--width)
+		num *= 10;
+	return num;
+}
+
+/* Parse up to 9 decimal digits at *str, advancing *str past them.
+ * RET false if there are no digits or too many */
+static bool _parse_name_num(char **str, uint32_t *num, uint16_t *digits)
+{
+	char *p = *str;
+	uint32_t val = 0;
+	uint16_t cnt = 0;
+
+	while (isdigit((int) *p)) {
+		if (++cnt > 9)
+			return false;
+		val = (val * 10) + (*p - '0');
+		p++;
+	}
+	if (cnt == 0)
+		return false;
+	*num = val;
+	if (digits)
+		*digits = cnt;
+	*str = p;
+	return true;
+}
+
+/* Compare a run's prefix with the first prefix_len characters of prefix,
+ * ordering runs the same way as strcmp() */
+static int _cmp_run_prefix(node_name_run_t *run, char *prefix, int prefix_len)
+{
+	int rc = strncmp(run->prefix, prefix, prefix_len);
+
+	if (rc == 0)
+		rc = (run->prefix_len > prefix_len) ? 1 : 0;
+	return rc;
+}
+
+/*
+ * _set_node_name_range - set in bitmap the nodes named <prefix><lo..hi>,
+ *	each number zero padded to width digits as a hostlist would print it
+ * RET false if any of those names is not part of a node name run
+ */
+static bool _set_node_name_range(bitstr_t *bitmap, char *prefix,
+				 int prefix_len, uint32_t lo, uint32_t hi,
+				 uint16_t width)
+{
+	node_name_run_t *run;
+	int class_start[4], class_end[4], class_cnt = 0;
+	int first, last, mid, i, j, run_inx;
+	uint32_t cur, end, min_num;
+
+	/* Locate the runs with this prefix, then split them by suffix width.
+	 * Within a width the runs are sorted and do not overlap. */
+	first = 0;
+	last = node_name_run_cnt;
+	while (first < last) {
+		mid = (first + last) / 2;
+		if (_cmp_run_prefix(&node_name_runs[mid], prefix,
+				    prefix_len) < 0)
+			first = mid + 1;
+		else
+			last = mid;
+	}
+	for (i = first; (i < node_name_run_cnt) &&
+		     !_cmp_run_prefix(&node_name_runs[i], prefix, prefix_len);
+	     i = j) {
+		if (class_cnt >= 4)
+			return false;
+		for (j = i + 1; (j < node_name_run_cnt) &&
+			     (node_name_runs[j].width == node_name_runs[i].width) &&
+			     !_cmp_run_prefix(&node_name_runs[j], prefix,
+					      prefix_len); j++)
+			;
+		class_start[class_cnt] = i;
+		class_end[class_cnt++] = j;
+	}
+
+	for (cur = lo; cur <= hi; cur = end + 1) {
+		run = NULL;
+		for (i = 0; i < class_cnt; i++) {
+			/* find the last run starting at or before cur */
+			first = class_start[i];
+			last  = class_end[i];
+			while ((last - first) > 1) {
+				mid = (first + last) / 2;
+				if (node_name_runs[mid].first_num <= cur)
+					first = mid;
+				else
+					last = mid;
+			}
+			run = &node_name_runs[first];
+			if ((run->first_num > cur) || (run->last_num < cur)) {
+				run = NULL;
+				continue;
+			}
+			/* the printed name must have as many digits as the
+			 * node names of this run */
+			if (run->width == 0)
+				min_num = _min_num_of_width(width);
+			else if (width == run->width)
+				min_num = 0;
+			else if (width < run->width)
+				min_num = _min_num_of_width(run->width);
+			else
+				min_num = NO_VAL;
+			if (min_num <= cur)
+				break;
+			run = NULL;
+		}
+		if (!run)
+			return false;
+		end = MIN(hi, run->last_num);
+		run_inx = run->first_inx - run->first_num;
+		bit_nset(bitmap, run_inx + cur, run_inx + end);
+	}
+	return true;
+}
+
+/*
+ * _node_name2bitmap_fast - set the bits of node_names using the node name
+ *	runs built by rehash_node(), without expanding it into host names.
+ *	Handles a comma separated list of names and "prefix[ranges]"
+ *	expressions, where ranges are numbers and "lo-hi" pairs.
+ * RET false if node_names must be resolved through a hostlist instead
+ *	(other syntax, names that are not node names, aliases)
+ */
+static bool _node_name2bitmap_fast(char *node_names, bitstr_t *bitmap)
+{
+	struct node_record *node_ptr;
+	char *p = node_names, *prefix, name[64];
+	int prefix_len;
+	uint32_t lo, hi;
+	uint16_t width;
+
+	if (!node_hash_table ||
+	    (node_name_runs_table != node_record_table_ptr) ||
+	    (node_name_runs_rec_cnt != node_record_count) ||
+	    (slurmdb_setup_cluster_name_dims() > 1))
+		return false;
+
+	while (*p) {
+		prefix = p;
+		while (*p && (*p != '[') && (*p != ',')) {
+			if ((*p == ']') || isspace((int) *p))
+				return false;
+			p++;
+		}
+		prefix_len = p - prefix;
+		if (prefix_len == 0)
+			return false;
+		if (*p != '[') {
+			/* single node name */
+			if (prefix_len >= sizeof(name))
+				return false;
+			memcpy(name, prefix, prefix_len);
+			name[prefix_len] = '\0';
+			node_ptr = xhash_get(node_hash_table, name);
+			if (!node_ptr)
+				return false;
+			bit_set(bitmap, (bitoff_t) (node_ptr -
+						    node_record_table_ptr));
+		} else {
+			p++;
+			while (1) {
+				if (!_parse_name_num(&p, &lo, &width))
+					return false;
+				hi = lo;
+				if (*p == '-') {
+					p++;
+					if (!_parse_name_num(&p, &hi, NULL))
+						return false;
+				}
+				/* hostlist rejects more than 64K per range */
+				if ((lo > hi) || ((hi - lo) >= (64 * 1024)))
+					return false;
+				if (!_set_node_name_range(bitmap, prefix,
+							  prefix_len, lo, hi,
+							  width))
+					return false;
+				if (*p == ']')
+					break;
+				if (*p++ != ',')
+					return false;
+			}
+			p++;
+			if (*p && (*p != ','))
+				return false;
+		}
+		if (*p == ',') {
+			p++;
+			if (*p == '\0')
+				return false;
+		}
+	}
+	return true;
+}
+
 /*
  * node_name2bitmap - given a node name regular expression, build a bitmap
  *	representation
@@ -954,6 +1331,11 @@ extern int node_name2bitmap (char *node_names, bool best_effort,
 		return rc;
 	}
 
+	if (_node_name2bitmap_fast(node_names, my_bitmap))
+		return rc;
+	if (node_record_count)
+		bit_nclear(my_bitmap, 0, node_record_count - 1);
+
 	if ( (host_list = hostlist_create (node_names)) == NULL) {
 		/* likely a badly formatted hostlist */
 		error ("hostlist_create on %s error:", node_names);
@@ -1060,6 +1442,7 @@ extern void rehash_node (void)
 			continue;	/* vestigial record */
 		xhash_add(node_hash_table, node_ptr);
 	}
+	_build_node_name_runs();
 
 #if _DEBUG
 	_dump_hash();
@@ -1067,6 +1450,193 @@ extern void rehash_node (void)
 	return;
 }
 
+static int _cmp_node_name_run(const void *a, const void *b)
+{
+	const node_name_run_t *run_a = (const node_name_run_t *) a;
+	const node_name_run_t *run_b = (const node_name_run_t *) b;
+	int rc;
+
+	rc = strcmp(run_a->prefix, run_b->prefix);
+	if (rc)
+		return rc;
+	if (run_a->width != run_b->width)
+		return (run_a->width < run_b->width) ? -1 : 1;
+	if (run_a->first_num != run_b->first_num)
+		return (run_a->first_num < run_b->first_num) ? -1 : 1;
+	return 0;
+}
+
+/* Build the node name runs used by node_name2bitmap() from the current
+ * node table: consecutive records whose names share a prefix and have
+ * numeric suffixes increasing by one, printed with the same padding */
+static void _build_node_name_runs(void)
+{
+	struct node_record *node_ptr = node_record_table_ptr;
+	node_name_run_t *run = NULL;
+	int i, len, prefix_len, run_size = 0;
+	uint32_t num;
+	uint16_t digits, width;
+	char *tmp;
+
+	_free_node_name_runs();
+	for (i = 0; i < node_record_count; i++, node_ptr++) {
+		if ((node_ptr->name == NULL) || (node_ptr->name[0] == '\0')) {
+			run = NULL;
+			continue;
+		}
+		len = strlen(node_ptr->name);
+		for (prefix_len = len; prefix_len > 0; prefix_len--) {
+			if (!isdigit((int) node_ptr->name[prefix_len - 1]))
+				break;
+		}
+		tmp = node_ptr->name + prefix_len;
+		if ((prefix_len == 0) || (prefix_len == len) ||
+		    !_parse_name_num(&tmp, &num, &digits)) {
+			run = NULL;
+			continue;
+		}
+		/* width is 0 unless the suffix has leading zeros */
+		width = (digits > _num_digits(num)) ? digits : 0;
+		if (run && (num == (run->last_num + 1)) &&
+		    (prefix_len == run->prefix_len) &&
+		    !strncmp(node_ptr->name, run->prefix, prefix_len) &&
+		    ((width == run->width) ||
+		     ((width == 0) && (digits == run->width)))) {
+			run->last_num = num;
+			continue;
+		}
+		if (node_name_run_cnt >= run_size) {
+			run_size = MAX(run_size * 2, 16);
+			xrealloc(node_name_runs,
+				 run_size * sizeof(node_name_run_t));
+		}
+		run = &node_name_runs[node_name_run_cnt++];
+		run->prefix     = xstrndup(node_ptr->name, prefix_len);
+		run->prefix_len = prefix_len;
+		run->width      = width;
+		run->first_num  = num;
+		run->last_num   = num;
+		run->first_inx  = i;
+	}
+	if (node_name_run_cnt > 1) {
+		qsort(node_name_runs, node_name_run_cnt,
+		      sizeof(node_name_run_t), _cmp_node_name_run);
+	}
+	node_name_runs_table   = node_record_table_ptr;
+	node_name_runs_rec_cnt = node_record_count;
+	_build_node_name_enc();
+}
+
+static int _cmp_run_inx(const void *a, const void *b)
+{
+	node_name_run_t *run_a = &node_name_runs[*(const int *) a];
+	node_name_run_t *run_b = &node_name_runs[*(const int *) b];
+
+	return run_a->first_inx - run_b->first_inx;
+}
+
+static int _cmp_run_prefix_nat(const void *a, const void *b)
+{
+	node_name_run_t *run_a = &node_name_runs[*(const int *) a];
+	node_name_run_t *run_b = &node_name_runs[*(const int *) b];
+
+	return strnatcmp(run_a->prefix, run_b->prefix);
+}
+
+static int _cmp_run_name(const void *a, const void *b)
+{
+	node_name_run_t *run_a = &node_name_runs[*(const int *) a];
+	node_name_run_t *run_b = &node_name_runs[*(const int *) b];
+
+	if (run_a->prefix_id != run_b->prefix_id)
+		return run_a->prefix_id - run_b->prefix_id;
+	if (run_a->first_num != run_b->first_num)
+		return (run_a->first_num < run_b->first_num) ? -1 : 1;
+	return 0;
+}
+
+/* Set up the run orderings used by _bitmap2node_name_fast(). This is only
+ * done if every node is part of a run and hostlist can combine all names
+ * with a given prefix into one bracketed list: either none is zero padded,
+ * or all are padded to one width and the others are no shorter (e.g.
+ * "tux[01-100]"). */
+static void _build_node_name_enc(void)
+{
+	node_name_run_t *run;
+	int *groups;
+	int i, j, k, group_cnt = 0, node_cnt = 0;
+	uint16_t width;
+
+	for (i = 0; i < node_name_run_cnt; i++) {
+		run = &node_name_runs[i];
+		node_cnt += run->last_num - run->first_num + 1;
+	}
+	if ((node_cnt != node_record_count) || (node_cnt == 0))
+		return;
+
+	/* Runs with a common prefix are adjacent, padded ones last */
+	groups = xmalloc(sizeof(int) * node_name_run_cnt);
+	for (i = 0; i < node_name_run_cnt; i = j) {
+		for (j = i + 1; (j < node_name_run_cnt) &&
+			     !strcmp(node_name_runs[j].prefix,
+				     node_name_runs[i].prefix); j++)
+			;
+		width = node_name_runs[j - 1].width;
+		for (k = i; k < j; k++) {
+			run = &node_name_runs[k];
+			if ((run->width != width) && ((run->width != 0) ||
+			    (_num_digits(run->first_num) < width)))
+				goto fini;
+			run->prefix_id = group_cnt;
+			run->print_width = width;
+		}
+		groups[group_cnt++] = i;
+	}
+
+	/* hostlist orders prefixes with strnatcmp(), which must tell all of
+	 * them apart */
+	qsort(groups, group_cnt, sizeof(int), _cmp_run_prefix_nat);
+	for (i = 1; i < group_cnt; i++) {
+		if (_cmp_run_prefix_nat(&groups[i - 1], &groups[i]) == 0)
+			goto fini;
+	}
+	for (i = 0; i < group_cnt; i++) {
+		k = node_name_runs[groups[i]].prefix_id;
+		for (j = groups[i]; (j < node_name_run_cnt) &&
+			     (node_name_runs[j].prefix_id == k); j++)
+			node_name_runs[j].prefix_id = group_cnt + i;
+	}
+	for (i = 0; i < node_name_run_cnt; i++)
+		node_name_runs[i].prefix_id -= group_cnt;
+
+	node_name_runs_by_inx  = xmalloc(sizeof(int) * node_name_run_cnt);
+	node_name_runs_by_name = xmalloc(sizeof(int) * node_name_run_cnt);
+	for (i = 0; i < node_name_run_cnt; i++) {
+		node_name_runs_by_inx[i]  = i;
+		node_name_runs_by_name[i] = i;
+	}
+	qsort(node_name_runs_by_inx, node_name_run_cnt, sizeof(int),
+	      _cmp_run_inx);
+	qsort(node_name_runs_by_name, node_name_run_cnt, sizeof(int),
+	      _cmp_run_name);
+
+fini:	xfree(groups);
+}
+
+static void _free_node_name_runs(void)
+{
+	int i;
+
+	for (i = 0; i < node_name_run_cnt; i++)
+		xfree(node_name_runs[i].prefix);
+	xfree(node_name_runs);
+	xfree(node_name_runs_by_inx);
+	xfree(node_name_runs_by_name);
+	node_name_run_cnt      = 0;
+	node_name_runs_table   = NULL;
+	node_name_runs_rec_cnt = 0;
+}
+
 /* Convert a node state string to it's equivalent enum value */
 extern int state_str2int(const char *state_str, char *node_name)
 {
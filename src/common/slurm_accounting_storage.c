@@ -191,6 +191,10 @@ typedef struct slurm_acct_storage_ops {
 				    struct job_record *job_ptr);
 	List (*get_jobs_cond)      (void *db_conn, uint32_t uid,
 				    slurmdb_job_cond_t *job_cond);
+	int  (*get_jobs_cb)        (void *db_conn, uint32_t uid,
+				    slurmdb_job_cond_t *job_cond,
+				    slurmdb_job_list_cb_t callback,
+				    void *arg);
 	int (*archive_dump)        (void *db_conn,
 				    slurmdb_archive_cond_t *arch_cond);
 	int (*archive_load)        (void *db_conn,
@@ -261,6 +265,7 @@ static const char *syms[] = {
 	"jobacct_storage_p_step_complete",
 	"jobacct_storage_p_suspend",
 	"jobacct_storage_p_get_jobs_cond",
+	"jobacct_storage_p_get_jobs_cb",
 	"jobacct_storage_p_archive",
 	"jobacct_storage_p_archive_load",
 	"acct_storage_p_update_shares_used",
@@ -901,6 +906,20 @@ extern List jobacct_storage_g_get_jobs_cond(void *db_conn, uint32_t uid,
 	return (*(ops.get_jobs_cond))(db_conn, uid, job_cond);
 }
 
+/*
+ * get info from the storage, handing it to callback a chunk at a time
+ * RET: SLURM_SUCCESS or error code
+ */
+extern int jobacct_storage_g_get_jobs_cb(void *db_conn, uint32_t uid,
+					 slurmdb_job_cond_t *job_cond,
+					 slurmdb_job_list_cb_t callback,
+					 void *arg)
+{
+	if (slurm_acct_storage_init(NULL) < 0)
+		return SLURM_ERROR;
+	return (*(ops.get_jobs_cb))(db_conn, uid, job_cond, callback, arg);
+}
+
 /*
  * expire old info from the storage
  */
@@ -533,6 +533,16 @@ extern int jobacct_storage_g_job_suspend(void *db_conn,
 extern List jobacct_storage_g_get_jobs_cond(void *db_conn, uint32_t uid,
 					    slurmdb_job_cond_t *job_cond);
 
+/*
+ * get info from the storage, handing it to callback a chunk at a time
+ * instead of building one List of everything
+ * RET: SLURM_SUCCESS or error code
+ */
+extern int jobacct_storage_g_get_jobs_cb(void *db_conn, uint32_t uid,
+					 slurmdb_job_cond_t *job_cond,
+					 slurmdb_job_list_cb_t callback,
+					 void *arg);
+
 /*
  * expire old info from the storage
  */
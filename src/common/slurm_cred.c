@@ -263,7 +263,7 @@ static bool _credential_replayed(slurm_cred_ctx_t ctx, slurm_cred_t *cred);
 static bool _credential_revoked(slurm_cred_ctx_t ctx, slurm_cred_t *cred);
 
 static int _slurm_cred_sign(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
-			    uint16_t protocol_version);
+			    Buf buffer, uint16_t protocol_version);
 static int _slurm_cred_verify_signature(slurm_cred_ctx_t ctx, slurm_cred_t *c,
 					uint16_t protocol_version);
 
@@ -516,6 +516,18 @@ slurm_cred_create(slurm_cred_ctx_t ctx, slurm_cred_arg_t *arg,
 {
 	slurm_cred_t *cred = NULL;
 
+	if (!(cred = slurm_cred_create_unsigned(ctx, arg)))
+		return NULL;
+	(void) slurm_cred_sign(ctx, &cred, 1, protocol_version);
+
+	return cred;
+}
+
+slurm_cred_t *
+slurm_cred_create_unsigned(slurm_cred_ctx_t ctx, slurm_cred_arg_t *arg)
+{
+	slurm_cred_t *cred = NULL;
+
 	xassert(ctx != NULL);
 	xassert(arg != NULL);
 	if (_slurm_crypto_init() < 0)
@@ -566,22 +578,49 @@ slurm_cred_create(slurm_cred_ctx_t ctx, slurm_cred_arg_t *arg,
 #endif
 	cred->ctime  = time(NULL);
 
-	slurm_mutex_lock(&ctx->mutex);
-	xassert(ctx->magic == CRED_CTX_MAGIC);
-	xassert(ctx->type == SLURM_CRED_CREATOR);
-	if (_slurm_cred_sign(ctx, cred, protocol_version) < 0)
-		goto fail;
-
-	slurm_mutex_unlock(&ctx->mutex);
 	slurm_mutex_unlock(&cred->mutex);
 
 	return cred;
+}
 
-fail:
+int
+slurm_cred_sign(slurm_cred_ctx_t ctx, slurm_cred_t **cred, int cred_cnt,
+		uint16_t protocol_version)
+{
+	Buf buffer;
+	int i, rc = SLURM_SUCCESS;
+
+	xassert(ctx != NULL);
+	xassert(cred != NULL);
+	if (_slurm_crypto_init() < 0)
+		return SLURM_ERROR;
+
+	buffer = init_buf(4096);
+	/* The credentials are not yet visible to any other thread, so
+	 * holding the context lock while locking each of them is safe */
+	slurm_mutex_lock(&ctx->mutex);
+	xassert(ctx->magic == CRED_CTX_MAGIC);
+	xassert(ctx->type == SLURM_CRED_CREATOR);
+	for (i = 0; i < cred_cnt; i++) {
+		if (!cred[i])
+			continue;
+		slurm_mutex_lock(&cred[i]->mutex);
+		xassert(cred[i]->magic == CRED_MAGIC);
+		if (cred[i]->signature ||
+		    (_slurm_cred_sign(ctx, cred[i], buffer,
+				      protocol_version) == SLURM_SUCCESS)) {
+			slurm_mutex_unlock(&cred[i]->mutex);
+			continue;
+		}
+		slurm_mutex_unlock(&cred[i]->mutex);
+		slurm_cred_destroy(cred[i]);
+		cred[i] = NULL;
+		rc = SLURM_ERROR;
+	}
 	slurm_mutex_unlock(&ctx->mutex);
-	slurm_mutex_unlock(&cred->mutex);
-	slurm_cred_destroy(cred);
-	return NULL;
+	free_buf(buffer);
+
+	return rc;
 }
 
 slurm_cred_t *
@@ -1559,21 +1598,20 @@ _print_data(char *data, int datalen)
 }
 #endif
 
+/* Sign a credential, "buffer" is scratch space reused between calls */
 static int
-_slurm_cred_sign(slurm_cred_ctx_t ctx, slurm_cred_t *cred,
+_slurm_cred_sign(slurm_cred_ctx_t ctx, slurm_cred_t *cred, Buf buffer,
 		 uint16_t protocol_version)
 {
-	Buf           buffer;
 	int           rc;
 
-	buffer = init_buf(4096);
+	set_buf_offset(buffer, 0);
 	_pack_cred(cred, buffer, protocol_version);
 	rc = (*(ops.crypto_sign))(ctx->key,
 				  get_buf_data(buffer),
 				  get_buf_offset(buffer),
 				  &cred->signature,
 				  &cred->siglen);
-	free_buf(buffer);
 
 	if (rc) {
 		error("Credential sign: %s",
@@ -189,6 +189,29 @@ int slurm_crypto_fini(void);
 slurm_cred_t *slurm_cred_create(slurm_cred_ctx_t ctx, slurm_cred_arg_t *arg,
 				uint16_t protocol_version);
 
+/*
+ * Create a slurm credential using the values in `arg' as with
+ * slurm_cred_create(), but do not sign it. The credential holds its
+ * own copy of the arguments, so locks protecting `arg' may be released
+ * before the credential is signed with slurm_cred_sign().
+ *
+ * Returns NULL on failure.
+ */
+slurm_cred_t *slurm_cred_create_unsigned(slurm_cred_ctx_t ctx,
+					 slurm_cred_arg_t *arg);
+
+/*
+ * Sign `cred_cnt' credentials created by slurm_cred_create_unsigned().
+ * All credentials are signed under a single hold of the context and
+ * share one pack buffer. Credentials which are already signed are left
+ * as is. A credential which can not be signed is destroyed and its
+ * entry in `cred' set to NULL.
+ *
+ * Returns SLURM_SUCCESS if all credentials are signed, SLURM_ERROR otherwise.
+ */
+int slurm_cred_sign(slurm_cred_ctx_t ctx, slurm_cred_t **cred, int cred_cnt,
+		    uint16_t protocol_version);
+
 /*
  * Copy a slurm credential.
  * Returns NULL on failure.
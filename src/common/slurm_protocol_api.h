@@ -1171,6 +1171,18 @@ extern int slurm_job_step_create (
 	job_step_create_request_msg_t *slurm_step_alloc_req_msg,
 	job_step_create_response_msg_t **slurm_step_alloc_resp_msg);
 
+/*
+ * slurm_job_step_create_bulk - Ask the slurm controller for several new job
+ *	steps and their credentials in a single RPC.
+ * IN req - description of the job step requests
+ * OUT resp - per step return codes and responses
+ * RET 0 on success, otherwise return -1 and set errno to indicate the error
+ * NOTE: free the response using slurm_free_job_step_create_bulk_response_msg
+ */
+extern int slurm_job_step_create_bulk(
+	job_step_create_bulk_request_msg_t *req,
+	job_step_create_bulk_response_msg_t **resp);
+
 
 /* Should this be in <slurm/slurm.h> ? */
 /*
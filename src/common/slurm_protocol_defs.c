@@ -290,6 +290,32 @@ extern int slurm_sort_char_list_desc(void *v1, void *v2)
 	return 0;
 }
 
+extern bitstr_t *slurm_array_str2bitmap(char *task_str)
+{
+	bitstr_t *task_bitmap;
+	int32_t *task_inx, i, max_task_id = 0;
+
+	if (!task_str)
+		return NULL;
+
+	if (!strncmp(task_str, "0x", 2)) {
+		task_bitmap = bit_alloc(strlen(task_str) * 4);
+		if (bit_unfmt_hexmask(task_bitmap, task_str) != 0)
+			FREE_NULL_BITMAP(task_bitmap);
+		return task_bitmap;
+	}
+
+	task_inx = bitfmt2int(task_str);
+	for (i = 0; task_inx[i] >= 0; i += 2)
+		max_task_id = MAX(max_task_id, task_inx[i + 1]);
+	task_bitmap = bit_alloc(max_task_id + 1);
+	if (inx2bitstr(task_bitmap, task_inx) != 0)
+		FREE_NULL_BITMAP(task_bitmap);
+	xfree(task_inx);
+
+	return task_bitmap;
+}
+
 extern void slurm_free_last_update_msg(last_update_msg_t * msg)
 {
 	xfree(msg);
@@ -693,6 +719,21 @@ extern void slurm_free_job_step_create_request_msg(
 	}
 }
 
+extern void slurm_free_job_step_create_bulk_request_msg(
+		job_step_create_bulk_request_msg_t *msg)
+{
+	uint32_t i;
+
+	if (msg) {
+		for (i = 0; i < msg->step_cnt; i++) {
+			slurm_free_job_step_create_request_msg(
+				msg->step_req[i]);
+		}
+		xfree(msg->step_req);
+		xfree(msg);
+	}
+}
+
 extern void slurm_free_complete_job_allocation_msg(
 	complete_job_allocation_msg_t * msg)
 {
@@ -989,6 +1030,14 @@ extern void slurm_free_stats_response_msg(stats_info_response_msg_t *msg)
 		xfree(msg->rpc_user_id);
 		xfree(msg->rpc_user_cnt);
 		xfree(msg->rpc_user_time);
+		xfree(msg->lock_cnt);
+		xfree(msg->lock_wait_time);
+		xfree(msg->lock_wait_max);
+		xfree(msg->lock_wait_hist);
+		xfree(msg->rpc_queue_depth);
+		xfree(msg->rpc_queue_depth_max);
+		xfree(msg->rpc_queue_cnt);
+		xfree(msg->rpc_queue_wait_time);
 		xfree(msg);
 	}
 }
@@ -2346,6 +2395,23 @@ extern void slurm_free_job_step_create_response_msg(
 
 }
 
+/* Free a bulk job step create response with individual return codes */
+extern void slurm_free_job_step_create_bulk_response_msg(
+	job_step_create_bulk_response_msg_t *msg)
+{
+	uint32_t i;
+
+	if (msg) {
+		for (i = 0; i < msg->step_cnt; i++) {
+			slurm_free_job_step_create_response_msg(
+				msg->step_resp[i]);
+		}
+		xfree(msg->step_resp);
+		xfree(msg->error_code);
+		xfree(msg);
+	}
+}
+
 
 /*
  * slurm_free_submit_response_response_msg - free slurm
@@ -2934,6 +3000,12 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 	case REQUEST_JOB_STEP_CREATE:
 		slurm_free_job_step_create_request_msg(data);
 		break;
+	case REQUEST_JOB_STEP_CREATE_BULK:
+		slurm_free_job_step_create_bulk_request_msg(data);
+		break;
+	case RESPONSE_JOB_STEP_CREATE_BULK:
+		slurm_free_job_step_create_bulk_response_msg(data);
+		break;
 	case REQUEST_JOB_STEP_INFO:
 		slurm_free_job_step_info_request_msg(data);
 		break;
@@ -3463,6 +3535,10 @@ rpc_num2string(uint16_t opcode)
 		return "REQUEST_JOB_STEP_CREATE";
 	case RESPONSE_JOB_STEP_CREATE:
 		return "RESPONSE_JOB_STEP_CREATE";
+	case REQUEST_JOB_STEP_CREATE_BULK:
+		return "REQUEST_JOB_STEP_CREATE_BULK";
+	case RESPONSE_JOB_STEP_CREATE_BULK:
+		return "RESPONSE_JOB_STEP_CREATE_BULK";
 	case REQUEST_RUN_JOB_STEP:
 		return "REQUEST_RUN_JOB_STEP";
 	case RESPONSE_RUN_JOB_STEP:
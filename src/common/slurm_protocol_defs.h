@@ -313,6 +313,8 @@ typedef enum {
 	REQUEST_KILL_JOB,       /* 5032 */
 	REQUEST_KILL_JOBSTEP,
 	RESPONSE_JOB_ARRAY_ERRORS,
+	REQUEST_JOB_STEP_CREATE_BULK,
+	RESPONSE_JOB_STEP_CREATE_BULK,
 
 	REQUEST_LAUNCH_TASKS = 6001,
 	RESPONSE_LAUNCH_TASKS,
@@ -686,6 +688,21 @@ typedef struct job_step_create_response_msg {
                                          * data structure */
 } job_step_create_response_msg_t;
 
+/* Create several job steps with a single RPC. The steps are created in
+ * array order and the response carries one return code per step. */
+#define MAX_STEP_BULK 4096	/* largest step_cnt accepted */
+
+typedef struct job_step_create_bulk_request_msg {
+	uint32_t step_cnt;		/* number of step requests */
+	job_step_create_request_msg_t **step_req; /* step specifications */
+} job_step_create_bulk_request_msg_t;
+
+typedef struct job_step_create_bulk_response_msg {
+	uint32_t step_cnt;		/* number of step responses */
+	uint32_t *error_code;		/* SLURM_SUCCESS or error per step */
+	job_step_create_response_msg_t **step_resp; /* NULL on error */
+} job_step_create_bulk_response_msg_t;
+
 typedef struct launch_tasks_request_msg {
 	uint32_t  job_id;
 	uint32_t  job_step_id;
@@ -1099,6 +1116,12 @@ extern int slurm_addto_char_list(List char_list, char *names);
 extern int slurm_sort_char_list_asc(void *, void *);
 extern int slurm_sort_char_list_desc(void *, void *);
 
+/* Convert a job array's task ID string to a bitmap large enough to hold its
+ * highest task ID. The string is either a range list (e.g. "0-99,200") or a
+ * hex mask (e.g. "0x3F") as used by older versions of Slurm.
+ * RET bitmap or NULL on error, caller must bit_free() */
+extern bitstr_t *slurm_array_str2bitmap(char *task_str);
+
 /* free message functions */
 extern void slurm_free_checkpoint_tasks_msg(checkpoint_tasks_msg_t * msg);
 extern void slurm_free_last_update_msg(last_update_msg_t * msg);
@@ -1165,6 +1188,10 @@ extern void slurm_free_job_step_create_request_msg(
 		job_step_create_request_msg_t * msg);
 extern void slurm_free_job_step_create_response_msg(
 		job_step_create_response_msg_t *msg);
+extern void slurm_free_job_step_create_bulk_request_msg(
+		job_step_create_bulk_request_msg_t *msg);
+extern void slurm_free_job_step_create_bulk_response_msg(
+		job_step_create_bulk_response_msg_t *msg);
 extern void slurm_free_complete_job_allocation_msg(
 		complete_job_allocation_msg_t * msg);
 extern void slurm_free_prolog_launch_msg(prolog_launch_msg_t * msg);
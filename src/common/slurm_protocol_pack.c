@@ -689,6 +689,19 @@ static void _pack_job_array_resp_msg(job_array_resp_msg_t *msg, Buf buffer,
 static int  _unpack_job_array_resp_msg(job_array_resp_msg_t **msg, Buf buffer,
 				       uint16_t protocol_version);
 
+static void _pack_job_step_create_bulk_request_msg(
+			job_step_create_bulk_request_msg_t *msg, Buf buffer,
+			uint16_t protocol_version);
+static int  _unpack_job_step_create_bulk_request_msg(
+			job_step_create_bulk_request_msg_t **msg, Buf buffer,
+			uint16_t protocol_version);
+static void _pack_job_step_create_bulk_response_msg(
+			job_step_create_bulk_response_msg_t *msg, Buf buffer,
+			uint16_t protocol_version);
+static int  _unpack_job_step_create_bulk_response_msg(
+			job_step_create_bulk_response_msg_t **msg, Buf buffer,
+			uint16_t protocol_version);
+
 static int _unpack_burst_buffer_info_msg(
 			burst_buffer_info_msg_t **burst_buffer_info, Buf buffer,
 			uint16_t protocol_version);
@@ -1116,6 +1129,18 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 			msg->data, buffer,
 			msg->protocol_version);
 		break;
+	case RESPONSE_JOB_STEP_CREATE_BULK:
+		_pack_job_step_create_bulk_response_msg(
+			(job_step_create_bulk_response_msg_t *)
+			msg->data, buffer,
+			msg->protocol_version);
+		break;
+	case REQUEST_JOB_STEP_CREATE_BULK:
+		_pack_job_step_create_bulk_request_msg(
+			(job_step_create_bulk_request_msg_t *)
+			msg->data, buffer,
+			msg->protocol_version);
+		break;
 	case REQUEST_JOB_ID:
 		_pack_job_id_request_msg(
 			(job_id_request_msg_t *)msg->data,
@@ -1736,6 +1761,18 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 			(job_step_create_request_msg_t **) & msg->data, buffer,
 			msg->protocol_version);
 		break;
+	case RESPONSE_JOB_STEP_CREATE_BULK:
+		rc = _unpack_job_step_create_bulk_response_msg(
+			(job_step_create_bulk_response_msg_t **)
+			& msg->data, buffer,
+			msg->protocol_version);
+		break;
+	case REQUEST_JOB_STEP_CREATE_BULK:
+		rc = _unpack_job_step_create_bulk_request_msg(
+			(job_step_create_bulk_request_msg_t **)
+			& msg->data, buffer,
+			msg->protocol_version);
+		break;
 	case REQUEST_JOB_ID:
 		rc = _unpack_job_id_request_msg(
 			(job_id_request_msg_t **) & msg->data,
@@ -4040,6 +4077,134 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+static void
+_pack_job_step_create_bulk_request_msg(job_step_create_bulk_request_msg_t *msg,
+				       Buf buffer, uint16_t protocol_version)
+{
+	uint32_t i;
+
+	xassert(msg != NULL);
+
+	if (protocol_version >= SLURM_15_08_PROTOCOL_VERSION) {
+		pack32(msg->step_cnt, buffer);
+		for (i = 0; i < msg->step_cnt; i++) {
+			pack_job_step_create_request_msg(msg->step_req[i],
+							 buffer,
+							 protocol_version);
+		}
+	} else {
+		error("_pack_job_step_create_bulk_request_msg: "
+		      "protocol_version %hu not supported", protocol_version);
+	}
+}
+
+static int
+_unpack_job_step_create_bulk_request_msg(
+	job_step_create_bulk_request_msg_t **msg, Buf buffer,
+	uint16_t protocol_version)
+{
+	job_step_create_bulk_request_msg_t *tmp_ptr;
+	uint32_t i;
+
+	xassert(msg != NULL);
+	tmp_ptr = xmalloc(sizeof(job_step_create_bulk_request_msg_t));
+	*msg = tmp_ptr;
+
+	if (protocol_version >= SLURM_15_08_PROTOCOL_VERSION) {
+		safe_unpack32(&i, buffer);
+		/* Each step request takes well over one byte */
+		if ((i > MAX_STEP_BULK) || (i > remaining_buf(buffer)))
+			goto unpack_error;
+		tmp_ptr->step_req = xmalloc(sizeof(
+					job_step_create_request_msg_t *) * i);
+		for (tmp_ptr->step_cnt = 0; tmp_ptr->step_cnt < i;
+		     tmp_ptr->step_cnt++) {
+			if (unpack_job_step_create_request_msg(
+				    &tmp_ptr->step_req[tmp_ptr->step_cnt],
+				    buffer, protocol_version))
+				goto unpack_error;
+		}
+	} else {
+		error("_unpack_job_step_create_bulk_request_msg: "
+		      "protocol_version %hu not supported", protocol_version);
+		goto unpack_error;
+	}
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_job_step_create_bulk_request_msg(tmp_ptr);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
+static void
+_pack_job_step_create_bulk_response_msg(
+	job_step_create_bulk_response_msg_t *msg, Buf buffer,
+	uint16_t protocol_version)
+{
+	uint32_t i;
+
+	xassert(msg != NULL);
+
+	if (protocol_version >= SLURM_15_08_PROTOCOL_VERSION) {
+		pack32(msg->step_cnt, buffer);
+		for (i = 0; i < msg->step_cnt; i++) {
+			pack32(msg->error_code[i], buffer);
+			if (msg->error_code[i] == SLURM_SUCCESS) {
+				pack_job_step_create_response_msg(
+					msg->step_resp[i], buffer,
+					protocol_version);
+			}
+		}
+	} else {
+		error("_pack_job_step_create_bulk_response_msg: "
+		      "protocol_version %hu not supported", protocol_version);
+	}
+}
+
+static int
+_unpack_job_step_create_bulk_response_msg(
+	job_step_create_bulk_response_msg_t **msg, Buf buffer,
+	uint16_t protocol_version)
+{
+	job_step_create_bulk_response_msg_t *tmp_ptr;
+	uint32_t i, cnt;
+
+	xassert(msg != NULL);
+	tmp_ptr = xmalloc(sizeof(job_step_create_bulk_response_msg_t));
+	*msg = tmp_ptr;
+
+	if (protocol_version >= SLURM_15_08_PROTOCOL_VERSION) {
+		safe_unpack32(&cnt, buffer);
+		if ((cnt > MAX_STEP_BULK) ||
+		    (cnt > (remaining_buf(buffer) / sizeof(uint32_t))))
+			goto unpack_error;
+		tmp_ptr->error_code = xmalloc(sizeof(uint32_t) * cnt);
+		tmp_ptr->step_resp  = xmalloc(sizeof(
+					job_step_create_response_msg_t *) * cnt);
+		tmp_ptr->step_cnt = cnt;
+		for (i = 0; i < cnt; i++) {
+			safe_unpack32(&tmp_ptr->error_code[i], buffer);
+			if (tmp_ptr->error_code[i] != SLURM_SUCCESS)
+				continue;
+			if (unpack_job_step_create_response_msg(
+				    &tmp_ptr->step_resp[i], buffer,
+				    protocol_version))
+				goto unpack_error;
+		}
+	} else {
+		error("_unpack_job_step_create_bulk_response_msg: "
+		      "protocol_version %hu not supported", protocol_version);
+		goto unpack_error;
+	}
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_job_step_create_bulk_response_msg(tmp_ptr);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
 static int
 _unpack_partition_info_msg(partition_info_msg_t ** msg, Buf buffer,
 			   uint16_t protocol_version)
@@ -4376,7 +4541,7 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
-/* Translate bitmap representation from hex to decimal format, replacing
+/* Translate bitmap representation to decimal format, replacing
  * array_task_str and store the bitmap in job->array_bitmap. */
 static void _xlate_task_str(job_info_t *job_ptr)
 {
@@ -4387,14 +4552,11 @@ static void _xlate_task_str(job_info_t *job_ptr)
 	char *in_buf = job_ptr->array_task_str;
 	char *out_buf = NULL;
 
-	if (!in_buf) {
+	task_bitmap = slurm_array_str2bitmap(in_buf);
+	if (!task_bitmap) {
 		job_ptr->array_bitmap = NULL;
 		return;
 	}
-
-	i = strlen(in_buf);
-	task_bitmap = bit_alloc(i * 4);
-	bit_unfmt_hexmask(task_bitmap, in_buf);
 	job_ptr->array_bitmap = (void *) task_bitmap;
 
 	/* Check first for a step function */
@@ -4439,19 +4601,8 @@ static void _xlate_task_str(job_info_t *job_ptr)
 		for (i = 0; i < 3; i++)
 			out_buf[buf_size - 2 - i] = '.';
 	} else {
-		/* Print the full bitmap's string representation.
-		 * For huge bitmaps this can take roughly one minute,
-		 * so let the client do the work */
-		buf_size = bit_size(task_bitmap) * 8;
-		while (1) {
-			out_buf = xmalloc(buf_size);
-			bit_fmt(out_buf, buf_size, task_bitmap);
-			len = strlen(out_buf);
-			if ((len > 0) && (len < (buf_size - 32)))
-				break;
-			xfree(out_buf);
-			buf_size *= 2;
-		}
+		/* Print the full bitmap's string representation */
+		out_buf = bit_fmt_full(task_bitmap);
 	}
 
 	if (job_ptr->array_max_tasks)
@@ -11423,6 +11574,46 @@ static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
 		safe_unpack32_array(&msg->rpc_user_id,   &uint32_tmp, buffer);
 		safe_unpack32_array(&msg->rpc_user_cnt,  &uint32_tmp, buffer);
 		safe_unpack64_array(&msg->rpc_user_time, &uint32_tmp, buffer);
+
+		if (protocol_version >= SLURM_15_08_PROTOCOL_VERSION) {
+			safe_unpack32(&msg->lock_stat_size,	buffer);
+			safe_unpack32(&msg->lock_hist_size,	buffer);
+			safe_unpack32_array(&msg->lock_cnt, &uint32_tmp,
+					    buffer);
+			if (uint32_tmp != msg->lock_stat_size)
+				goto unpack_error;
+			safe_unpack64_array(&msg->lock_wait_time, &uint32_tmp,
+					    buffer);
+			if (uint32_tmp != msg->lock_stat_size)
+				goto unpack_error;
+			safe_unpack32_array(&msg->lock_wait_max, &uint32_tmp,
+					    buffer);
+			if (uint32_tmp != msg->lock_stat_size)
+				goto unpack_error;
+			safe_unpack32_array(&msg->lock_wait_hist, &uint32_tmp,
+					    buffer);
+			if (uint32_tmp != (msg->lock_stat_size *
+					   msg->lock_hist_size))
+				goto unpack_error;
+
+			safe_unpack32(&msg->rpc_queue_size,	buffer);
+			safe_unpack32_array(&msg->rpc_queue_depth, &uint32_tmp,
+					    buffer);
+			if (uint32_tmp != msg->rpc_queue_size)
+				goto unpack_error;
+			safe_unpack32_array(&msg->rpc_queue_depth_max,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->rpc_queue_size)
+				goto unpack_error;
+			safe_unpack32_array(&msg->rpc_queue_cnt, &uint32_tmp,
+					    buffer);
+			if (uint32_tmp != msg->rpc_queue_size)
+				goto unpack_error;
+			safe_unpack64_array(&msg->rpc_queue_wait_time,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->rpc_queue_size)
+				goto unpack_error;
+		}
 	} else if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		safe_unpack32(&msg->parts_packed,	buffer);
 		if (msg->parts_packed) {
@@ -92,6 +92,7 @@
 #define	bit_realloc		slurm_bit_realloc
 #define	bit_size		slurm_bit_size
 #define	bit_and			slurm_bit_and
+#define	bit_and_not		slurm_bit_and_not
 #define	bit_not			slurm_bit_not
 #define	bit_or			slurm_bit_or
 #define	bit_set_count		slurm_bit_set_count
@@ -102,6 +103,7 @@
 #define	bit_rotate_copy		slurm_bit_rotate_copy
 #define	bit_rotate		slurm_bit_rotate
 #define	bit_fmt			slurm_bit_fmt
+#define	bit_fmt_full		slurm_bit_fmt_full
 #define bit_unfmt		slurm_bit_unfmt
 #define	bitfmt2int		slurm_bitfmt2int
 #define	bit_fmt_hexmask		slurm_bit_fmt_hexmask
@@ -111,12 +113,18 @@
 #define	bit_fls			slurm_bit_fls
 #define	bit_fill_gaps		slurm_bit_fill_gaps
 #define	bit_super_set		slurm_bit_super_set
+#define	bit_overlap		slurm_bit_overlap
+#define	bit_overlap_any		slurm_bit_overlap_any
 #define	bit_copy		slurm_bit_copy
 #define	bit_pick_cnt		slurm_bit_pick_cnt
 #define bit_nffc		slurm_bit_nffc
 #define bit_noc			slurm_bit_noc
 #define bit_nffs		slurm_bit_nffs
 #define bit_copybits		slurm_bit_copybits
+#define	bit_scratch_alloc	slurm_bit_scratch_alloc
+#define	bit_scratch_copy	slurm_bit_scratch_copy
+#define	bit_scratch_free	slurm_bit_scratch_free
+#define	bit_scratch_purge	slurm_bit_scratch_purge
 
 /* fd.[ch] functions */
 #define fd_read_n		slurm_fd_read_n
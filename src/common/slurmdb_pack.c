@@ -3386,7 +3386,20 @@ extern void slurmdb_pack_job_rec(void *object, uint16_t rpc_version, Buf buffer)
 		pack32(job->array_job_id, buffer);
 		pack32(job->array_max_tasks, buffer);
 		pack32(job->array_task_id, buffer);
-		packstr(job->array_task_str, buffer);
+		if ((rpc_version < SLURM_15_08_PROTOCOL_VERSION) &&
+		    job->array_task_str &&
+		    strncmp(job->array_task_str, "0x", 2)) {
+			/* Older clients expect a hex mask */
+			bitstr_t *task_bitmap =
+				slurm_array_str2bitmap(job->array_task_str);
+			char *task_hex = NULL;
+			if (task_bitmap)
+				task_hex = bit_fmt_hexmask(task_bitmap);
+			packstr(task_hex, buffer);
+			xfree(task_hex);
+			FREE_NULL_BITMAP(task_bitmap);
+		} else
+			packstr(job->array_task_str, buffer);
 		pack32(job->associd, buffer);
 		packstr(job->blockid, buffer);
 		packstr(job->cluster, buffer);
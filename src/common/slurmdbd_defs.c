@@ -50,10 +50,13 @@
 #endif				/*  HAVE_CONFIG_H */
 
 #include <arpa/inet.h>
+#include <dirent.h>
 #include <fcntl.h>
 #include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <syslog.h>
+#include <sys/mman.h>
 #include <sys/poll.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -87,22 +90,89 @@ strong_alias(slurmdbd_free_id_rc_msg,	slurmdb_slurmdbd_free_id_rc_msg);
 
 #define DBD_MAGIC		0xDEAD3219
 #define MAX_AGENT_QUEUE		10000
+#define MAX_AGENT_FRAME		1000	/* Messages per DBD_SEND_MULT_MSG */
+#define MAX_AGENT_WINDOW	4	/* DBD_SEND_MULT_MSG frames in flight */
 #define MAX_DBD_MSG_LEN		16384
-#define SLURMDBD_TIMEOUT	900	/* Seconds SlurmDBD for response */
+#define SPOOL_SEG_SIZE		(16 * 1024 * 1024) /* Bytes per segment */
+#define SPOOL_MAX_SEGS		64	/* Segments before discarding */
+#define SPOOL_REC_DEAD		0x80000000 /* Record not to be sent */
 
 uint16_t running_cache = 0;
 pthread_mutex_t assoc_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_cond_t assoc_cache_cond = PTHREAD_COND_INITIALIZER;
 
+/* The agent's queue of pending messages is a spool of memory mapped
+ * segment files, "seg.<seq>" in StateSaveLocation/dbd.spool. Each segment
+ * starts with a spool_seg_hdr_t followed by records of a uint32_t length
+ * and the packed message, padded to a multiple of four bytes. The length
+ * is stored after the message, so a zero length marks the end of the
+ * records even if slurmctld dies while appending. The "head" file records
+ * the position of the oldest message not yet acknowledged by the SlurmDBD.
+ * Only the segments the agent is working on stay mapped. */
+typedef struct {
+	uint32_t magic;
+	uint16_t rpc_version;	/* version the records were packed with */
+	uint16_t reserved;
+} spool_seg_hdr_t;
+
+typedef struct {
+	uint32_t seq;		/* segment file suffix */
+	char *addr;		/* mmap'd segment, NULL if not mapped */
+	uint32_t size;		/* size of the segment file */
+	uint32_t end;		/* offset past the last record */
+	uint16_t rpc_version;	/* version the records were packed with */
+} spool_seg_t;
+
+typedef struct {
+	uint32_t seq;		/* segment */
+	uint32_t offset;	/* offset of a record in the segment */
+} spool_pos_t;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t reserved;
+	uint64_t ack;		/* spool_pos_t, seq in the high bits */
+} spool_head_t;
+
 static pthread_mutex_t agent_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  agent_cond = PTHREAD_COND_INITIALIZER;
-static List      agent_list     = (List) NULL;
 static pthread_t agent_tid      = 0;
 static time_t    agent_shutdown = 0;
 
+/* Spool state, protected by agent_lock. spool_ack is the oldest message
+ * not yet acknowledged, spool_send the next one to send. Records between
+ * the two are in flight. */
+static char *    spool_dir      = NULL;
+static List      spool_segs     = (List) NULL;	/* oldest first */
+static spool_seg_t *spool_wseg  = NULL;		/* segment appended to */
+static spool_head_t *spool_head = NULL;
+static spool_pos_t spool_ack;
+static spool_pos_t spool_send;
+static int       spool_rec_cnt  = 0;		/* records not acknowledged */
+static spool_seg_t *spool_next  = NULL;		/* spare segment "seg.next" */
+
+/* Records before spool_synced were written to disk by the agent, see
+ * _spool_sync(). Only used by the agent. */
+static spool_pos_t spool_synced;
+
+/* Frames in flight. agent_frame_cnt[] holds the message count of each,
+ * oldest first. Once a message in a frame fails, agent_failed is set and
+ * the remaining frames are only drained, their messages are sent again.
+ * More than one frame is only kept in flight once the SlurmDBD accepted
+ * DBD_SYNC_MULT_MSG on the connection (agent_sync_gen), as only then does
+ * it refuse the frames after a failed one rather than apply them.
+ * Only used by the agent while it holds slurmdbd_lock. */
+static int       agent_frames    = 0;
+static int       agent_frame_cnt[MAX_AGENT_WINDOW];
+static bool      agent_failed    = false;
+static bool      agent_synced    = false;
+static uint32_t  agent_sync_gen  = 0;
+static int       agent_window    = 1;
+
 static pthread_mutex_t slurmdbd_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  slurmdbd_cond = PTHREAD_COND_INITIALIZER;
 static slurm_fd_t  slurmdbd_fd         = -1;
+static uint32_t  slurmdbd_fd_gen     = 0;
 static char *    slurmdbd_auth_info  = NULL;
 static char *    slurmdbd_cluster    = NULL;
 static bool      rollback_started    = 0;
@@ -121,18 +191,26 @@ static int    _get_return_code(uint16_t rpc_version, int read_timeout);
 static Buf    _load_dbd_rec(int fd);
 static void   _load_dbd_state(void);
 static void   _open_slurmdbd_fd(bool db_needed);
-static int    _purge_job_start_req(void);
 static Buf    _recv_msg(int read_timeout);
 static void   _reopen_slurmdbd_fd(void);
-static int    _save_dbd_rec(int fd, Buf buffer);
-static void   _save_dbd_state(void);
+static Buf    _repack_dbd_rec(Buf buffer, uint16_t rpc_version);
 static int    _send_init_msg(void);
 static int    _send_fini_msg(void);
 static int    _send_msg(Buf buffer);
+static int    _send_req(uint16_t rpc_version, slurmdbd_msg_t *req);
 static void   _sig_handler(int signal);
 static void   _shutdown_agent(void);
 static void   _slurmdbd_packstr(void *str, uint16_t rpc_version, Buf buffer);
 static int    _slurmdbd_unpackstr(void **str, uint16_t rpc_version, Buf buffer);
+static void   _spool_ack(int ack_cnt);
+static int    _spool_append(Buf buffer);
+static void   _spool_close(void);
+static int    _spool_open(void);
+static void   _spool_prepare(void);
+static spool_seg_t *_spool_rec(spool_pos_t *pos);
+static Buf    _spool_rec_buf(spool_seg_t *seg, uint32_t *rec);
+static uint32_t _spool_rec_size(uint32_t len);
+static void   _spool_sync(void);
 static int    _tot_wait (struct timeval *start_time);
 
 /****************************************************************************
@@ -179,9 +257,9 @@ extern int slurm_open_slurmdbd_conn(char *auth_info,
 		callbacks_requested = false;
 	}
 
-	if ((callbacks != NULL) && ((agent_tid == 0) || (agent_list == NULL)))
+	if ((callbacks != NULL) && ((agent_tid == 0) || (spool_segs == NULL)))
 		_create_agent();
-	else if (agent_list)
+	else if (spool_segs)
 		_load_dbd_state();
 
 	slurm_mutex_unlock(&agent_lock);
@@ -296,31 +374,8 @@ extern int slurm_send_recv_slurmdbd_msg(uint16_t rpc_version,
 	read_timeout = SLURMDBD_TIMEOUT * 1000;
 	slurm_mutex_lock(&slurmdbd_lock);
 	halt_agent = 0;
-	if (slurmdbd_fd < 0) {
-		/* Either slurm_open_slurmdbd_conn() was not executed or
-		 * the connection to Slurm DBD has been closed */
-		if (req->msg_type == DBD_GET_CONFIG)
-			_open_slurmdbd_fd(0);
-		else
-			_open_slurmdbd_fd(1);
-		if (slurmdbd_fd < 0) {
-			rc = SLURM_ERROR;
-			goto end_it;
-		}
-	}
-
-	if (!(buffer = pack_slurmdbd_msg(req, rpc_version))) {
-		rc = SLURM_ERROR;
+	if ((rc = _send_req(rpc_version, req)) != SLURM_SUCCESS)
 		goto end_it;
-	}
-
-	rc = _send_msg(buffer);
-	free_buf(buffer);
-	if (rc != SLURM_SUCCESS) {
-		error("slurmdbd: Sending message type %s: %d: %m",
-		      rpc_num2string(req->msg_type), rc);
-		goto end_it;
-	}
 
 	buffer = _recv_msg(read_timeout);
 	if (buffer == NULL) {
@@ -343,6 +398,62 @@ end_it:
 	return rc;
 }
 
+/* Send an RPC to the SlurmDBD and hand each reply message to "callback"
+ * until a DBD_RC ends the stream.  The callback must free the messages
+ * it is handed, returning anything but SLURM_SUCCESS from it stops the
+ * stream and drops the connection since the rest of the replies can not
+ * be told apart from those of the next RPC.
+ * The closing "resp" message must be freed by the caller.
+ * Returns SLURM_SUCCESS or an error code */
+extern int slurm_send_recv_slurmdbd_stream(
+	uint16_t rpc_version, slurmdbd_msg_t *req, slurmdbd_msg_t *resp,
+	int (*callback) (slurmdbd_msg_t *msg, void *arg), void *arg)
+{
+	int rc = SLURM_SUCCESS, read_timeout;
+	Buf buffer;
+	slurmdbd_msg_t msg;
+
+	xassert(req);
+	xassert(resp);
+	xassert(callback);
+
+	halt_agent = 1;
+	read_timeout = SLURMDBD_TIMEOUT * 1000;
+	slurm_mutex_lock(&slurmdbd_lock);
+	halt_agent = 0;
+	if ((rc = _send_req(rpc_version, req)) != SLURM_SUCCESS)
+		goto end_it;
+
+	while (1) {
+		/* Each chunk restarts the read timeout, so only the time
+		 * it takes the SlurmDBD to come up with a chunk counts */
+		if (!(buffer = _recv_msg(read_timeout))) {
+			error("slurmdbd: Getting response to message type %u",
+			      req->msg_type);
+			rc = SLURM_ERROR;
+			break;
+		}
+		rc = unpack_slurmdbd_msg(&msg, rpc_version, buffer);
+		free_buf(buffer);
+		if (rc != SLURM_SUCCESS)
+			break;
+		if (msg.msg_type == DBD_RC) {
+			memcpy(resp, &msg, sizeof(slurmdbd_msg_t));
+			break;
+		}
+		if ((rc = (*callback)(&msg, arg)) != SLURM_SUCCESS)
+			break;
+	}
+
+	if (rc != SLURM_SUCCESS)
+		_close_slurmdbd_fd();
+end_it:
+	pthread_cond_signal(&slurmdbd_cond);
+	slurm_mutex_unlock(&slurmdbd_lock);
+
+	return rc;
+}
+
 /* Send an RPC to the SlurmDBD. Do not wait for the reply. The RPC
  * will be queued and processed later if the SlurmDBD is not responding.
  * NOTE: slurm_open_slurmdbd_conn() must have been called with callbacks set
@@ -364,15 +475,15 @@ extern int slurm_send_slurmdbd_msg(uint16_t rpc_version, slurmdbd_msg_t *req)
 	buffer = pack_slurmdbd_msg(req, rpc_version);
 
 	slurm_mutex_lock(&agent_lock);
-	if ((agent_tid == 0) || (agent_list == NULL)) {
+	if ((agent_tid == 0) || (spool_segs == NULL)) {
 		_create_agent();
-		if ((agent_tid == 0) || (agent_list == NULL)) {
+		if ((agent_tid == 0) || (spool_segs == NULL)) {
 			slurm_mutex_unlock(&agent_lock);
 			free_buf(buffer);
 			return SLURM_ERROR;
 		}
 	}
-	cnt = list_count(agent_list);
+	cnt = spool_rec_cnt;
 	if ((cnt >= (max_agent_queue / 2)) &&
 	    (difftime(time(NULL), syslog_time) > 120)) {
 		/* Record critical error every 120 seconds */
@@ -382,12 +493,7 @@ extern int slurm_send_slurmdbd_msg(uint16_t rpc_version, slurmdbd_msg_t *req)
 		if (callbacks_requested)
 			(callback.dbd_fail)();
 	}
-	if (cnt == (max_agent_queue - 1))
-		cnt -= _purge_job_start_req();
-	if (cnt < max_agent_queue) {
-		if (list_enqueue(agent_list, buffer) == NULL)
-			fatal("list_enqueue: memory allocation failure");
-	} else {
+	if (_spool_append(buffer) != SLURM_SUCCESS) {
 		error("slurmdbd: agent queue is full, discarding request");
 		if (callbacks_requested)
 			(callback.acct_full)();
@@ -396,6 +502,7 @@ extern int slurm_send_slurmdbd_msg(uint16_t rpc_version, slurmdbd_msg_t *req)
 
 	pthread_cond_broadcast(&agent_cond);
 	slurm_mutex_unlock(&agent_lock);
+	free_buf(buffer);
 	return rc;
 }
 
@@ -541,6 +648,7 @@ extern Buf pack_slurmdbd_msg(slurmdbd_msg_t *req, uint16_t rpc_version)
 	case DBD_GET_CLUSTERS:
 	case DBD_GET_EVENTS:
 	case DBD_GET_JOBS_COND:
+	case DBD_GET_JOBS_STREAM:
 	case DBD_GET_PROBS:
 	case DBD_GET_QOS:
 	case DBD_GET_RESVS:
@@ -647,6 +755,7 @@ extern Buf pack_slurmdbd_msg(slurmdbd_msg_t *req, uint16_t rpc_version)
 		packstr((char *)req->data, buffer);
 		break;
 	case DBD_RECONFIG:
+	case DBD_SYNC_MULT_MSG:
 		break;
 	default:
 		error("slurmdbd: Invalid message type pack %u(%s:%u)",
@@ -723,6 +832,7 @@ extern int unpack_slurmdbd_msg(slurmdbd_msg_t *resp,
 	case DBD_GET_CLUSTERS:
 	case DBD_GET_EVENTS:
 	case DBD_GET_JOBS_COND:
+	case DBD_GET_JOBS_STREAM:
 	case DBD_GET_PROBS:
 	case DBD_GET_QOS:
 	case DBD_GET_RESVS:
@@ -833,6 +943,7 @@ extern int unpack_slurmdbd_msg(slurmdbd_msg_t *resp,
 	case DBD_GET_CONFIG:
 		/* (handled in src/slurmdbd/proc_req.c) */
 	case DBD_RECONFIG:
+	case DBD_SYNC_MULT_MSG:
 		/* No message to unpack */
 		break;
 	default:
@@ -965,6 +1076,8 @@ extern slurmdbd_msg_type_t str_2_slurmdbd_msg_type(char *msg_type)
 		return DBD_STEP_START;
 	} else if (!strcasecmp(msg_type, "Get Jobs Conditional")) {
 		return DBD_GET_JOBS_COND;
+	} else if (!strcasecmp(msg_type, "Get Jobs Stream")) {
+		return DBD_GET_JOBS_STREAM;
 	} else if (!strcasecmp(msg_type, "Get Transations")) {
 		return DBD_GET_TXN;
 	} else if (!strcasecmp(msg_type, "Got Transations")) {
@@ -1011,6 +1124,8 @@ extern slurmdbd_msg_type_t str_2_slurmdbd_msg_type(char *msg_type)
 		return DBD_SEND_MULT_MSG;
 	} else if (!strcasecmp(msg_type, "Got Multiple Message Returns")) {
 		return DBD_GOT_MULT_MSG;
+	} else if (!strcasecmp(msg_type, "Sync Multiple Messages")) {
+		return DBD_SYNC_MULT_MSG;
 	} else {
 		return NO_VAL;
 	}
@@ -1363,6 +1478,12 @@ extern char *slurmdbd_msg_type_2_str(slurmdbd_msg_type_t msg_type, int get_enum)
 		} else
 			return "Get Jobs Conditional";
 		break;
+	case DBD_GET_JOBS_STREAM:
+		if (get_enum) {
+			return "DBD_GET_JOBS_STREAM";
+		} else
+			return "Get Jobs Stream";
+		break;
 	case DBD_GET_TXN:
 		if (get_enum) {
 			return "DBD_GET_TXN";
@@ -1501,6 +1622,12 @@ extern char *slurmdbd_msg_type_2_str(slurmdbd_msg_type_t msg_type, int get_enum)
 		} else
 			return "Got Multiple Message Returns";
 		break;
+	case DBD_SYNC_MULT_MSG:
+		if (get_enum) {
+			return "DBD_SYNC_MULT_MSG";
+		} else
+			return "Sync Multiple Messages";
+		break;
 	default:
 		return "Unknown";
 		break;
@@ -1591,6 +1718,7 @@ static void _close_slurmdbd_fd(void)
 	if (slurmdbd_fd >= 0) {
 		close(slurmdbd_fd);
 		slurmdbd_fd = -1;
+		slurmdbd_fd_gen++;	/* replies in flight are lost */
 	}
 }
 
@@ -1602,6 +1730,36 @@ static void _reopen_slurmdbd_fd(void)
 	_open_slurmdbd_fd(1);
 }
 
+/* Send a request to the SlurmDBD, opening the connection first if
+ * needed.  slurmdbd_lock must be locked before calling. */
+static int _send_req(uint16_t rpc_version, slurmdbd_msg_t *req)
+{
+	Buf buffer;
+	int rc;
+
+	if (slurmdbd_fd < 0) {
+		/* Either slurm_open_slurmdbd_conn() was not executed or
+		 * the connection to Slurm DBD has been closed */
+		if (req->msg_type == DBD_GET_CONFIG)
+			_open_slurmdbd_fd(0);
+		else
+			_open_slurmdbd_fd(1);
+		if (slurmdbd_fd < 0)
+			return SLURM_ERROR;
+	}
+
+	if (!(buffer = pack_slurmdbd_msg(req, rpc_version)))
+		return SLURM_ERROR;
+
+	rc = _send_msg(buffer);
+	free_buf(buffer);
+	if (rc != SLURM_SUCCESS)
+		error("slurmdbd: Sending message type %s: %d: %m",
+		      rpc_num2string(req->msg_type), rc);
+
+	return rc;
+}
+
 static int _send_msg(Buf buffer)
 {
 	uint32_t msg_size, nw_size;
@@ -1725,18 +1883,149 @@ static int _get_return_code(uint16_t rpc_version, int read_timeout)
 	return rc;
 }
 
+/* Forget the frames in flight, their messages will be sent again */
+static void _reset_agent_frames(void)
+{
+	slurm_mutex_lock(&agent_lock);
+	spool_send = spool_ack;
+	slurm_mutex_unlock(&agent_lock);
+	agent_frames = 0;
+	agent_failed = false;
+	agent_synced = false;
+}
+
+/* RET true if DBD_SYNC_MULT_MSG was sent since the last failure on the
+ * current connection, _send_msg() may have reopened it */
+static bool _agent_synced(void)
+{
+	return (agent_synced && (agent_sync_gen == slurmdbd_fd_gen));
+}
+
+/* Tell the SlurmDBD that DBD_SEND_MULT_MSG frames are about to (re)start
+ * and set agent_window from its answer. A SlurmDBD which does not know
+ * DBD_SYNC_MULT_MSG would apply frames pipelined after a failed one, so
+ * only one frame is kept in flight with it.
+ * RET SLURM_SUCCESS or SLURM_ERROR if the connection failed */
+static int _sync_agent_frames(int read_timeout)
+{
+	slurmdbd_msg_t req;
+	Buf buffer;
+	int rc;
+
+	req.msg_type = DBD_SYNC_MULT_MSG;
+	req.data = NULL;
+	buffer = pack_slurmdbd_msg(&req, SLURM_PROTOCOL_VERSION);
+	rc = _send_msg(buffer);
+	free_buf(buffer);
+	if ((rc != SLURM_SUCCESS) ||
+	    !(buffer = _recv_msg(read_timeout))) {
+		if (agent_shutdown == 0) {
+			error("slurmdbd: Sending DBD_SYNC_MULT_MSG: %m");
+			_close_slurmdbd_fd();
+		}
+		return SLURM_ERROR;
+	}
+	rc = _unpack_return_code(SLURM_PROTOCOL_VERSION, buffer);
+	free_buf(buffer);
+
+	if (rc == SLURM_SUCCESS)
+		agent_window = MAX_AGENT_WINDOW;
+	else
+		agent_window = 1;
+	agent_synced = true;
+	agent_sync_gen = slurmdbd_fd_gen;
+	return SLURM_SUCCESS;
+}
+
+/* Pack up to MAX_AGENT_FRAME spooled messages which are not yet in flight
+ * into a DBD_SEND_MULT_MSG and send it without waiting for the reply.
+ * RET count of messages sent, 0 if none are waiting, -1 on error */
+static int _send_agent_frame(void)
+{
+	slurmdbd_msg_t list_req;
+	dbd_list_msg_t list_msg;
+	spool_seg_t *seg;
+	uint32_t *rec;
+	Buf buffer = NULL;
+	uint32_t fd_gen;
+	int cnt = 0, rc;
+
+	list_req.msg_type = DBD_SEND_MULT_MSG;
+	list_req.data = &list_msg;
+	memset(&list_msg, 0, sizeof(dbd_list_msg_t));
+	list_msg.my_list = list_create(slurmdbd_free_buffer);
+
+	slurm_mutex_lock(&agent_lock);
+	while (spool_segs && (cnt < MAX_AGENT_FRAME) &&
+	       (seg = _spool_rec(&spool_send))) {
+		rec = (uint32_t *) (seg->addr + spool_send.offset);
+		spool_send.offset += _spool_rec_size(*rec);
+		if (!(buffer = _spool_rec_buf(seg, rec))) {
+			error("slurmdbd: discarding unreadable spool record");
+			*rec |= SPOOL_REC_DEAD;
+			spool_rec_cnt--;
+			continue;
+		}
+		list_enqueue(list_msg.my_list, buffer);
+		cnt++;
+	}
+	if (cnt)
+		buffer = pack_slurmdbd_msg(&list_req, SLURM_PROTOCOL_VERSION);
+	slurm_mutex_unlock(&agent_lock);
+	list_destroy(list_msg.my_list);
+	if (cnt == 0)
+		return 0;
+
+	fd_gen = slurmdbd_fd_gen;
+	rc = _send_msg(buffer);
+	free_buf(buffer);
+	/* If _send_msg() had to reopen the connection, the replies to the
+	 * frames already in flight are lost */
+	if ((rc == SLURM_SUCCESS) && agent_frames &&
+	    (fd_gen != slurmdbd_fd_gen))
+		rc = EAGAIN;
+	if (rc != SLURM_SUCCESS) {
+		if (agent_shutdown == 0) {
+			error("slurmdbd: Failure sending message: %d: %m",
+			      rc);
+		}
+		/* A partial write leaves the stream out of sync */
+		_close_slurmdbd_fd();
+		_reset_agent_frames();
+		return -1;
+	}
+
+	agent_frame_cnt[agent_frames++] = cnt;
+	return cnt;
+}
+
+/* Read the reply to the oldest frame in flight and advance the spool past
+ * the messages it acknowledges. Messages which were not processed, and
+ * those of later frames, are sent again once the frames in flight are
+ * answered.
+ * RET SLURM_SUCCESS if every message of the frame was processed */
 static int _handle_mult_rc_ret(uint16_t rpc_version, int read_timeout)
 {
 	Buf buffer;
 	uint16_t msg_type;
 	dbd_rc_msg_t *msg;
 	dbd_list_msg_t *list_msg;
-	int rc = SLURM_ERROR;
+	int i, frame_cnt, ack_cnt = 0, rc = SLURM_ERROR;
 	Buf out_buf = NULL;
 
 	buffer = _recv_msg(read_timeout);
-	if (buffer == NULL)
+	if (buffer == NULL) {
+		/* Can not tell which reply comes next, start over */
+		if (agent_shutdown == 0)
+			_close_slurmdbd_fd();
+		_reset_agent_frames();
 		return rc;
+	}
+
+	frame_cnt = agent_frame_cnt[0];
+	agent_frames--;
+	for (i = 0; i < agent_frames; i++)
+		agent_frame_cnt[i] = agent_frame_cnt[i + 1];
 
 	safe_unpack16(&msg_type, buffer);
 	switch(msg_type) {
@@ -1748,27 +2037,19 @@ static int _handle_mult_rc_ret(uint16_t rpc_version, int read_timeout)
 			break;
 		}
 
-		slurm_mutex_lock(&agent_lock);
-		if (agent_list) {
+		if (list_msg->my_list) {
 			ListIterator itr =
 				list_iterator_create(list_msg->my_list);
-			while ((out_buf = list_next(itr))) {
-				Buf b;
+			while ((ack_cnt < frame_cnt) &&
+			       (out_buf = list_next(itr))) {
 				if ((rc = _unpack_return_code(
 					    rpc_version, out_buf))
 				    != SLURM_SUCCESS)
 					break;
-
-				if ((b = list_dequeue(agent_list))) {
-					free_buf(b);
-				} else {
-					error("slurmdbd: DBD_GOT_MULT_MSG "
-					      "unpack message error");
-				}
+				ack_cnt++;
 			}
 			list_iterator_destroy(itr);
 		}
-		slurm_mutex_unlock(&agent_lock);
 		slurmdbd_free_list_msg(list_msg);
 		break;
 	case DBD_RC:
@@ -1810,6 +2091,21 @@ static int _handle_mult_rc_ret(uint16_t rpc_version, int read_timeout)
 
 unpack_error:
 	free_buf(buffer);
+
+	slurm_mutex_lock(&agent_lock);
+	if (!agent_failed)
+		_spool_ack(ack_cnt);
+	if (ack_cnt < frame_cnt)
+		agent_failed = true;
+	if (agent_frames == 0) {
+		/* The SlurmDBD refuses frames until told they restart */
+		if (agent_failed && (agent_window > 1))
+			agent_synced = false;
+		spool_send = spool_ack;
+		agent_failed = false;
+	}
+	slurm_mutex_unlock(&agent_lock);
+
 	return rc;
 }
 
@@ -1953,9 +2249,11 @@ static int _fd_writeable(slurm_fd_t fd)
 		 * If not then exit out and notify the sender.  This
  		 * is here since a write doesn't always tell you the
 		 * socket is gone, but getting 0 back from a
-		 * nonblocking read means just that.
+		 * nonblocking read means just that. Only peek, the
+		 * agent may have replies pending on this socket.
 		 */
-		if (ufds.revents & POLLHUP || (recv(fd, &temp, 1, 0) == 0)) {
+		if (ufds.revents & POLLHUP ||
+		    (recv(fd, &temp, 1, MSG_PEEK) == 0)) {
 			debug2("SlurmDBD connection is closed");
 			if (callbacks_requested)
 				(callback.dbd_fail)();
@@ -1992,10 +2290,8 @@ static void _create_agent(void)
 	   nothing if the connection was closed and then opened again */
 	agent_shutdown = 0;
 
-	if (agent_list == NULL) {
-		agent_list = list_create(slurmdbd_free_buffer);
+	if ((spool_segs == NULL) && (_spool_open() == SLURM_SUCCESS))
 		_load_dbd_state();
-	}
 
 	if (agent_tid == 0) {
 		pthread_attr_t agent_attr;
@@ -2026,7 +2322,6 @@ static void _shutdown_agent(void)
 		 * and leave the agent without valid data */
 		if (pthread_kill(agent_tid, 0) == 0) {
 			error("slurmdbd: agent failed to shutdown gracefully");
-			error("slurmdbd: unable to save pending requests");
 			pthread_cancel(agent_tid);
 		}
 		pthread_join(agent_tid,  NULL);
@@ -2051,17 +2346,10 @@ unpack_error:
 static void *_agent(void *x)
 {
 	int cnt, rc;
-	Buf buffer;
 	struct timespec abs_time;
 	static time_t fail_time = 0;
 	int sigarray[] = {SIGUSR1, 0};
 	int read_timeout = SLURMDBD_TIMEOUT * 1000;
-	slurmdbd_msg_t list_req;
-	dbd_list_msg_t list_msg;
-
-	list_req.msg_type = DBD_SEND_MULT_MSG;
-	list_req.data = &list_msg;
-	memset(&list_msg, 0, sizeof(dbd_list_msg_t));
 	/* DEF_TIMERS; */
 
 	/* Prepare to catch SIGUSR1 to interrupt pending
@@ -2071,6 +2359,8 @@ static void *_agent(void *x)
 
 	while (agent_shutdown == 0) {
 		/* START_TIMER; */
+		_spool_sync();
+		_spool_prepare();
 		slurm_mutex_lock(&slurmdbd_lock);
 		if (halt_agent)
 			pthread_cond_wait(&slurmdbd_cond, &slurmdbd_lock);
@@ -2084,8 +2374,8 @@ static void *_agent(void *x)
 		}
 
 		slurm_mutex_lock(&agent_lock);
-		if (agent_list && slurmdbd_fd)
-			cnt = list_count(agent_list);
+		if (spool_segs && slurmdbd_fd)
+			cnt = spool_rec_cnt;
 		else
 			cnt = 0;
 		if ((cnt == 0) || (slurmdbd_fd < 0) ||
@@ -2099,67 +2389,37 @@ static void *_agent(void *x)
 			continue;
 		} else if ((cnt > 0) && ((cnt % 50) == 0))
 			info("slurmdbd: agent queue size %u", cnt);
-		/* Leave item on the queue until processing complete */
-		if (agent_list) {
-			int handle_agent_count = 1000;
-			if (cnt > handle_agent_count) {
-				int agent_count = 0;
-				ListIterator agent_itr =
-					list_iterator_create(agent_list);
-				list_msg.my_list = list_create(NULL);
-				while ((buffer = list_next(agent_itr))) {
-					list_enqueue(list_msg.my_list, buffer);
-					agent_count++;
-					if (agent_count > handle_agent_count)
-						break;
-				}
-				list_iterator_destroy(agent_itr);
-				buffer = pack_slurmdbd_msg(
-					&list_req, SLURM_PROTOCOL_VERSION);
-			} else if (cnt > 1) {
-				list_msg.my_list = agent_list;
-				buffer = pack_slurmdbd_msg(
-					&list_req, SLURM_PROTOCOL_VERSION);
-			} else
-				buffer = (Buf) list_peek(agent_list);
-		} else
-			buffer = NULL;
 		slurm_mutex_unlock(&agent_lock);
-		if (buffer == NULL) {
-			slurm_mutex_unlock(&slurmdbd_lock);
-
-			slurm_mutex_lock(&assoc_cache_mutex);
-			if (slurmdbd_fd >= 0 && running_cache)
-				pthread_cond_signal(&assoc_cache_cond);
-			slurm_mutex_unlock(&assoc_cache_mutex);
-
-			continue;
-		}
 
 		/* NOTE: agent_lock is clear here, so we can add more
-		 * requests to the queue while waiting for this RPC to
-		 * complete. */
-		rc = _send_msg(buffer);
-		if (rc != SLURM_SUCCESS) {
-			if (agent_shutdown) {
-				slurm_mutex_unlock(&slurmdbd_lock);
-				break;
-			}
-			error("slurmdbd: Failure sending message: %d: %m", rc);
-		} else if (list_msg.my_list) {
-			rc = _handle_mult_rc_ret(SLURM_PROTOCOL_VERSION,
-						 read_timeout);
-		} else {
-			rc = _get_return_code(SLURM_PROTOCOL_VERSION,
-					      read_timeout);
-			if (rc == EAGAIN) {
-				if (agent_shutdown) {
-					slurm_mutex_unlock(&slurmdbd_lock);
+		 * requests to the queue while waiting for these RPCs to
+		 * complete. Items stay on the queue until acknowledged.
+		 * Keep up to agent_window frames in flight, sending
+		 * another as soon as the oldest one is answered, until the
+		 * queue drains, a message fails or some other thread needs
+		 * the connection (halt_agent). */
+		rc = SLURM_SUCCESS;
+		if (!_agent_synced())
+			rc = _sync_agent_frames(read_timeout);
+		do {
+			while ((rc == SLURM_SUCCESS) && !halt_agent &&
+			       (agent_shutdown == 0) &&
+			       (agent_frames <
+				(_agent_synced() ? agent_window : 1))) {
+				cnt = _send_agent_frame();
+				if (cnt < 0)
+					rc = SLURM_ERROR;
+				if (cnt <= 0)
 					break;
-				}
-				error("slurmdbd: Failure with "
-				      "message need to resend: %d: %m", rc);
 			}
+			if (agent_frames &&
+			    (_handle_mult_rc_ret(SLURM_PROTOCOL_VERSION,
+						 read_timeout) != SLURM_SUCCESS))
+				rc = SLURM_ERROR;
+		} while (agent_frames);
+		if ((rc != SLURM_SUCCESS) && agent_shutdown) {
+			slurm_mutex_unlock(&slurmdbd_lock);
+			break;
 		}
 		slurm_mutex_unlock(&slurmdbd_lock);
 		slurm_mutex_lock(&assoc_cache_mutex);
@@ -2167,36 +2427,10 @@ static void *_agent(void *x)
 			pthread_cond_signal(&assoc_cache_cond);
 		slurm_mutex_unlock(&assoc_cache_mutex);
 
-		slurm_mutex_lock(&agent_lock);
-		if (agent_list && (rc == SLURM_SUCCESS)) {
-			/* If we sent a mult_msg we just need to free
-			   buffer, we don't need to requeue, just mark
-			   list_msg.my_list as NULL as that is the
-			   sign we sent a mult_msg.
-			*/
-			if (list_msg.my_list) {
-				if (list_msg.my_list != agent_list)
-					list_destroy(list_msg.my_list);
-				list_msg.my_list = NULL;
-			} else
-				buffer = (Buf) list_dequeue(agent_list);
-
-			free_buf(buffer);
+		if (rc == SLURM_SUCCESS)
 			fail_time = 0;
-		} else {
-			/* We still need to free a mult_msg even if we
-			   got a failure.
-			*/
-			if (list_msg.my_list) {
-				if (list_msg.my_list != agent_list)
-					list_destroy(list_msg.my_list);
-				list_msg.my_list = NULL;
-				free_buf(buffer);
-			}
-
+		else
 			fail_time = time(NULL);
-		}
-		slurm_mutex_unlock(&agent_lock);
 		/* END_TIMER; */
 		/* info("at the end with %s", TIME_STR); */
 		if (need_to_register) {
@@ -2210,82 +2444,21 @@ static void *_agent(void *x)
 		}
 	}
 
+	_spool_sync();
 	slurm_mutex_lock(&agent_lock);
-	_save_dbd_state();
-	if (agent_list) {
-		list_destroy(agent_list);
-		agent_list = NULL;
-	}
+	_spool_close();
 	slurm_mutex_unlock(&agent_lock);
 	return NULL;
 }
 
-static void _save_dbd_state(void)
-{
-	char *dbd_fname;
-	Buf buffer;
-	int fd, rc, wrote = 0;
-	uint16_t msg_type;
-	uint32_t offset;
-
-	dbd_fname = slurm_get_state_save_location();
-	xstrcat(dbd_fname, "/dbd.messages");
-	(void) unlink(dbd_fname);	/* clear save state */
-	fd = open(dbd_fname, O_WRONLY | O_CREAT | O_TRUNC, 0600);
-	if (fd < 0) {
-		error("slurmdbd: Creating state save file %s", dbd_fname);
-	} else if (agent_list && list_count(agent_list)) {
-		char curr_ver_str[10];
-		snprintf(curr_ver_str, sizeof(curr_ver_str),
-			 "VER%d", SLURM_PROTOCOL_VERSION);
-		buffer = init_buf(strlen(curr_ver_str));
-		packstr(curr_ver_str, buffer);
-		rc = _save_dbd_rec(fd, buffer);
-		free_buf(buffer);
-		if (rc != SLURM_SUCCESS)
-			goto end_it;
-
-		while ((buffer = list_dequeue(agent_list))) {
-			/* We do not want to store registration
-			   messages.  If an admin puts in an incorrect
-			   cluster name we can get a deadlock unless
-			   they add the bogus cluster name to the
-			   accounting system.
-			*/
-			offset = get_buf_offset(buffer);
-			if (offset < 2) {
-				free_buf(buffer);
-				continue;
-			}
-			set_buf_offset(buffer, 0);
-			unpack16(&msg_type, buffer);
-			set_buf_offset(buffer, offset);
-			if (msg_type == DBD_REGISTER_CTLD) {
-				free_buf(buffer);
-				continue;
-			}
-
-			rc = _save_dbd_rec(fd, buffer);
-			free_buf(buffer);
-			if (rc != SLURM_SUCCESS)
-				break;
-			wrote++;
-		}
-	}
-
-end_it:
-	if (fd >= 0) {
-		verbose("slurmdbd: saved %d pending RPCs", wrote);
-		(void) close(fd);
-	}
-	xfree(dbd_fname);
-}
-
+/* Move the messages saved in dbd.messages by older versions of Slurm into
+ * the spool.
+ * NOTE: agent_lock must be locked */
 static void _load_dbd_state(void)
 {
 	char *dbd_fname;
 	Buf buffer;
-	int fd, recovered = 0;
+	int fd, rc, recovered = 0;
 	uint16_t rpc_version = 0;
 
 	dbd_fname = slurm_get_state_save_location();
@@ -2339,27 +2512,24 @@ static void _load_dbd_state(void)
 				 * PROTOCOL_VERSION just so we keep
 				 * things up to date.
 				 */
-				slurmdbd_msg_t msg;
-				int rc;
-				set_buf_offset(buffer, 0);
-				rc = unpack_slurmdbd_msg(
-					&msg, rpc_version, buffer);
-				free_buf(buffer);
-				if (rc == SLURM_SUCCESS)
-					buffer = pack_slurmdbd_msg(
-						&msg, SLURM_PROTOCOL_VERSION);
-				else
-					buffer = NULL;
+				buffer = _repack_dbd_rec(buffer, rpc_version);
 			}
 			if (!buffer) {
 				error("no buffer given");
 				continue;
 			}
-			if (!list_enqueue(agent_list, buffer))
-				fatal("slurmdbd: list_enqueue, no memory");
-			recovered++;
+			rc = _spool_append(buffer);
+			free_buf(buffer);
 			buffer = NULL;
+			if (rc != SLURM_SUCCESS) {
+				error("slurmdbd: spool full, keeping %s",
+				      dbd_fname);
+				goto end_it;
+			}
+			recovered++;
 		}
+		/* The records are safe in the spool now */
+		(void) unlink(dbd_fname);
 
 	end_it:
 		verbose("slurmdbd: recovered %d pending RPCs", recovered);
@@ -2368,42 +2538,20 @@ static void _load_dbd_state(void)
 	xfree(dbd_fname);
 }
 
-static int _save_dbd_rec(int fd, Buf buffer)
+/* Unpack a message packed with an older rpc_version and pack it again
+ * with SLURM_PROTOCOL_VERSION. The original buffer is freed.
+ * RET the new buffer or NULL on error */
+static Buf _repack_dbd_rec(Buf buffer, uint16_t rpc_version)
 {
-	ssize_t size, wrote;
-	uint32_t msg_size = get_buf_offset(buffer);
-	uint32_t magic = DBD_MAGIC;
-	char *msg = get_buf_data(buffer);
-
-	size = sizeof(msg_size);
-	wrote = write(fd, &msg_size, size);
-	if (wrote != size) {
-		error("slurmdbd: state save error: %m");
-		return SLURM_ERROR;
-	}
-
-	wrote = 0;
-	while (wrote < msg_size) {
-		wrote = write(fd, msg, msg_size);
-		if (wrote > 0) {
-			msg += wrote;
-			msg_size -= wrote;
-		} else if ((wrote == -1) && (errno == EINTR))
-			continue;
-		else {
-			error("slurmdbd: state save error: %m");
-			return SLURM_ERROR;
-		}
-	}
-
-	size = sizeof(magic);
-	wrote = write(fd, &magic, size);
-	if (wrote != size) {
-		error("slurmdbd: state save error: %m");
-		return SLURM_ERROR;
-	}
+	slurmdbd_msg_t msg;
+	int rc;
 
-	return SLURM_SUCCESS;
+	set_buf_offset(buffer, 0);
+	rc = unpack_slurmdbd_msg(&msg, rpc_version, buffer);
+	free_buf(buffer);
+	if (rc != SLURM_SUCCESS)
+		return NULL;
+	return pack_slurmdbd_msg(&msg, SLURM_PROTOCOL_VERSION);
 }
 
 static Buf _load_dbd_rec(int fd)
@@ -2459,34 +2607,533 @@ static void _sig_handler(int signal)
 {
 }
 
-/* Purge queued job/step start records from the agent queue
- * RET number of records purged */
-static int _purge_job_start_req(void)
+/****************************************************************************
+ * Functions for the agent's spool of pending messages
+ * NOTE: agent_lock must be locked for all of them
+ ****************************************************************************/
+static char *_spool_seg_name(uint32_t seq)
 {
-	int purged = 0;
-	ListIterator iter;
-	uint16_t msg_type;
-	uint32_t offset;
+	char *name = NULL;
+
+	xstrfmtcat(name, "%s/seg.%u", spool_dir, seq);
+	return name;
+}
+
+static int _spool_seg_map(spool_seg_t *seg)
+{
+	char *name = _spool_seg_name(seg->seq);
+	int fd;
+
+	if ((fd = open(name, O_RDWR)) < 0) {
+		error("slurmdbd: open(%s): %m", name);
+		xfree(name);
+		return SLURM_ERROR;
+	}
+	seg->addr = mmap(NULL, seg->size, PROT_READ | PROT_WRITE,
+			 MAP_SHARED, fd, 0);
+	(void) close(fd);
+	if (seg->addr == MAP_FAILED) {
+		error("slurmdbd: mmap(%s): %m", name);
+		seg->addr = NULL;
+		xfree(name);
+		return SLURM_ERROR;
+	}
+	xfree(name);
+	return SLURM_SUCCESS;
+}
+
+static void _spool_seg_unmap(spool_seg_t *seg)
+{
+	if (seg->addr) {
+		(void) msync(seg->addr, seg->size, MS_ASYNC);
+		(void) munmap(seg->addr, seg->size);
+		seg->addr = NULL;
+	}
+}
+
+static void _spool_seg_free(void *x)
+{
+	spool_seg_t *seg = (spool_seg_t *) x;
+
+	_spool_seg_unmap(seg);
+	xfree(seg);
+}
+
+/* RET the first segment with a sequence number of seq or later */
+static spool_seg_t *_spool_seg_find(uint32_t seq)
+{
+	ListIterator itr = list_iterator_create(spool_segs);
+	spool_seg_t *seg;
+
+	while ((seg = list_next(itr))) {
+		if (seg->seq >= seq)
+			break;
+	}
+	list_iterator_destroy(itr);
+	return seg;
+}
+
+/* Bytes used by a record with a message of len bytes */
+static uint32_t _spool_rec_size(uint32_t len)
+{
+	len &= ~SPOOL_REC_DEAD;
+	return sizeof(uint32_t) + ((len + 3) & ~3);
+}
+
+/* Move pos to the next record at or after it which is to be sent.
+ * RET the record's segment, mapped, or NULL if there is no such record */
+static spool_seg_t *_spool_rec(spool_pos_t *pos)
+{
+	spool_seg_t *seg;
+	uint32_t len;
+
+	while ((seg = _spool_seg_find(pos->seq))) {
+		if (seg->seq != pos->seq) {
+			pos->seq = seg->seq;
+			pos->offset = sizeof(spool_seg_hdr_t);
+		}
+		if (pos->offset >= seg->end) {
+			if (seg == spool_wseg)
+				break;
+			pos->seq++;
+			pos->offset = sizeof(spool_seg_hdr_t);
+			continue;
+		}
+		if (!seg->addr && (_spool_seg_map(seg) != SLURM_SUCCESS))
+			break;
+		len = *(uint32_t *) (seg->addr + pos->offset);
+		if (!(len & SPOOL_REC_DEAD))
+			return seg;
+		pos->offset += _spool_rec_size(len);
+	}
+	return NULL;
+}
+
+/* RET a copy of the record's message, packed with SLURM_PROTOCOL_VERSION,
+ * or NULL on error */
+static Buf _spool_rec_buf(spool_seg_t *seg, uint32_t *rec)
+{
+	uint32_t len = *rec;
+	char *data = xmalloc(len);
 	Buf buffer;
 
-	iter = list_iterator_create(agent_list);
-	while ((buffer = list_next(iter))) {
-		offset = get_buf_offset(buffer);
-		if (offset < 2)
+	memcpy(data, rec + 1, len);
+	buffer = create_buf(data, len);
+	set_buf_offset(buffer, len);
+	if (seg->rpc_version != SLURM_PROTOCOL_VERSION)
+		buffer = _repack_dbd_rec(buffer, seg->rpc_version);
+	return buffer;
+}
+
+/* Remove the segments which have been acknowledged and unmap those which
+ * the agent is not working on */
+static void _spool_trim(void)
+{
+	ListIterator itr = list_iterator_create(spool_segs);
+	spool_seg_t *seg;
+	char *name;
+
+	while ((seg = list_next(itr))) {
+		if (seg == spool_wseg)
 			continue;
-		set_buf_offset(buffer, 0);
-		unpack16(&msg_type, buffer);
-		set_buf_offset(buffer, offset);
-		if ((msg_type == DBD_JOB_START) ||
-		    (msg_type == DBD_STEP_START) ||
-		    (msg_type == DBD_STEP_COMPLETE)) {
-			list_remove(iter);
-			purged++;
+		if (seg->seq < spool_ack.seq) {
+			name = _spool_seg_name(seg->seq);
+			(void) unlink(name);
+			xfree(name);
+			list_delete_item(itr);
+		} else if (seg->seq > spool_send.seq)
+			_spool_seg_unmap(seg);
+	}
+	list_iterator_destroy(itr);
+}
+
+/* Advance spool_ack past ack_cnt records and record it in the head file */
+static void _spool_ack(int ack_cnt)
+{
+	spool_seg_t *seg;
+	uint32_t seq = spool_ack.seq;
+
+	while ((ack_cnt > 0) && (seg = _spool_rec(&spool_ack))) {
+		spool_ack.offset += _spool_rec_size(
+			*(uint32_t *) (seg->addr + spool_ack.offset));
+		spool_rec_cnt--;
+		ack_cnt--;
+	}
+	if (ack_cnt)
+		error("slurmdbd: DBD_GOT_MULT_MSG unpack message error");
+	(void) _spool_rec(&spool_ack);
+	spool_head->ack = ((uint64_t) spool_ack.seq << 32) | spool_ack.offset;
+	if (seq != spool_ack.seq)
+		_spool_trim();
+}
+
+/* Create the segment file name of size bytes with its blocks allocated
+ * and map it.
+ * NOTE: agent_lock is not needed, the agent creates spool_next without it
+ * so that posix_fallocate() does not hold up slurm_send_slurmdbd_msg() */
+static spool_seg_t *_spool_seg_alloc(char *name, uint32_t size)
+{
+	spool_seg_hdr_t *hdr;
+	spool_seg_t *seg;
+	int fd, rc;
+
+	fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) {
+		error("slurmdbd: open(%s): %m", name);
+		return NULL;
+	}
+	/* Allocate the blocks now, a full file system would otherwise
+	 * raise SIGBUS when the mapping is written */
+	if ((rc = posix_fallocate(fd, 0, size))) {
+		errno = rc;
+		error("slurmdbd: posix_fallocate(%s): %m", name);
+		(void) close(fd);
+		(void) unlink(name);
+		return NULL;
+	}
+
+	seg = xmalloc(sizeof(spool_seg_t));
+	seg->size = size;
+	seg->end = sizeof(spool_seg_hdr_t);
+	seg->rpc_version = SLURM_PROTOCOL_VERSION;
+	seg->addr = mmap(NULL, seg->size, PROT_READ | PROT_WRITE,
+			 MAP_SHARED, fd, 0);
+	(void) close(fd);
+	if (seg->addr == MAP_FAILED) {
+		error("slurmdbd: mmap(%s): %m", name);
+		(void) unlink(name);
+		xfree(seg);
+		return NULL;
+	}
+
+	hdr = (spool_seg_hdr_t *) seg->addr;
+	hdr->magic = DBD_MAGIC;
+	hdr->rpc_version = seg->rpc_version;
+	return seg;
+}
+
+/* Start a new segment with room for a record of at least rec_size bytes,
+ * taking over spool_next if the agent has it ready */
+static spool_seg_t *_spool_seg_create(uint32_t rec_size)
+{
+	static time_t full_time = 0;
+	spool_seg_t *seg = NULL;
+	uint32_t seq, size;
+	char *name, *next_name;
+
+	if (list_count(spool_segs) >= SPOOL_MAX_SEGS) {
+		if (difftime(time(NULL), full_time) > 120) {
+			full_time = time(NULL);
+			error("slurmdbd: spool %s holds %d segments",
+			      spool_dir, SPOOL_MAX_SEGS);
+		}
+		return NULL;
+	}
+
+	seq = spool_wseg ? (spool_wseg->seq + 1) : spool_ack.seq;
+	size = MAX(SPOOL_SEG_SIZE, sizeof(spool_seg_hdr_t) + rec_size +
+		   sizeof(uint32_t));
+	name = _spool_seg_name(seq);
+	if (spool_next && (spool_next->size >= size)) {
+		next_name = xstrdup_printf("%s/seg.next", spool_dir);
+		if (rename(next_name, name) == 0)
+			seg = spool_next;
+		else {
+			error("slurmdbd: rename(%s, %s): %m", next_name, name);
+			_spool_seg_free(spool_next);
+			(void) unlink(next_name);
+		}
+		spool_next = NULL;
+		xfree(next_name);
+	}
+	if (!seg && !(seg = _spool_seg_alloc(name, size))) {
+		xfree(name);
+		return NULL;
+	}
+	xfree(name);
+	seg->seq = seq;
+
+	list_append(spool_segs, seg);
+	spool_wseg = seg;
+	_spool_trim();
+	return seg;
+}
+
+/* Have the spare segment spool_next ready for _spool_seg_create(). Called
+ * by the agent without agent_lock. */
+static void _spool_prepare(void)
+{
+	static time_t fail_time = 0;
+	spool_seg_t *seg;
+	char *name = NULL;
+
+	slurm_mutex_lock(&agent_lock);
+	if (spool_segs && !spool_next &&
+	    (list_count(spool_segs) < SPOOL_MAX_SEGS) &&
+	    (difftime(time(NULL), fail_time) > 120))
+		name = xstrdup_printf("%s/seg.next", spool_dir);
+	slurm_mutex_unlock(&agent_lock);
+	if (!name)
+		return;
+
+	seg = _spool_seg_alloc(name, SPOOL_SEG_SIZE);
+	xfree(name);
+	slurm_mutex_lock(&agent_lock);
+	if (seg)
+		spool_next = seg;
+	else
+		fail_time = time(NULL);
+	slurm_mutex_unlock(&agent_lock);
+}
+
+/* Write the records appended since the last call and the head file to
+ * disk. The records live in shared mappings, so they survive slurmctld
+ * dying, but not the node crashing before the kernel writes them back.
+ * Called by the agent without agent_lock, fdatasync() of the segment
+ * files also writes their mapped pages. */
+static void _spool_sync(void)
+{
+	spool_pos_t end;
+	uint32_t seq;
+	char *name;
+	int fd;
+
+	slurm_mutex_lock(&agent_lock);
+	if (!spool_wseg) {
+		slurm_mutex_unlock(&agent_lock);
+		return;
+	}
+	end.seq = spool_wseg->seq;
+	end.offset = spool_wseg->end;
+	seq = MAX(spool_synced.seq, spool_ack.seq);
+	slurm_mutex_unlock(&agent_lock);
+	if ((spool_synced.seq == end.seq) &&
+	    (spool_synced.offset == end.offset))
+		return;
+
+	for ( ; seq <= end.seq; seq++) {
+		slurm_mutex_lock(&agent_lock);
+		name = _spool_seg_name(seq);
+		slurm_mutex_unlock(&agent_lock);
+		/* Acknowledged segments may be gone already */
+		if ((fd = open(name, O_RDONLY)) >= 0) {
+			(void) fdatasync(fd);
+			(void) close(fd);
+		}
+		xfree(name);
+	}
+	slurm_mutex_lock(&agent_lock);
+	name = xstrdup_printf("%s/head", spool_dir);
+	slurm_mutex_unlock(&agent_lock);
+	if ((fd = open(name, O_RDONLY)) >= 0) {
+		(void) fdatasync(fd);
+		(void) close(fd);
+	}
+	xfree(name);
+	spool_synced = end;
+}
+
+/* Append a copy of buffer's message to the spool */
+static int _spool_append(Buf buffer)
+{
+	uint32_t len = get_buf_offset(buffer);
+	uint32_t rec_size = _spool_rec_size(len);
+	spool_seg_t *seg = spool_wseg;
+	uint32_t *rec;
+
+	if (len & SPOOL_REC_DEAD)
+		return SLURM_ERROR;
+	/* Keep room for the zero length ending the records */
+	if (!seg || ((seg->end + rec_size + sizeof(uint32_t)) > seg->size)) {
+		if (!(seg = _spool_seg_create(rec_size)))
+			return SLURM_ERROR;
+	}
+
+	rec = (uint32_t *) (seg->addr + seg->end);
+	memcpy(rec + 1, get_buf_data(buffer), len);
+	*rec = len;
+	seg->end += rec_size;
+	spool_rec_cnt++;
+	return SLURM_SUCCESS;
+}
+
+/* Find the end of the records in a recovered segment, counting those
+ * still to be sent from offset on. Registration messages are not sent
+ * again, if an admin puts in an incorrect cluster name we can get a
+ * deadlock unless they add the bogus cluster name to the accounting
+ * system. */
+static void _spool_seg_recover(spool_seg_t *seg, uint32_t offset)
+{
+	spool_seg_hdr_t *hdr = (spool_seg_hdr_t *) seg->addr;
+	uint32_t *rec, len;
+	uint16_t msg_type;
+
+	seg->end = sizeof(spool_seg_hdr_t);
+	if ((seg->size < sizeof(spool_seg_hdr_t)) ||
+	    (hdr->magic != DBD_MAGIC)) {
+		error("slurmdbd: spool segment %u is corrupted", seg->seq);
+		return;
+	}
+	seg->rpc_version = hdr->rpc_version;
+
+	while ((seg->end + sizeof(uint32_t)) <= seg->size) {
+		rec = (uint32_t *) (seg->addr + seg->end);
+		if (!(len = *rec))
+			break;
+		if ((seg->end + _spool_rec_size(len)) > seg->size) {
+			error("slurmdbd: spool segment %u is truncated",
+			      seg->seq);
+			break;
+		}
+		if ((seg->end >= offset) && !(len & SPOOL_REC_DEAD)) {
+			memcpy(&msg_type, rec + 1, sizeof(msg_type));
+			if ((len < sizeof(msg_type)) ||
+			    (ntohs(msg_type) == DBD_REGISTER_CTLD))
+				*rec |= SPOOL_REC_DEAD;
+			else
+				spool_rec_cnt++;
 		}
+		seg->end += _spool_rec_size(len);
+	}
+}
+
+static int _spool_seq_cmp(const void *a, const void *b)
+{
+	uint32_t x = *(uint32_t *) a, y = *(uint32_t *) b;
+
+	return (x < y) ? -1 : (x > y);
+}
+
+/* Open the spool in StateSaveLocation/dbd.spool and recover the messages
+ * which were not acknowledged before */
+static int _spool_open(void)
+{
+	uint32_t *seqs = NULL, seq;
+	int i, fd, seq_cnt = 0;
+	struct dirent *ent;
+	struct stat st;
+	spool_seg_t *seg;
+	char *name;
+	DIR *dir;
+
+	spool_dir = slurm_get_state_save_location();
+	xstrcat(spool_dir, "/dbd.spool");
+	if ((mkdir(spool_dir, 0700) < 0) && (errno != EEXIST)) {
+		error("slurmdbd: mkdir(%s): %m", spool_dir);
+		xfree(spool_dir);
+		return SLURM_ERROR;
+	}
+
+	name = xstrdup_printf("%s/head", spool_dir);
+	fd = open(name, O_RDWR | O_CREAT, 0600);
+	if ((fd < 0) || (ftruncate(fd, sizeof(spool_head_t)) < 0) ||
+	    ((spool_head = mmap(NULL, sizeof(spool_head_t),
+				PROT_READ | PROT_WRITE, MAP_SHARED,
+				fd, 0)) == MAP_FAILED)) {
+		error("slurmdbd: spool head %s: %m", name);
+		if (fd >= 0)
+			(void) close(fd);
+		spool_head = NULL;
+		xfree(name);
+		xfree(spool_dir);
+		return SLURM_ERROR;
+	}
+	(void) close(fd);
+	xfree(name);
+
+	if ((dir = opendir(spool_dir))) {
+		while ((ent = readdir(dir))) {
+			if (sscanf(ent->d_name, "seg.%u", &seq) != 1)
+				continue;
+			xrealloc(seqs, sizeof(uint32_t) * (seq_cnt + 1));
+			seqs[seq_cnt++] = seq;
+		}
+		closedir(dir);
+	}
+	if (seq_cnt)
+		qsort(seqs, seq_cnt, sizeof(uint32_t), _spool_seq_cmp);
+
+	if (spool_head->magic != DBD_MAGIC) {
+		spool_head->magic = DBD_MAGIC;
+		spool_head->ack = (uint64_t) (seq_cnt ? seqs[0] : 0) << 32;
+	}
+	spool_ack.seq = spool_head->ack >> 32;
+	spool_ack.offset = MAX((uint32_t) spool_head->ack,
+			       sizeof(spool_seg_hdr_t));
+
+	spool_segs = list_create(_spool_seg_free);
+	spool_wseg = NULL;
+	spool_rec_cnt = 0;
+	memset(&spool_synced, 0, sizeof(spool_pos_t));
+	for (i = 0; i < seq_cnt; i++) {
+		name = _spool_seg_name(seqs[i]);
+		if (seqs[i] < spool_ack.seq) {
+			(void) unlink(name);
+			xfree(name);
+			continue;
+		}
+		if ((stat(name, &st) < 0) || (st.st_size > 0xffffffff)) {
+			error("slurmdbd: stat(%s): %m", name);
+			xfree(name);
+			continue;
+		}
+		xfree(name);
+		seg = xmalloc(sizeof(spool_seg_t));
+		seg->seq = seqs[i];
+		seg->size = st.st_size;
+		if (_spool_seg_map(seg) != SLURM_SUCCESS) {
+			xfree(seg);
+			continue;
+		}
+		_spool_seg_recover(seg, (seg->seq == spool_ack.seq) ?
+				   spool_ack.offset : 0);
+		_spool_seg_unmap(seg);
+		list_append(spool_segs, seg);
+		spool_wseg = seg;
+	}
+	xfree(seqs);
+
+	/* New records go to a new segment */
+	spool_send = spool_ack;
+	if (!_spool_seg_create(0)) {
+		list_destroy(spool_segs);
+		spool_segs = NULL;
+		spool_wseg = NULL;
+		(void) munmap(spool_head, sizeof(spool_head_t));
+		spool_head = NULL;
+		xfree(spool_dir);
+		return SLURM_ERROR;
+	}
+	(void) _spool_rec(&spool_ack);
+	spool_send = spool_ack;
+	if (spool_rec_cnt)
+		verbose("slurmdbd: recovered %d pending RPCs from %s",
+			spool_rec_cnt, spool_dir);
+	return SLURM_SUCCESS;
+}
+
+static void _spool_close(void)
+{
+	if (spool_segs == NULL)
+		return;
+
+	verbose("slurmdbd: %d pending RPCs left in %s",
+		spool_rec_cnt, spool_dir);
+	if (spool_next) {
+		char *name = xstrdup_printf("%s/seg.next", spool_dir);
+		_spool_seg_free(spool_next);
+		spool_next = NULL;
+		(void) unlink(name);
+		xfree(name);
 	}
-	list_iterator_destroy(iter);
-	info("slurmdbd: purge %d job/step start records", purged);
-	return purged;
+	list_destroy(spool_segs);
+	spool_segs = NULL;
+	spool_wseg = NULL;
+	(void) msync(spool_head, sizeof(spool_head_t), MS_ASYNC);
+	(void) munmap(spool_head, sizeof(spool_head_t));
+	spool_head = NULL;
+	spool_rec_cnt = 0;
+	xfree(spool_dir);
 }
 
 /****************************************************************************\
@@ -2555,6 +3202,7 @@ extern void slurmdbd_free_cond_msg(dbd_cond_msg_t *msg,
 			my_destroy = slurmdb_destroy_cluster_cond;
 			break;
 		case DBD_GET_JOBS_COND:
+		case DBD_GET_JOBS_STREAM:
 			my_destroy = slurmdb_destroy_job_cond;
 			break;
 		case DBD_GET_QOS:
@@ -2945,6 +3593,7 @@ extern void slurmdbd_pack_cond_msg(dbd_cond_msg_t *msg,
 		my_function = slurmdb_pack_cluster_cond;
 		break;
 	case DBD_GET_JOBS_COND:
+	case DBD_GET_JOBS_STREAM:
 		my_function = slurmdb_pack_job_cond;
 		break;
 	case DBD_GET_QOS:
@@ -3005,6 +3654,7 @@ extern int slurmdbd_unpack_cond_msg(dbd_cond_msg_t **msg,
 		my_function = slurmdb_unpack_cluster_cond;
 		break;
 	case DBD_GET_JOBS_COND:
+	case DBD_GET_JOBS_STREAM:
 		my_function = slurmdb_unpack_job_cond;
 		break;
 	case DBD_GET_QOS:
@@ -83,6 +83,8 @@
 #define SLURMDBD_2_6_VERSION   12	/* slurm version 2.6 */
 #define SLURMDBD_MIN_VERSION   SLURMDBD_2_6_VERSION
 
+#define SLURMDBD_TIMEOUT	900	/* Seconds SlurmDBD for response */
+
 /* SLURM DBD message types */
 /* ANY TIME YOU ADD TO THIS LIST UPDATE THE CONVERSION FUNCTIONS! */
 typedef enum {
@@ -178,6 +180,11 @@ typedef enum {
 	DBD_ADD_CLUS_RES,    	/* Add cluster using a resource    	*/
 	DBD_REMOVE_CLUS_RES,   	/* Remove existing cluster resource    	*/
 	DBD_MODIFY_CLUS_RES,   	/* Modify existing cluster resource   	*/
+	DBD_GET_JOBS_STREAM,	/* Get job information with a condition,
+				 * answered by DBD_GOT_JOBS chunks ended
+				 * with a DBD_RC			*/
+	DBD_SYNC_MULT_MSG,	/* Start pipelined DBD_SEND_MULT_MSG
+				 * frames, again after a failure	*/
 } slurmdbd_msg_type_t;
 
 /*****************************************************************************\
@@ -442,6 +449,16 @@ extern int slurm_send_recv_slurmdbd_msg(uint16_t rpc_version,
 					slurmdbd_msg_t *req,
 					slurmdbd_msg_t *resp);
 
+/* Send an RPC to the SlurmDBD and hand each reply message to "callback"
+ * until a DBD_RC ends the stream, which is returned in "resp".
+ * The callback must free the messages it is handed and return
+ * SLURM_SUCCESS to keep going.
+ * The "resp" message must be freed by the caller.
+ * Returns SLURM_SUCCESS or an error code */
+extern int slurm_send_recv_slurmdbd_stream(
+	uint16_t rpc_version, slurmdbd_msg_t *req, slurmdbd_msg_t *resp,
+	int (*callback) (slurmdbd_msg_t *msg, void *arg), void *arg);
+
 /* Send an RPC to the SlurmDBD and wait for the return code reply.
  * The RPC will not be queued if an error occurs.
  * Returns SLURM_SUCCESS or an error code */
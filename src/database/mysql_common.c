@@ -39,6 +39,8 @@
  *  Copyright (C) 2002 The Regents of the University of California.
 \*****************************************************************************/
 
+#include <ctype.h>
+
 #include "mysql_common.h"
 #include "src/common/xstring.h"
 #include "src/common/xmalloc.h"
@@ -46,6 +48,10 @@
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/read_config.h"
 
+/* Send queued statements once this much SQL is pending, well below the
+ * smallest default max_allowed_packet of the server (1MB). */
+#define MAX_BATCH_SIZE (512 * 1024)
+
 static char *table_defs_table = "table_defs_table";
 
 typedef struct {
@@ -53,6 +59,12 @@ typedef struct {
 	char *columns;
 } db_key_t;
 
+typedef struct {
+	char *head;	/* statement, or the insert up to its rows */
+	char *rows;	/* rows of a multi-row insert */
+	char *tail;	/* rest of a multi-row insert */
+} batch_stmt_t;
+
 static void _destroy_db_key(void *arg)
 {
 	db_key_t *db_key = (db_key_t *)arg;
@@ -64,6 +76,25 @@ static void _destroy_db_key(void *arg)
 	}
 }
 
+static void _destroy_batch_stmt(void *arg)
+{
+	batch_stmt_t *stmt = (batch_stmt_t *)arg;
+
+	if (stmt) {
+		xfree(stmt->head);
+		xfree(stmt->rows);
+		xfree(stmt->tail);
+		xfree(stmt);
+	}
+}
+
+static void _batch_stmt_cat(char **query, batch_stmt_t *stmt)
+{
+	xstrfmtcat(*query, "%s%s%s;", stmt->head,
+		   stmt->rows ? stmt->rows : "",
+		   stmt->tail ? stmt->tail : "");
+}
+
 /* NOTE: Insure that mysql_conn->lock is set on function entry */
 static int _clear_results(MYSQL *db_conn)
 {
@@ -168,6 +199,121 @@ end_it:
 	return rc;
 }
 
+/* Throw away the statements queued on mysql_conn, they would only ever be
+ * sent in a transaction which is being rolled back or has been lost.
+ * NOTE: Insure that mysql_conn->lock is set on function entry */
+static void _batch_discard(mysql_conn_t *mysql_conn)
+{
+	if (mysql_conn->batch_list)
+		list_flush(mysql_conn->batch_list);
+	mysql_conn->batch_size = 0;
+}
+
+/* Send the statements queued on mysql_conn, in the order they were queued,
+ * as one multi statement query.  The callers were told they went through
+ * when they were queued, so if they fail mysql_conn->batch_failed is set
+ * and mysql_db_commit() rolls the whole transaction back and fails.
+ * NOTE: Insure that mysql_conn->lock is set on function entry */
+static int _batch_flush(mysql_conn_t *mysql_conn)
+{
+	ListIterator itr;
+	batch_stmt_t *stmt, **stmts;
+	char *query = NULL;
+	int i, cnt, rc = SLURM_SUCCESS;
+
+	if (!mysql_conn->batch_list
+	    || !(cnt = list_count(mysql_conn->batch_list)))
+		return SLURM_SUCCESS;
+
+	/* batch_list has the newest statement first */
+	stmts = xmalloc(sizeof(batch_stmt_t *) * cnt);
+	i = cnt;
+	itr = list_iterator_create(mysql_conn->batch_list);
+	while ((stmt = list_next(itr)) && i)
+		stmts[--i] = stmt;
+	list_iterator_destroy(itr);
+
+	for (i = 0; i < cnt; i++)
+		_batch_stmt_cat(&query, stmts[i]);
+	if ((_mysql_query_internal(mysql_conn->db_conn, query)
+	     != SLURM_SUCCESS)
+	    || (_clear_results(mysql_conn->db_conn) != SLURM_SUCCESS)) {
+		error("batch of %d statements failed", cnt);
+		mysql_conn->batch_failed = true;
+		rc = SLURM_ERROR;
+	}
+	xfree(query);
+	xfree(stmts);
+	_batch_discard(mysql_conn);
+
+	return rc;
+}
+
+/* NOTE: Insure that mysql_conn->lock is NOT set on function entry */
+static int _batch_add(mysql_conn_t *mysql_conn, char *head, char *row,
+		      char *tail)
+{
+	batch_stmt_t *stmt = NULL;
+	char *query = NULL;
+	int len, rc = SLURM_SUCCESS;
+
+	if (!mysql_conn || !mysql_conn->db_conn) {
+		fatal("You haven't inited this storage yet.");
+		return 0;	/* For CLANG false positive */
+	}
+
+	if (!mysql_conn->rollback) {
+		/* autocommit, nothing would send the batch in time */
+		query = xstrdup_printf("%s%s%s", head,
+				       row ? row : "", tail ? tail : "");
+		rc = mysql_db_query(mysql_conn, query);
+		xfree(query);
+		return rc;
+	}
+
+	slurm_mutex_lock(&mysql_conn->lock);
+	if (!mysql_conn->batch_list)
+		mysql_conn->batch_list = list_create(_destroy_batch_stmt);
+
+	if (row) {
+		stmt = list_peek(mysql_conn->batch_list);
+		if (stmt && (!stmt->rows || xstrcmp(stmt->head, head)
+			     || xstrcmp(stmt->tail, tail)))
+			stmt = NULL;
+	}
+
+	if (stmt) {
+		len = strlen(row) + 2;
+		xstrfmtcat(stmt->rows, ", %s", row);
+	} else {
+		stmt = xmalloc(sizeof(batch_stmt_t));
+		if (row) {
+			stmt->head = xstrdup(head);
+			stmt->rows = xstrdup(row);
+			stmt->tail = xstrdup(tail);
+			len = strlen(head) + strlen(row) + 1;
+			if (tail)
+				len += strlen(tail);
+		} else {
+			/* the statements get joined with ';' */
+			len = strlen(head);
+			while (len && ((head[len - 1] == ';')
+				       || isspace((int)head[len - 1])))
+				len--;
+			xstrncat(stmt->head, head, len);
+			len++;
+		}
+		list_push(mysql_conn->batch_list, stmt);
+	}
+
+	mysql_conn->batch_size += len;
+	if (mysql_conn->batch_size >= MAX_BATCH_SIZE)
+		rc = _batch_flush(mysql_conn);
+	slurm_mutex_unlock(&mysql_conn->lock);
+
+	return rc;
+}
+
 /* NOTE: Insure that mysql_conn->lock is NOT set on function entry */
 static int _mysql_make_table_current(mysql_conn_t *mysql_conn, char *table_name,
 				     storage_field_t *fields, char *ending)
@@ -593,6 +739,8 @@ extern int destroy_mysql_conn(mysql_conn_t *mysql_conn)
 {
 	if (mysql_conn) {
 		mysql_db_close_db_connection(mysql_conn);
+		if (mysql_conn->batch_list)
+			list_destroy(mysql_conn->batch_list);
 		xfree(mysql_conn->pre_commit_query);
 		xfree(mysql_conn->cluster_name);
 		slurm_mutex_destroy(&mysql_conn->lock);
@@ -726,6 +874,8 @@ extern int mysql_db_close_db_connection(mysql_conn_t *mysql_conn)
 {
 	slurm_mutex_lock(&mysql_conn->lock);
 	if (mysql_conn && mysql_conn->db_conn) {
+		_batch_discard(mysql_conn);
+		mysql_conn->batch_failed = false;
 		if (mysql_thread_safe())
 			mysql_thread_end();
 		mysql_close(mysql_conn->db_conn);
@@ -757,7 +907,9 @@ extern int mysql_db_query(mysql_conn_t *mysql_conn, char *query)
 		return 0;	/* For CLANG false positive */
 	}
 	slurm_mutex_lock(&mysql_conn->lock);
-	rc = _mysql_query_internal(mysql_conn->db_conn, query);
+	/* Statements after a failed batch must not go through either */
+	if ((rc = _batch_flush(mysql_conn)) == SLURM_SUCCESS)
+		rc = _mysql_query_internal(mysql_conn->db_conn, query);
 	slurm_mutex_unlock(&mysql_conn->lock);
 	return rc;
 }
@@ -785,6 +937,21 @@ extern int mysql_db_commit(mysql_conn_t *mysql_conn)
 		return SLURM_ERROR;
 
 	slurm_mutex_lock(&mysql_conn->lock);
+	if ((_batch_flush(mysql_conn) != SLURM_SUCCESS) ||
+	    mysql_conn->batch_failed) {
+		/* The callers were told the queued statements went
+		 * through, undo the whole transaction so they can be
+		 * sent again instead of committing part of it */
+		error("queued statements failed, rolling back");
+		mysql_conn->batch_failed = false;
+		_clear_results(mysql_conn->db_conn);
+		if (mysql_rollback(mysql_conn->db_conn))
+			error("mysql_rollback failed: %d %s",
+			      mysql_errno(mysql_conn->db_conn),
+			      mysql_error(mysql_conn->db_conn));
+		slurm_mutex_unlock(&mysql_conn->lock);
+		return SLURM_ERROR;
+	}
 	/* clear out the old results so we don't get a 2014 error */
 	_clear_results(mysql_conn->db_conn);
 	if (mysql_commit(mysql_conn->db_conn)) {
@@ -806,6 +973,8 @@ extern int mysql_db_rollback(mysql_conn_t *mysql_conn)
 		return SLURM_ERROR;
 
 	slurm_mutex_lock(&mysql_conn->lock);
+	_batch_discard(mysql_conn);
+	mysql_conn->batch_failed = false;
 	/* clear out the old results so we don't get a 2014 error */
 	_clear_results(mysql_conn->db_conn);
 	if (mysql_rollback(mysql_conn->db_conn)) {
@@ -826,6 +995,8 @@ extern MYSQL_RES *mysql_db_query_ret(mysql_conn_t *mysql_conn,
 	MYSQL_RES *result = NULL;
 
 	slurm_mutex_lock(&mysql_conn->lock);
+	if (_batch_flush(mysql_conn) != SLURM_SUCCESS)
+		goto fini;
 	if (_mysql_query_internal(mysql_conn->db_conn, query) != SLURM_ERROR)  {
 		if (mysql_errno(mysql_conn->db_conn) == ER_NO_SUCH_TABLE)
 			goto fini;
@@ -850,8 +1021,9 @@ extern int mysql_db_query_check_after(mysql_conn_t *mysql_conn, char *query)
 	int rc = SLURM_SUCCESS;
 
 	slurm_mutex_lock(&mysql_conn->lock);
-	if ((rc = _mysql_query_internal(
-		     mysql_conn->db_conn, query)) != SLURM_ERROR)
+	if (((rc = _batch_flush(mysql_conn)) == SLURM_SUCCESS) &&
+	    ((rc = _mysql_query_internal(
+		      mysql_conn->db_conn, query)) != SLURM_ERROR))
 		rc = _clear_results(mysql_conn->db_conn);
 	slurm_mutex_unlock(&mysql_conn->lock);
 	return rc;
@@ -862,7 +1034,9 @@ extern int mysql_db_insert_ret_id(mysql_conn_t *mysql_conn, char *query)
 	int new_id = 0;
 
 	slurm_mutex_lock(&mysql_conn->lock);
-	if (_mysql_query_internal(mysql_conn->db_conn, query) != SLURM_ERROR)  {
+	if ((_batch_flush(mysql_conn) == SLURM_SUCCESS) &&
+	    (_mysql_query_internal(mysql_conn->db_conn, query)
+	     != SLURM_ERROR)) {
 		new_id = mysql_insert_id(mysql_conn->db_conn);
 		if (!new_id) {
 			/* should have new id */
@@ -875,6 +1049,17 @@ extern int mysql_db_insert_ret_id(mysql_conn_t *mysql_conn, char *query)
 
 }
 
+extern int mysql_db_batch_query(mysql_conn_t *mysql_conn, char *query)
+{
+	return _batch_add(mysql_conn, query, NULL, NULL);
+}
+
+extern int mysql_db_batch_insert(mysql_conn_t *mysql_conn, char *head,
+				 char *row, char *tail)
+{
+	return _batch_add(mysql_conn, head, row, tail);
+}
+
 extern int mysql_db_create_table(mysql_conn_t *mysql_conn, char *table_name,
 				 storage_field_t *fields, char *ending)
 {
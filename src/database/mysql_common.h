@@ -70,6 +70,10 @@ typedef enum {
 } slurm_mysql_plugin_type_t;
 
 typedef struct {
+	List batch_list; /* statements queued by mysql_db_batch_*() */
+	uint32_t batch_size; /* bytes of SQL in batch_list */
+	bool batch_failed; /* queued statements failed since the last commit,
+			    * mysql_db_commit() will roll back instead */
 	bool cluster_deleted;
 	char *cluster_name;
 	MYSQL *db_conn;
@@ -114,6 +118,23 @@ extern int mysql_db_query_check_after(mysql_conn_t *mysql_conn, char *query);
 
 extern int mysql_db_insert_ret_id(mysql_conn_t *mysql_conn, char *query);
 
+/* Queue query, which must not return a result, to be sent on a
+ * transactional (rollback) connection together with other queued statements
+ * just before anything else is sent on it or it is committed.  On other
+ * connections the query is sent right away.  If the queued statements fail,
+ * the call sending them fails and so does the next mysql_db_commit(), which
+ * rolls the transaction back.
+ */
+extern int mysql_db_batch_query(mysql_conn_t *mysql_conn, char *query);
+
+/* Like mysql_db_batch_query() for the insert "head row tail".  Rows queued
+ * back to back with the same head and tail are sent as one multi-row insert,
+ * so any "on duplicate key update" in tail must use VALUES() to refer to the
+ * row being inserted.
+ */
+extern int mysql_db_batch_insert(mysql_conn_t *mysql_conn, char *head,
+				 char *row, char *tail);
+
 extern int mysql_db_create_table(mysql_conn_t *mysql_conn, char *table_name,
 				 storage_field_t *fields, char *ending);
 
@@ -90,6 +90,20 @@ extern List slurmdb_jobs_get(void *db_conn, slurmdb_job_cond_t *job_cond)
 	return jobacct_storage_g_get_jobs_cond(db_conn, getuid(), job_cond);
 }
 
+/*
+ * get info from the storage a chunk at a time instead of all at once
+ * IN:  slurmdb_job_cond_t *
+ * IN:  callback - handed each chunk of slurmdb_job_rec_t *'s in order
+ * IN:  arg - passed through to callback
+ * RET: SLURM_SUCCESS or error code
+ */
+extern int slurmdb_jobs_get_cb(void *db_conn, slurmdb_job_cond_t *job_cond,
+			       slurmdb_job_list_cb_t callback, void *arg)
+{
+	return jobacct_storage_g_get_jobs_cb(db_conn, getuid(), job_cond,
+					     callback, arg);
+}
+
 /*
  * get info from the storage
  * IN:  slurmdb_assoc_cond_t *
@@ -1003,6 +1003,27 @@ extern List jobacct_storage_p_get_jobs_cond(void *db_conn, uid_t uid,
 	return filetxt_jobacct_process_get_jobs(job_cond);
 }
 
+/*
+ * get info from the storage a chunk at a time, the file is read all at
+ * once so there is only ever the one chunk
+ * RET: SLURM_SUCCESS or error code
+ */
+extern int jobacct_storage_p_get_jobs_cb(void *db_conn, uid_t uid,
+					 slurmdb_job_cond_t *job_cond,
+					 slurmdb_job_list_cb_t callback,
+					 void *arg)
+{
+	int rc;
+	List job_list = filetxt_jobacct_process_get_jobs(job_cond);
+
+	if (!job_list)
+		return SLURM_ERROR;
+	rc = (*callback)(job_list, arg);
+	list_destroy(job_list);
+
+	return rc;
+}
+
 /*
  * expire old info from the storage
  */
@@ -2228,12 +2228,12 @@ extern int acct_storage_p_commit(mysql_conn_t *mysql_conn, bool commit)
 
 	debug4("got %d commits", list_count(mysql_conn->update_list));
 
+	rc = SLURM_SUCCESS;
 	if (mysql_conn->rollback) {
 		if (!commit) {
 			if (mysql_db_rollback(mysql_conn))
 				error("rollback failed");
 		} else {
-			int rc = SLURM_SUCCESS;
 			/* Handle anything here we were unable to do
 			   because of rollback issues.  i.e. Since any
 			   use of altering a tables
@@ -2252,14 +2252,15 @@ extern int acct_storage_p_commit(mysql_conn_t *mysql_conn, bool commit)
 			if (rc != SLURM_SUCCESS) {
 				if (mysql_db_rollback(mysql_conn))
 					error("rollback failed");
-			} else {
-				if (mysql_db_commit(mysql_conn))
-					error("commit failed");
-			}
+			} else if ((rc = mysql_db_commit(mysql_conn))
+				   != SLURM_SUCCESS)
+				error("commit failed");
 		}
 	}
 
-	if (commit && list_count(mysql_conn->update_list)) {
+	/* Nothing to tell anyone about if the changes were rolled back */
+	if (commit && (rc == SLURM_SUCCESS) &&
+	    list_count(mysql_conn->update_list)) {
 		char *query = NULL;
 		MYSQL_RES *result = NULL;
 		MYSQL_ROW row;
@@ -2326,7 +2327,7 @@ extern int acct_storage_p_commit(mysql_conn_t *mysql_conn, bool commit)
 	xfree(mysql_conn->pre_commit_query);
 	list_flush(mysql_conn->update_list);
 
-	return SLURM_SUCCESS;
+	return rc;
 }
 
 extern int acct_storage_p_add_users(mysql_conn_t *mysql_conn, uint32_t uid,
@@ -2570,6 +2571,9 @@ end_it:
 
 extern List acct_storage_p_get_config(void *db_conn, char *config_name)
 {
+	if (config_name && !strcmp(config_name, "rollup_stats"))
+		return as_mysql_get_rollup_stats();
+
 	return NULL;
 }
 
@@ -2790,6 +2794,23 @@ extern List jobacct_storage_p_get_jobs_cond(mysql_conn_t *mysql_conn,
 	return job_list;
 }
 
+/*
+ * get info from the storage a window of jobs at a time
+ * RET: SLURM_SUCCESS or error code
+ */
+extern int jobacct_storage_p_get_jobs_cb(mysql_conn_t *mysql_conn,
+					 uid_t uid,
+					 slurmdb_job_cond_t *job_cond,
+					 slurmdb_job_list_cb_t callback,
+					 void *arg)
+{
+	if (check_connection(mysql_conn) != SLURM_SUCCESS)
+		return ESLURM_DB_CONNECTION;
+
+	return as_mysql_jobacct_process_get_jobs_cb(mysql_conn, uid, job_cond,
+						    callback, arg);
+}
+
 /*
  * expire old info from the storage
  */
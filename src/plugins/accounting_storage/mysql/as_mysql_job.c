@@ -882,7 +882,7 @@ extern int as_mysql_job_complete(mysql_conn_t *mysql_conn,
 
 	if (debug_flags & DEBUG_FLAG_DB_JOB)
 		DB_DEBUG(mysql_conn->conn, "query\n%s", query);
-	rc = mysql_db_query(mysql_conn, query);
+	rc = mysql_db_batch_query(mysql_conn, query);
 	xfree(query);
 
 	return rc;
@@ -896,7 +896,7 @@ extern int as_mysql_step_start(mysql_conn_t *mysql_conn,
 	char node_list[BUFFER_SIZE];
 	char *node_inx = NULL, *step_name = NULL;
 	time_t start_time, submit_time;
-	char *query = NULL;
+	char *query = NULL, *row = NULL, *tail = NULL;
 
 	if (!step_ptr->job_ptr->db_index
 	    && ((!step_ptr->job_ptr->details
@@ -1010,30 +1010,38 @@ extern int as_mysql_step_start(mysql_conn_t *mysql_conn,
 
 	step_name = slurm_add_slash_to_quotes(step_ptr->name);
 
-	/* we want to print a -1 for the requid so leave it a
-	   %d */
-	/* The stepid could be -2 so use %d not %u */
+	/* Steps started one after the other are sent as one multi-row
+	 * insert, so only refer to the row itself in the update part.
+	 */
 	query = xstrdup_printf(
 		"insert into \"%s_%s\" (job_db_inx, id_step, time_start, "
 		"step_name, state, "
 		"cpus_alloc, nodes_alloc, task_cnt, nodelist, "
-		"node_inx, task_dist, req_cpufreq) "
-		"values (%d, %d, %d, '%s', %d, %d, %d, %d, "
-		"'%s', '%s', %d, %u) "
-		"on duplicate key update cpus_alloc=%d, nodes_alloc=%d, "
-		"task_cnt=%d, time_end=0, state=%d, "
-		"nodelist='%s', node_inx='%s', task_dist=%d, req_cpufreq=%u",
-		mysql_conn->cluster_name, step_table,
+		"node_inx, task_dist, req_cpufreq) values ",
+		mysql_conn->cluster_name, step_table);
+	/* we want to print a -1 for the requid so leave it a
+	   %d */
+	/* The stepid could be -2 so use %d not %u */
+	row = xstrdup_printf(
+		"(%d, %d, %d, '%s', %d, %d, %d, %d, '%s', '%s', %d, %u)",
 		step_ptr->job_ptr->db_index,
 		step_ptr->step_id,
 		(int)start_time, step_name,
 		JOB_RUNNING, cpus, nodes, tasks, node_list, node_inx, task_dist,
-		step_ptr->cpu_freq, cpus, nodes, tasks, JOB_RUNNING,
-		node_list, node_inx, task_dist, step_ptr->cpu_freq);
+		step_ptr->cpu_freq);
+	tail = xstrdup(
+		" on duplicate key update cpus_alloc=VALUES(cpus_alloc), "
+		"nodes_alloc=VALUES(nodes_alloc), task_cnt=VALUES(task_cnt), "
+		"time_end=0, state=VALUES(state), "
+		"nodelist=VALUES(nodelist), node_inx=VALUES(node_inx), "
+		"task_dist=VALUES(task_dist), "
+		"req_cpufreq=VALUES(req_cpufreq)");
 	if (debug_flags & DEBUG_FLAG_DB_STEP)
-		DB_DEBUG(mysql_conn->conn, "query\n%s", query);
-	rc = mysql_db_query(mysql_conn, query);
+		DB_DEBUG(mysql_conn->conn, "query\n%s%s%s", query, row, tail);
+	rc = mysql_db_batch_insert(mysql_conn, query, row, tail);
 	xfree(query);
+	xfree(row);
+	xfree(tail);
 	xfree(step_name);
 
 	return rc;
@@ -1219,7 +1227,7 @@ extern int as_mysql_step_complete(mysql_conn_t *mysql_conn,
 		step_ptr->job_ptr->db_index, step_ptr->step_id);
 	if (debug_flags & DEBUG_FLAG_DB_STEP)
 		DB_DEBUG(mysql_conn->conn, "query\n%s", query);
-	rc = mysql_db_query(mysql_conn, query);
+	rc = mysql_db_batch_query(mysql_conn, query);
 	xfree(query);
 
 	return rc;
@@ -44,6 +44,10 @@
 
 #include "as_mysql_jobacct_process.h"
 
+/* Number of job records read from the database at a time when the jobs
+ * are handed to a callback instead of returned in one List */
+#define JOB_WINDOW_SIZE 1000
+
 typedef struct {
 	hostlist_t hl;
 	time_t start;
@@ -51,6 +55,21 @@ typedef struct {
 	bitstr_t *asked_bitmap;
 } local_cluster_t;
 
+typedef struct {
+	void *arg;
+	slurmdb_job_list_cb_t callback; /* if NULL read everything at once */
+	bool done;		/* no more windows to read */
+	bool has_where;		/* query already has a where clause */
+	List job_list;		/* jobs of the current window */
+	uint32_t min_id;	/* smallest id_job of the next window */
+	mysql_conn_t *mysql_conn;
+	char *query;		/* job query without window or grouping */
+	int rc;
+	MYSQL_RES *result;	/* current window */
+	bool single_id;		/* next window is all records of min_id */
+	uint32_t stop_id;	/* id_job starting the next window */
+} job_window_t;
+
 /* if this changes you will need to edit the corresponding
  * enum below also t1 is job_table */
 char *job_req_inx[] = {
@@ -347,13 +366,104 @@ static void _destroy_local_cluster(void *object)
 	}
 }
 
+/* Return the next job row, reading the next window of jobs when the
+ * current one runs out.  With a callback the jobs made from a window are
+ * handed to it before the next window is read, so only JOB_WINDOW_SIZE
+ * records are ever held.  A window never ends part way through the
+ * records of one id_job so duplicates can still be found.
+ * Returns NULL once there are no more rows or on error (window->rc). */
+static MYSQL_ROW _fetch_job_row(job_window_t *window)
+{
+	MYSQL_ROW row;
+	char *query;
+	uint64_t row_cnt;
+
+	while (1) {
+		if (window->result) {
+			if ((row = mysql_fetch_row(window->result))
+			    && (slurm_atoul(row[JOB_REQ_JOBID]) !=
+				window->stop_id))
+				return row;
+			mysql_free_result(window->result);
+			window->result = NULL;
+
+			if (window->callback && list_count(window->job_list)) {
+				window->rc = (*(window->callback))(
+					window->job_list, window->arg);
+				list_flush(window->job_list);
+				if (window->rc != SLURM_SUCCESS)
+					return NULL;
+			}
+		}
+
+		if (window->done)
+			return NULL;
+
+		query = xstrdup(window->query);
+		if (window->single_id)
+			xstrfmtcat(query, "%s t1.id_job=%u",
+				   window->has_where ? " &&" : " where",
+				   window->min_id);
+		else if (window->min_id)
+			xstrfmtcat(query, "%s t1.id_job>=%u",
+				   window->has_where ? " &&" : " where",
+				   window->min_id);
+
+		/* Here we want to order them this way in such a way so it is
+		   easy to look for duplicates, it is also easy to sort the
+		   resized jobs.
+		*/
+		xstrcat(query, " group by id_job, time_submit desc");
+		if (window->callback && !window->single_id)
+			xstrfmtcat(query, " limit %u", JOB_WINDOW_SIZE);
+
+		if (debug_flags & DEBUG_FLAG_DB_JOB)
+			DB_DEBUG(window->mysql_conn->conn, "query\n%s", query);
+		if (!(window->result = mysql_db_query_ret(
+			      window->mysql_conn, query, 0))) {
+			xfree(query);
+			window->rc = SLURM_ERROR;
+			return NULL;
+		}
+		xfree(query);
+
+		window->stop_id = NO_VAL;
+		row_cnt = mysql_num_rows(window->result);
+		if (window->single_id) {
+			window->single_id = false;
+			window->min_id++;
+		} else if (!window->callback || (row_cnt < JOB_WINDOW_SIZE)) {
+			window->done = true;
+		} else {
+			/* The last id_job may go on in the next window,
+			   leave all of its records for that one. */
+			mysql_data_seek(window->result, row_cnt - 1);
+			row = mysql_fetch_row(window->result);
+			window->stop_id = slurm_atoul(row[JOB_REQ_JOBID]);
+			window->min_id = window->stop_id;
+			mysql_data_seek(window->result, 0);
+			row = mysql_fetch_row(window->result);
+			mysql_data_seek(window->result, 0);
+			if (slurm_atoul(row[JOB_REQ_JOBID]) ==
+			    window->stop_id) {
+				/* The whole window is the one id_job,
+				   read all of its records by themselves. */
+				mysql_free_result(window->result);
+				window->result = NULL;
+				window->single_id = true;
+			}
+		}
+	}
+}
+
 static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 			     slurmdb_user_rec_t *user,
 			     slurmdb_job_cond_t *job_cond,
 			     char *cluster_name,
 			     char *job_fields, char *step_fields,
 			     char *sent_extra,
-			     bool is_admin, int only_pending, List sent_list)
+			     bool is_admin, int only_pending, List sent_list,
+			     slurmdb_job_list_cb_t callback, void *arg)
 {
 	char *query = NULL;
 	char *extra = xstrdup(sent_extra);
@@ -372,6 +482,9 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 	int rc = SLURM_SUCCESS;
 	int last_id = -1, curr_id = -1;
 	local_cluster_t *curr_cluster = NULL;
+	job_window_t window;
+
+	memset(&window, 0, sizeof(job_window_t));
 
 	/* This is here to make sure we are looking at only this user
 	 * if this flag is set.  We also include any accounts they may be
@@ -451,24 +564,9 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 	if (extra) {
 		xstrcat(query, extra);
 		xfree(extra);
+		window.has_where = true;
 	}
 
-	/* Here we want to order them this way in such a way so it is
-	   easy to look for duplicates, it is also easy to sort the
-	   resized jobs.
-	*/
-	xstrcat(query, " group by id_job, time_submit desc");
-
-	if (debug_flags & DEBUG_FLAG_DB_JOB)
-		DB_DEBUG(mysql_conn->conn, "query\n%s", query);
-	if (!(result = mysql_db_query_ret(mysql_conn, query, 0))) {
-		xfree(query);
-		rc = SLURM_ERROR;
-		goto end_it;
-	}
-	xfree(query);
-
-
 	/* Here we set up environment to check used nodes of jobs.
 	   Since we store the bitmap of the entire cluster we can use
 	   that to set up a hostlist and set up the bitmap to make
@@ -479,12 +577,20 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 		local_cluster_list = setup_cluster_list_with_inx(
 			mysql_conn, job_cond, (void **)&curr_cluster);
 		if (!local_cluster_list) {
+			xfree(query);
 			rc = SLURM_ERROR;
 			goto end_it;
 		}
 	}
 
-	while ((row = mysql_fetch_row(result))) {
+	window.arg = arg;
+	window.callback = callback;
+	window.job_list = job_list;
+	window.mysql_conn = mysql_conn;
+	window.query = query;
+	query = NULL;
+
+	while ((row = _fetch_job_row(&window))) {
 		char *id = row[JOB_REQ_ID];
 		bool job_ended = 0;
 		int submit = slurm_atoul(row[JOB_REQ_SUBMIT]);
@@ -911,13 +1017,17 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 		/* need to reset here to make the above test valid */
 		step = NULL;
 	}
-	mysql_free_result(result);
+	rc = window.rc;
 
 end_it:
+	if (window.result)
+		mysql_free_result(window.result);
+	xfree(window.query);
+
 	if (local_cluster_list)
 		list_destroy(local_cluster_list);
 
-	if (rc == SLURM_SUCCESS)
+	if ((rc == SLURM_SUCCESS) && sent_list)
 		list_transfer(sent_list, job_list);
 
 	list_destroy(job_list);
@@ -1520,20 +1630,21 @@ extern int setup_job_cond_limits(mysql_conn_t *mysql_conn,
 	return set;
 }
 
-extern List as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
-					      uid_t uid,
-					      slurmdb_job_cond_t *job_cond)
+/* Get the jobs either into job_list or, if callback is set, handed to it
+ * a window at a time. */
+static int _get_jobs(mysql_conn_t *mysql_conn, uid_t uid,
+		     slurmdb_job_cond_t *job_cond, List job_list,
+		     slurmdb_job_list_cb_t callback, void *arg)
 {
 	char *extra = NULL;
 	char *tmp = NULL, *tmp2 = NULL;
 	ListIterator itr = NULL;
 	int is_admin=1;
-	int i;
-	List job_list = NULL;
+	int i, rc = SLURM_SUCCESS;
 	uint16_t private_data = 0;
 	slurmdb_user_rec_t user;
 	int only_pending = 0;
-	List use_cluster_list = as_mysql_cluster_list;
+	List use_cluster_list = NULL, cluster_copy = NULL;
 	char *cluster_name;
 
 	memset(&user, 0, sizeof(slurmdb_user_rec_t));
@@ -1552,7 +1663,7 @@ extern List as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
 		if (!is_admin && !user.name) {
 			debug("User %u has no assocations, and is not admin, "
 			      "so not returning any jobs.", user.uid);
-			return NULL;
+			return SLURM_SUCCESS;
 		}
 	}
 
@@ -1578,28 +1689,63 @@ extern List as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
 	if (job_cond
 	    && job_cond->cluster_list && list_count(job_cond->cluster_list))
 		use_cluster_list = job_cond->cluster_list;
-	else
+	else {
+		/* Work on a copy, the jobs may be handed to a callback
+		 * which writes them to a client that is slow to read */
+		use_cluster_list = cluster_copy =
+			list_create(slurm_destroy_char);
 		slurm_mutex_lock(&as_mysql_cluster_list_lock);
+		itr = list_iterator_create(as_mysql_cluster_list);
+		while ((cluster_name = list_next(itr)))
+			list_append(use_cluster_list, xstrdup(cluster_name));
+		list_iterator_destroy(itr);
+		slurm_mutex_unlock(&as_mysql_cluster_list_lock);
+	}
 
-	job_list = list_create(slurmdb_destroy_job_rec);
 	itr = list_iterator_create(use_cluster_list);
 	while ((cluster_name = list_next(itr))) {
-		int rc;
 		if ((rc = _cluster_get_jobs(mysql_conn, &user, job_cond,
 					    cluster_name, tmp, tmp2, extra,
-					    is_admin, only_pending, job_list))
-		    != SLURM_SUCCESS)
+					    is_admin, only_pending, job_list,
+					    callback, arg))
+		    != SLURM_SUCCESS) {
 			error("Problem getting jobs for cluster %s",
 			      cluster_name);
+			/* Some of the jobs may have already been handed
+			   out, don't go on as if nothing happened. */
+			if (callback)
+				break;
+			rc = SLURM_SUCCESS;
+		}
 	}
 	list_iterator_destroy(itr);
 
-	if (use_cluster_list == as_mysql_cluster_list)
-		slurm_mutex_unlock(&as_mysql_cluster_list_lock);
+	if (cluster_copy)
+		list_destroy(cluster_copy);
 
 	xfree(tmp);
 	xfree(tmp2);
 	xfree(extra);
 
+	return rc;
+}
+
+extern List as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
+					      uid_t uid,
+					      slurmdb_job_cond_t *job_cond)
+{
+	List job_list = list_create(slurmdb_destroy_job_rec);
+
+	_get_jobs(mysql_conn, uid, job_cond, job_list, NULL, NULL);
+
 	return job_list;
 }
+
+extern int as_mysql_jobacct_process_get_jobs_cb(mysql_conn_t *mysql_conn,
+						uid_t uid,
+						slurmdb_job_cond_t *job_cond,
+						slurmdb_job_list_cb_t callback,
+						void *arg)
+{
+	return _get_jobs(mysql_conn, uid, job_cond, NULL, callback, arg);
+}
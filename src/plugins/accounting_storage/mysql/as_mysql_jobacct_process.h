@@ -62,4 +62,12 @@ extern int setup_job_cond_limits(mysql_conn_t *mysql_conn,
 extern List as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn, uid_t uid,
 					   slurmdb_job_cond_t *job_cond);
 
+/* Same as as_mysql_jobacct_process_get_jobs() except the jobs are handed
+ * to callback as they are read instead of returned in one List */
+extern int as_mysql_jobacct_process_get_jobs_cb(mysql_conn_t *mysql_conn,
+						uid_t uid,
+						slurmdb_job_cond_t *job_cond,
+						slurmdb_job_list_cb_t callback,
+						void *arg);
+
 #endif
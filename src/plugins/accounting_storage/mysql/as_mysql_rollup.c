@@ -41,9 +41,19 @@
 #include "as_mysql_rollup.h"
 #include "as_mysql_archive.h"
 #include "src/common/parse_time.h"
+#include "src/common/xhash.h"
+
+/* Hours are rolled up independently of each other, so a long stretch of
+ * them (i.e. catching up after the slurmdbd was down) is split over up to
+ * this many threads, each with its own connection and transaction.
+ */
+#define MAX_ROLLUP_THREADS 4
+/* Fewest hours worth handing to a thread of their own */
+#define MIN_ROLLUP_THREAD_HOURS 6
 
 typedef struct {
 	int id;
+	char id_str[11]; /* id as a string, key in the xhash tables */
 	uint64_t a_cpu;
 	uint64_t energy;
 } local_id_usage_t;
@@ -73,6 +83,15 @@ typedef struct {
 	time_t end;
 } local_resv_usage_t;
 
+typedef struct {
+	char *cluster_name;
+	int conn;
+	time_t end;
+	time_t now;
+	int rc;
+	time_t start;
+} local_hour_range_t;
+
 static void _destroy_local_id_usage(void *object)
 {
 	local_id_usage_t *a_usage = (local_id_usage_t *)object;
@@ -81,6 +100,35 @@ static void _destroy_local_id_usage(void *object)
 	}
 }
 
+static const char *_local_id_usage_key(void *object)
+{
+	local_id_usage_t *usage = (local_id_usage_t *)object;
+
+	return usage->id_str;
+}
+
+/* Find the usage record for id in usage_hash, adding a new one to both
+ * usage_list and usage_hash if there isn't one yet.
+ */
+static local_id_usage_t *_get_id_usage(List usage_list, xhash_t *usage_hash,
+				       uint32_t id)
+{
+	local_id_usage_t *usage;
+	char id_str[11];
+
+	snprintf(id_str, sizeof(id_str), "%u", id);
+	if ((usage = xhash_get(usage_hash, id_str)))
+		return usage;
+
+	usage = xmalloc(sizeof(local_id_usage_t));
+	usage->id = id;
+	strcpy(usage->id_str, id_str);
+	list_append(usage_list, usage);
+	xhash_add(usage_hash, usage);
+
+	return usage;
+}
+
 static void _destroy_local_cluster_usage(void *object)
 {
 	local_cluster_usage_t *c_usage = (local_cluster_usage_t *)object;
@@ -457,15 +505,13 @@ static local_cluster_usage_t *_setup_cluster_usage(mysql_conn_t *mysql_conn,
 	return c_usage;
 }
 
-extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
-				  char *cluster_name,
-				  time_t start, time_t end,
-				  uint16_t archive_data)
+/* Roll up the hours from start to end on mysql_conn */
+static int _hourly_rollup(mysql_conn_t *mysql_conn, char *cluster_name,
+			  time_t start, time_t end, time_t now)
 {
 	int rc = SLURM_SUCCESS;
 	int add_sec = 3600;
 	int i=0;
-	time_t now = time(NULL);
 	time_t curr_start = start;
 	time_t curr_end = curr_start + add_sec;
 	char *query = NULL;
@@ -479,6 +525,10 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 	List cluster_down_list = list_create(_destroy_local_cluster_usage);
 	List wckey_usage_list = list_create(_destroy_local_id_usage);
 	List resv_usage_list = list_create(_destroy_local_resv_usage);
+	xhash_t *assoc_usage_hash = xhash_init(_local_id_usage_key,
+					       NULL, NULL, 0);
+	xhash_t *wckey_usage_hash = xhash_init(_local_id_usage_key,
+					       NULL, NULL, 0);
 	uint16_t track_wckey = slurm_get_track_wckey();
 	/* char start_char[20], end_char[20]; */
 
@@ -806,9 +856,9 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 			}
 
 			if (last_id != assoc_id) {
-				a_usage = xmalloc(sizeof(local_id_usage_t));
-				a_usage->id = assoc_id;
-				list_append(assoc_usage_list, a_usage);
+				a_usage = _get_id_usage(assoc_usage_list,
+							assoc_usage_hash,
+							assoc_id);
 				last_id = assoc_id;
 			}
 
@@ -820,19 +870,9 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 
 			/* do the wckey calculation */
 			if (last_wckeyid != wckey_id) {
-				list_iterator_reset(w_itr);
-				while ((w_usage = list_next(w_itr)))
-					if (w_usage->id == wckey_id)
-						break;
-
-				if (!w_usage) {
-					w_usage = xmalloc(
-						sizeof(local_id_usage_t));
-					w_usage->id = wckey_id;
-					list_append(wckey_usage_list,
-						    w_usage);
-				}
-
+				w_usage = _get_id_usage(wckey_usage_list,
+							wckey_usage_hash,
+							wckey_id);
 				last_wckeyid = wckey_id;
 			}
 			w_usage->a_cpu += seconds * row_acpu;
@@ -997,21 +1037,10 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 			tmp_itr = list_iterator_create(r_usage->local_assocs);
 			while ((assoc = list_next(tmp_itr))) {
 				uint32_t associd = slurm_atoul(assoc);
-				if (last_id != associd) {
-					list_iterator_reset(a_itr);
-					while ((a_usage = list_next(a_itr))) {
-						if (a_usage->id == associd) {
-							last_id = a_usage->id;
-							break;
-						}
-					}
-				}
-
-				if (!a_usage) {
-					a_usage = xmalloc(
-						sizeof(local_id_usage_t));
-					a_usage->id = associd;
-					list_append(assoc_usage_list, a_usage);
+				if ((last_id != associd) || !a_usage) {
+					a_usage = _get_id_usage(
+						assoc_usage_list,
+						assoc_usage_hash, associd);
 					last_id = associd;
 				}
 
@@ -1132,6 +1161,8 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 
 	end_loop:
 		_destroy_local_cluster_usage(c_usage);
+		xhash_clear(assoc_usage_hash);
+		xhash_clear(wckey_usage_hash);
 		list_flush(assoc_usage_list);
 		list_flush(cluster_down_list);
 		list_flush(wckey_usage_list);
@@ -1148,6 +1179,8 @@ end_it:
 	list_iterator_destroy(w_itr);
 	list_iterator_destroy(r_itr);
 
+	xhash_free(assoc_usage_hash);
+	xhash_free(wckey_usage_hash);
 	list_destroy(assoc_usage_list);
 	list_destroy(cluster_down_list);
 	list_destroy(wckey_usage_list);
@@ -1156,6 +1189,96 @@ end_it:
 /* 	info("stop start %s", slurm_ctime(&curr_start)); */
 /* 	info("stop end %s", slurm_ctime(&curr_end)); */
 
+	return rc;
+}
+
+static void *_hourly_rollup_thread(void *arg)
+{
+	local_hour_range_t *range = (local_hour_range_t *)arg;
+	mysql_conn_t mysql_conn;
+
+	memset(&mysql_conn, 0, sizeof(mysql_conn_t));
+	mysql_conn.rollback = 1;
+	mysql_conn.conn = range->conn;
+	slurm_mutex_init(&mysql_conn.lock);
+
+	/* Each thread needs it's own connection we can't use the one
+	 * sent from the parent thread. */
+	range->rc = check_connection(&mysql_conn);
+	if (range->rc == SLURM_SUCCESS)
+		range->rc = _hourly_rollup(&mysql_conn, range->cluster_name,
+					   range->start, range->end,
+					   range->now);
+
+	if (range->rc == SLURM_SUCCESS) {
+		if (mysql_db_commit(&mysql_conn)) {
+			error("Couldn't commit hourly rollup of cluster %s",
+			      range->cluster_name);
+			range->rc = SLURM_ERROR;
+		}
+	} else if (mysql_conn.db_conn && mysql_db_rollback(&mysql_conn))
+		error("rollback failed");
+
+	mysql_db_close_db_connection(&mysql_conn);
+	slurm_mutex_destroy(&mysql_conn.lock);
+
+	return NULL;
+}
+extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
+				  char *cluster_name,
+				  time_t start, time_t end,
+				  uint16_t archive_data)
+{
+	int rc = SLURM_SUCCESS;
+	int add_sec = 3600;
+	int hours, per_thread, i, thread_cnt;
+	time_t now = time(NULL);
+	pthread_t rollup_tid[MAX_ROLLUP_THREADS];
+	pthread_attr_t rollup_attr;
+	local_hour_range_t range[MAX_ROLLUP_THREADS];
+
+	hours = (end - start + add_sec - 1) / add_sec;
+	thread_cnt = MIN(MAX_ROLLUP_THREADS, hours / MIN_ROLLUP_THREAD_HOURS);
+
+	if (thread_cnt <= 1) {
+		rc = _hourly_rollup(mysql_conn, cluster_name, start, end, now);
+	} else {
+		per_thread = (hours + thread_cnt - 1) / thread_cnt;
+		debug2("rolling up %d hours of cluster %s in %d threads",
+		       hours, cluster_name, thread_cnt);
+		memset(range, 0, sizeof(range));
+		for (i = 0; i < thread_cnt; i++) {
+			range[i].cluster_name = cluster_name;
+			range[i].conn = mysql_conn->conn;
+			range[i].now = now;
+			range[i].start = start + (i * per_thread * add_sec);
+			range[i].end = MIN(end, range[i].start
+					   + (per_thread * add_sec));
+			slurm_attr_init(&rollup_attr);
+			if (pthread_create(&rollup_tid[i], &rollup_attr,
+					   _hourly_rollup_thread,
+					   (void *)&range[i]))
+				fatal("pthread_create: %m");
+			slurm_attr_destroy(&rollup_attr);
+		}
+		for (i = 0; i < thread_cnt; i++) {
+			pthread_join(rollup_tid[i], NULL);
+			if ((range[i].rc != SLURM_SUCCESS)
+			    && (rc == SLURM_SUCCESS))
+				rc = range[i].rc;
+		}
+
+		/* The hours were committed by the threads.  End the
+		 * transaction of this connection so the daily rollup
+		 * doesn't read them from a snapshot taken before.
+		 */
+		if ((rc == SLURM_SUCCESS) && mysql_db_commit(mysql_conn)) {
+			error("Couldn't commit rollup of cluster %s",
+			      cluster_name);
+			rc = SLURM_ERROR;
+		}
+	}
+
 	/* go check to see if we archive and purge */
 
 	if (rc == SLURM_SUCCESS)
@@ -1164,6 +1287,7 @@ end_it:
 
 	return rc;
 }
+
 extern int as_mysql_daily_rollup(mysql_conn_t *mysql_conn,
 				 char *cluster_name,
 				 time_t start, time_t end,
@@ -45,6 +45,24 @@ pthread_mutex_t rollup_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static pthread_mutex_t usage_rollup_lock = PTHREAD_MUTEX_INITIALIZER;
 
+enum {
+	ROLLUP_HOUR,
+	ROLLUP_DAY,
+	ROLLUP_MONTH,
+	ROLLUP_COUNT
+};
+
+typedef struct {
+	uint32_t count;
+	uint64_t last_time;	/* usec */
+	uint64_t max_time;	/* usec */
+	uint64_t total_time;	/* usec */
+	uint64_t periods;	/* hours/days/months rolled up */
+} local_rollup_stats_t;
+
+static pthread_mutex_t rollup_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static local_rollup_stats_t rollup_stats[ROLLUP_COUNT];
+
 typedef struct {
 	uint16_t archive_data;
 	char *cluster_name;
@@ -57,6 +75,28 @@ typedef struct {
 	time_t sent_start;
 } local_rollup_t;
 
+static void _add_rollup_stats(int type, long delta, uint32_t periods)
+{
+	local_rollup_stats_t *stats = &rollup_stats[type];
+
+	slurm_mutex_lock(&rollup_stats_lock);
+	stats->count++;
+	stats->last_time = delta;
+	stats->max_time = MAX(stats->max_time, delta);
+	stats->total_time += delta;
+	stats->periods += periods;
+	slurm_mutex_unlock(&rollup_stats_lock);
+}
+
+static void _add_stats_pair(List ret_list, char *name, uint64_t value)
+{
+	config_key_pair_t *key_pair = xmalloc(sizeof(config_key_pair_t));
+
+	key_pair->name = xstrdup(name);
+	key_pair->value = xstrdup_printf("%"PRIu64, value);
+	list_append(ret_list, key_pair);
+}
+
 static void *_cluster_rollup_usage(void *arg)
 {
 	local_rollup_t *local_rollup = (local_rollup_t *)arg;
@@ -304,6 +344,8 @@ static void *_cluster_rollup_usage(void *arg)
 		snprintf(timer_str, sizeof(timer_str),
 			 "hourly_rollup for %s", local_rollup->cluster_name);
 		END_TIMER3(timer_str, 5000000);
+		_add_rollup_stats(ROLLUP_HOUR, DELTA_TIMER,
+				  (hour_end - hour_start) / 3600);
 		if (rc != SLURM_SUCCESS)
 			goto end_it;
 	}
@@ -318,6 +360,8 @@ static void *_cluster_rollup_usage(void *arg)
 		snprintf(timer_str, sizeof(timer_str),
 			 "daily_rollup for %s", local_rollup->cluster_name);
 		END_TIMER3(timer_str, 5000000);
+		_add_rollup_stats(ROLLUP_DAY, DELTA_TIMER,
+				  (day_end - day_start + 3600) / 86400);
 		if (rc != SLURM_SUCCESS)
 			goto end_it;
 	}
@@ -332,6 +376,9 @@ static void *_cluster_rollup_usage(void *arg)
 		snprintf(timer_str, sizeof(timer_str),
 			 "monthly_rollup for %s", local_rollup->cluster_name);
 		END_TIMER3(timer_str, 5000000);
+		_add_rollup_stats(ROLLUP_MONTH, DELTA_TIMER,
+				  end_tm.tm_mon - start_tm.tm_mon
+				  + (12 * (end_tm.tm_year - start_tm.tm_year)));
 		if (rc != SLURM_SUCCESS)
 			goto end_it;
 	}
@@ -998,3 +1045,31 @@ extern int as_mysql_roll_usage(mysql_conn_t *mysql_conn,
 
 	return rc;
 }
+
+extern List as_mysql_get_rollup_stats(void)
+{
+	List ret_list = list_create(destroy_config_key_pair);
+	char *type_str[] = { "Hourly", "Daily", "Monthly" };
+	char name[64];
+	local_rollup_stats_t *stats;
+	int i;
+
+	slurm_mutex_lock(&rollup_stats_lock);
+	for (i = 0; i < ROLLUP_COUNT; i++) {
+		stats = &rollup_stats[i];
+		snprintf(name, sizeof(name), "%sRollupCount", type_str[i]);
+		_add_stats_pair(ret_list, name, stats->count);
+		snprintf(name, sizeof(name), "%sRollupPeriods", type_str[i]);
+		_add_stats_pair(ret_list, name, stats->periods);
+		snprintf(name, sizeof(name), "%sRollupLastTime", type_str[i]);
+		_add_stats_pair(ret_list, name, stats->last_time);
+		snprintf(name, sizeof(name), "%sRollupMaxTime", type_str[i]);
+		_add_stats_pair(ret_list, name, stats->max_time);
+		snprintf(name, sizeof(name), "%sRollupAveTime", type_str[i]);
+		_add_stats_pair(ret_list, name, stats->count ?
+				stats->total_time / stats->count : 0);
+	}
+	slurm_mutex_unlock(&rollup_stats_lock);
+
+	return ret_list;
+}
@@ -55,4 +55,8 @@ extern int as_mysql_roll_usage(mysql_conn_t *mysql_conn,
 			    time_t sent_start, time_t sent_end,
 			    uint16_t archive_data);
 
+/* Return a list of config_key_pair_t with the number and duration (usec)
+ * of the rollups done since the slurmdbd started */
+extern List as_mysql_get_rollup_stats(void);
+
 #endif
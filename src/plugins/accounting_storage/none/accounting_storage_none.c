@@ -461,6 +461,18 @@ extern List jobacct_storage_p_get_jobs_cond(void *db_conn, uid_t uid,
 	return NULL;
 }
 
+/*
+ * get info from the storage a chunk at a time
+ * RET: SLURM_SUCCESS or error code
+ */
+extern int jobacct_storage_p_get_jobs_cb(void *db_conn, uid_t uid,
+					 void *job_cond,
+					 slurmdb_job_list_cb_t callback,
+					 void *arg)
+{
+	return SLURM_SUCCESS;
+}
+
 /*
  * expire old info from the storage
  */
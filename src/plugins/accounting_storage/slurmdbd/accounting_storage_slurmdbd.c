@@ -113,6 +113,11 @@ const char plugin_name[] = "Accounting storage SLURMDBD plugin";
 const char plugin_type[] = "accounting_storage/slurmdbd";
 const uint32_t plugin_version = 100;
 
+typedef struct {
+	slurmdb_job_list_cb_t callback;
+	void *arg;
+} job_stream_arg_t;
+
 static char *slurmdbd_auth_info = NULL;
 
 static pthread_t db_inx_handler_thread;
@@ -2546,6 +2551,27 @@ extern int jobacct_storage_p_suspend(void *db_conn,
 	return SLURM_SUCCESS;
 }
 
+/* Hand each DBD_GOT_JOBS chunk of a DBD_GET_JOBS_STREAM to the callback
+ * given to jobacct_storage_p_get_jobs_cb() */
+static int _got_jobs_chunk(slurmdbd_msg_t *msg, void *arg)
+{
+	job_stream_arg_t *stream_arg = (job_stream_arg_t *)arg;
+	dbd_list_msg_t *got_msg;
+	int rc;
+
+	if (msg->msg_type != DBD_GOT_JOBS) {
+		error("slurmdbd: response type not DBD_GOT_JOBS: %u",
+		      msg->msg_type);
+		return SLURM_ERROR;
+	}
+
+	got_msg = (dbd_list_msg_t *) msg->data;
+	rc = (*(stream_arg->callback))(got_msg->my_list, stream_arg->arg);
+	slurmdbd_free_list_msg(got_msg);
+
+	return rc;
+}
+
 /*
  * get info from the storage
  * returns List of job_rec_t *
@@ -2593,6 +2619,59 @@ extern List jobacct_storage_p_get_jobs_cond(void *db_conn, uid_t uid,
 	return my_job_list;
 }
 
+/*
+ * get info from the storage a chunk at a time, each DBD_GOT_JOBS
+ * message of the stream being one chunk
+ * RET: SLURM_SUCCESS or error code
+ */
+extern int jobacct_storage_p_get_jobs_cb(void *db_conn, uid_t uid,
+					 slurmdb_job_cond_t *job_cond,
+					 slurmdb_job_list_cb_t callback,
+					 void *arg)
+{
+	slurmdbd_msg_t req, resp;
+	dbd_cond_msg_t get_msg;
+	job_stream_arg_t stream_arg;
+	List job_list;
+	int rc;
+
+	memset(&get_msg, 0, sizeof(dbd_cond_msg_t));
+	get_msg.cond = job_cond;
+
+	stream_arg.callback = callback;
+	stream_arg.arg = arg;
+
+	req.msg_type = DBD_GET_JOBS_STREAM;
+	req.data = &get_msg;
+	rc = slurm_send_recv_slurmdbd_stream(SLURM_PROTOCOL_VERSION,
+					     &req, &resp,
+					     _got_jobs_chunk, &stream_arg);
+
+	if (rc != SLURM_SUCCESS) {
+		error("slurmdbd: DBD_GET_JOBS_STREAM failure: %m");
+	} else {
+		dbd_rc_msg_t *msg = resp.data;
+		rc = msg->return_code;
+		if (rc == EINVAL && msg->sent_type != DBD_GET_JOBS_STREAM) {
+			/* The SlurmDBD is too old to know the RPC,
+			 * get all of it in one go instead. */
+			slurmdbd_free_rc_msg(msg);
+			if (!(job_list = jobacct_storage_p_get_jobs_cond(
+				      db_conn, uid, job_cond)))
+				return SLURM_ERROR;
+			rc = (*callback)(job_list, arg);
+			list_destroy(job_list);
+			return rc;
+		} else if (rc != SLURM_SUCCESS) {
+			slurm_seterrno(rc);
+			error("%s", msg->comment);
+		}
+		slurmdbd_free_rc_msg(msg);
+	}
+
+	return rc;
+}
+
 /*
  * Expire old info from the storage
  * Not applicable for any database
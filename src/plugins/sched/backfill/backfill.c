@@ -108,6 +108,33 @@ typedef struct node_space_map {
 	int next;	/* next record, by time, zero termination */
 } node_space_map_t;
 
+/* Resources reserved for a pending job in the node_space table. Preserved
+ * across backfill cycles when bf_incremental is configured so the table can
+ * be rebuilt without re-testing jobs when a reservation is dropped. */
+typedef struct bf_resv_rec {
+	uint32_t job_id;
+	uint32_t time_limit;	/* job's time_limit when reserved */
+	uint32_t start_time;
+	uint32_t end_reserve;
+	bitstr_t *res_bitmap;	/* nodes NOT reserved for the job */
+} bf_resv_rec_t;
+
+/* A job queue record already tested by the backfill pass being resumed,
+ * with the values which determined its place in the queue */
+typedef struct bf_tested_rec {
+	uint32_t job_id;
+	struct part_record *part_ptr;
+	uint32_t priority;	/* job_queue_rec_t priority */
+	uint32_t job_prio;	/* job_record priority */
+	uint32_t resv_id;
+} bf_tested_rec_t;
+
+/* Expected end of a job running when a backfill pass was saved */
+typedef struct bf_end_rec {
+	uint32_t job_id;
+	time_t end_time;
+} bf_end_rec_t;
+
 /* Diag statistics */
 extern diag_stats_t slurmctld_diag_stats;
 int bf_last_yields = 0;
@@ -128,16 +155,44 @@ static int max_backfill_job_per_part = 0;
 static int max_backfill_job_per_user = 0;
 static int max_backfill_jobs_start = 0;
 static bool backfill_continue = false;
+static bool backfill_incremental = false;
 static int defer_rpc_cnt = 0;
 static int sched_timeout = SCHED_TIMEOUT;
 static int yield_sleep   = YIELD_SLEEP;
 
+/* State of an unfinished pass preserved between cycles when bf_incremental
+ * is configured. Protected by the slurmctld job write lock. */
+static bool bf_state_saved = false;	/* a pass can be resumed */
+static bool bf_resume_now = false;	/* resume without bf_interval wait */
+static node_space_map_t *bf_node_space = NULL;
+static int bf_node_space_recs = 0;
+static bool bf_node_space_dirty = false; /* reservation dropped */
+static List bf_resv_list = NULL;	/* bf_resv_rec_t for this pass */
+static bf_tested_rec_t *bf_tested = NULL; /* queue records tested, in order */
+static int bf_tested_cnt = 0, bf_tested_size = 0;
+static bf_end_rec_t *bf_end = NULL;	/* running jobs, sorted by job_id */
+static int bf_end_cnt = 0;
+static bitstr_t *bf_avail_bitmap = NULL; /* avail_node_bitmap when saved */
+static time_t bf_config_update = (time_t) 0;
+static time_t bf_part_update = (time_t) 0;
+static bool bf_state_purge = false;
+
 /*********************** local functions *********************/
 static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
 			     bitstr_t *res_bitmap,
 			     node_space_map_t *node_space,
 			     int *node_space_recs);
 static int  _attempt_backfill(void);
+static int  _bf_end_cmp(const void *x, const void *y);
+static void _bf_resv_del(void *x);
+static void _bf_resv_save(struct job_record *job_ptr, uint32_t start_time,
+			  uint32_t end_reserve, bitstr_t *res_bitmap);
+static void _bf_state_clear(void);
+static bool _bf_state_resume(List job_queue, time_t now);
+static void _bf_state_save(node_space_map_t *node_space,
+			   int node_space_recs, time_t config_update,
+			   time_t part_update, bool resume_now);
+static void _bf_tested_add(job_queue_rec_t *job_queue_rec);
 static void _clear_job_start_times(void);
 static int  _delta_tv(struct timeval *tv);
 static bool _job_is_completing(void);
@@ -145,6 +200,9 @@ static void _load_config(void);
 static bool _many_pending_rpcs(void);
 static bool _more_work(time_t last_backfill_time);
 static void _my_sleep(int usec);
+static node_space_map_t *_node_space_create(time_t begin_time,
+					    time_t end_time, int *recs);
+static void _node_space_free(node_space_map_t *node_space);
 static int  _num_feature_count(struct job_record *job_ptr);
 static void _reset_job_time_limit(struct job_record *job_ptr, time_t now,
 				  node_space_map_t *node_space);
@@ -521,6 +579,14 @@ static void _load_config(void)
 		backfill_continue = true;
 	}
 
+	/* bf_incremental makes a pass interrupted by state changes or by
+	 * bf_max_job_start resume where it stopped in the next cycle, keeping
+	 * its reservations, rather than starting over */
+	if (sched_params && (strstr(sched_params, "bf_incremental")))
+		backfill_incremental = true;
+	else
+		backfill_incremental = false;
+
 	if (sched_params && (tmp_ptr=strstr(sched_params, "bf_yield_interval=")))
 		sched_timeout = atoi(tmp_ptr + 18);
 	if (sched_timeout <= 0) {
@@ -587,6 +653,7 @@ extern void *backfill_agent(void *args)
 {
 	time_t now;
 	double wait_time;
+	bool resume_now;
 	static time_t last_backfill_time = 0;
 	/* Read config and partitions; Write jobs and nodes */
 	slurmctld_lock_t all_locks = {
@@ -601,7 +668,13 @@ extern void *backfill_agent(void *args)
 	_load_config();
 	last_backfill_time = time(NULL);
 	while (!stop_backfill) {
-		_my_sleep(backfill_interval * 1000000);
+		/* A pass interrupted by state changes is resumed as soon as
+		 * pending RPCs allow, not after another bf_interval */
+		resume_now = bf_resume_now;
+		if (resume_now)
+			_my_sleep(yield_sleep);
+		else
+			_my_sleep(backfill_interval * 1000000);
 		if (stop_backfill)
 			break;
 		if (config_flag) {
@@ -610,17 +683,26 @@ extern void *backfill_agent(void *args)
 		}
 		now = time(NULL);
 		wait_time = difftime(now, last_backfill_time);
-		if ((wait_time < backfill_interval) ||
+		if ((!resume_now && (wait_time < backfill_interval)) ||
 		    _job_is_completing() || _many_pending_rpcs() ||
-		    !avail_front_end(NULL) || !_more_work(last_backfill_time))
+		    !avail_front_end(NULL) ||
+		    (!resume_now && !_more_work(last_backfill_time)))
 			continue;
 
 		lock_slurmctld(all_locks);
 		(void) _attempt_backfill();
+		job_pack_cache_clear();
 		last_backfill_time = time(NULL);
 		(void) bb_g_job_try_stage_in();
 		unlock_slurmctld(all_locks);
 	}
+
+	lock_slurmctld(all_locks);
+	_bf_state_clear();
+	FREE_NULL_LIST(bf_resv_list);
+	xfree(bf_tested);
+	bf_tested_size = 0;
+	unlock_slurmctld(all_locks);
 	return NULL;
 }
 
@@ -652,6 +734,8 @@ static int _yield_locks(int usec)
 	node_update = last_node_update;
 	part_update = last_part_update;
 
+	/* Expected start times of pending jobs may have changed */
+	job_pack_cache_clear();
 	unlock_slurmctld(all_locks);
 	bf_last_yields++;
 	_my_sleep(usec);
@@ -699,6 +783,7 @@ static int _attempt_backfill(void)
 	uint32_t test_array_job_id = 0;
 	uint32_t test_array_count = 0;
 	bool resv_overlap = false;
+	bool resume = false, save_state = false, resume_now = false;
 
 	bf_last_yields = 0;
 #ifdef HAVE_ALPS_CRAY
@@ -740,10 +825,25 @@ static int _attempt_backfill(void)
 		else
 			debug("backfill: no jobs to backfill");
 		list_destroy(job_queue);
+		_bf_state_clear();
 		return 0;
 	}
+	sort_job_queue(job_queue);
 
-	if (backfill_continue)
+	/* Resume the pass started by a previous cycle if nothing it depends
+	 * upon has changed, dropping the jobs it has already tested */
+	if (bf_state_saved && backfill_incremental &&
+	    _bf_state_resume(job_queue, now)) {
+		resume = true;
+		if (debug_flags & DEBUG_FLAG_BACKFILL) {
+			info("backfill: resuming after %d tested jobs with %d "
+			     "reservations, %d jobs queued", bf_tested_cnt,
+			     list_count(bf_resv_list), list_count(job_queue));
+		}
+	} else
+		_bf_state_clear();
+
+	if (backfill_continue && !resume)
 		_clear_job_start_times();
 
 	gettimeofday(&bf_time1, NULL);
@@ -759,14 +859,19 @@ static int _attempt_backfill(void)
 	slurmctld_diag_stats.bf_when_last_cycle = now;
 	slurmctld_diag_stats.bf_active = 1;
 
-	node_space = xmalloc(sizeof(node_space_map_t) *
-			     (max_backfill_job_cnt * 2 + 1));
-	node_space[0].begin_time = sched_start;
-	window_end = sched_start + backfill_window;
-	node_space[0].end_time = window_end;
-	node_space[0].avail_bitmap = bit_copy(avail_node_bitmap);
-	node_space[0].next = 0;
-	node_space_recs = 1;
+	if (resume) {
+		/* The table covers the window of the pass being resumed */
+		node_space = bf_node_space;
+		node_space_recs = bf_node_space_recs;
+		bf_node_space = NULL;
+		window_end = node_space[0].end_time;
+		for (j = 0; (j = node_space[j].next); )
+			window_end = node_space[j].end_time;
+	} else {
+		window_end = sched_start + backfill_window;
+		node_space = _node_space_create(sched_start, window_end,
+						&node_space_recs);
+	}
 	if (debug_flags & DEBUG_FLAG_BACKFILL_MAP)
 		_dump_node_space_table(node_space);
 
@@ -788,7 +893,6 @@ static int _attempt_backfill(void)
 		uid = xmalloc(BF_MAX_USERS * sizeof(uint32_t));
 		njobs = xmalloc(BF_MAX_USERS * sizeof(uint16_t));
 	}
-	sort_job_queue(job_queue);
 	while (1) {
 		job_queue_rec = (job_queue_rec_t *) list_pop(job_queue);
 		if (!job_queue_rec) {
@@ -822,6 +926,11 @@ static int _attempt_backfill(void)
 				}
 				rc = 1;
 				xfree(job_queue_rec);
+				if (backfill_incremental &&
+				    (slurmctld_conf.last_update ==
+				     config_update) &&
+				    (last_part_update == part_update))
+					save_state = resume_now = true;
 				break;
 			}
 			/* cg_node_bitmap may be changed */
@@ -845,6 +954,8 @@ static int _attempt_backfill(void)
 		orig_start_time = job_ptr->start_time;
 		orig_time_limit = job_ptr->time_limit;
 		part_ptr = job_queue_rec->part_ptr;
+		if (backfill_incremental)
+			_bf_tested_add(job_queue_rec);
 		xfree(job_queue_rec);
 
 next_task:
@@ -1031,6 +1142,14 @@ next_task:
 					     job_test_count);
 				}
 				rc = 1;
+				if (backfill_incremental &&
+				    (slurmctld_conf.last_update ==
+				     config_update) &&
+				    (last_part_update == part_update)) {
+					/* Test this job again on resume */
+					bf_tested_cnt--;
+					save_state = resume_now = true;
+				}
 				break;
 			}
 			/* cg_node_bitmap may be changed */
@@ -1258,6 +1377,7 @@ next_task:
 						     " limit of %d reached",
 						     max_backfill_jobs_start);
 					}
+					save_state = backfill_incremental;
 					break;
 				}
 				if (job_ptr->array_task_id != NO_VAL) {
@@ -1335,6 +1455,10 @@ next_task:
 		bit_not(avail_bitmap);
 		_add_reservation(start_time, end_reserve,
 				 avail_bitmap, node_space, &node_space_recs);
+		if (backfill_incremental) {
+			_bf_resv_save(job_ptr, start_time, end_reserve,
+				      avail_bitmap);
+		}
 		if (debug_flags & DEBUG_FLAG_BACKFILL_MAP)
 			_dump_node_space_table(node_space);
 		if ((orig_start_time != 0) &&
@@ -1364,13 +1488,15 @@ next_task:
 	FREE_NULL_BITMAP(resv_bitmap);
 	FREE_NULL_BITMAP(non_cg_bitmap);
 
-	for (i=0; ; ) {
-		FREE_NULL_BITMAP(node_space[i].avail_bitmap);
-		if ((i = node_space[i].next) == 0)
-			break;
-	}
-	xfree(node_space);
 	list_destroy(job_queue);
+	if (save_state && !slurmctld_config.shutdown_time) {
+		/* Pick up with the jobs not yet tested in the next cycle */
+		_bf_state_save(node_space, node_space_recs, config_update,
+			       part_update, resume_now);
+	} else {
+		_node_space_free(node_space);
+		_bf_state_clear();
+	}
 	gettimeofday(&bf_time2, NULL);
 	_do_diag_stats(&bf_time1, &bf_time2, yield_sleep);
 	if (debug_flags & DEBUG_FLAG_BACKFILL) {
@@ -1615,3 +1741,295 @@ static bool _test_resv_overlap(node_space_map_t *node_space,
 	}
 	return overlap;
 }
+
+static void _bf_resv_del(void *x)
+{
+	bf_resv_rec_t *resv_ptr = (bf_resv_rec_t *) x;
+
+	if (resv_ptr) {
+		FREE_NULL_BITMAP(resv_ptr->res_bitmap);
+		xfree(resv_ptr);
+	}
+}
+
+/* Record a reservation made for a pending job so that it can be restored
+ * into the node_space table of a later cycle */
+static void _bf_resv_save(struct job_record *job_ptr, uint32_t start_time,
+			  uint32_t end_reserve, bitstr_t *res_bitmap)
+{
+	bf_resv_rec_t *resv_ptr;
+
+	if (!bf_resv_list)
+		bf_resv_list = list_create(_bf_resv_del);
+	resv_ptr = xmalloc(sizeof(bf_resv_rec_t));
+	resv_ptr->job_id      = job_ptr->job_id;
+	resv_ptr->time_limit  = job_ptr->time_limit;
+	resv_ptr->start_time  = start_time;
+	resv_ptr->end_reserve = end_reserve;
+	resv_ptr->res_bitmap  = bit_copy(res_bitmap);
+	list_append(bf_resv_list, resv_ptr);
+}
+
+/* Create a node_space table with a single record covering the given window
+ * of time on all available nodes */
+static node_space_map_t *_node_space_create(time_t begin_time,
+					    time_t end_time, int *recs)
+{
+	node_space_map_t *node_space;
+
+	node_space = xmalloc(sizeof(node_space_map_t) *
+			     (max_backfill_job_cnt * 2 + 1));
+	node_space[0].begin_time = begin_time;
+	node_space[0].end_time = end_time;
+	node_space[0].avail_bitmap = bit_copy(avail_node_bitmap);
+	node_space[0].next = 0;
+	*recs = 1;
+	return node_space;
+}
+
+static void _node_space_free(node_space_map_t *node_space)
+{
+	int i;
+
+	if (!node_space)
+		return;
+	for (i = 0; ; ) {
+		FREE_NULL_BITMAP(node_space[i].avail_bitmap);
+		if ((i = node_space[i].next) == 0)
+			break;
+	}
+	xfree(node_space);
+}
+
+/* Record a job queue record as tested by the current pass */
+static void _bf_tested_add(job_queue_rec_t *job_queue_rec)
+{
+	bf_tested_rec_t *tested;
+
+	if (bf_tested_cnt >= bf_tested_size) {
+		bf_tested_size = MAX(bf_tested_size * 2, 1024);
+		xrealloc(bf_tested, sizeof(bf_tested_rec_t) * bf_tested_size);
+	}
+	tested = &bf_tested[bf_tested_cnt++];
+	tested->job_id   = job_queue_rec->job_id;
+	tested->part_ptr = job_queue_rec->part_ptr;
+	tested->priority = job_queue_rec->priority;
+	tested->job_prio = job_queue_rec->job_ptr->priority;
+	tested->resv_id  = job_queue_rec->job_ptr->resv_id;
+}
+
+static int _bf_end_cmp(const void *x, const void *y)
+{
+	const bf_end_rec_t *end1 = (const bf_end_rec_t *) x;
+	const bf_end_rec_t *end2 = (const bf_end_rec_t *) y;
+
+	if (end1->job_id < end2->job_id)
+		return -1;
+	if (end1->job_id > end2->job_id)
+		return 1;
+	return 0;
+}
+
+/* Preserve the state of an unfinished pass to be resumed by a later cycle.
+ * The expected end time of running jobs is recorded since reservations
+ * depend upon them. */
+static void _bf_state_save(node_space_map_t *node_space,
+			   int node_space_recs, time_t config_update,
+			   time_t part_update, bool resume_now)
+{
+	ListIterator job_iterator;
+	struct job_record *job_ptr;
+	int end_size;
+
+	if (!bf_resv_list)
+		bf_resv_list = list_create(_bf_resv_del);
+	bf_node_space = node_space;
+	bf_node_space_recs = node_space_recs;
+	FREE_NULL_BITMAP(bf_avail_bitmap);
+	bf_avail_bitmap = bit_copy(avail_node_bitmap);
+
+	xfree(bf_end);
+	bf_end_cnt = 0;
+	end_size = 1024;
+	bf_end = xmalloc(sizeof(bf_end_rec_t) * end_size);
+	job_iterator = list_iterator_create(job_list);
+	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
+		if (!IS_JOB_RUNNING(job_ptr) && !IS_JOB_SUSPENDED(job_ptr))
+			continue;
+		if (bf_end_cnt >= end_size) {
+			end_size *= 2;
+			xrealloc(bf_end, sizeof(bf_end_rec_t) * end_size);
+		}
+		bf_end[bf_end_cnt].job_id = job_ptr->job_id;
+		bf_end[bf_end_cnt].end_time = job_ptr->end_time;
+		bf_end_cnt++;
+	}
+	list_iterator_destroy(job_iterator);
+	qsort(bf_end, bf_end_cnt, sizeof(bf_end_rec_t), _bf_end_cmp);
+
+	bf_config_update = config_update;
+	bf_part_update = part_update;
+	bf_state_purge = false;
+	bf_resume_now = resume_now;
+	bf_state_saved = true;
+}
+
+/* Rebuild the saved node_space table from the saved reservations after
+ * some of them have been dropped */
+static void _bf_node_space_rebuild(void)
+{
+	ListIterator iter;
+	bf_resv_rec_t *resv_ptr;
+	time_t begin_time, end_time;
+	int j;
+
+	begin_time = bf_node_space[0].begin_time;
+	end_time = bf_node_space[0].end_time;
+	for (j = 0; (j = bf_node_space[j].next); )
+		end_time = bf_node_space[j].end_time;
+	_node_space_free(bf_node_space);
+	bf_node_space = _node_space_create(begin_time, end_time,
+					   &bf_node_space_recs);
+
+	iter = list_iterator_create(bf_resv_list);
+	while ((resv_ptr = (bf_resv_rec_t *) list_next(iter))) {
+		_add_reservation(resv_ptr->start_time, resv_ptr->end_reserve,
+				 resv_ptr->res_bitmap, bf_node_space,
+				 &bf_node_space_recs);
+	}
+	list_iterator_destroy(iter);
+	bf_node_space_dirty = false;
+}
+
+/* Determine if the pass saved by a previous cycle can be resumed and if so
+ * remove the records it has already tested from job_queue, which must be
+ * sorted. The pass can only be resumed if the configuration, partitions,
+ * available nodes and expected end of running jobs are unchanged, no job
+ * it reserved resources for has missed its expected start time and the
+ * order of the jobs it has tested has not been changed by new jobs or by
+ * changes in priority. Reservations of jobs which have since started or
+ * ended are dropped. */
+static bool _bf_state_resume(List job_queue, time_t now)
+{
+	ListIterator iter;
+	bf_resv_rec_t *resv_ptr;
+	bf_tested_rec_t *tested;
+	bf_end_rec_t end_key, *end_ptr;
+	job_queue_rec_t *job_queue_rec;
+	struct job_record *job_ptr;
+	bool valid = true;
+	int i;
+
+	if (bf_state_purge || config_flag ||
+	    (slurmctld_conf.last_update != bf_config_update) ||
+	    (last_part_update != bf_part_update) ||
+	    !bit_equal(avail_node_bitmap, bf_avail_bitmap))
+		return false;
+
+	/* A running job's time limit changed */
+	iter = list_iterator_create(job_list);
+	while ((job_ptr = (struct job_record *) list_next(iter))) {
+		if (!IS_JOB_RUNNING(job_ptr) && !IS_JOB_SUSPENDED(job_ptr))
+			continue;
+		end_key.job_id = job_ptr->job_id;
+		end_ptr = bsearch(&end_key, bf_end, bf_end_cnt,
+				  sizeof(bf_end_rec_t), _bf_end_cmp);
+		if (end_ptr && (end_ptr->end_time != job_ptr->end_time)) {
+			valid = false;
+			break;
+		}
+	}
+	list_iterator_destroy(iter);
+	if (!valid)
+		return false;
+
+	iter = list_iterator_create(bf_resv_list);
+	while ((resv_ptr = (bf_resv_rec_t *) list_next(iter))) {
+		job_ptr = find_job_record(resv_ptr->job_id);
+		if (!job_ptr || !IS_JOB_PENDING(job_ptr)) {
+			list_delete_item(iter);
+			bf_node_space_dirty = true;
+		} else if ((job_ptr->time_limit != resv_ptr->time_limit) ||
+			   ((resv_ptr->start_time + backfill_resolution) <=
+			    now)) {
+			valid = false;
+			break;
+		}
+	}
+	list_iterator_destroy(iter);
+	if (!valid)
+		return false;
+
+	/* Every tested record still pending must head the new queue in the
+	 * same order, otherwise something now sorts ahead of it */
+	iter = list_iterator_create(job_queue);
+	for (i = 0; i < bf_tested_cnt; i++) {
+		tested = &bf_tested[i];
+		job_ptr = find_job_record(tested->job_id);
+		if (!job_ptr || !IS_JOB_PENDING(job_ptr))
+			continue;	/* started or ended since tested */
+		job_queue_rec = (job_queue_rec_t *) list_next(iter);
+		if (!job_queue_rec ||
+		    (job_queue_rec->job_id   != tested->job_id)   ||
+		    (job_queue_rec->part_ptr != tested->part_ptr) ||
+		    (job_queue_rec->priority != tested->priority) ||
+		    (job_ptr->priority       != tested->job_prio) ||
+		    (job_ptr->resv_id        != tested->resv_id)) {
+			valid = false;
+			break;
+		}
+		list_delete_item(iter);
+	}
+	list_iterator_destroy(iter);
+	if (!valid)
+		return false;
+
+	if (bf_node_space_dirty)
+		_bf_node_space_rebuild();
+	return true;
+}
+
+/* Discard all state preserved from previous backfill cycles */
+static void _bf_state_clear(void)
+{
+	_node_space_free(bf_node_space);
+	bf_node_space = NULL;
+	bf_node_space_recs = 0;
+	bf_node_space_dirty = false;
+	if (bf_resv_list)
+		list_flush(bf_resv_list);
+	bf_tested_cnt = 0;
+	xfree(bf_end);
+	bf_end_cnt = 0;
+	FREE_NULL_BITMAP(bf_avail_bitmap);
+	bf_state_purge = false;
+	bf_resume_now = false;
+	bf_state_saved = false;
+}
+
+/* Note that a job has been allocated resources. Any reservation made for it
+ * by an earlier cycle is no longer needed. */
+extern void backfill_job_alloc(struct job_record *job_ptr)
+{
+	ListIterator iter;
+	bf_resv_rec_t *resv_ptr;
+
+	if (!bf_resv_list || !job_ptr)
+		return;
+
+	iter = list_iterator_create(bf_resv_list);
+	while ((resv_ptr = (bf_resv_rec_t *) list_next(iter))) {
+		if (resv_ptr->job_id == job_ptr->job_id) {
+			list_delete_item(iter);
+			bf_node_space_dirty = true;
+		}
+	}
+	list_iterator_destroy(iter);
+}
+
+/* Note that partition configuration has changed. Preserved state is
+ * discarded at the start of the next cycle. */
+extern void backfill_part_change(void)
+{
+	bf_state_purge = true;
+}
@@ -50,4 +50,10 @@ extern void stop_backfill_agent(void);
 /* Note that slurm.conf has changed */
 extern void backfill_reconfig(void);
 
+/* Note that a job has been allocated resources */
+extern void backfill_job_alloc(struct job_record *job_ptr);
+
+/* Note that partition configuration has changed */
+extern void backfill_part_change(void);
+
 #endif	/* _SLURM_BACKFILL_H */
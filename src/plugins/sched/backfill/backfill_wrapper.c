@@ -132,6 +132,7 @@ slurm_sched_p_schedule( void )
 int
 slurm_sched_p_newalloc( struct job_record *job_ptr )
 {
+	backfill_job_alloc(job_ptr);
 	return SLURM_SUCCESS;
 }
 
@@ -168,7 +169,7 @@ void slurm_sched_p_job_is_pending( void )
 /**************************************************************************/
 void slurm_sched_p_partition_change( void )
 {
-	/* Empty. */
+	backfill_part_change();
 }
 
 /**************************************************************************/
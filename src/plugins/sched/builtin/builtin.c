@@ -279,6 +279,7 @@ extern void *builtin_agent(void *args)
 
 		lock_slurmctld(all_locks);
 		_compute_start_times();
+		job_pack_cache_clear();
 		last_sched_time = time(NULL);
 		(void) bb_g_job_try_stage_in();
 		unlock_slurmctld(all_locks);
@@ -109,6 +109,9 @@
 /* Enables module specific debugging */
 #define _DEBUG 0
 
+/* _allocate_sc() keeps per-socket counts on the stack up to this size */
+#define SC_STACK_SOCKETS 16
+
 static int _eval_nodes(struct job_record *job_ptr, bitstr_t *node_map,
 			uint32_t min_nodes, uint32_t max_nodes,
 			uint32_t req_nodes, uint32_t cr_node_cnt,
@@ -194,6 +197,9 @@ static uint16_t _allocate_sc(struct job_record *job_ptr, bitstr_t *core_map,
 	uint16_t min_cores = 1, min_sockets = 1, ntasks_per_socket = 0;
 	uint16_t ntasks_per_core = 0xffff;
 	uint32_t free_cpu_count = 0, used_cpu_count = 0, *used_cpu_array = NULL;
+	uint16_t free_cores_buf[SC_STACK_SOCKETS];
+	uint16_t used_cores_buf[SC_STACK_SOCKETS];
+	uint32_t used_cpu_buf[SC_STACK_SOCKETS];
 
 	if (job_ptr->details && job_ptr->details->mc_ptr) {
 		multi_core_data_t *mc_ptr = job_ptr->details->mc_ptr;
@@ -267,10 +273,20 @@ static uint16_t _allocate_sc(struct job_record *job_ptr, bitstr_t *core_map,
 
 
 	/* Step 1: create and compute core-count-per-socket
-	 * arrays and total core counts */
-	free_cores = xmalloc(sockets * sizeof(uint16_t));
-	used_cores = xmalloc(sockets * sizeof(uint16_t));
-	used_cpu_array = xmalloc(sockets * sizeof(uint32_t));
+	 * arrays and total core counts. This runs for every node of every
+	 * test, so avoid the heap for common socket counts. */
+	if (sockets <= SC_STACK_SOCKETS) {
+		free_cores = free_cores_buf;
+		used_cores = used_cores_buf;
+		used_cpu_array = used_cpu_buf;
+		memset(free_cores, 0, sockets * sizeof(uint16_t));
+		memset(used_cores, 0, sockets * sizeof(uint16_t));
+		memset(used_cpu_array, 0, sockets * sizeof(uint32_t));
+	} else {
+		free_cores = xmalloc(sockets * sizeof(uint16_t));
+		used_cores = xmalloc(sockets * sizeof(uint16_t));
+		used_cpu_array = xmalloc(sockets * sizeof(uint32_t));
+	}
 
 	for (c = core_begin; c < core_end; c++) {
 		i = (uint16_t) (c - core_begin) / cores_per_socket;
@@ -296,8 +312,10 @@ static uint16_t _allocate_sc(struct job_record *job_ptr, bitstr_t *core_map,
 		if (used_cpu_array[i])
 			used_cpu_count += used_cores[i] * threads_per_core;
 	}
-	xfree(used_cores);
-	xfree(used_cpu_array);
+	if (used_cores != used_cores_buf) {
+		xfree(used_cores);
+		xfree(used_cpu_array);
+	}
 
 	/* Ignore resources that would push a job allocation over the
 	 * partition CPU limit (if any) */
@@ -445,7 +463,8 @@ fini:
 		bit_nclear(core_map, core_begin, core_end-1);
 		cpu_count = 0;
 	}
-	xfree(free_cores);
+	if (free_cores != free_cores_buf)
+		xfree(free_cores);
 	return cpu_count;
 }
 
@@ -774,7 +793,8 @@ clear_bit:	/* This node is not usable by this job */
 }
 
 
-/* given an "avail" node_bitmap, return a corresponding "avail" core_bitmap */
+/* given an "avail" node_bitmap, return a corresponding "avail" core_bitmap,
+ * release with FREE_NULL_SCRATCH_BITMAP() */
 bitstr_t *_make_core_bitmap(bitstr_t *node_map, uint16_t core_spec)
 {
 	uint32_t n, c, nodes, size;
@@ -785,7 +805,7 @@ bitstr_t *_make_core_bitmap(bitstr_t *node_map, uint16_t core_spec)
 
 	nodes = bit_size(node_map);
 	size = cr_get_coremap_offset(nodes);
-	bitstr_t *core_map = bit_alloc(size);
+	bitstr_t *core_map = bit_scratch_alloc(size);
 
 	nodes = bit_size(node_map);
 
@@ -1498,6 +1518,66 @@ static int _eval_nodes_serial(struct job_record *job_ptr, bitstr_t *node_map,
 fini:	return error_code;
 }
 
+/*
+ * Accumulate the available CPUs of every switch, working up the switch tree
+ * one level at a time. Leaf switches scan their own nodes. A higher level
+ * switch whose child switches' available node bitmaps are disjoint and
+ * together equal its own just sums their counts, rather than scanning a node
+ * range that grows with every level. Other switches (e.g. nodes reached
+ * through two children or not through any child) scan their nodes.
+ */
+static void _topo_switch_cpus(struct job_record *job_ptr,
+			      bitstr_t **switches_bitmap,
+			      int *switches_cpu_cnt, uint16_t *cpu_cnt)
+{
+	struct switch_record *switch_ptr;
+	bitstr_t *child_bitmap = NULL;
+	int i, j, k, level, first, last, cpu_sum;
+
+	for (level = 0; level <= switch_levels; level++) {
+		for (j = 0; j < switch_record_cnt; j++) {
+			switch_ptr = &switch_record_table[j];
+			if (switch_ptr->level != level)
+				continue;
+			if ((level > 0) && (switch_ptr->num_switches > 0)) {
+				if (child_bitmap) {
+					bit_nclear(child_bitmap, 0,
+						   node_record_count - 1);
+				} else
+					child_bitmap =
+						bit_alloc(node_record_count);
+				cpu_sum = 0;
+				for (k = 0; k < switch_ptr->num_switches; k++) {
+					i = switch_ptr->switch_index[k];
+					if (bit_overlap_any(child_bitmap,
+							    switches_bitmap[i]))
+						break;
+					bit_or(child_bitmap,
+					       switches_bitmap[i]);
+					cpu_sum += switches_cpu_cnt[i];
+				}
+				if ((k == switch_ptr->num_switches) &&
+				    bit_equal(child_bitmap,
+					      switches_bitmap[j])) {
+					switches_cpu_cnt[j] = cpu_sum;
+					continue;
+				}
+			}
+			first = bit_ffs(switches_bitmap[j]);
+			if (first < 0)
+				continue;
+			last  = bit_fls(switches_bitmap[j]);
+			for (i = first; i <= last; i++) {
+				if (!bit_test(switches_bitmap[j], i))
+					continue;
+				switches_cpu_cnt[j] +=
+					_get_cpu_cnt(job_ptr, i, cpu_cnt);
+			}
+		}
+	}
+	FREE_NULL_BITMAP(child_bitmap);
+}
+
 /*
  * A network topology aware version of _eval_nodes().
  * NOTE: The logic here is almost identical to that of _job_test_topo()
@@ -1565,7 +1645,7 @@ static int _eval_nodes_topo(struct job_record *job_ptr, bitstr_t *bitmap,
 		bit_or(avail_nodes_bitmap, switches_bitmap[i]);
 		switches_node_cnt[i] = bit_set_count(switches_bitmap[i]);
 		if (req_nodes_bitmap &&
-		    bit_overlap(req_nodes_bitmap, switches_bitmap[i])) {
+		    bit_overlap_any(req_nodes_bitmap, switches_bitmap[i])) {
 			switches_required[i] = 1;
 		}
 	}
@@ -1683,18 +1763,8 @@ static int _eval_nodes_topo(struct job_record *job_ptr, bitstr_t *bitmap,
 		}
 	} else {
 		/* No specific required nodes, calculate CPU counts */
-		for (j=0; j<switch_record_cnt; j++) {
-			first = bit_ffs(switches_bitmap[j]);
-			if (first < 0)
-				continue;
-			last  = bit_fls(switches_bitmap[j]);
-			for (i=first; i<=last; i++) {
-				if (!bit_test(switches_bitmap[j], i))
-					continue;
-				switches_cpu_cnt[j] +=
-					_get_cpu_cnt(job_ptr, i, cpu_cnt);
-			}
-		}
+		_topo_switch_cpus(job_ptr, switches_bitmap, switches_cpu_cnt,
+				  cpu_cnt);
 	}
 
 	/* Determine lowest level switch satisfying request with best fit 
@@ -1990,13 +2060,13 @@ static int _choose_nodes(struct job_record *job_ptr, bitstr_t *node_map,
 	    (max_nodes > job_ptr->details->num_tasks))
 		max_nodes = job_ptr->details->num_tasks;
 
-	origmap = bit_copy(node_map);
+	origmap = bit_scratch_copy(node_map);
 
 	ec = _eval_nodes(job_ptr, node_map, min_nodes, max_nodes,
 			 req_nodes, cr_node_cnt, cpu_cnt, cr_type);
 
 	if (ec == SLURM_SUCCESS) {
-		FREE_NULL_BITMAP(origmap);
+		FREE_NULL_SCRATCH_BITMAP(origmap);
 		return ec;
 	}
 
@@ -2025,11 +2095,11 @@ static int _choose_nodes(struct job_record *job_ptr, bitstr_t *node_map,
 		ec = _eval_nodes(job_ptr, node_map, min_nodes, max_nodes,
 				 req_nodes, cr_node_cnt, cpu_cnt, cr_type);
 		if (ec == SLURM_SUCCESS) {
-			FREE_NULL_BITMAP(origmap);
+			FREE_NULL_SCRATCH_BITMAP(origmap);
 			return ec;
 		}
 	}
-	FREE_NULL_BITMAP(origmap);
+	FREE_NULL_SCRATCH_BITMAP(origmap);
 	return ec;
 }
 
@@ -2142,6 +2212,66 @@ static uint16_t *_select_nodes(struct job_record *job_ptr, uint32_t min_nodes,
 	return cpus;
 }
 
+/* Clear from node_map the nodes whose free core and memory summary in
+ * node_usage shows they cannot satisfy the job's per-node requirements.
+ * This only uses integer compares, so nodes that are busy get dropped
+ * before _can_job_run_on_node() scans their cores. Only valid when the
+ * core map to be tested excludes all cores allocated in partition rows.
+ * Required nodes are left for _select_nodes() to reject. */
+static void _prune_busy_nodes(struct job_record *job_ptr, bitstr_t *node_map,
+			      struct node_use_record *node_usage,
+			      uint16_t cr_type)
+{
+	struct job_details *details_ptr = job_ptr->details;
+	bitstr_t *req_map = details_ptr->req_node_bitmap;
+	uint16_t min_cores = 1, ntasks_per_core = 0xffff, threads;
+	uint32_t avail_cpus, avail_mem, req_mem = 0;
+	int i, i_first, i_last;
+
+	if (details_ptr->mc_ptr) {
+		multi_core_data_t *mc_ptr = details_ptr->mc_ptr;
+		if (mc_ptr->cores_per_socket != (uint16_t) NO_VAL)
+			min_cores = mc_ptr->cores_per_socket;
+		if (mc_ptr->ntasks_per_core)
+			ntasks_per_core = mc_ptr->ntasks_per_core;
+		if ((mc_ptr->threads_per_core != (uint16_t) NO_VAL) &&
+		    (mc_ptr->threads_per_core <  ntasks_per_core))
+			ntasks_per_core = mc_ptr->threads_per_core;
+	}
+	if ((cr_type & CR_MEMORY) &&
+	    !(details_ptr->pn_min_memory & MEM_PER_CPU))
+		req_mem = details_ptr->pn_min_memory;
+
+	i_first = bit_ffs(node_map);
+	if (i_first == -1)
+		return;
+	i_last = bit_fls(node_map);
+	for (i = i_first; i <= i_last; i++) {
+		if (!bit_test(node_map, i))
+			continue;
+		if (req_map && bit_test(req_map, i))
+			continue;
+		threads = MIN(select_node_record[i].vpus, ntasks_per_core);
+		avail_cpus = node_usage[i].free_cores * threads;
+		if ((node_usage[i].free_cores == 0) ||
+		    (node_usage[i].max_sock_free < min_cores) ||
+		    (details_ptr->pn_min_cpus &&
+		     (avail_cpus < details_ptr->pn_min_cpus)) ||
+		    (details_ptr->ntasks_per_node &&
+		     (details_ptr->overcommit == 0) &&
+		     (avail_cpus < details_ptr->ntasks_per_node))) {
+			bit_clear(node_map, i);
+			continue;
+		}
+		if (req_mem) {
+			avail_mem = select_node_record[i].real_memory -
+				    node_usage[i].alloc_memory;
+			if (req_mem > avail_mem)
+				bit_clear(node_map, i);
+		}
+	}
+}
+
 /* When any cores on a node are removed from being available for a job,
  * then remove the entire node from being available. */
 static void _block_whole_nodes(bitstr_t *node_bitmap,
@@ -2200,7 +2330,7 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *node_bitmap,
 	int error_code = SLURM_SUCCESS, ll; /* ll = layout array index */
 	uint16_t *layout_ptr = NULL;
 	bitstr_t *orig_map, *avail_cores, *free_cores, *part_core_map = NULL;
-	bitstr_t *tmpcore = NULL, *reqmap = NULL;
+	bitstr_t *reqmap = NULL;
 	bool test_only;
 	uint32_t c, i, k, n, csize, total_cpus, save_mem = 0;
 	int32_t build_cnt;
@@ -2258,7 +2388,7 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *node_bitmap,
 		     job_ptr->job_id, bit_set_count(node_bitmap));
 	}
 
-	orig_map = bit_copy(node_bitmap);
+	orig_map = bit_scratch_copy(node_bitmap);
 	avail_cores = _make_core_bitmap(node_bitmap,
 					job_ptr->details->core_spec);
 
@@ -2267,33 +2397,33 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *node_bitmap,
 	 * if 'yes' then we will seek the optimal placement for this job
 	 *          within avail_cores
 	 */
-	free_cores = bit_copy(avail_cores);
+	free_cores = bit_scratch_copy(avail_cores);
 	cpu_count = _select_nodes(job_ptr, min_nodes, max_nodes, req_nodes,
 				  node_bitmap, cr_node_cnt, free_cores,
 				  node_usage, cr_type, test_only,
 				  part_core_map);
 	if (cpu_count == NULL) {
 		/* job cannot fit */
-		FREE_NULL_BITMAP(orig_map);
-		FREE_NULL_BITMAP(free_cores);
-		FREE_NULL_BITMAP(avail_cores);
+		FREE_NULL_SCRATCH_BITMAP(orig_map);
+		FREE_NULL_SCRATCH_BITMAP(free_cores);
+		FREE_NULL_SCRATCH_BITMAP(avail_cores);
 		if (select_debug_flags & DEBUG_FLAG_SELECT_TYPE) {
 			info("cons_res: cr_job_test: test 0 fail: "
 			     "insufficient resources");
 		}
 		return SLURM_ERROR;
 	} else if (test_only) {
-		FREE_NULL_BITMAP(orig_map);
-		FREE_NULL_BITMAP(free_cores);
-		FREE_NULL_BITMAP(avail_cores);
+		FREE_NULL_SCRATCH_BITMAP(orig_map);
+		FREE_NULL_SCRATCH_BITMAP(free_cores);
+		FREE_NULL_SCRATCH_BITMAP(avail_cores);
 		xfree(cpu_count);
 		if (select_debug_flags & DEBUG_FLAG_SELECT_TYPE)
 			info("cons_res: cr_job_test: test 0 pass: test_only");
 		return SLURM_SUCCESS;
 	} else if (!job_ptr->best_switch) {
-		FREE_NULL_BITMAP(orig_map);
-		FREE_NULL_BITMAP(free_cores);
-		FREE_NULL_BITMAP(avail_cores);
+		FREE_NULL_SCRATCH_BITMAP(orig_map);
+		FREE_NULL_SCRATCH_BITMAP(free_cores);
+		FREE_NULL_SCRATCH_BITMAP(avail_cores);
 		xfree(cpu_count);
 		if (select_debug_flags & DEBUG_FLAG_CPU_BIND) {
 			info("cons_res: cr_job_test: test 0 fail: "
@@ -2371,34 +2501,30 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *node_bitmap,
 		bit_fmt(str, (sizeof(str) - 1), exc_core_bitmap);
 		debug2("excluding cores reserved: %s", str);
 #endif
-		bit_not(exc_core_bitmap);
-		bit_and(free_cores, exc_core_bitmap);
-		bit_not(exc_core_bitmap);
+		bit_and_not(free_cores, exc_core_bitmap);
 	}
 
 	/* remove all existing allocations from free_cores */
-	tmpcore = bit_copy(free_cores);
 	for (p_ptr = cr_part_ptr; p_ptr; p_ptr = p_ptr->next) {
 		if (!p_ptr->row)
 			continue;
 		for (i = 0; i < p_ptr->num_rows; i++) {
 			if (!p_ptr->row[i].row_bitmap)
 				continue;
-			bit_copybits(tmpcore, p_ptr->row[i].row_bitmap);
-			bit_not(tmpcore); /* set bits now "free" resources */
-			bit_and(free_cores, tmpcore);
+			bit_and_not(free_cores, p_ptr->row[i].row_bitmap);
 			if (p_ptr->part_ptr != job_ptr->part_ptr)
 				continue;
 			if (part_core_map) {
 				bit_or(part_core_map, p_ptr->row[i].row_bitmap);
 			} else {
-				part_core_map = bit_copy(p_ptr->row[i].
-							 row_bitmap);
+				part_core_map = bit_scratch_copy(
+						p_ptr->row[i].row_bitmap);
 			}
 		}
 	}
 	if (job_ptr->details->whole_node)
 		_block_whole_nodes(node_bitmap, avail_cores, free_cores);
+	_prune_busy_nodes(job_ptr, node_bitmap, node_usage, cr_type);
 
 	cpu_count = _select_nodes(job_ptr, min_nodes, max_nodes, req_nodes,
 				  node_bitmap, cr_node_cnt, free_cores,
@@ -2436,9 +2562,7 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *node_bitmap,
 	bit_copybits(free_cores, avail_cores);
 
 	if (exc_core_bitmap) {
-		bit_not(exc_core_bitmap);
-		bit_and(free_cores, exc_core_bitmap);
-		bit_not(exc_core_bitmap);
+		bit_and_not(free_cores, exc_core_bitmap);
 	}
 
 	for (jp_ptr = cr_part_ptr; jp_ptr; jp_ptr = jp_ptr->next) {
@@ -2472,9 +2596,7 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *node_bitmap,
 		for (i = 0; i < p_ptr->num_rows; i++) {
 			if (!p_ptr->row[i].row_bitmap)
 				continue;
-			bit_copybits(tmpcore, p_ptr->row[i].row_bitmap);
-			bit_not(tmpcore); /* set bits now "free" resources */
-			bit_and(free_cores, tmpcore);
+			bit_and_not(free_cores, p_ptr->row[i].row_bitmap);
 		}
 	}
 	if (job_ptr->details->whole_node)
@@ -2514,9 +2636,7 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *node_bitmap,
 		for (i = 0; i < p_ptr->num_rows; i++) {
 			if (!p_ptr->row[i].row_bitmap)
 				continue;
-			bit_copybits(tmpcore, p_ptr->row[i].row_bitmap);
-			bit_not(tmpcore); /* set bits now "free" resources */
-			bit_and(free_cores, tmpcore);
+			bit_and_not(free_cores, p_ptr->row[i].row_bitmap);
 		}
 	}
 	cpu_count = _select_nodes(job_ptr, min_nodes, max_nodes, req_nodes,
@@ -2544,7 +2664,6 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *node_bitmap,
 	/*** Step 4 ***/
 	/* try to fit the job into an existing row
 	 *
-	 * tmpcore = worker core_bitmap
 	 * free_cores = core_bitmap to be built
 	 * avail_cores = static core_bitmap of all available cores
 	 */
@@ -2578,9 +2697,7 @@ extern int cr_job_test(struct job_record *job_ptr, bitstr_t *node_bitmap,
 			break;
 		bit_copybits(node_bitmap, orig_map);
 		bit_copybits(free_cores, avail_cores);
-		bit_copybits(tmpcore, jp_ptr->row[i].row_bitmap);
-		bit_not(tmpcore);
-		bit_and(free_cores, tmpcore);
+		bit_and_not(free_cores, jp_ptr->row[i].row_bitmap);
 		cpu_count = _select_nodes(job_ptr, min_nodes, max_nodes,
 					  req_nodes, node_bitmap, cr_node_cnt,
 					  free_cores, node_usage, cr_type,
@@ -2638,13 +2755,12 @@ alloc_job:
 	 * create the job_resources struct,
 	 * distribute the job on the bits, and exit
 	 */
-	FREE_NULL_BITMAP(orig_map);
-	FREE_NULL_BITMAP(avail_cores);
-	FREE_NULL_BITMAP(tmpcore);
-	FREE_NULL_BITMAP(part_core_map);
+	FREE_NULL_SCRATCH_BITMAP(orig_map);
+	FREE_NULL_SCRATCH_BITMAP(avail_cores);
+	FREE_NULL_SCRATCH_BITMAP(part_core_map);
 	if ((!cpu_count) || (!job_ptr->best_switch)) {
 		/* we were sent here to cleanup and exit */
-		FREE_NULL_BITMAP(free_cores);
+		FREE_NULL_SCRATCH_BITMAP(free_cores);
 		if (select_debug_flags & DEBUG_FLAG_SELECT_TYPE) {
 			info("cons_res: exiting cr_job_test with no "
 			     "allocation");
@@ -2667,7 +2783,7 @@ alloc_job:
 					  job_ptr->details->min_nodes);
 	}
 	if ((error_code != SLURM_SUCCESS) || (mode != SELECT_MODE_RUN_NOW)) {
-		FREE_NULL_BITMAP(free_cores);
+		FREE_NULL_SCRATCH_BITMAP(free_cores);
 		xfree(cpu_count);
 		return error_code;
 	}
@@ -2705,7 +2821,7 @@ alloc_job:
 					  select_fast_schedule);
 	if (error_code != SLURM_SUCCESS) {
 		free_job_resources(&job_res);
-		FREE_NULL_BITMAP(free_cores);
+		FREE_NULL_SCRATCH_BITMAP(free_cores);
 		return error_code;
 	}
 
@@ -2737,7 +2853,7 @@ alloc_job:
 						    "Bad core count",
 						    getuid());
 					free_job_resources(&job_res);
-					FREE_NULL_BITMAP(free_cores);
+					FREE_NULL_SCRATCH_BITMAP(free_cores);
 					return SLURM_ERROR;
 				}
 				bit_set(job_res->core_bitmap, c);
@@ -2769,7 +2885,7 @@ alloc_job:
 		     job_res->ncpus, bit_set_count(free_cores),
 		     bit_set_count(job_res->core_bitmap), job_res->nhosts);
 	}
-	FREE_NULL_BITMAP(free_cores);
+	FREE_NULL_SCRATCH_BITMAP(free_cores);
 
 	/* distribute the tasks and clear any unused cores */
 	job_ptr->job_resrcs = job_res;
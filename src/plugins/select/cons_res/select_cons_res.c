@@ -123,6 +123,7 @@ int node_record_count __attribute__((weak_import));
 time_t last_node_update __attribute__((weak_import));
 struct switch_record *switch_record_table __attribute__((weak_import));
 int switch_record_cnt __attribute__((weak_import));
+int switch_levels __attribute__((weak_import));
 bitstr_t *avail_node_bitmap __attribute__((weak_import));
 bitstr_t *idle_node_bitmap __attribute__((weak_import));
 uint16_t *cr_node_num_cores __attribute__((weak_import));
@@ -136,6 +137,7 @@ int node_record_count;
 time_t last_node_update;
 struct switch_record *switch_record_table;
 int switch_record_cnt;
+int switch_levels;
 bitstr_t *avail_node_bitmap;
 bitstr_t *idle_node_bitmap;
 uint16_t *cr_node_num_cores;
@@ -189,6 +191,53 @@ static bool select_state_initializing = true;
 static int select_node_cnt = 0;
 static int preempt_reorder_cnt = 1;
 static bool preempt_strict_order = false;
+static int will_run_threads = 1;
+
+#define MAX_WILL_RUN_THREADS 64
+
+/* Per-thread arguments for _will_run_agent(). Each thread simulates the
+ * termination of the same sequence of running jobs against its own copy of
+ * the resource tables, but only tests the pending job after removal of every
+ * thread_cnt'th job. The lowest index at which the job fits wins.
+ * cr_job_test() sets fields of the job record it is given, so each thread
+ * tests its own copy of the pending job's record in job_rec and the winning
+ * thread's results are copied into the real record once all are done. */
+typedef struct will_run_args {
+	struct job_record job_rec;		/* private copy of pending job */
+	struct job_record **run_job_ptr;	/* sorted by end_time */
+	int run_job_cnt;
+	int thread_inx;
+	int thread_cnt;
+	bitstr_t *orig_map;
+	bitstr_t *bitmap;		/* selected nodes on success */
+	uint32_t min_nodes;
+	uint32_t max_nodes;
+	uint32_t req_nodes;
+	uint16_t cr_type;
+	uint16_t job_node_req;
+	bitstr_t *exc_core_bitmap;
+	struct part_res_record *snap_part;	/* shared, read-only */
+	struct node_use_record *snap_usage;	/* shared, read-only */
+	pthread_mutex_t *best_lock;
+	int *best_inx;			/* lowest index with job fit */
+} will_run_args_t;
+
+/* Persistent pool of _will_run_agent() threads. The threads are started on
+ * the first threaded will-run test and live until fini() or until
+ * will_run_threads changes. Each test bumps will_run_pool_gen to hand
+ * will_run_pool_args[i] to thread i, then waits for will_run_pool_busy to
+ * drop to zero. */
+static pthread_mutex_t will_run_call_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t will_run_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  will_run_pool_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  will_run_done_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t *will_run_pool_tid = NULL;
+static will_run_args_t *will_run_pool_args = NULL;
+static int will_run_pool_cnt = 0;	/* threads actually started */
+static int will_run_pool_want = 0;	/* will_run_threads at start */
+static int will_run_pool_busy = 0;
+static uint32_t will_run_pool_gen = 0;
+static bool will_run_pool_shutdown = false;
 
 struct select_nodeinfo {
 	uint16_t magic;		/* magic number */
@@ -223,6 +272,14 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 			  uint32_t req_nodes, uint16_t job_node_req,
 			  List preemptee_candidates, List *preemptee_job_list,
 			  bitstr_t *exc_core_bitmap);
+static int _will_run_test_threaded(struct job_record *job_ptr,
+			bitstr_t *bitmap, bitstr_t *orig_map,
+			uint32_t min_nodes, uint32_t max_nodes,
+			uint32_t req_nodes, uint16_t job_node_req,
+			uint16_t tmp_cr_type, List cr_job_list,
+			struct part_res_record *future_part,
+			struct node_use_record *future_usage,
+			bitstr_t *exc_core_bitmap);
 
 struct sort_support {
 	int jstart;
@@ -369,6 +426,8 @@ static struct node_use_record *_dup_node_usage(struct node_use_record *orig_ptr)
 	for (i = 0; i < select_node_cnt; i++) {
 		new_ptr[i].node_state   = orig_ptr[i].node_state;
 		new_ptr[i].alloc_memory = orig_ptr[i].alloc_memory;
+		new_ptr[i].free_cores   = orig_ptr[i].free_cores;
+		new_ptr[i].max_sock_free = orig_ptr[i].max_sock_free;
 		if (orig_ptr[i].gres_list)
 			gres_list = orig_ptr[i].gres_list;
 		else
@@ -475,6 +534,50 @@ static void _destroy_node_data(struct node_use_record *node_usage,
 }
 
 
+/* Recompute the free core summary of node_usage[node_i] from the row bitmaps
+ * of all partitions. Call after any change to the rows covering that node. */
+static void _set_node_free_cores(struct part_res_record *part_record_ptr,
+				 struct node_use_record *node_usage,
+				 uint32_t node_i)
+{
+	struct part_res_record *p_ptr;
+	uint32_t c, core_begin = cr_get_coremap_offset(node_i);
+	uint32_t core_end = cr_get_coremap_offset(node_i + 1);
+	uint16_t cores_per_socket = select_node_record[node_i].cores;
+	uint16_t free_cores = 0, sock_free = 0, max_sock_free = 0;
+	int i;
+	bool used;
+
+	if (cores_per_socket == 0)
+		cores_per_socket = core_end - core_begin;
+	for (c = core_begin; c < core_end; c++) {
+		used = false;
+		for (p_ptr = part_record_ptr; p_ptr && !used;
+		     p_ptr = p_ptr->next) {
+			if (!p_ptr->row)
+				continue;
+			for (i = 0; i < p_ptr->num_rows; i++) {
+				if (p_ptr->row[i].row_bitmap &&
+				    bit_test(p_ptr->row[i].row_bitmap, c)) {
+					used = true;
+					break;
+				}
+			}
+		}
+		if (!used) {
+			free_cores++;
+			sock_free++;
+		}
+		if ((((c - core_begin) + 1) % cores_per_socket) == 0) {
+			max_sock_free = MAX(max_sock_free, sock_free);
+			sock_free = 0;
+		}
+	}
+	node_usage[node_i].free_cores = free_cores;
+	node_usage[node_i].max_sock_free = MAX(max_sock_free, sock_free);
+}
+
+
 static void _add_job_to_row(struct job_resources *job,
 			    struct part_row_data *r_ptr)
 {
@@ -882,6 +985,8 @@ static int _add_job_to_res(struct job_record *job_ptr, int action)
 					continue;  /* node lost by job resize */
 				select_node_usage[i].node_state +=
 					job->node_req;
+				_set_node_free_cores(select_part_record,
+						     select_node_usage, i);
 			}
 		}
 		if (select_debug_flags & DEBUG_FLAG_SELECT_TYPE) {
@@ -1264,6 +1369,8 @@ static int _rm_job_from_res(struct part_res_record *part_record_ptr,
 					node_usage[i].node_state =
 						NODE_CR_AVAILABLE;
 				}
+				_set_node_free_cores(part_record_ptr,
+						     node_usage, i);
 			}
 		}
 	}
@@ -1389,6 +1496,7 @@ static int _rm_job_from_one_node(struct job_record *job_ptr,
 		error("cons_res:_rm_job_from_one_node: node_state miscount");
 		node_usage[node_inx].node_state = NODE_CR_AVAILABLE;
 	}
+	_set_node_free_cores(part_record_ptr, node_usage, node_inx);
 
 	return SLURM_SUCCESS;
 }
@@ -1510,8 +1618,8 @@ static int _run_now(struct job_record *job_ptr, bitstr_t *bitmap,
 	uint16_t mode;
 	uint16_t tmp_cr_type = cr_type;
 
-	save_bitmap = bit_copy(bitmap);
-top:	orig_map = bit_copy(save_bitmap);
+	save_bitmap = bit_scratch_copy(bitmap);
+top:	orig_map = bit_scratch_copy(save_bitmap);
 
 	if (job_ptr->part_ptr->cr_type) {
 		if (((cr_type & CR_SOCKET) || (cr_type & CR_CORE)) &&
@@ -1535,15 +1643,15 @@ top:	orig_map = bit_copy(save_bitmap);
 		/* Remove preemptable jobs from simulated environment */
 		future_part = _dup_part_data(select_part_record);
 		if (future_part == NULL) {
-			FREE_NULL_BITMAP(orig_map);
-			FREE_NULL_BITMAP(save_bitmap);
+			FREE_NULL_SCRATCH_BITMAP(orig_map);
+			FREE_NULL_SCRATCH_BITMAP(save_bitmap);
 			return SLURM_ERROR;
 		}
 		future_usage = _dup_node_usage(select_node_usage);
 		if (future_usage == NULL) {
 			_destroy_part_data(future_part);
-			FREE_NULL_BITMAP(orig_map);
-			FREE_NULL_BITMAP(save_bitmap);
+			FREE_NULL_SCRATCH_BITMAP(orig_map);
+			FREE_NULL_SCRATCH_BITMAP(save_bitmap);
 			return SLURM_ERROR;
 		}
 
@@ -1611,7 +1719,7 @@ top:	orig_map = bit_copy(save_bitmap);
 				list_sort(preemptee_candidates,
 					  (ListCmpF)_sort_usable_nodes_dec);
 			}
-			FREE_NULL_BITMAP(orig_map);
+			FREE_NULL_SCRATCH_BITMAP(orig_map);
 			list_iterator_destroy(job_iterator);
 			_destroy_part_data(future_part);
 			_destroy_node_data(future_usage, NULL);
@@ -1635,8 +1743,8 @@ top:	orig_map = bit_copy(save_bitmap);
 				    (mode != PREEMPT_MODE_CHECKPOINT) &&
 				    (mode != PREEMPT_MODE_CANCEL))
 					continue;
-				if (bit_overlap(bitmap,
-						tmp_job_ptr->node_bitmap) == 0)
+				if (!bit_overlap_any(bitmap,
+						     tmp_job_ptr->node_bitmap))
 					continue;
 				list_append(*preemptee_job_list,
 					    tmp_job_ptr);
@@ -1652,8 +1760,8 @@ top:	orig_map = bit_copy(save_bitmap);
 		_destroy_part_data(future_part);
 		_destroy_node_data(future_usage, NULL);
 	}
-	FREE_NULL_BITMAP(orig_map);
-	FREE_NULL_BITMAP(save_bitmap);
+	FREE_NULL_SCRATCH_BITMAP(orig_map);
+	FREE_NULL_SCRATCH_BITMAP(save_bitmap);
 
 	return rc;
 }
@@ -1677,7 +1785,7 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 	time_t now = time(NULL);
 	uint16_t tmp_cr_type = cr_type;
 
-	orig_map = bit_copy(bitmap);
+	orig_map = bit_scratch_copy(bitmap);
 
 	if (job_ptr->part_ptr->cr_type) {
 		if (((cr_type & CR_SOCKET) || (cr_type & CR_CORE)) &&
@@ -1697,7 +1805,7 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 			 select_node_cnt, select_part_record,
 			 select_node_usage, exc_core_bitmap);
 	if (rc == SLURM_SUCCESS) {
-		FREE_NULL_BITMAP(orig_map);
+		FREE_NULL_SCRATCH_BITMAP(orig_map);
 		job_ptr->start_time = now;
 		return SLURM_SUCCESS;
 	}
@@ -1706,13 +1814,13 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 	 * to determine when and where the job can start. */
 	future_part = _dup_part_data(select_part_record);
 	if (future_part == NULL) {
-		FREE_NULL_BITMAP(orig_map);
+		FREE_NULL_SCRATCH_BITMAP(orig_map);
 		return SLURM_ERROR;
 	}
 	future_usage = _dup_node_usage(select_node_usage);
 	if (future_usage == NULL) {
 		_destroy_part_data(future_part);
-		FREE_NULL_BITMAP(orig_map);
+		FREE_NULL_SCRATCH_BITMAP(orig_map);
 		return SLURM_ERROR;
 	}
 
@@ -1762,7 +1870,15 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 
 	/* Remove the running jobs one at a time from exp_node_cr and try
 	 * scheduling the pending job after each one. */
-	if (rc != SLURM_SUCCESS) {
+	if ((rc != SLURM_SUCCESS) && (will_run_threads > 1) &&
+	    (list_count(cr_job_list) > will_run_threads)) {
+		list_sort(cr_job_list, _cr_job_list_sort);
+		rc = _will_run_test_threaded(job_ptr, bitmap, orig_map,
+					     min_nodes, max_nodes, req_nodes,
+					     job_node_req, tmp_cr_type,
+					     cr_job_list, future_part,
+					     future_usage, exc_core_bitmap);
+	} else if (rc != SLURM_SUCCESS) {
 		list_sort(cr_job_list, _cr_job_list_sort);
 		job_iterator = list_iterator_create(cr_job_list);
 		while ((tmp_job_ptr = list_next(job_iterator))) {
@@ -1804,8 +1920,8 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 		preemptee_iterator =list_iterator_create(preemptee_candidates);
 		while ((tmp_job_ptr = (struct job_record *)
 			list_next(preemptee_iterator))) {
-			if (bit_overlap(bitmap,
-					tmp_job_ptr->node_bitmap) == 0)
+			if (!bit_overlap_any(bitmap,
+					     tmp_job_ptr->node_bitmap))
 				continue;
 			list_append(*preemptee_job_list, tmp_job_ptr);
 		}
@@ -1815,7 +1931,238 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 	list_destroy(cr_job_list);
 	_destroy_part_data(future_part);
 	_destroy_node_data(future_usage, NULL);
-	FREE_NULL_BITMAP(orig_map);
+	FREE_NULL_SCRATCH_BITMAP(orig_map);
+	return rc;
+}
+
+/* Run one share of a threaded will-run test. The thread's private copy of the
+ * resource tables is made here from the shared snapshot, so the copies for
+ * all threads are built concurrently rather than by the calling thread. */
+static void _will_run_agent(will_run_args_t *args)
+{
+	struct part_res_record *future_part;
+	struct node_use_record *future_usage;
+	struct job_record *tmp_job_ptr;
+	int i, rc;
+
+	future_part  = _dup_part_data(args->snap_part);
+	future_usage = _dup_node_usage(args->snap_usage);
+
+	for (i = 0; i < args->run_job_cnt; i++) {
+		slurm_mutex_lock(args->best_lock);
+		rc = (*args->best_inx <= i);
+		slurm_mutex_unlock(args->best_lock);
+		if (rc)		/* Another thread found an earlier fit */
+			break;
+
+		tmp_job_ptr = args->run_job_ptr[i];
+		if (!bit_overlap_any(args->orig_map, tmp_job_ptr->node_bitmap))
+			continue;	/* job has no usable nodes, skip it */
+		_rm_job_from_res(future_part, future_usage, tmp_job_ptr, 0);
+		if ((i % args->thread_cnt) != args->thread_inx)
+			continue;	/* Tested by another thread */
+
+		bit_copybits(args->bitmap, args->orig_map);
+		rc = cr_job_test(&args->job_rec, args->bitmap, args->min_nodes,
+				 args->max_nodes, args->req_nodes,
+				 SELECT_MODE_WILL_RUN, args->cr_type,
+				 args->job_node_req, select_node_cnt,
+				 future_part, future_usage,
+				 args->exc_core_bitmap);
+		if (rc == SLURM_SUCCESS) {
+			slurm_mutex_lock(args->best_lock);
+			if (i < *args->best_inx)
+				*args->best_inx = i;
+			slurm_mutex_unlock(args->best_lock);
+			break;
+		}
+	}
+
+	_destroy_part_data(future_part);
+	_destroy_node_data(future_usage, NULL);
+}
+
+static void *_will_run_pool_thread(void *x)
+{
+	int inx = (int) (long) x;
+	uint32_t gen = 0;
+
+	slurm_mutex_lock(&will_run_pool_lock);
+	while (1) {
+		while (!will_run_pool_shutdown && (gen == will_run_pool_gen))
+			pthread_cond_wait(&will_run_pool_cond,
+					  &will_run_pool_lock);
+		if (will_run_pool_shutdown)
+			break;
+		gen = will_run_pool_gen;
+		slurm_mutex_unlock(&will_run_pool_lock);
+
+		_will_run_agent(&will_run_pool_args[inx]);
+
+		slurm_mutex_lock(&will_run_pool_lock);
+		if (--will_run_pool_busy == 0)
+			pthread_cond_signal(&will_run_done_cond);
+	}
+	slurm_mutex_unlock(&will_run_pool_lock);
+
+	return NULL;
+}
+
+/* Stop and join the will-run thread pool. Caller must hold
+ * will_run_call_lock or be in fini(). */
+static void _will_run_pool_fini(void)
+{
+	int i;
+
+	will_run_pool_want = 0;
+	if (will_run_pool_cnt == 0) {
+		xfree(will_run_pool_tid);
+		xfree(will_run_pool_args);
+		return;
+	}
+
+	slurm_mutex_lock(&will_run_pool_lock);
+	will_run_pool_shutdown = true;
+	pthread_cond_broadcast(&will_run_pool_cond);
+	slurm_mutex_unlock(&will_run_pool_lock);
+	for (i = 0; i < will_run_pool_cnt; i++)
+		pthread_join(will_run_pool_tid[i], NULL);
+
+	xfree(will_run_pool_tid);
+	xfree(will_run_pool_args);
+	will_run_pool_cnt = 0;
+	will_run_pool_gen = 0;
+	will_run_pool_shutdown = false;
+}
+
+/* Start thread_cnt will-run pool threads unless already running.
+ * Caller must hold will_run_call_lock.
+ * RET count of threads in the pool, 0 if none could be started */
+static int _will_run_pool_init(int thread_cnt)
+{
+	pthread_attr_t attr;
+	int i;
+
+	if (will_run_pool_want == thread_cnt)
+		return will_run_pool_cnt;
+	_will_run_pool_fini();
+	will_run_pool_want = thread_cnt;
+
+	will_run_pool_tid  = xmalloc(sizeof(pthread_t) * thread_cnt);
+	will_run_pool_args = xmalloc(sizeof(will_run_args_t) * thread_cnt);
+	slurm_attr_init(&attr);
+	for (i = 0; i < thread_cnt; i++) {
+		if (pthread_create(&will_run_pool_tid[i], &attr,
+				   _will_run_pool_thread, (void *) (long) i)) {
+			error("cons_res: pthread_create: %m");
+			break;
+		}
+		will_run_pool_cnt++;
+	}
+	slurm_attr_destroy(&attr);
+
+	return will_run_pool_cnt;
+}
+
+/* Variant of the job termination simulation in _will_run_test() which
+ * spreads the cr_job_test() calls over the will_run_threads pool threads.
+ * The result is identical to that of the serial simulation: the pending
+ * job's start time is the end time of the first running job after whose
+ * termination it fits.
+ * IN/OUT bitmap - usable nodes, set to selected nodes on success
+ * IN cr_job_list - running jobs, sorted by end time
+ * IN future_part, future_usage - resource tables with preemptable jobs
+ *	already removed, shared read-only by all pool threads
+ * RET SLURM_SUCCESS if the job can run at some point in the future */
+static int _will_run_test_threaded(struct job_record *job_ptr,
+			bitstr_t *bitmap, bitstr_t *orig_map,
+			uint32_t min_nodes, uint32_t max_nodes,
+			uint32_t req_nodes, uint16_t job_node_req,
+			uint16_t tmp_cr_type, List cr_job_list,
+			struct part_res_record *future_part,
+			struct node_use_record *future_usage,
+			bitstr_t *exc_core_bitmap)
+{
+	pthread_mutex_t best_lock = PTHREAD_MUTEX_INITIALIZER;
+	will_run_args_t *args, local_args;
+	struct job_record **run_job_ptr, *tmp_job_ptr;
+	ListIterator job_iterator;
+	int best_inx, i, run_job_cnt = 0, thread_cnt;
+	int rc = SLURM_ERROR;
+	time_t now = time(NULL);
+
+	run_job_ptr = xmalloc(sizeof(struct job_record *) *
+			      list_count(cr_job_list));
+	job_iterator = list_iterator_create(cr_job_list);
+	while ((tmp_job_ptr = list_next(job_iterator)))
+		run_job_ptr[run_job_cnt++] = tmp_job_ptr;
+	list_iterator_destroy(job_iterator);
+	best_inx = run_job_cnt;
+
+	slurm_mutex_lock(&will_run_call_lock);
+	thread_cnt = _will_run_pool_init(will_run_threads);
+	if (thread_cnt == 0) {
+		/* No pool, do the whole simulation in this thread */
+		args = &local_args;
+		thread_cnt = 1;
+	} else
+		args = will_run_pool_args;
+
+	for (i = 0; i < thread_cnt; i++) {
+		memcpy(&args[i].job_rec, job_ptr, sizeof(struct job_record));
+		args[i].job_rec.job_resrcs = NULL;
+		args[i].run_job_ptr     = run_job_ptr;
+		args[i].run_job_cnt     = run_job_cnt;
+		args[i].thread_inx      = i;
+		args[i].thread_cnt      = thread_cnt;
+		args[i].orig_map        = orig_map;
+		args[i].bitmap          = bit_scratch_copy(orig_map);
+		args[i].min_nodes       = min_nodes;
+		args[i].max_nodes       = max_nodes;
+		args[i].req_nodes       = req_nodes;
+		args[i].cr_type         = tmp_cr_type;
+		args[i].job_node_req    = job_node_req;
+		args[i].exc_core_bitmap = exc_core_bitmap;
+		args[i].snap_part       = future_part;
+		args[i].snap_usage      = future_usage;
+		args[i].best_lock       = &best_lock;
+		args[i].best_inx        = &best_inx;
+	}
+
+	if (args == &local_args) {
+		_will_run_agent(args);
+	} else {
+		slurm_mutex_lock(&will_run_pool_lock);
+		will_run_pool_busy = thread_cnt;
+		will_run_pool_gen++;
+		pthread_cond_broadcast(&will_run_pool_cond);
+		while (will_run_pool_busy)
+			pthread_cond_wait(&will_run_done_cond,
+					  &will_run_pool_lock);
+		slurm_mutex_unlock(&will_run_pool_lock);
+	}
+
+	if (best_inx < run_job_cnt) {
+		rc = SLURM_SUCCESS;
+		i = best_inx % thread_cnt;
+		bit_copybits(bitmap, args[i].bitmap);
+		job_ptr->total_cpus  = args[i].job_rec.total_cpus;
+		job_ptr->best_switch = args[i].job_rec.best_switch;
+		tmp_job_ptr = run_job_ptr[best_inx];
+		if (tmp_job_ptr->end_time <= now)
+			job_ptr->start_time = now + 1;
+		else
+			job_ptr->start_time = tmp_job_ptr->end_time;
+	}
+
+	for (i = 0; i < thread_cnt; i++) {
+		FREE_NULL_SCRATCH_BITMAP(args[i].bitmap);
+		free_job_resources(&args[i].job_rec.job_resrcs);
+	}
+	slurm_mutex_unlock(&will_run_call_lock);
+	xfree(run_job_ptr);
+	slurm_mutex_destroy(&best_lock);
+
 	return rc;
 }
 
@@ -1851,6 +2198,9 @@ extern int init(void)
 
 extern int fini(void)
 {
+	slurm_mutex_lock(&will_run_call_lock);
+	_will_run_pool_fini();
+	slurm_mutex_unlock(&will_run_call_lock);
 	_destroy_node_data(select_node_usage, select_node_record);
 	select_node_record = NULL;
 	select_node_usage = NULL;
@@ -1945,6 +2295,15 @@ extern int select_p_node_init(struct node_record *node_ptr, int node_cnt)
 	}
 	if (sched_params && strstr(sched_params, "pack_serial_at_end"))
 		pack_serial_at_end = true;
+	if (sched_params &&
+	    (tmp_ptr = strstr(sched_params, "will_run_threads=")))
+		will_run_threads = atoi(tmp_ptr + 17);
+	if ((will_run_threads < 1) ||
+	    (will_run_threads > MAX_WILL_RUN_THREADS)) {
+		error("Invalid SchedulerParameters will_run_threads: %d",
+		      will_run_threads);
+		will_run_threads = 1;
+	}
 	xfree(sched_params);
 
 	/* initial global core data structures */
@@ -1989,6 +2348,8 @@ extern int select_p_node_init(struct node_record *node_ptr, int node_cnt)
 						   node_ptr->gres_list);
 	}
 	_create_part_data();
+	for (i = 0; i < select_node_cnt; i++)
+		_set_node_free_cores(select_part_record, select_node_usage, i);
 
 	return SLURM_SUCCESS;
 }
@@ -2957,8 +3318,8 @@ extern bitstr_t * select_p_resv_test(resv_desc_msg_t *resv_desc_ptr,
 		char str[100];
 		switches_bitmap[i] = bit_copy(switch_record_table[i].
 						  node_bitmap);
-		bit_and(switches_bitmap[i], avail_bitmap);
-		switches_node_cnt[i] = bit_set_count(switches_bitmap[i]);
+		switches_node_cnt[i] = bit_and_set_count(switches_bitmap[i],
+							 avail_bitmap);
 
 		switches_core_bitmap[i] =
 			_make_core_bitmap_filtered(switches_bitmap[i], 1);
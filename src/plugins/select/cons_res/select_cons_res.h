@@ -101,6 +101,9 @@ struct node_use_record {
 	List gres_list;			/* list of gres state info managed by 
 					 * plugins */
 	uint16_t node_state;		/* see node_cr_state comments */
+	uint16_t free_cores;		/* cores not allocated in any row of
+					 * any partition */
+	uint16_t max_sock_free;		/* most free cores on any one socket */
 };
 
 extern bool     pack_serial_at_end;
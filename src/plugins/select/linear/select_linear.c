@@ -94,6 +94,7 @@ int node_record_count __attribute__((weak_import));
 time_t last_node_update __attribute__((weak_import));
 struct switch_record *switch_record_table __attribute__((weak_import));
 int switch_record_cnt __attribute__((weak_import));
+int switch_levels __attribute__((weak_import));
 #else
 slurm_ctl_conf_t slurmctld_conf;
 struct node_record *node_record_table_ptr;
@@ -103,6 +104,7 @@ int node_record_count;
 time_t last_node_update;
 struct switch_record *switch_record_table;
 int switch_record_cnt;
+int switch_levels;
 #endif
 
 struct select_nodeinfo {
@@ -155,6 +157,9 @@ static int _run_now(struct job_record *job_ptr, bitstr_t *bitmap,
 		    List preemptee_candidates,
 		    List *preemptee_job_list);
 static int _sort_usable_nodes_dec(void *, void *);
+static void _switch_cpu_cnt(struct job_record *job_ptr,
+			    bitstr_t **switches_bitmap,
+			    int *switches_cpu_cnt);
 static bool _test_run_job(struct cr_record *cr_ptr, uint32_t job_id);
 static bool _test_tot_job(struct cr_record *cr_ptr, uint32_t job_id);
 static int _test_only(struct job_record *job_ptr, bitstr_t *bitmap,
@@ -1092,6 +1097,67 @@ static int _job_test(struct job_record *job_ptr, bitstr_t *bitmap,
 	return error_code;
 }
 
+/*
+ * _switch_cpu_cnt - Accumulate the available CPUs of every switch, working
+ *	up the switch tree one level at a time. Leaf switches scan their own
+ *	nodes. A higher level switch whose child switches' available node
+ *	bitmaps are disjoint and together equal its own just sums their
+ *	counts. Other switches (e.g. nodes reached through two children or
+ *	not through any child) scan their nodes.
+ * NOTE: This is the same as _topo_switch_cpus() in select/cons_res/job_test.c
+ */
+static void _switch_cpu_cnt(struct job_record *job_ptr,
+			    bitstr_t **switches_bitmap,
+			    int *switches_cpu_cnt)
+{
+	struct switch_record *switch_ptr;
+	bitstr_t *child_bitmap = NULL;
+	int i, j, k, level, first, last, cpu_sum;
+
+	for (level = 0; level <= switch_levels; level++) {
+		for (j = 0; j < switch_record_cnt; j++) {
+			switch_ptr = &switch_record_table[j];
+			if (switch_ptr->level != level)
+				continue;
+			if ((level > 0) && (switch_ptr->num_switches > 0)) {
+				if (child_bitmap) {
+					bit_nclear(child_bitmap, 0,
+						   node_record_count - 1);
+				} else
+					child_bitmap =
+						bit_alloc(node_record_count);
+				cpu_sum = 0;
+				for (k = 0; k < switch_ptr->num_switches; k++) {
+					i = switch_ptr->switch_index[k];
+					if (bit_overlap_any(child_bitmap,
+							    switches_bitmap[i]))
+						break;
+					bit_or(child_bitmap,
+					       switches_bitmap[i]);
+					cpu_sum += switches_cpu_cnt[i];
+				}
+				if ((k == switch_ptr->num_switches) &&
+				    bit_equal(child_bitmap,
+					      switches_bitmap[j])) {
+					switches_cpu_cnt[j] = cpu_sum;
+					continue;
+				}
+			}
+			first = bit_ffs(switches_bitmap[j]);
+			if (first < 0)
+				continue;
+			last  = bit_fls(switches_bitmap[j]);
+			for (i = first; i <= last; i++) {
+				if (bit_test(switches_bitmap[j], i)) {
+					switches_cpu_cnt[j] +=
+						_get_avail_cpus(job_ptr, i);
+				}
+			}
+		}
+	}
+	FREE_NULL_BITMAP(child_bitmap);
+}
+
 /*
  * _job_test_topo - A topology aware version of _job_test()
  * NOTE: The logic here is almost identical to that of _eval_nodes_topo() in
@@ -1195,14 +1261,7 @@ static int _job_test_topo(struct job_record *job_ptr, bitstr_t *bitmap,
 #if SELECT_DEBUG
 	debug5("_job_test_topo: phase 2");
 #endif
-	for (i = 0; i < node_record_count; i++) {
-		avail_cpus = _get_avail_cpus(job_ptr, i);
-		for (j=0; j<switch_record_cnt; j++) {
-			if (bit_test(switches_bitmap[j], i)) {
-				switches_cpu_cnt[j] += avail_cpus;
-			}
-		}
-	}
+	_switch_cpu_cnt(job_ptr, switches_bitmap, switches_cpu_cnt);
 
 	/* phase 3 */
 #if SELECT_DEBUG
@@ -2518,8 +2577,8 @@ top:	if ((rc != SLURM_SUCCESS) && preemptee_candidates &&
 				preemptee_candidates);
 			while ((tmp_job_ptr = (struct job_record *)
 				list_next(preemptee_iterator))) {
-				if (bit_overlap(bitmap,
-						tmp_job_ptr->node_bitmap) == 0)
+				if (!bit_overlap_any(bitmap,
+						     tmp_job_ptr->node_bitmap))
 					continue;
 				if (tmp_job_ptr->details->usable_nodes == 0)
 					continue;
@@ -2663,7 +2722,7 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 		preemptee_iterator =list_iterator_create(preemptee_candidates);
 		while ((tmp_job_ptr = (struct job_record *)
 			list_next(preemptee_iterator))) {
-			if (bit_overlap(bitmap, tmp_job_ptr->node_bitmap) == 0)
+			if (!bit_overlap_any(bitmap, tmp_job_ptr->node_bitmap))
 				continue;
 
 			list_append(*preemptee_job_list, tmp_job_ptr);
@@ -3460,8 +3519,8 @@ extern bitstr_t * select_p_resv_test(resv_desc_msg_t *resv_desc_ptr,
 	for (i=0; i<switch_record_cnt; i++) {
 		switches_bitmap[i] = bit_copy(switch_record_table[i].
 					      node_bitmap);
-		bit_and(switches_bitmap[i], avail_bitmap);
-		switches_node_cnt[i] = bit_set_count(switches_bitmap[i]);
+		switches_node_cnt[i] = bit_and_set_count(switches_bitmap[i],
+							 avail_bitmap);
 	}
 
 #if SELECT_DEBUG
@@ -565,64 +565,122 @@ void _init_params()
 	params.job_cond->without_usage_truncation = 1;
 }
 
-int get_data(void)
+/* _aggregate_job() -- Roll the step statistics up into the job
+ *
+ * In:	job - as it came from the database.
+ * Out:	void.
+ */
+static void _aggregate_job(slurmdb_job_rec_t *job)
 {
-	slurmdb_job_rec_t *job = NULL;
 	slurmdb_step_rec_t *step = NULL;
-
-	ListIterator itr = NULL;
 	ListIterator itr_step = NULL;
-	slurmdb_job_cond_t *job_cond = params.job_cond;
 
-	if (params.opt_completion) {
-		jobs = g_slurm_jobcomp_get_jobs(job_cond);
-		return SLURM_SUCCESS;
-	} else {
-		jobs = slurmdb_jobs_get(acct_db_conn, job_cond);
+	if (job->user) {
+		struct	passwd *pw = NULL;
+		if ((pw=getpwnam(job->user)))
+			job->uid = pw->pw_uid;
 	}
 
-	if (!jobs)
-		return SLURM_ERROR;
+	if (!job->steps || !list_count(job->steps))
+		return;
 
-	itr = list_iterator_create(jobs);
+	itr_step = list_iterator_create(job->steps);
+	while((step = list_next(itr_step)) != NULL) {
+		/* now aggregate the aggregatable */
+		job->alloc_cpus = MAX(job->alloc_cpus, step->ncpus);
+
+		if (step->state < JOB_COMPLETE)
+			continue;
+		job->tot_cpu_sec += step->tot_cpu_sec;
+		job->tot_cpu_usec += step->tot_cpu_usec;
+		job->user_cpu_sec +=
+			step->user_cpu_sec;
+		job->user_cpu_usec +=
+			step->user_cpu_usec;
+		job->sys_cpu_sec +=
+			step->sys_cpu_sec;
+		job->sys_cpu_usec +=
+			step->sys_cpu_usec;
+
+		/* get the max for all the sacct_t struct */
+		aggregate_stats(&job->stats, &step->stats);
+	}
+	list_iterator_destroy(itr_step);
+}
+
+/* _list_jobs() -- List a chunk of the data as it comes in
+ *
+ * In:	job_list - the next jobs from the database.
+ * Out:	SLURM_SUCCESS to keep the jobs coming.
+ *
+ * The database hands the jobs over a chunk at a time so they are
+ * printed right away instead of after the whole query is done.
+ */
+static int _list_jobs(List job_list, void *arg)
+{
+	ListIterator itr = NULL;
+	ListIterator itr_step = NULL;
+	slurmdb_job_rec_t *job = NULL;
+	slurmdb_step_rec_t *step = NULL;
+
+	itr = list_iterator_create(job_list);
 	while((job = list_next(itr))) {
-		if (job->user) {
-			struct	passwd *pw = NULL;
-			if ((pw=getpwnam(job->user)))
-				job->uid = pw->pw_uid;
+		_aggregate_job(job);
+
+		if (list_count(job->steps)) {
+			int cnt = list_count(job->steps);
+			job->stats.cpu_ave /= (double)cnt;
+			job->stats.rss_ave /= (double)cnt;
+			job->stats.vsize_ave /= (double)cnt;
+			job->stats.pages_ave /= (double)cnt;
+			job->stats.disk_read_ave /= (double)cnt;
+			job->stats.disk_write_ave /= (double)cnt;
 		}
 
-		if (!job->steps || !list_count(job->steps))
-			continue;
+		if (job->show_full)
+			print_fields(JOB, job);
 
-		itr_step = list_iterator_create(job->steps);
-		while((step = list_next(itr_step)) != NULL) {
-			/* now aggregate the aggregatable */
-			job->alloc_cpus = MAX(job->alloc_cpus, step->ncpus);
-
-			if (step->state < JOB_COMPLETE)
-				continue;
-			job->tot_cpu_sec += step->tot_cpu_sec;
-			job->tot_cpu_usec += step->tot_cpu_usec;
-			job->user_cpu_sec +=
-				step->user_cpu_sec;
-			job->user_cpu_usec +=
-				step->user_cpu_usec;
-			job->sys_cpu_sec +=
-				step->sys_cpu_sec;
-			job->sys_cpu_usec +=
-				step->sys_cpu_usec;
-
-			/* get the max for all the sacct_t struct */
-			aggregate_stats(&job->stats, &step->stats);
+		if (!params.opt_allocs
+		    && (job->track_steps || !job->show_full)) {
+			itr_step = list_iterator_create(job->steps);
+			while((step = list_next(itr_step))) {
+				if (step->end == 0)
+					step->end = job->end;
+				print_fields(JOBSTEP, step);
+			}
+			list_iterator_destroy(itr_step);
 		}
-		list_iterator_destroy(itr_step);
 	}
 	list_iterator_destroy(itr);
 
 	return SLURM_SUCCESS;
 }
 
+/* get_data() -- Get the data from the database or job completion log
+ *
+ * Jobs from the database are listed as they come in, the job
+ * completion records are listed afterwards with do_list_completion().
+ */
+int get_data(void)
+{
+	slurmdb_job_cond_t *job_cond = params.job_cond;
+	int rc;
+
+	if (params.opt_completion) {
+		jobs = g_slurm_jobcomp_get_jobs(job_cond);
+		return SLURM_SUCCESS;
+	}
+
+	rc = slurmdb_jobs_get_cb(acct_db_conn, job_cond, _list_jobs, NULL);
+	if (rc != SLURM_SUCCESS) {
+		if (rc != SLURM_ERROR)
+			slurm_seterrno(rc);
+		return SLURM_ERROR;
+	}
+
+	return SLURM_SUCCESS;
+}
+
 void parse_command_line(int argc, char **argv)
 {
 	extern int optind;
@@ -1246,53 +1304,6 @@ void do_help(void)
 	}
 }
 
-/* do_list() -- List the assembled data
- *
- * In:	Nothing explicit.
- * Out:	void.
- *
- * At this point, we have already selected the desired data,
- * so we just need to print it for the user.
- */
-void do_list(void)
-{
-	ListIterator itr = NULL;
-	ListIterator itr_step = NULL;
-	slurmdb_job_rec_t *job = NULL;
-	slurmdb_step_rec_t *step = NULL;
-
-	if (!jobs)
-		return;
-
-	itr = list_iterator_create(jobs);
-	while((job = list_next(itr))) {
-		if (list_count(job->steps)) {
-			int cnt = list_count(job->steps);
-			job->stats.cpu_ave /= (double)cnt;
-			job->stats.rss_ave /= (double)cnt;
-			job->stats.vsize_ave /= (double)cnt;
-			job->stats.pages_ave /= (double)cnt;
-			job->stats.disk_read_ave /= (double)cnt;
-			job->stats.disk_write_ave /= (double)cnt;
-		}
-
-		if (job->show_full)
-			print_fields(JOB, job);
-
-		if (!params.opt_allocs
-		    && (job->track_steps || !job->show_full)) {
-			itr_step = list_iterator_create(job->steps);
-			while((step = list_next(itr_step))) {
-				if (step->end == 0)
-					step->end = job->end;
-				print_fields(JOBSTEP, step);
-			}
-			list_iterator_destroy(itr_step);
-		}
-	}
-	list_iterator_destroy(itr);
-}
-
 /* do_list_completion() -- List the assembled data
  *
  * In:	Nothing explicit.
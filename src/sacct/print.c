@@ -119,7 +119,7 @@ static void _print_small_double(
 		snprintf(outbuf, buf_size, "0");
 }
 
-/* Translate bitmap representation from hex to decimal format, replacing
+/* Translate bitmap representation to decimal format, replacing
  * array_task_str. */
 static void _xlate_task_str(slurmdb_job_rec_t *job_ptr)
 {
@@ -130,13 +130,10 @@ static void _xlate_task_str(slurmdb_job_rec_t *job_ptr)
 	char *in_buf = job_ptr->array_task_str;
 	char *out_buf = NULL;
 
-	if (!in_buf)
+	task_bitmap = slurm_array_str2bitmap(in_buf);
+	if (!task_bitmap)
 		return;
 
-	i = strlen(in_buf);
-	task_bitmap = bit_alloc(i * 4);
-	bit_unfmt_hexmask(task_bitmap, in_buf);
-
 	/* Check first for a step function */
 	i_first = bit_ffs(task_bitmap);
 	i_last  = bit_fls(task_bitmap);
@@ -171,24 +168,14 @@ static void _xlate_task_str(slurmdb_job_rec_t *job_ptr)
 			for (i = 0; i < 3; i++)
 				out_buf[buf_size - 2 - i] = '.';
 	} else {
-		/* Print the full bitmap's string representation.
-		 * For huge bitmaps this can take roughly one minute,
-		 * so let the client do the work */
-		buf_size = bit_size(task_bitmap) * 8;
-		while (1) {
-			out_buf = xmalloc(buf_size);
-			bit_fmt(out_buf, buf_size, task_bitmap);
-			len = strlen(out_buf);
-			if ((len > 0) && (len < (buf_size - 32)))
-				break;
-			xfree(out_buf);
-			buf_size *= 2;
-		}
+		/* Print the full bitmap's string representation */
+		out_buf = bit_fmt_full(task_bitmap);
 	}
 
 	if (job_ptr->array_max_tasks)
 		xstrfmtcat(out_buf, "%c%u", '%', job_ptr->array_max_tasks);
 
+	FREE_NULL_BITMAP(task_bitmap);
 	xfree(job_ptr->array_task_str);
 	job_ptr->array_task_str = out_buf;
 }
@@ -203,7 +203,6 @@ void print_fields(type_t type, void *object);
 int get_data(void);
 void parse_command_line(int argc, char **argv);
 void do_help(void);
-void do_list(void);
 void do_list_completion(void);
 void sacct_init();
 void sacct_fini();
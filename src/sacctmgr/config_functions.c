@@ -145,6 +145,31 @@ static void _print_slurm_config(void)
 	printf("TrackWCKey             = %u\n", track_wckey);
 }
 
+extern int sacctmgr_list_stats(void)
+{
+	List stats_list;
+	ListIterator iter = NULL;
+	config_key_pair_t *key_pair;
+
+	if (!(stats_list = acct_storage_g_get_config(db_conn,
+						     "rollup_stats"))) {
+		exit_code = 1;
+		fprintf(stderr, " Problem getting statistics "
+			"from the database\n");
+		return SLURM_ERROR;
+	}
+
+	printf("Rollup statistics (times in usec):\n");
+	iter = list_iterator_create(stats_list);
+	while ((key_pair = list_next(iter))) {
+		printf("%-22s = %s\n", key_pair->name, key_pair->value);
+	}
+	list_iterator_destroy(iter);
+	list_destroy(stats_list);
+
+	return SLURM_SUCCESS;
+}
+
 extern int sacctmgr_list_config(bool have_db_conn)
 {
 	_load_slurm_config();
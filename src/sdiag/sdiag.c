@@ -61,6 +61,8 @@ bool sort_by_time2 = false;
 stats_info_response_msg_t *buf;
 uint32_t *rpc_type_ave_time = NULL, *rpc_user_ave_time = NULL;
 
+static void _print_lock_stats(void);
+static void _print_rpc_queue_stats(void);
 static int  _print_stats(void);
 static void _sort_rpc(void);
 
@@ -166,6 +168,16 @@ static int _print_stats(void)
 		printf("\tDepth Mean (try depth): %u\n",
 		       buf->bf_depth_try_sum / buf->bf_cycle_counter);
 	}
+	if (buf->bf_cycle_last > 0) {
+		printf("\tLast cycle jobs tested per second: %u\n",
+		       (uint32_t) ((uint64_t) buf->bf_last_depth_try *
+				   1000000 / buf->bf_cycle_last));
+	}
+	if (buf->bf_cycle_sum > 0) {
+		printf("\tMean jobs tested per second: %u\n",
+		       (uint32_t) ((uint64_t) buf->bf_depth_try_sum *
+				   1000000 / buf->bf_cycle_sum));
+	}
 	printf("\tLast queue length: %u\n", buf->bf_queue_len);
 	if (buf->bf_cycle_counter > 0) {
 		printf("\tQueue length mean: %u\n",
@@ -192,9 +204,72 @@ static int _print_stats(void)
 		       rpc_user_ave_time[i], buf->rpc_user_time[i]);
 	}
 
+	_print_rpc_queue_stats();
+	_print_lock_stats();
+
 	return 0;
 }
 
+static void _print_lock_stats(void)
+{
+	static char *lock_names[] = { "config", "job", "node", "partition" };
+	static char *hist_names[] = { "<10us", "<100us", "<1ms", "<10ms",
+				      "<100ms", "<1s", ">=1s" };
+	uint32_t hist_size, ave_wait;
+	int i, j;
+
+	if ((buf->lock_stat_size == 0) ||
+	    (buf->lock_stat_size > (sizeof(lock_names) / sizeof(char *) * 2)))
+		return;
+	hist_size = MIN(buf->lock_hist_size,
+			sizeof(hist_names) / sizeof(char *));
+
+	printf("\nLock wait time statistics (usec)\n");
+	printf("\t%-16s %10s %8s %8s", "", "count", "ave_wait", "max_wait");
+	for (j = 0; j < hist_size; j++)
+		printf(" %8s", hist_names[j]);
+	printf("\n");
+	for (i = 0; i < buf->lock_stat_size; i++) {
+		if (buf->lock_cnt[i])
+			ave_wait = buf->lock_wait_time[i] / buf->lock_cnt[i];
+		else
+			ave_wait = 0;
+		printf("\t%-10s %-5s %10u %8u %8u", lock_names[i / 2],
+		       (i % 2) ? "write" : "read", buf->lock_cnt[i],
+		       ave_wait, buf->lock_wait_max[i]);
+		for (j = 0; j < hist_size; j++) {
+			printf(" %8u", buf->lock_wait_hist[i *
+							   buf->lock_hist_size
+							   + j]);
+		}
+		printf("\n");
+	}
+}
+
+static void _print_rpc_queue_stats(void)
+{
+	static char *queue_names[] = { "receive", "node", "job", "query" };
+	uint32_t ave_wait;
+	int i;
+
+	if ((buf->rpc_queue_size == 0) ||
+	    (buf->rpc_queue_size > (sizeof(queue_names) / sizeof(char *))))
+		return;
+
+	printf("\nRemote Procedure Call queues\n");
+	for (i = 0; i < buf->rpc_queue_size; i++) {
+		if (buf->rpc_queue_cnt[i]) {
+			ave_wait = buf->rpc_queue_wait_time[i] /
+				   buf->rpc_queue_cnt[i];
+		} else
+			ave_wait = 0;
+		printf("\t%-8s depth:%-6u max_depth:%-6u count:%-8u "
+		       "ave_wait:%u\n", queue_names[i],
+		       buf->rpc_queue_depth[i], buf->rpc_queue_depth_max[i],
+		       buf->rpc_queue_cnt[i], ave_wait);
+	}
+}
+
 static void _sort_rpc(void)
 {
 	int i, j;
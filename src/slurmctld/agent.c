@@ -264,6 +264,13 @@ void *agent(void *args)
 	if (_valid_agent_arg(agent_arg_ptr))
 		goto cleanup;
 
+	/* Batch job credentials are built under the job write lock, but
+	 * signed here to keep the signature off the scheduling path */
+	if ((agent_arg_ptr->msg_type == REQUEST_BATCH_JOB_LAUNCH) &&
+	    sign_batch_job_cred(agent_arg_ptr->msg_args,
+				agent_arg_ptr->protocol_version))
+		goto cleanup;
+
 	/* initialize the agent data structures */
 	agent_info_ptr = _make_agent_info(agent_arg_ptr);
 	thread_ptr = agent_info_ptr->thread_struct;
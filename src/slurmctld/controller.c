@@ -58,6 +58,7 @@
 #include <string.h>
 #include <sys/resource.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <unistd.h>
 
 #include "slurm/slurm_errno.h"
@@ -100,6 +101,7 @@
 #include "src/slurmctld/job_submit.h"
 #include "src/slurmctld/licenses.h"
 #include "src/slurmctld/locks.h"
+#include "src/slurmctld/node_scheduler.h"
 #include "src/slurmctld/ping_nodes.h"
 #include "src/slurmctld/port_mgr.h"
 #include "src/slurmctld/preempt.h"
@@ -190,6 +192,7 @@ static int	debug_level = 0;
 static char *	debug_logfile = NULL;
 static bool	dump_core = false;
 static int      job_sched_cnt = 0;
+static uint32_t max_server_conns = MAX_SERVER_CONNS;
 static uint32_t max_server_threads = MAX_SERVER_THREADS;
 static time_t	next_stats_reset = 0;
 static int	new_nice = 0;
@@ -200,6 +203,38 @@ static pthread_cond_t server_thread_cond = PTHREAD_COND_INITIALIZER;
 static pid_t	slurmctld_pid;
 static char *	slurm_conf_filename;
 
+/* RPC queues. Accepted connections wait in RPC_QUEUE_RECV until a worker
+ * thread reads the message, which is then queued by message type. Queued
+ * messages are processed in order of queue priority, so node registrations
+ * and job completions do not wait behind user information requests. */
+enum {
+	RPC_QUEUE_RECV,		/* connection accepted, message not yet read */
+	RPC_QUEUE_NODE,		/* slurmd and controller messages */
+	RPC_QUEUE_JOB,		/* job submission, update and everything else */
+	RPC_QUEUE_QUERY,	/* read-only information requests */
+	RPC_QUEUE_CNT
+};
+
+/* A lower priority queue is serviced after this many consecutive messages
+ * were taken from higher priority queues, preventing starvation */
+#define RPC_QUEUE_MAX_SKIP 10
+
+typedef struct rpc_queue_rec {
+	connection_arg_t *conn;
+	slurm_msg_t *msg;		/* NULL until message is read */
+	struct timeval queue_time;	/* when added to current queue */
+} rpc_queue_rec_t;
+
+static List	rpc_queue[RPC_QUEUE_CNT];
+static uint32_t	rpc_queue_cnt[RPC_QUEUE_CNT];
+static pthread_cond_t rpc_queue_cond = PTHREAD_COND_INITIALIZER;
+static uint32_t	rpc_queue_depth_max[RPC_QUEUE_CNT];
+static pthread_mutex_t rpc_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool	rpc_queue_shutdown = false;
+static uint32_t	rpc_queue_skip[RPC_QUEUE_CNT];
+static uint64_t	rpc_queue_wait_time[RPC_QUEUE_CNT];	/* usec */
+static int	rpc_worker_cnt = 0;
+
 /*
  * Static list of signals to block in this process
  * *Must be zero-terminated*
@@ -226,7 +261,14 @@ static void         _remove_qos(slurmdb_qos_rec_t *rec);
 static void         _update_assoc(slurmdb_assoc_rec_t *rec);
 static void         _update_qos(slurmdb_qos_rec_t *rec);
 inline static int   _report_locks_set(void);
-static void *       _service_connection(void *arg);
+static bool         _receive_connection(rpc_queue_rec_t *rec);
+static void         _rpc_queue_add(rpc_queue_rec_t *rec, int inx);
+static void         _rpc_queue_fini(void);
+static int          _rpc_queue_inx(uint16_t msg_type);
+static void         _rpc_queue_init(void);
+static rpc_queue_rec_t *_rpc_queue_next(int *inx);
+static void *       _rpc_worker(void *no_data);
+static void         _service_connection(rpc_queue_rec_t *rec);
 static void         _set_work_dir(void);
 static int          _shutdown_backup_controller(int wait_time);
 static void *       _slurmctld_background(void *no_data);
@@ -641,6 +683,7 @@ int main(int argc, char *argv[])
 
 	/* Purge our local data structures */
 	job_fini();
+	purge_node_set_cache();
 	part_fini();	/* part_fini() must preceed node_fini() */
 	node_fini();
 	purge_front_end_state();
@@ -671,6 +714,7 @@ int main(int argc, char *argv[])
 
 	/* purge remaining data structures */
 	license_free();
+	bit_scratch_purge();
 	slurm_cred_ctx_destroy(slurmctld_config.cred_ctx);
 	slurm_crypto_fini();	/* must be after ctx_destroy */
 	slurm_conf_destroy();
@@ -875,7 +919,8 @@ static void _sig_handler(int signal)
 {
 }
 
-/* _slurmctld_rpc_mgr - Read incoming RPCs and create pthread for each */
+/* _slurmctld_rpc_mgr - Accept incoming RPC connections and queue them for
+ *	the RPC worker threads */
 static void *_slurmctld_rpc_mgr(void *no_data)
 {
 	slurm_fd_t newsockfd;
@@ -883,12 +928,10 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	slurm_addr_t cli_addr, srv_addr;
 	uint16_t port;
 	char ip[32];
-	pthread_t thread_id_rpc_req;
-	pthread_attr_t thread_attr_rpc_req;
-	int no_thread;
 	int fd_next = 0, i, nports;
 	fd_set rfds;
 	connection_arg_t *conn_arg = NULL;
+	rpc_queue_rec_t *rec;
 	/* Locks: Read config */
 	slurmctld_lock_t config_read_lock = {
 		READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
@@ -906,11 +949,7 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	(void) pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
 	debug3("_slurmctld_rpc_mgr pid = %u", getpid());
 
-	/* threads to process individual RPC's are detached */
-	slurm_attr_init(&thread_attr_rpc_req);
-	if (pthread_attr_setdetachstate
-	    (&thread_attr_rpc_req, PTHREAD_CREATE_DETACHED))
-		fatal("pthread_attr_setdetachstate %m");
+	_rpc_queue_init();
 
 	/* set node_addr to bind to (NULL means any) */
 	if (slurmctld_conf.backup_controller && slurmctld_conf.backup_addr &&
@@ -1007,25 +1046,15 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 			info("%s: accept() connection from %s", __func__, inetbuf);
 		}
 
-		if (slurmctld_config.shutdown_time)
-			no_thread = 1;
-		else if (pthread_create(&thread_id_rpc_req,
-					&thread_attr_rpc_req,
-					_service_connection,
-					(void *) conn_arg)) {
-			error("pthread_create: %m");
-			no_thread = 1;
-		} else
-			no_thread = 0;
-
-		if (no_thread) {
-			slurmctld_diag_stats.proc_req_raw++;
-		       	_service_connection((void *) conn_arg);
-	       	}
+		rec = xmalloc(sizeof(rpc_queue_rec_t));
+		rec->conn = conn_arg;
+		slurm_mutex_lock(&rpc_queue_mutex);
+		_rpc_queue_add(rec, RPC_QUEUE_RECV);
+		slurm_mutex_unlock(&rpc_queue_mutex);
 	}
 
 	debug3("_slurmctld_rpc_mgr shutting down");
-	slurm_attr_destroy(&thread_attr_rpc_req);
+	_rpc_queue_fini();
 	for (i=0; i<nports; i++)
 		(void) slurm_shutdown_msg_engine(sockfd[i]);
 	xfree(sockfd);
@@ -1035,16 +1064,181 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 }
 
 /*
- * _service_connection - service the RPC
- * IN/OUT arg - really just the connection's file descriptor, freed
- *	upon completion
- * RET - NULL
+ * _rpc_queue_init - Start the RPC worker threads
+ */
+static void _rpc_queue_init(void)
+{
+	pthread_attr_t thread_attr;
+	pthread_t thread_id;
+	int i;
+
+	slurm_mutex_lock(&rpc_queue_mutex);
+	/* Workers from a previous instance of the RPC manager (e.g. after
+	 * resuming backup mode) must finish before the queues are reused */
+	while (rpc_worker_cnt)
+		pthread_cond_wait(&rpc_queue_cond, &rpc_queue_mutex);
+	for (i = 0; i < RPC_QUEUE_CNT; i++) {
+		if (!rpc_queue[i])
+			rpc_queue[i] = list_create(NULL);
+	}
+	rpc_queue_shutdown = false;
+
+	/* RPC worker threads are detached */
+	slurm_attr_init(&thread_attr);
+	if (pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_DETACHED))
+		fatal("pthread_attr_setdetachstate %m");
+	for (i = 0; i < max_server_threads; i++) {
+		if (pthread_create(&thread_id, &thread_attr, _rpc_worker,
+				   NULL)) {
+			error("pthread_create: %m");
+			break;
+		}
+		rpc_worker_cnt++;
+	}
+	slurm_attr_destroy(&thread_attr);
+	if (rpc_worker_cnt == 0)
+		fatal("Unable to create any RPC worker threads");
+	debug2("started %d RPC worker threads", rpc_worker_cnt);
+	slurm_mutex_unlock(&rpc_queue_mutex);
+}
+
+/*
+ * _rpc_queue_fini - Tell the RPC worker threads to exit once all queued
+ *	connections have been processed
+ */
+static void _rpc_queue_fini(void)
+{
+	slurm_mutex_lock(&rpc_queue_mutex);
+	rpc_queue_shutdown = true;
+	pthread_cond_broadcast(&rpc_queue_cond);
+	slurm_mutex_unlock(&rpc_queue_mutex);
+}
+
+/*
+ * _rpc_queue_inx - Identify the RPC queue for a message type
+ */
+static int _rpc_queue_inx(uint16_t msg_type)
+{
+	switch (msg_type) {
+	case MESSAGE_EPILOG_COMPLETE:
+	case MESSAGE_NODE_REGISTRATION_STATUS:
+	case REQUEST_COMPLETE_BATCH_JOB:
+	case REQUEST_COMPLETE_BATCH_SCRIPT:
+	case REQUEST_COMPLETE_JOB_ALLOCATION:
+	case REQUEST_COMPLETE_PROLOG:
+	case REQUEST_CONTROL:
+	case REQUEST_PING:
+	case REQUEST_RECONFIGURE:
+	case REQUEST_SHUTDOWN:
+	case REQUEST_SHUTDOWN_IMMEDIATE:
+	case REQUEST_STEP_COMPLETE:
+	case REQUEST_TAKEOVER:
+		return RPC_QUEUE_NODE;
+	case REQUEST_BLOCK_INFO:
+	case REQUEST_BUILD_INFO:
+	case REQUEST_BURST_BUFFER_INFO:
+	case REQUEST_FRONT_END_INFO:
+	case REQUEST_JOB_END_TIME:
+	case REQUEST_JOB_INFO:
+	case REQUEST_JOB_INFO_SINGLE:
+	case REQUEST_JOB_STEP_INFO:
+	case REQUEST_JOB_USER_INFO:
+	case REQUEST_LICENSE_INFO:
+	case REQUEST_NODE_INFO:
+	case REQUEST_NODE_INFO_SINGLE:
+	case REQUEST_PARTITION_INFO:
+	case REQUEST_PRIORITY_FACTORS:
+	case REQUEST_RESERVATION_INFO:
+	case REQUEST_SHARE_INFO:
+	case REQUEST_STATS_INFO:
+	case REQUEST_TOPO_INFO:
+	case REQUEST_TRIGGER_GET:
+		return RPC_QUEUE_QUERY;
+	default:
+		return RPC_QUEUE_JOB;
+	}
+}
+
+/*
+ * _rpc_queue_add - Add a record to an RPC queue and wake a worker thread
+ * NOTE: Caller must hold rpc_queue_mutex
+ */
+static void _rpc_queue_add(rpc_queue_rec_t *rec, int inx)
+{
+	uint32_t depth;
+
+	gettimeofday(&rec->queue_time, NULL);
+	list_enqueue(rpc_queue[inx], rec);
+	depth = list_count(rpc_queue[inx]);
+	if (rpc_queue_depth_max[inx] < depth)
+		rpc_queue_depth_max[inx] = depth;
+	pthread_cond_signal(&rpc_queue_cond);
+}
+
+/*
+ * _rpc_queue_next - Remove the next record to work on from the RPC queues
+ * OUT inx - queue the record was taken from
+ * RET record or NULL if all queues are empty
+ * NOTE: Caller must hold rpc_queue_mutex
+ */
+static rpc_queue_rec_t *_rpc_queue_next(int *inx)
+{
+	rpc_queue_rec_t *rec;
+	struct timeval now;
+	int i, msg_cnt = 0, q = -1;
+
+	for (i = RPC_QUEUE_NODE; i < RPC_QUEUE_CNT; i++)
+		msg_cnt += list_count(rpc_queue[i]);
+
+	/* Read pending messages first so that they can be prioritized,
+	 * unless a full thread pool's worth of work is already queued */
+	if (list_count(rpc_queue[RPC_QUEUE_RECV]) &&
+	    (msg_cnt < max_server_threads)) {
+		q = RPC_QUEUE_RECV;
+	} else if (msg_cnt) {
+		for (i = RPC_QUEUE_CNT - 1; i > RPC_QUEUE_NODE; i--) {
+			if (list_count(rpc_queue[i]) &&
+			    (rpc_queue_skip[i] >= RPC_QUEUE_MAX_SKIP)) {
+				q = i;
+				break;
+			}
+		}
+		if (q == -1) {
+			for (i = RPC_QUEUE_NODE; i < RPC_QUEUE_CNT; i++) {
+				if (list_count(rpc_queue[i])) {
+					q = i;
+					break;
+				}
+			}
+		}
+		for (i = q + 1; i < RPC_QUEUE_CNT; i++) {
+			if (list_count(rpc_queue[i]))
+				rpc_queue_skip[i]++;
+		}
+		rpc_queue_skip[q] = 0;
+	} else if (list_count(rpc_queue[RPC_QUEUE_RECV])) {
+		q = RPC_QUEUE_RECV;
+	} else
+		return NULL;
+
+	rec = list_dequeue(rpc_queue[q]);
+	gettimeofday(&now, NULL);
+	rpc_queue_cnt[q]++;
+	rpc_queue_wait_time[q] += (now.tv_sec - rec->queue_time.tv_sec) *
+				  1000000;
+	rpc_queue_wait_time[q] += now.tv_usec - rec->queue_time.tv_usec;
+	*inx = q;
+	return rec;
+}
+
+/*
+ * _rpc_worker - Read messages from accepted connections and process them in
+ *	order of RPC queue priority until _rpc_queue_fini() is called
  */
-static void *_service_connection(void *arg)
+static void *_rpc_worker(void *no_data)
 {
-	connection_arg_t *conn = (connection_arg_t *) arg;
-	void *return_code = NULL;
-	slurm_msg_t *msg = xmalloc(sizeof(slurm_msg_t));
+	rpc_queue_rec_t *rec;
+	int inx;
 
 #if HAVE_SYS_PRCTL_H
 	if (prctl(PR_SET_NAME, "slurmctld_srvcn", NULL, NULL, NULL) < 0) {
@@ -1052,40 +1246,137 @@ static void *_service_connection(void *arg)
 		      __func__, "slurmctld_srvcn");
 	}
 #endif
-	slurm_msg_t_init(msg);
+	slurm_mutex_lock(&rpc_queue_mutex);
+	while (1) {
+		rec = _rpc_queue_next(&inx);
+		if (!rec) {
+			if (rpc_queue_shutdown)
+				break;
+			pthread_cond_wait(&rpc_queue_cond, &rpc_queue_mutex);
+			continue;
+		}
+		slurm_mutex_unlock(&rpc_queue_mutex);
+
+		if (inx != RPC_QUEUE_RECV) {
+			_service_connection(rec);
+			slurm_mutex_lock(&rpc_queue_mutex);
+		} else if (_receive_connection(rec)) {
+			slurm_mutex_lock(&rpc_queue_mutex);
+			_rpc_queue_add(rec, _rpc_queue_inx(rec->msg->msg_type));
+		} else
+			slurm_mutex_lock(&rpc_queue_mutex);
+	}
+	rpc_worker_cnt--;
+	pthread_cond_broadcast(&rpc_queue_cond);
+	slurm_mutex_unlock(&rpc_queue_mutex);
+
+	return NULL;
+}
+
+/*
+ * _receive_connection - read the RPC from an accepted connection
+ * IN/OUT rec - queued connection, freed upon error
+ * RET true if the message is ready to be processed
+ */
+static bool _receive_connection(rpc_queue_rec_t *rec)
+{
+	connection_arg_t *conn = rec->conn;
+
+	rec->msg = xmalloc(sizeof(slurm_msg_t));
+	slurm_msg_t_init(rec->msg);
 	/*
 	 * slurm_receive_msg sets msg connection fd to accepted fd. This allows
 	 * possibility for slurmctld_req() to close accepted connection.
 	 */
-	if (slurm_receive_msg(conn->newsockfd, msg, 0) != 0) {
+	if (slurm_receive_msg(conn->newsockfd, rec->msg, 0) != 0) {
 		error("slurm_receive_msg: %m");
 		/* close the new socket */
 		slurm_close(conn->newsockfd);
 		goto cleanup;
 	}
 
-	if (errno != SLURM_SUCCESS) {
-		if (errno == SLURM_PROTOCOL_VERSION_ERROR) {
-			slurm_send_rc_msg(msg, SLURM_PROTOCOL_VERSION_ERROR);
-		} else
-			info("_service_connection/slurm_receive_msg %m");
-	} else {
-		/* process the request */
-		slurmctld_req(msg, conn);
-	}
+	if (errno == SLURM_SUCCESS)
+		return true;
+
+	if (errno == SLURM_PROTOCOL_VERSION_ERROR)
+		slurm_send_rc_msg(rec->msg, SLURM_PROTOCOL_VERSION_ERROR);
+	else
+		info("_service_connection/slurm_receive_msg %m");
 	if ((conn->newsockfd >= 0)
 	    && slurm_close(conn->newsockfd) < 0)
 		error ("close(%d): %m",  conn->newsockfd);
 
 cleanup:
-	slurm_free_msg(msg);
-	xfree(arg);
+	slurm_free_msg(rec->msg);
+	xfree(rec->conn);
+	xfree(rec);
 	_free_server_thread();
-	return return_code;
+	return false;
+}
+
+/*
+ * _service_connection - service the RPC
+ * IN/OUT rec - received message and its connection, freed upon completion
+ */
+static void _service_connection(rpc_queue_rec_t *rec)
+{
+	connection_arg_t *conn = rec->conn;
+
+	/* process the request */
+	slurmctld_req(rec->msg, conn);
+	if ((conn->newsockfd >= 0)
+	    && slurm_close(conn->newsockfd) < 0)
+		error ("close(%d): %m",  conn->newsockfd);
+
+	slurm_free_msg(rec->msg);
+	xfree(rec->conn);
+	xfree(rec);
+	_free_server_thread();
+}
+
+/* pack_rpc_queue_stats - Append RPC queue statistics to a buffer
+ * IN/OUT buffer_ptr - buffer built by pack_all_stat()
+ * IN/OUT buffer_size - size of buffer_ptr
+ * IN protocol_version - slurm protocol version of client */
+extern void pack_rpc_queue_stats(char **buffer_ptr, int *buffer_size,
+				 uint16_t protocol_version)
+{
+	uint32_t depth[RPC_QUEUE_CNT];
+	Buf buffer;
+	int i;
+
+	if (protocol_version < SLURM_15_08_PROTOCOL_VERSION)
+		return;
+
+	slurm_mutex_lock(&rpc_queue_mutex);
+	buffer = create_buf(*buffer_ptr, *buffer_size);
+	set_buf_offset(buffer, *buffer_size);
+	for (i = 0; i < RPC_QUEUE_CNT; i++)
+		depth[i] = rpc_queue[i] ? list_count(rpc_queue[i]) : 0;
+	pack32(RPC_QUEUE_CNT, buffer);
+	pack32_array(depth,               RPC_QUEUE_CNT, buffer);
+	pack32_array(rpc_queue_depth_max, RPC_QUEUE_CNT, buffer);
+	pack32_array(rpc_queue_cnt,       RPC_QUEUE_CNT, buffer);
+	pack64_array(rpc_queue_wait_time, RPC_QUEUE_CNT, buffer);
+	slurm_mutex_unlock(&rpc_queue_mutex);
+
+	*buffer_size = get_buf_offset(buffer);
+	buffer_ptr[0] = xfer_buf_data(buffer);
+}
+
+/* reset_rpc_queue_stats - Clear RPC queue statistics */
+extern void reset_rpc_queue_stats(void)
+{
+	slurm_mutex_lock(&rpc_queue_mutex);
+	memset(rpc_queue_cnt, 0, sizeof(rpc_queue_cnt));
+	memset(rpc_queue_depth_max, 0, sizeof(rpc_queue_depth_max));
+	memset(rpc_queue_wait_time, 0, sizeof(rpc_queue_wait_time));
+	slurm_mutex_unlock(&rpc_queue_mutex);
 }
 
 /* Increment slurmctld_config.server_thread_count and don't return
- * until its value is no larger than MAX_SERVER_THREADS,
+ * until its value is no larger than max_server_conns (the count of accepted
+ * connections which are queued or being processed),
  * RET true unless shutdown in progress */
 static bool _wait_for_server_thread(void)
 {
@@ -1098,7 +1389,7 @@ static bool _wait_for_server_thread(void)
 			rc = false;
 			break;
 		}
-		if (slurmctld_config.server_thread_count < max_server_threads) {
+		if (slurmctld_config.server_thread_count < max_server_conns) {
 			slurmctld_config.server_thread_count++;
 			break;
 		} else {
@@ -2425,13 +2716,14 @@ static void _test_thread_limit(void)
 	if (getrlimit(RLIMIT_NOFILE, rlim) < 0)
 		error("Unable to get file count limit");
 	else if ((rlim->rlim_cur != RLIM_INFINITY) &&
-		 (max_server_threads > rlim->rlim_cur)) {
-		max_server_threads = rlim->rlim_cur;
-		info("Reducing max_server_thread to %u due to file count limit "
-		     "of %u", max_server_threads, max_server_threads);
+		 (max_server_conns > rlim->rlim_cur)) {
+		max_server_conns = rlim->rlim_cur;
+		info("Reducing max_server_conns to %u due to file count limit "
+		     "of %u", max_server_conns, max_server_conns);
 	}
 }
 #endif
+	max_server_threads = MIN(max_server_threads, max_server_conns);
 	return;
 }
 
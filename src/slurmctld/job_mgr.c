@@ -44,6 +44,10 @@
 #  include "config.h"
 #endif
 
+#ifdef WITH_PTHREADS
+#  include <pthread.h>
+#endif
+
 #include <ctype.h>
 #include <dirent.h>
 #include <errno.h>
@@ -68,6 +72,7 @@
 #include "src/common/forward.h"
 #include "src/common/gres.h"
 #include "src/common/hostlist.h"
+#include "src/common/id_hash.h"
 #include "src/common/node_select.h"
 #include "src/common/parse_time.h"
 #include "src/common/slurm_accounting_storage.h"
@@ -104,15 +109,25 @@
 #define STEP_FLAG 0xbbbb
 #define TOP_PRIORITY 0xffff0000	/* large, but leave headroom for higher */
 
-#define JOB_HASH_INX(_job_id)	(_job_id % hash_table_size)
-#define JOB_ARRAY_HASH_INX(_job_id, _task_id) \
-	((_job_id + _task_id) % hash_table_size)
+/* Key of a job array task in job_array_hash_t */
+#define JOB_ARRAY_KEY(_job_id, _task_id) \
+	(((uint64_t) (_job_id) << 32) | (_task_id))
 
 /* No need to change we always pack SLURM_PROTOCOL_VERSION */
 #define JOB_STATE_VERSION       "PROTOCOL_VERSION"
 
 #define JOB_CKPT_VERSION      "PROTOCOL_VERSION"
 
+/* Number of packed job information buffers to retain and their maximum
+ * total size in bytes, see pack_all_jobs() */
+#define JOB_PACK_CACHE_SIZE 8
+#define JOB_PACK_CACHE_MAX_BYTES (64 * 1024 * 1024)
+
+/* Write a new job state checkpoint rather than appending to the job state
+ * journal once the journal would exceed this percentage of the checkpoint
+ * size, see dump_all_job_state() */
+#define JOB_JOURNAL_MAX_PCT 50
+
 typedef struct {
 	int resp_array_cnt;
 	int resp_array_size;
@@ -120,6 +135,44 @@ typedef struct {
 	bitstr_t **resp_array_task_id;
 } resp_array_struct_t;
 
+/* Header of a buffer returned by pack_all_jobs(), the packed data follows.
+ * The buffer is shared by the cache and every RPC sending it. */
+typedef struct {
+	int buffer_size;
+	uint32_t ref_cnt;		/* protected by job_pack_cache_mutex */
+} job_pack_buf_t;
+
+typedef struct {
+	job_pack_buf_t *buf;		/* NULL if record is unused */
+	time_t expire;			/* output changes at this time, 0 never */
+	uint32_t filter_uid;
+	uint32_t last_use;		/* for least recently used replacement */
+	uint16_t protocol_version;
+	uint16_t show_flags;
+	uid_t uid;
+} job_pack_cache_t;
+
+typedef struct {
+	uint64_t hash;			/* FNV-1a hash of packed record */
+	uint32_t job_id;
+	uint32_t offset;		/* offset of record in save buffer */
+	uint32_t size;			/* size of packed record */
+} job_state_sum_t;
+
+typedef struct {
+	uint32_t job_id;
+	uint32_t offset;		/* offset of record in journal buffer,
+					 * 0 if superseded or job purged */
+	uint32_t size;			/* size of record, 0 if job purged */
+} job_journal_rec_t;
+
+typedef struct {
+	char *dir_name;			/* hash.# directory to scan */
+	uint32_t *job_ids;		/* job_ids of batch directories */
+	int job_id_cnt;
+	int job_id_size;
+} batch_dir_ids_t;
+
 /* Global variables */
 List   job_list = NULL;		/* job_record list */
 time_t last_job_update;		/* time of last update to job records */
@@ -127,12 +180,17 @@ time_t last_job_update;		/* time of last update to job records */
 /* Local variables */
 static uint32_t highest_prio = 0;
 static uint32_t lowest_prio  = TOP_PRIORITY;
-static int      hash_table_size = 0;
 static int      job_count = 0;		/* job's in the system */
 static uint32_t job_id_sequence = 0;	/* first job_id to assign new job */
-static struct   job_record **job_hash = NULL;
-static struct   job_record **job_array_hash_j = NULL;
-static struct   job_record **job_array_hash_t = NULL;
+static uint32_t job_ckpt_size = 0;	/* size of last job_state checkpoint */
+static uint32_t job_journal_size = 0;	/* size of job_state.journal */
+static pthread_mutex_t job_journal_mutex = PTHREAD_MUTEX_INITIALIZER;
+static job_state_sum_t *job_state_sum = NULL;	/* records of last save */
+static int      job_state_sum_cnt = 0;
+static id_hash_t *job_hash = NULL;		/* jobs by job_id */
+static id_hash_t *job_array_hash_j = NULL;	/* first task by array_job_id,
+						 * see job_array_next_j */
+static id_hash_t *job_array_hash_t = NULL;	/* tasks by JOB_ARRAY_KEY */
 static time_t   last_file_write_time = (time_t) 0;
 static uint32_t max_array_size = NO_VAL;
 static int	select_serial = -1;
@@ -144,10 +202,20 @@ static int32_t  *requeue_exit;
 static uint32_t num_hold;
 static int32_t  *requeue_exit_hold;
 static bool     kill_invalid_dep;
+static job_pack_cache_t job_pack_cache[JOB_PACK_CACHE_SIZE];
+static uint32_t job_pack_cache_bytes = 0;
+static time_t   job_pack_cache_conf_update = (time_t) 0;
+static time_t   job_pack_cache_job_update = (time_t) 0;
+static pthread_mutex_t job_pack_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t nodes_cg_mutex = PTHREAD_MUTEX_INITIALIZER;
+static time_t   job_pack_cache_part_update = (time_t) 0;
+static uint32_t job_pack_cache_use = 0;
 
 /* Local functions */
+static void _add_batch_dir_id(batch_dir_ids_t *batch_dirs, char *dir_name);
 static void _add_job_hash(struct job_record *job_ptr);
 static void _add_job_array_hash(struct job_record *job_ptr);
+static int  _batch_dir_id_cmp(const void *x, const void *y);
 static int  _checkpoint_job_record (struct job_record *job_ptr,
 				    char *image_dir);
 static int  _copy_job_desc_files(uint32_t job_id_src, uint32_t job_id_dest);
@@ -163,7 +231,6 @@ static job_desc_msg_t * _copy_job_record_to_job_desc(
 static char *_copy_nodelist_no_dup(char *node_list);
 static struct job_record *_create_job_record(int *error_code,
 					     uint32_t num_jobs);
-static void _del_batch_list_rec(void *x);
 static void _delete_job_desc_files(uint32_t job_id);
 static slurmdb_qos_rec_t *_determine_and_validate_qos(
 	char *resv_name, slurmdb_assoc_rec_t *assoc_ptr,
@@ -171,11 +238,33 @@ static slurmdb_qos_rec_t *_determine_and_validate_qos(
 static void _dump_job_details(struct job_details *detail_ptr,
 			      Buf buffer);
 static void _dump_job_state(struct job_record *dump_job_ptr, Buf buffer);
-static int  _find_batch_dir(void *x, void *key);
-static void _get_batch_job_dir_ids(List batch_dirs);
+static void _get_batch_job_dir_ids(batch_dir_ids_t *batch_dirs);
 static time_t _get_last_state_write_time(void);
+static int  _job_journal_append(char *journal_file, Buf journal);
+static int  _job_journal_create(char *journal_file, time_t ckpt_time);
+static Buf  _job_journal_entry(Buf buffer, job_state_sum_t *sum, int sum_cnt,
+			       time_t now, int *change_cnt);
+static int  _job_journal_id_cmp(const void *x, const void *y);
+static int  _job_journal_load(time_t ckpt_time, bool ids_only);
+static void _job_journal_purge(job_journal_rec_t **final, int final_cnt);
+static int  _job_journal_rec_cmp(const void *x, const void *y);
+static bool _job_pack_cache_get(char **buffer_ptr, int *buffer_size,
+				uint16_t show_flags, uid_t uid,
+				uint32_t filter_uid, uint16_t protocol_version);
+static void _job_pack_cache_purge(void);
+static void _job_pack_cache_put(job_pack_buf_t *buf, uint16_t show_flags,
+				uid_t uid, uint32_t filter_uid,
+				uint16_t protocol_version, time_t pack_time,
+				time_t expire);
+static void _job_pack_cache_rm(job_pack_cache_t *cache_ptr);
 static struct job_record *_job_rec_copy(struct job_record *job_ptr);
+static int  _job_state_sum_cmp(const void *x, const void *y);
+static void _job_state_sum_set(job_state_sum_t *sum, uint32_t job_id,
+			       Buf buffer, uint32_t offset);
+static int  _job_state_write(Buf buffer, char *new_file, char *reg_file,
+			     char *old_file);
 static void _job_timed_out(struct job_record *job_ptr);
+static struct job_record *_job_array_head(uint32_t array_job_id);
 static int  _job_create(job_desc_msg_t * job_specs, int allocate, int will_run,
 			struct job_record **job_rec_ptr, uid_t submit_uid,
 			char **err_msg);
@@ -191,6 +280,7 @@ static void _notify_srun_missing_step(struct job_record *job_ptr, int node_inx,
 				      time_t now, time_t node_boot_time);
 static int  _open_job_state_file(char **state_file);
 static void _pack_job_for_ckpt (struct job_record *job_ptr, Buf buffer);
+static void _pack_nodes_cg(struct job_record *job_ptr, Buf buffer);
 static void _pack_default_job_details(struct job_record *job_ptr,
 				      Buf buffer,
 				      uint16_t protocol_version);
@@ -205,8 +295,11 @@ static int  _read_data_array_from_file(char *file_name, char ***data,
 				       struct job_record *job_ptr);
 static int  _read_data_from_file(char *file_name, char **data);
 static char *_read_job_ckpt_file(char *ckpt_file, int *size_ptr);
-static void _remove_defunct_batch_dirs(List batch_dirs);
+static void _remove_defunct_batch_dirs(batch_dir_ids_t *batch_dirs,
+				       bitstr_t *keep_dirs);
+static void _remove_job_array_hash(struct job_record *job_ptr);
 static void _remove_job_hash(struct job_record *job_ptr);
+static void *_scan_batch_hash_dir(void *arg);
 static int  _reset_detail_bitmaps(struct job_record *job_ptr);
 static void _reset_step_bitmaps(struct job_record *job_ptr);
 static void _resp_array_add(resp_array_struct_t **resp,
@@ -237,7 +330,8 @@ static int  _valid_job_part(job_desc_msg_t * job_desc,
 static int  _validate_job_desc(job_desc_msg_t * job_desc_msg, int allocate,
                                uid_t submit_uid, struct part_record *part_ptr,
                                List part_list);
-static void _validate_job_files(List batch_dirs);
+static void _validate_job_files(batch_dir_ids_t *batch_dirs,
+				bitstr_t *keep_dirs);
 static bool _validate_min_mem_partition(job_desc_msg_t *job_desc_msg,
                                         struct part_record *,
                                         List part_list);
@@ -646,6 +740,9 @@ static slurmdb_qos_rec_t *_determine_and_validate_qos(
 
 /*
  * dump_all_job_state - save the state of all jobs to file for checkpoint
+ *	Only job records which changed since the previous save are appended
+ *	to the job_state.journal file. A full job_state checkpoint is written
+ *	on the first save and once the journal grows too large.
  *	Changes here should be reflected in load_last_job_id() and
  *	load_all_job_state().
  * RET 0 or error code */
@@ -653,8 +750,8 @@ int dump_all_job_state(void)
 {
 	/* Save high-water mark to avoid buffer growth with copies */
 	static int high_buffer_size = (1024 * 1024);
-	int error_code = SLURM_SUCCESS, log_fd;
-	char *old_file, *new_file, *reg_file;
+	int error_code = SLURM_SUCCESS;
+	char *old_file, *new_file, *reg_file, *journal_file;
 	struct stat stat_buf;
 	/* Locks: Read config and job */
 	slurmctld_lock_t job_read_lock =
@@ -662,6 +759,10 @@ int dump_all_job_state(void)
 	ListIterator job_iterator;
 	struct job_record *job_ptr;
 	Buf buffer = init_buf(high_buffer_size);
+	Buf journal = NULL;
+	job_state_sum_t *sum;
+	int change_cnt = 0, sum_cnt = 0;
+	uint32_t offset;
 	time_t now = time(NULL);
 	time_t last_state_file_time;
 	DEF_TIMERS;
@@ -701,13 +802,25 @@ int dump_all_job_state(void)
 
 	/* write individual job records */
 	lock_slurmctld(job_read_lock);
+	slurm_mutex_lock(&job_journal_mutex);
+	sum = xmalloc(sizeof(job_state_sum_t) * MAX(list_count(job_list), 1));
 	job_iterator = list_iterator_create(job_list);
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		xassert (job_ptr->magic == JOB_MAGIC);
+		offset = get_buf_offset(buffer);
 		_dump_job_state(job_ptr, buffer);
+		_job_state_sum_set(&sum[sum_cnt++], job_ptr->job_id, buffer,
+				   offset);
 	}
 	list_iterator_destroy(job_iterator);
 
+	/* Journal the changed records unless a new checkpoint is needed,
+	 * which includes the first save since we started or took control */
+	qsort(sum, sum_cnt, sizeof(job_state_sum_t), _job_state_sum_cmp);
+	if (last_file_write_time && job_state_sum)
+		journal = _job_journal_entry(buffer, sum, sum_cnt, now,
+					     &change_cnt);
+
 	/* write the buffer to file */
 	old_file = xstrdup(slurmctld_conf.state_save_location);
 	xstrcat(old_file, "/job_state.old");
@@ -715,9 +828,13 @@ int dump_all_job_state(void)
 	xstrcat(reg_file, "/job_state");
 	new_file = xstrdup(slurmctld_conf.state_save_location);
 	xstrcat(new_file, "/job_state.new");
+	journal_file = xstrdup(slurmctld_conf.state_save_location);
+	xstrcat(journal_file, "/job_state.journal");
 	unlock_slurmctld(job_read_lock);
 
-	if (stat(reg_file, &stat_buf) == 0) {
+	/* The checkpoint file is not modified when only the journal is
+	 * written, so check its time only when replacing it */
+	if (!journal && (stat(reg_file, &stat_buf) == 0)) {
 		static time_t last_mtime = (time_t) 0;
 		int delta_t = difftime(stat_buf.st_mtime, last_mtime);
 		if (delta_t < -10) {
@@ -733,6 +850,54 @@ int dump_all_job_state(void)
 	}
 
 	lock_state_files();
+	if (journal) {
+		if (change_cnt) {
+			error_code = _job_journal_append(journal_file, journal);
+			debug3("Journaled %d job record changes",
+			       change_cnt);
+		}
+		free_buf(journal);
+	} else {
+		high_buffer_size = MAX(get_buf_offset(buffer),
+				       high_buffer_size);
+		error_code = _job_state_write(buffer, new_file, reg_file,
+					      old_file);
+		if (error_code == SLURM_SUCCESS) {
+			last_file_write_time = now;
+			job_ckpt_size = get_buf_offset(buffer);
+			error_code = _job_journal_create(journal_file, now);
+		}
+	}
+	xfree(old_file);
+	xfree(reg_file);
+	xfree(new_file);
+	xfree(journal_file);
+	unlock_state_files();
+
+	/* Any failure forces a new checkpoint on the next save */
+	if (error_code) {
+		xfree(sum);
+		sum_cnt = 0;
+	}
+	xfree(job_state_sum);
+	job_state_sum = sum;
+	job_state_sum_cnt = sum_cnt;
+	slurm_mutex_unlock(&job_journal_mutex);
+
+	free_buf(buffer);
+	END_TIMER2("dump_all_job_state");
+	return error_code;
+}
+
+/* Write a full job state checkpoint to new_file, then rename it to reg_file,
+ * keeping the previous checkpoint as old_file.
+ * Call with lock_state_files() held.
+ * RET 0 or error code */
+static int _job_state_write(Buf buffer, char *new_file, char *reg_file,
+			    char *old_file)
+{
+	int error_code = SLURM_SUCCESS, log_fd;
+
 	log_fd = creat(new_file, 0600);
 	if (log_fd < 0) {
 		error("Can't save state, create file %s error %m",
@@ -745,7 +910,6 @@ int dump_all_job_state(void)
 		fd_set_close_on_exec(log_fd);
 		nwrite = get_buf_offset(buffer);
 		data = (char *)get_buf_data(buffer);
-		high_buffer_size = MAX(nwrite, high_buffer_size);
 		while (nwrite > 0) {
 			amount = write(log_fd, &data[pos], nwrite);
 			if ((amount < 0) && (errno != EINTR)) {
@@ -773,16 +937,443 @@ int dump_all_job_state(void)
 			debug4("unable to create link for %s -> %s: %m",
 			       new_file, reg_file);
 		(void) unlink(new_file);
-		last_file_write_time = now;
 	}
-	xfree(old_file);
-	xfree(reg_file);
+
+	return error_code;
+}
+
+/* Record the size and hash of the job record packed into buffer at offset */
+static void _job_state_sum_set(job_state_sum_t *sum, uint32_t job_id,
+			       Buf buffer, uint32_t offset)
+{
+	unsigned char *data = (unsigned char *) get_buf_data(buffer);
+	uint32_t i, end = get_buf_offset(buffer);
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (i = offset; i < end; i++) {
+		hash ^= data[i];
+		hash *= 1099511628211ULL;
+	}
+	sum->hash   = hash;
+	sum->job_id = job_id;
+	sum->offset = offset;
+	sum->size   = end - offset;
+}
+
+static int _job_state_sum_cmp(const void *x, const void *y)
+{
+	const job_state_sum_t *sum1 = (const job_state_sum_t *) x;
+	const job_state_sum_t *sum2 = (const job_state_sum_t *) y;
+
+	if (sum1->job_id < sum2->job_id)
+		return -1;
+	if (sum1->job_id > sum2->job_id)
+		return 1;
+	return 0;
+}
+
+/* Build a job state journal entry from the job records packed in buffer
+ * which are new or changed since the previous save, plus the IDs of jobs
+ * which have since been purged. Both sum and job_state_sum must be sorted
+ * by job ID.
+ * change_cnt OUT - count of records and purged jobs in the entry
+ * RET the entry to append, or NULL if a new checkpoint should be written
+ *	instead. Call free_buf() on the return value. */
+static Buf _job_journal_entry(Buf buffer, job_state_sum_t *sum, int sum_cnt,
+			      time_t now, int *change_cnt)
+{
+	Buf journal = init_buf(BUF_SIZE);
+	char *data = get_buf_data(buffer);
+	uint32_t *del_ids = NULL;
+	uint32_t del_cnt = 0, rec_cnt = 0, rec_offset, size_offset, end_offset;
+	uint64_t max_size;
+	int i = 0, j = 0;
+
+	max_size = (uint64_t) job_ckpt_size * JOB_JOURNAL_MAX_PCT / 100;
+
+	size_offset = get_buf_offset(journal);
+	pack32(0, journal);		/* entry size, set below */
+	pack_time(now, journal);
+	pack32(job_id_sequence, journal);
+	rec_offset = get_buf_offset(journal);
+	pack32(0, journal);		/* record count, set below */
+
+	while ((i < sum_cnt) || (j < job_state_sum_cnt)) {
+		if ((i < sum_cnt) &&
+		    ((j >= job_state_sum_cnt) ||
+		     (sum[i].job_id < job_state_sum[j].job_id))) {
+			/* New job record */
+		} else if ((j < job_state_sum_cnt) &&
+			   ((i >= sum_cnt) ||
+			    (job_state_sum[j].job_id < sum[i].job_id))) {
+			/* Purged job record */
+			xrealloc(del_ids, sizeof(uint32_t) * (del_cnt + 1));
+			del_ids[del_cnt++] = job_state_sum[j++].job_id;
+			continue;
+		} else if ((sum[i].size == job_state_sum[j].size) &&
+			   (sum[i].hash == job_state_sum[j].hash)) {
+			i++;		/* Unchanged job record */
+			j++;
+			continue;
+		} else {
+			j++;		/* Changed job record */
+		}
+		pack32(sum[i].job_id, journal);
+		packmem(data + sum[i].offset, sum[i].size, journal);
+		rec_cnt++;
+		i++;
+		if ((job_journal_size + get_buf_offset(journal)) > max_size)
+			break;
+	}
+	pack32_array(del_ids, del_cnt, journal);
+	xfree(del_ids);
+
+	if ((job_journal_size + get_buf_offset(journal)) > max_size) {
+		free_buf(journal);
+		return NULL;
+	}
+
+	end_offset = get_buf_offset(journal);
+	set_buf_offset(journal, size_offset);
+	pack32(end_offset - size_offset - sizeof(uint32_t), journal);
+	set_buf_offset(journal, rec_offset);
+	pack32(rec_cnt, journal);
+	set_buf_offset(journal, end_offset);
+
+	*change_cnt = rec_cnt + del_cnt;
+	return journal;
+}
+
+/* Append an entry to the job state journal.
+ * Call with lock_state_files() held.
+ * RET 0 or error code */
+static int _job_journal_append(char *journal_file, Buf journal)
+{
+	int error_code = SLURM_SUCCESS, log_fd;
+	int pos = 0, nwrite, amount, rc;
+	char *data;
+
+	log_fd = open(journal_file, O_WRONLY | O_APPEND);
+	if (log_fd < 0) {
+		error("Can't save state, open file %s error %m",
+		      journal_file);
+		return errno;
+	}
+
+	fd_set_close_on_exec(log_fd);
+	nwrite = get_buf_offset(journal);
+	data = (char *)get_buf_data(journal);
+	while (nwrite > 0) {
+		amount = write(log_fd, &data[pos], nwrite);
+		if ((amount < 0) && (errno != EINTR)) {
+			error("Error writing file %s, %m", journal_file);
+			error_code = errno;
+			break;
+		}
+		nwrite -= amount;
+		pos    += amount;
+	}
+
+	rc = fsync_and_close(log_fd, "job");
+	if (rc && !error_code)
+		error_code = rc;
+	if (error_code == SLURM_SUCCESS)
+		job_journal_size += get_buf_offset(journal);
+
+	return error_code;
+}
+
+/* Start a new job state journal for the checkpoint written at ckpt_time.
+ * Call with lock_state_files() held.
+ * RET 0 or error code */
+static int _job_journal_create(char *journal_file, time_t ckpt_time)
+{
+	Buf buffer = init_buf(BUF_SIZE);
+	char *new_file;
+	int error_code = SLURM_SUCCESS, log_fd, rc;
+	int pos = 0, nwrite, amount;
+	char *data;
+
+	/* write header: version, checkpoint time */
+	packstr(JOB_STATE_VERSION, buffer);
+	pack16(SLURM_PROTOCOL_VERSION, buffer);
+	pack_time(ckpt_time, buffer);
+
+	new_file = xstrdup_printf("%s.new", journal_file);
+	log_fd = creat(new_file, 0600);
+	if (log_fd < 0) {
+		error("Can't save state, create file %s error %m",
+		      new_file);
+		error_code = errno;
+	} else {
+		fd_set_close_on_exec(log_fd);
+		nwrite = get_buf_offset(buffer);
+		data = (char *)get_buf_data(buffer);
+		while (nwrite > 0) {
+			amount = write(log_fd, &data[pos], nwrite);
+			if ((amount < 0) && (errno != EINTR)) {
+				error("Error writing file %s, %m", new_file);
+				error_code = errno;
+				break;
+			}
+			nwrite -= amount;
+			pos    += amount;
+		}
+
+		rc = fsync_and_close(log_fd, "job");
+		if (rc && !error_code)
+			error_code = rc;
+	}
+	if (error_code)
+		(void) unlink(new_file);
+	else if (rename(new_file, journal_file)) {
+		error("Can't save state, rename %s to %s error %m",
+		      new_file, journal_file);
+		error_code = errno;
+		(void) unlink(new_file);
+	} else
+		job_journal_size = get_buf_offset(buffer);
 	xfree(new_file);
+	free_buf(buffer);
+
+	return error_code;
+}
+
+static int _job_journal_id_cmp(const void *x, const void *y)
+{
+	const job_journal_rec_t *rec1 = *(job_journal_rec_t * const *) x;
+	const job_journal_rec_t *rec2 = *(job_journal_rec_t * const *) y;
+
+	if (rec1->job_id < rec2->job_id)
+		return -1;
+	if (rec1->job_id > rec2->job_id)
+		return 1;
+	return 0;
+}
+
+static int _job_journal_rec_cmp(const void *x, const void *y)
+{
+	const job_journal_rec_t *rec1 = *(job_journal_rec_t * const *) x;
+	const job_journal_rec_t *rec2 = *(job_journal_rec_t * const *) y;
+
+	if (rec1->job_id < rec2->job_id)
+		return -1;
+	if (rec1->job_id > rec2->job_id)
+		return 1;
+	/* Records are allocated in journal order */
+	if (rec1 < rec2)
+		return -1;
+	if (rec1 > rec2)
+		return 1;
+	return 0;
+}
+
+/* Remove the job records replaced or purged by the journal. final is sorted
+ * by job ID and holds the last journal record of each job. A single pass
+ * over job_list avoids a list search for every journaled job. */
+static void _job_journal_purge(job_journal_rec_t **final, int final_cnt)
+{
+	ListIterator job_iterator;
+	struct job_record *job_ptr;
+	job_journal_rec_t key, *key_ptr = &key, **rec_pptr;
+
+	job_iterator = list_iterator_create(job_list);
+	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
+		key.job_id = job_ptr->job_id;
+		rec_pptr = bsearch(&key_ptr, final, final_cnt,
+				   sizeof(job_journal_rec_t *),
+				   _job_journal_id_cmp);
+		if (!rec_pptr)
+			continue;
+		/* The replacement record still needs the job's script and
+		 * environment, which delete_job_details() removes for
+		 * finished jobs */
+		if ((*rec_pptr)->size)
+			job_ptr->job_state = JOB_PENDING;
+		list_delete_item(job_iterator);
+	}
+	list_iterator_destroy(job_iterator);
+}
+
+/* Replay the job state journal written after the checkpoint at ckpt_time.
+ * Only the last record of each job is loaded. A truncated final entry
+ * (e.g. a save interrupted by a crash) is ignored.
+ * ids_only IN - only recover job_id_sequence, leave job records alone
+ * RET count of job records recovered from the journal */
+static int _job_journal_load(time_t ckpt_time, bool ids_only)
+{
+	int data_allocated, data_read = 0, state_fd;
+	uint32_t data_size = 0;
+	char *data = NULL, *state_file;
+	Buf buffer;
+	time_t buf_time, entry_time;
+	uint32_t saved_job_id, entry_size, entry_end;
+	uint32_t rec_cnt, rec_size, job_id, i;
+	uint32_t *del_ids = NULL, del_cnt = 0;
+	job_journal_rec_t *recs = NULL, **final = NULL;
+	int rec_inx = 0, rec_alloc = 0, final_cnt = 0, j;
+	int rec_total = 0, del_total = 0;
+	char *ver_str = NULL;
+	uint32_t ver_str_len;
+	uint16_t protocol_version = (uint16_t)NO_VAL;
+	struct stat stat_buf;
+
+	/* read the file */
+	state_file = slurm_get_state_save_location();
+	xstrcat(state_file, "/job_state.journal");
+	lock_state_files();
+	state_fd = open(state_file, O_RDONLY);
+	if (state_fd < 0) {
+		debug("No job state journal (%s) to recover", state_file);
+		xfree(state_file);
+		unlock_state_files();
+		return 0;
+	}
+	data_allocated = BUF_SIZE;
+	if (fstat(state_fd, &stat_buf) == 0)
+		data_allocated += stat_buf.st_size;
+	data = xmalloc(data_allocated);
+	while (1) {
+		data_read = read(state_fd, &data[data_size],
+				 data_allocated - data_size);
+		if (data_read < 0) {
+			if (errno == EINTR)
+				continue;
+			else {
+				error("Read error on %s: %m", state_file);
+				break;
+			}
+		} else if (data_read == 0)	/* eof */
+			break;
+		data_size += data_read;
+		if ((data_allocated - data_size) < BUF_SIZE) {
+			data_allocated += BUF_SIZE;
+			xrealloc(data, data_allocated);
+		}
+	}
+	close(state_fd);
+	xfree(state_file);
 	unlock_state_files();
 
+	buffer = create_buf(data, data_size);
+	safe_unpackstr_xmalloc(&ver_str, &ver_str_len, buffer);
+	if (ver_str && !strcmp(ver_str, JOB_STATE_VERSION))
+		safe_unpack16(&protocol_version, buffer);
+	xfree(ver_str);
+	if (protocol_version == (uint16_t)NO_VAL) {
+		error("Can not recover job state journal, incompatible "
+		      "version");
+		free_buf(buffer);
+		return 0;
+	}
+
+	safe_unpack_time(&buf_time, buffer);
+	if (buf_time != ckpt_time) {
+		/* Written for a newer or older checkpoint */
+		debug("Job state journal does not match job state file, "
+		      "ignoring it");
+		free_buf(buffer);
+		return 0;
+	}
+
+	/* Index every record and purged job ID in journal order */
+	while (remaining_buf(buffer) > 0) {
+		safe_unpack32(&entry_size, buffer);
+		if (remaining_buf(buffer) < entry_size) {
+			error("Ignoring incomplete job state journal entry");
+			break;
+		}
+		entry_end = get_buf_offset(buffer) + entry_size;
+		safe_unpack_time(&entry_time, buffer);
+		safe_unpack32(&saved_job_id, buffer);
+		job_id_sequence = MAX(saved_job_id, job_id_sequence);
+
+		safe_unpack32(&rec_cnt, buffer);
+		for (i = 0; i < rec_cnt; i++) {
+			safe_unpack32(&job_id, buffer);
+			safe_unpack32(&rec_size, buffer);
+			if ((rec_size == 0) ||
+			    ((get_buf_offset(buffer) + rec_size) > entry_end))
+				goto unpack_error;
+			if (rec_inx >= rec_alloc) {
+				rec_alloc = MAX(rec_alloc * 2, 1024);
+				xrealloc(recs, sizeof(job_journal_rec_t) *
+					 rec_alloc);
+			}
+			recs[rec_inx].job_id = job_id;
+			recs[rec_inx].offset = get_buf_offset(buffer);
+			recs[rec_inx].size   = rec_size;
+			rec_inx++;
+			set_buf_offset(buffer, get_buf_offset(buffer) +
+				       rec_size);
+		}
+
+		safe_unpack32_array(&del_ids, &del_cnt, buffer);
+		for (i = 0; i < del_cnt; i++) {
+			if (rec_inx >= rec_alloc) {
+				rec_alloc = MAX(rec_alloc * 2, 1024);
+				xrealloc(recs, sizeof(job_journal_rec_t) *
+					 rec_alloc);
+			}
+			recs[rec_inx].job_id = del_ids[i];
+			recs[rec_inx].offset = 0;
+			recs[rec_inx].size   = 0;	/* job purged */
+			rec_inx++;
+		}
+		xfree(del_ids);
+		if (get_buf_offset(buffer) != entry_end)
+			goto unpack_error;
+		debug3("Indexed job state journal entry from %u",
+		       (uint32_t) entry_time);
+	}
+
+	if (ids_only || (rec_inx == 0))
+		goto fini;
+
+	/* Keep only the last record of each job */
+	final = xmalloc(sizeof(job_journal_rec_t *) * rec_inx);
+	for (j = 0; j < rec_inx; j++)
+		final[j] = &recs[j];
+	qsort(final, rec_inx, sizeof(job_journal_rec_t *),
+	      _job_journal_rec_cmp);
+	for (j = 0; j < rec_inx; j++) {
+		if (((j + 1) < rec_inx) &&
+		    (final[j]->job_id == final[j + 1]->job_id)) {
+			final[j]->offset = 0;	/* superseded */
+			continue;
+		}
+		final[final_cnt++] = final[j];
+		if (final[j]->size == 0)
+			del_total++;
+	}
+
+	_job_journal_purge(final, final_cnt);
+	for (j = 0; j < rec_inx; j++) {
+		if (recs[j].offset == 0)
+			continue;
+		set_buf_offset(buffer, recs[j].offset);
+		if ((_load_job_state(buffer, protocol_version) !=
+		     SLURM_SUCCESS) ||
+		    (get_buf_offset(buffer) != (recs[j].offset + recs[j].size)))
+			goto unpack_error;
+		rec_total++;
+	}
+	info("Recovered %d job records and %d purged jobs from "
+	     "job state journal", rec_total, del_total);
+
+fini:	xfree(final);
+	xfree(recs);
 	free_buf(buffer);
-	END_TIMER2("dump_all_job_state");
-	return error_code;
+	return rec_total;
+
+unpack_error:
+	error("Incomplete job state journal, recovered %d job records",
+	      rec_total);
+	xfree(del_ids);
+	xfree(final);
+	xfree(recs);
+	free_buf(buffer);
+	return rec_total;
 }
 
 /* Open the job state save file, or backup if necessary.
@@ -895,19 +1486,27 @@ extern int load_all_job_state(void)
 	char *ver_str = NULL;
 	uint32_t ver_str_len;
 	uint16_t protocol_version = (uint16_t)NO_VAL;
+	struct stat stat_buf;
+	long read_usec, unpack_usec;
+	DEF_TIMERS;
 
 	/* read the file */
+	START_TIMER;
 	lock_state_files();
 	state_fd = _open_job_state_file(&state_file);
 	if (state_fd < 0) {
 		info("No job state file (%s) to recover", state_file);
 		error_code = ENOENT;
 	} else {
+		/* Size the buffer for the whole file to avoid repeated
+		 * reallocation and copying of large state files */
 		data_allocated = BUF_SIZE;
+		if (fstat(state_fd, &stat_buf) == 0)
+			data_allocated += stat_buf.st_size;
 		data = xmalloc(data_allocated);
 		while (1) {
 			data_read = read(state_fd, &data[data_size],
-					 BUF_SIZE);
+					 data_allocated - data_size);
 			if (data_read < 0) {
 				if (errno == EINTR)
 					continue;
@@ -918,19 +1517,24 @@ extern int load_all_job_state(void)
 				}
 			} else if (data_read == 0)	/* eof */
 				break;
-			data_size      += data_read;
-			data_allocated += data_read;
-			xrealloc(data, data_allocated);
+			data_size += data_read;
+			if ((data_allocated - data_size) < BUF_SIZE) {
+				data_allocated += BUF_SIZE;
+				xrealloc(data, data_allocated);
+			}
 		}
 		close(state_fd);
 	}
 	xfree(state_file);
 	unlock_state_files();
+	END_TIMER;
+	read_usec = DELTA_TIMER;
 
 	job_id_sequence = MAX(job_id_sequence, slurmctld_conf.first_job_id);
 	if (error_code)
 		return error_code;
 
+	START_TIMER;
 	buffer = create_buf(data, data_size);
 	safe_unpackstr_xmalloc(&ver_str, &ver_str_len, buffer);
 	debug3("Version string in job_state header is %s", ver_str);
@@ -958,10 +1562,18 @@ extern int load_all_job_state(void)
 			goto unpack_error;
 		job_cnt++;
 	}
+	info("Recovered information about %d jobs", job_cnt);
+	END_TIMER;
+	unpack_usec = DELTA_TIMER;
+
+	START_TIMER;
+	(void) _job_journal_load(buf_time, false);
 	debug3("Set job_id_sequence to %u", job_id_sequence);
+	END_TIMER;
+	info("load_all_job_state: read usec=%ld unpack usec=%ld "
+	     "journal usec=%ld", read_usec, unpack_usec, DELTA_TIMER);
 
 	free_buf(buffer);
-	info("Recovered information about %d jobs", job_cnt);
 	return error_code;
 
 unpack_error:
@@ -1043,7 +1655,9 @@ extern int load_last_job_id( void )
 	safe_unpack32( &job_id_sequence, buffer);
 	debug3("Job ID in job_state header is %u", job_id_sequence);
 
-	/* Ignore the state for individual jobs stored here */
+	/* Ignore the state for individual jobs stored here and in the
+	 * journal, but recover any newer job ID from the journal */
+	(void) _job_journal_load(buf_time, true);
 
 	free_buf(buffer);
 	return error_code;
@@ -1900,10 +2514,22 @@ static int _load_job_state(Buf buffer, uint16_t protocol_version)
 		job_ptr->array_recs->task_id_bitmap = bit_alloc(task_id_size);
 		xfree(job_ptr->array_recs->task_id_str);
 		if (task_id_str) {
-			bit_unfmt_hexmask(job_ptr->array_recs->task_id_bitmap,
-					  task_id_str);
-			job_ptr->array_recs->task_id_str = task_id_str;
-			task_id_str = NULL;
+			int rc;
+			if (!strncmp(task_id_str, "0x", 2)) {
+				rc = bit_unfmt_hexmask(job_ptr->array_recs->
+						       task_id_bitmap,
+						       task_id_str);
+			} else {
+				rc = bit_unfmt(job_ptr->array_recs->
+					       task_id_bitmap, task_id_str);
+			}
+			if (rc) {
+				error("%s: invalid task_id_str %s for job %u",
+				      __func__, task_id_str, job_id);
+			} else {
+				job_ptr->array_recs->task_id_str = task_id_str;
+				task_id_str = NULL;
+			}
 		}
 		job_ptr->array_recs->task_cnt =
 			bit_set_count(job_ptr->array_recs->task_id_bitmap);
@@ -2333,11 +2959,7 @@ unpack_error:
  */
 static void _add_job_hash(struct job_record *job_ptr)
 {
-	int inx;
-
-	inx = JOB_HASH_INX(job_ptr->job_id);
-	job_ptr->job_next = job_hash[inx];
-	job_hash[inx] = job_ptr;
+	(void) id_hash_add(job_hash, job_ptr->job_id, job_ptr);
 }
 
 /* _remove_job_hash - remove a job hash entry for given job record, job_id must
@@ -2347,19 +2969,11 @@ static void _add_job_hash(struct job_record *job_ptr)
  */
 static void _remove_job_hash(struct job_record *job_entry)
 {
-	struct job_record *job_ptr, **job_pptr;
-
-        job_pptr = &job_hash[JOB_HASH_INX(job_entry->job_id)];
-        while ((job_pptr != NULL) &&
-               ((job_ptr = *job_pptr) != job_entry)) {
-                job_pptr = &job_ptr->job_next;
-        }
-        if (job_pptr == NULL) {
-                fatal("job hash error");
-                return; /* Fix CLANG false positive error */
-        }
-        job_entry->job_next = NULL;
-
+	if (id_hash_find(job_hash, job_entry->job_id) != job_entry) {
+		fatal("job hash error");
+		return; /* Fix CLANG false positive error */
+	}
+	(void) id_hash_remove(job_hash, job_entry->job_id);
 }
 
 /* _add_job_array_hash - add a job hash entry for given job record,
@@ -2369,31 +2983,90 @@ static void _remove_job_hash(struct job_record *job_entry)
  */
 void _add_job_array_hash(struct job_record *job_ptr)
 {
-	int inx;
+	struct job_record *head_ptr;
 
 	if (job_ptr->array_task_id == NO_VAL)
 		return;	/* Not a job array */
 
-	inx = JOB_HASH_INX(job_ptr->array_job_id);
-	job_ptr->job_array_next_j = job_array_hash_j[inx];
-	job_array_hash_j[inx] = job_ptr;
+	head_ptr = id_hash_add(job_array_hash_j, job_ptr->array_job_id,
+			       job_ptr);
+	job_ptr->job_array_next_j = head_ptr;
+	job_ptr->job_array_prev_j = NULL;
+	if (head_ptr)
+		head_ptr->job_array_prev_j = job_ptr;
 
-	inx = JOB_ARRAY_HASH_INX(job_ptr->array_job_id,job_ptr->array_task_id);
-	job_ptr->job_array_next_t = job_array_hash_t[inx];
-	job_array_hash_t[inx] = job_ptr;
+	(void) id_hash_add(job_array_hash_t,
+			   JOB_ARRAY_KEY(job_ptr->array_job_id,
+					 job_ptr->array_task_id), job_ptr);
+}
+
+/* _remove_job_array_hash - remove the job array hash entries for given job
+ *	record, if any
+ * IN job_ptr - pointer to job record
+ * Globals: hash table updated
+ */
+static void _remove_job_array_hash(struct job_record *job_ptr)
+{
+	uint64_t key;
+
+	if (job_ptr->array_task_id == NO_VAL)
+		return;	/* Not a job array */
+
+	if (job_ptr->job_array_prev_j) {
+		job_ptr->job_array_prev_j->job_array_next_j =
+			job_ptr->job_array_next_j;
+	} else if (id_hash_find(job_array_hash_j, job_ptr->array_job_id) ==
+		   job_ptr) {
+		if (job_ptr->job_array_next_j) {
+			(void) id_hash_add(job_array_hash_j,
+					   job_ptr->array_job_id,
+					   job_ptr->job_array_next_j);
+		} else {
+			(void) id_hash_remove(job_array_hash_j,
+					      job_ptr->array_job_id);
+		}
+	} else
+		error("job array hash error");
+	if (job_ptr->job_array_next_j) {
+		job_ptr->job_array_next_j->job_array_prev_j =
+			job_ptr->job_array_prev_j;
+	}
+	job_ptr->job_array_next_j = NULL;
+	job_ptr->job_array_prev_j = NULL;
+
+	key = JOB_ARRAY_KEY(job_ptr->array_job_id, job_ptr->array_task_id);
+	if (id_hash_find(job_array_hash_t, key) == job_ptr)
+		(void) id_hash_remove(job_array_hash_t, key);
+	else
+		error("job array, task ID hash error");
+}
+
+/* Return the first record of the job array tasks with the given
+ *	array_job_id, follow job_array_next_j for the others */
+static struct job_record *_job_array_head(uint32_t array_job_id)
+{
+	return id_hash_find(job_array_hash_j, array_job_id);
 }
 
 /* For the job array data structure, build the string representation of the
- * bitmap.
- * NOTE: bit_fmt_hexmask() is far more scalable than bit_fmt(). */
+ * bitmap. A list of task ID ranges (e.g. "0-999999") packs a huge pending
+ * array into a few bytes, but a hex mask is used if it would be shorter,
+ * as happens once many scattered tasks have started. */
 extern void build_array_str(struct job_record *job_ptr)
 {
 	job_array_struct_t *array_recs = job_ptr->array_recs;
+	int hex_len;
 
 	if (!array_recs || array_recs->task_id_str || !array_recs->task_cnt)
 		return;
 
-	array_recs->task_id_str = bit_fmt_hexmask(array_recs->task_id_bitmap);
+	array_recs->task_id_str = bit_fmt_full(array_recs->task_id_bitmap);
+	hex_len = (bit_size(array_recs->task_id_bitmap) + 3) / 4 + 2;
+	if (strlen(array_recs->task_id_str) > hex_len) {
+		xfree(array_recs->task_id_str);
+		array_recs->task_id_str =
+			bit_fmt_hexmask(array_recs->task_id_bitmap);
+	}
 	/* Here we set the db_index to 0 so we resend the start of the
 	 * job updating the array task string and count of pending
 	 * jobs.  This is faster than sending the start again since
@@ -2406,7 +3079,6 @@ extern void build_array_str(struct job_record *job_ptr)
 extern bool test_job_array_complete(uint32_t array_job_id)
 {
 	struct job_record *job_ptr;
-	int inx;
 
 	job_ptr = find_job_record(array_job_id);
 	if (job_ptr) {
@@ -2419,8 +3091,7 @@ extern bool test_job_array_complete(uint32_t array_job_id)
 	}
 
 	/* Need to test individual job array records */
-	inx = JOB_HASH_INX(array_job_id);
-	job_ptr = job_array_hash_j[inx];
+	job_ptr = _job_array_head(array_job_id);
 	while (job_ptr) {
 		if (job_ptr->array_job_id == array_job_id) {
 			if (!IS_JOB_COMPLETE(job_ptr))
@@ -2435,7 +3106,6 @@ extern bool test_job_array_complete(uint32_t array_job_id)
 extern bool test_job_array_completed(uint32_t array_job_id)
 {
 	struct job_record *job_ptr;
-	int inx;
 
 	job_ptr = find_job_record(array_job_id);
 	if (job_ptr) {
@@ -2446,8 +3116,7 @@ extern bool test_job_array_completed(uint32_t array_job_id)
 	}
 
 	/* Need to test individual job array records */
-	inx = JOB_HASH_INX(array_job_id);
-	job_ptr = job_array_hash_j[inx];
+	job_ptr = _job_array_head(array_job_id);
 	while (job_ptr) {
 		if (job_ptr->array_job_id == array_job_id) {
 			if (!IS_JOB_COMPLETED(job_ptr))
@@ -2462,7 +3131,6 @@ extern bool test_job_array_completed(uint32_t array_job_id)
 extern bool test_job_array_pending(uint32_t array_job_id)
 {
 	struct job_record *job_ptr;
-	int inx;
 
 	job_ptr = find_job_record(array_job_id);
 	if (job_ptr) {
@@ -2473,8 +3141,7 @@ extern bool test_job_array_pending(uint32_t array_job_id)
 	}
 
 	/* Need to test individual job array records */
-	inx = JOB_HASH_INX(array_job_id);
-	job_ptr = job_array_hash_j[inx];
+	job_ptr = _job_array_head(array_job_id);
 	while (job_ptr) {
 		if (job_ptr->array_job_id == array_job_id) {
 			if (IS_JOB_PENDING(job_ptr))
@@ -2504,8 +3171,7 @@ extern struct job_record *find_job_array_rec(uint32_t array_job_id,
 		return find_job_record(array_job_id);
 
 	if (array_task_id == INFINITE) {	/* find by job ID */
-		inx = JOB_HASH_INX(array_job_id);
-		job_ptr = job_array_hash_j[inx];
+		job_ptr = _job_array_head(array_job_id);
 		while (job_ptr) {
 			if (job_ptr->array_job_id == array_job_id) {
 				match_job_ptr = job_ptr;
@@ -2525,15 +3191,11 @@ extern struct job_record *find_job_array_rec(uint32_t array_job_id,
 			return job_ptr;
 		return match_job_ptr;
 	} else {		/* Find specific task ID */
-		inx = JOB_ARRAY_HASH_INX(array_job_id, array_task_id);
-		job_ptr = job_array_hash_t[inx];
-		while (job_ptr) {
-			if ((job_ptr->array_job_id == array_job_id) &&
-			    (job_ptr->array_task_id == array_task_id)) {
-				return job_ptr;
-			}
-			job_ptr = job_ptr->job_array_next_t;
-		}
+		job_ptr = id_hash_find(job_array_hash_t,
+				       JOB_ARRAY_KEY(array_job_id,
+						     array_task_id));
+		if (job_ptr)
+			return job_ptr;
 		/* Look for job record with all of the pending tasks */
 		job_ptr = find_job_record(array_job_id);
 		if (job_ptr && job_ptr->array_recs &&
@@ -2556,16 +3218,7 @@ extern struct job_record *find_job_array_rec(uint32_t array_job_id,
  */
 struct job_record *find_job_record(uint32_t job_id)
 {
-	struct job_record *job_ptr;
-
-	job_ptr = job_hash[JOB_HASH_INX(job_id)];
-	while (job_ptr) {
-		if (job_ptr->job_id == job_id)
-			return job_ptr;
-		job_ptr = job_ptr->job_next;
-	}
-
-	return NULL;
+	return id_hash_find(job_hash, job_id);
 }
 
 /* rebuild a job's partition name list based upon the contents of its
@@ -3361,21 +4014,12 @@ int init_job_conf(void)
  */
 extern void rehash_jobs(void)
 {
+	/* The tables grow as needed, so MaxJobCount changes only
+	 * affect their initial size */
 	if (job_hash == NULL) {
-		hash_table_size = slurmctld_conf.max_job_cnt;
-		job_hash = (struct job_record **)
-			xmalloc(hash_table_size * sizeof(struct job_record *));
-		job_array_hash_j = (struct job_record **)
-			xmalloc(hash_table_size * sizeof(struct job_record *));
-		job_array_hash_t = (struct job_record **)
-			xmalloc(hash_table_size * sizeof(struct job_record *));
-	} else if (hash_table_size < (slurmctld_conf.max_job_cnt / 2)) {
-		/* If the MaxJobCount grows by too much, the hash table will
-		 * be ineffective without rebuilding. We don't presently bother
-		 * to rebuild the hash table, but cut MaxJobCount back as
-		 * needed. */
-		error ("MaxJobCount reset too high, restart slurmctld");
-		slurmctld_conf.max_job_cnt = hash_table_size;
+		job_hash = id_hash_init(slurmctld_conf.max_job_cnt);
+		job_array_hash_j = id_hash_init(0);
+		job_array_hash_t = id_hash_init(0);
 	}
 }
 
@@ -3383,7 +4027,7 @@ extern void rehash_jobs(void)
  * The array_recs structure is moved to the new job record copy */
 struct job_record *_job_rec_copy(struct job_record *job_ptr)
 {
-	struct job_record *job_ptr_pend = NULL, *save_job_next;
+	struct job_record *job_ptr_pend = NULL;
 	struct job_details *job_details, *details_new, *save_details;
 	uint32_t save_job_id, save_db_index = job_ptr->db_index;
 	priority_factors_object_t *save_prio_factors;
@@ -3414,14 +4058,12 @@ struct job_record *_job_rec_copy(struct job_record *job_ptr)
 	/* Copy most of original job data.
 	 * This could be done in parallel, but performance was worse. */
 	save_job_id   = job_ptr_pend->job_id;
-	save_job_next = job_ptr_pend->job_next;
 	save_details  = job_ptr_pend->details;
 	save_prio_factors = job_ptr_pend->prio_factors;
 	save_step_list = job_ptr_pend->step_list;
 	memcpy(job_ptr_pend, job_ptr, sizeof(struct job_record));
 
 	job_ptr_pend->job_id   = save_job_id;
-	job_ptr_pend->job_next = save_job_next;
 	job_ptr_pend->details  = save_details;
 	job_ptr_pend->prio_factors = save_prio_factors;
 	job_ptr_pend->step_list = save_step_list;
@@ -3459,8 +4101,8 @@ struct job_record *_job_rec_copy(struct job_record *job_ptr)
 	job_ptr_pend->gres_req = NULL;
 	job_ptr_pend->gres_used = NULL;
 
-	_add_job_hash(job_ptr);		/* Sets job_next */
-	_add_job_hash(job_ptr_pend);	/* Sets job_next */
+	_add_job_hash(job_ptr);
+	_add_job_hash(job_ptr_pend);
 	_add_job_array_hash(job_ptr);
 	job_ptr_pend->job_resrcs = NULL;
 
@@ -3473,6 +4115,7 @@ struct job_record *_job_rec_copy(struct job_record *job_ptr)
 	job_ptr_pend->node_bitmap = NULL;
 	job_ptr_pend->node_bitmap_cg = NULL;
 	job_ptr_pend->nodes = NULL;
+	job_ptr_pend->nodes_cg = NULL;
 	job_ptr_pend->nodes_completing = NULL;
 	job_ptr_pend->partition = xstrdup(job_ptr->partition);
 	job_ptr_pend->part_ptr_list = part_list_copy(job_ptr->part_ptr_list);
@@ -4133,7 +4776,7 @@ extern int job_str_signal(char *job_id_str, uint16_t signal, uint16_t flags,
 		}
 
 		/* Signal all tasks of this job array */
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
+		job_ptr = _job_array_head(job_id);
 		if (!job_ptr && !job_ptr_done) {
 			info("%s: 2 invalid job id %u", __func__, job_id);
 			return ESLURM_INVALID_JOB_ID;
@@ -4181,7 +4824,7 @@ extern int job_str_signal(char *job_id_str, uint16_t signal, uint16_t flags,
 	/* Find some job record and validate the user cancelling the job */
 	job_ptr = find_job_record(job_id);
 	if (job_ptr == NULL) {
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
+		job_ptr = _job_array_head(job_id);
 		while (job_ptr) {
 			if (job_ptr->array_job_id == job_id)
 				break;
@@ -6976,7 +7619,6 @@ _validate_min_mem_partition(job_desc_msg_t *job_desc_msg,
 static void _list_delete_job(void *job_entry)
 {
 	struct job_record *job_ptr = (struct job_record *) job_entry;
-	struct job_record **job_pptr, *tmp_ptr;
 	int job_array_size, i;
 
 	xassert(job_entry);
@@ -6984,16 +7626,10 @@ static void _list_delete_job(void *job_entry)
 	job_ptr->magic = 0;	/* make sure we don't delete record twice */
 
 	/* Remove the record from job hash table */
-	job_pptr = &job_hash[JOB_HASH_INX(job_ptr->job_id)];
-	while ((job_pptr != NULL) && (*job_pptr != NULL) &&
-	       ((tmp_ptr = *job_pptr) != (struct job_record *) job_entry)) {
-		xassert(tmp_ptr->magic == JOB_MAGIC);
-		job_pptr = &tmp_ptr->job_next;
-	}
-	if (job_pptr == NULL)
-		error("job hash error");
+	if (id_hash_find(job_hash, job_ptr->job_id) == job_ptr)
+		(void) id_hash_remove(job_hash, job_ptr->job_id);
 	else
-		*job_pptr = job_ptr->job_next;
+		error("job hash error");
 
 	if (job_ptr->array_recs) {
 		job_array_size = MAX(1, job_ptr->array_recs->task_cnt);
@@ -7002,34 +7638,7 @@ static void _list_delete_job(void *job_entry)
 	}
 
 	/* Remove the record from job array hash tables, if applicable */
-	if (job_ptr->array_task_id != NO_VAL) {
-		job_pptr = &job_array_hash_j[
-			JOB_HASH_INX(job_ptr->array_job_id)];
-		while ((job_pptr != NULL) && (*job_pptr != NULL) &&
-		       ((tmp_ptr = *job_pptr) !=
-			(struct job_record *) job_entry)) {
-			xassert(tmp_ptr->magic == JOB_MAGIC);
-			job_pptr = &tmp_ptr->job_array_next_j;
-		}
-		if (job_pptr == NULL)
-			error("job array hash error");
-		else
-			*job_pptr = job_ptr->job_array_next_j;
-
-		job_pptr = &job_array_hash_t[
-			JOB_ARRAY_HASH_INX(job_ptr->array_job_id,
-					   job_ptr->array_task_id)];
-		while ((job_pptr != NULL) && (*job_pptr != NULL) &&
-		       ((tmp_ptr = *job_pptr) !=
-			(struct job_record *) job_entry)) {
-			xassert(tmp_ptr->magic == JOB_MAGIC);
-			job_pptr = &tmp_ptr->job_array_next_t;
-		}
-		if (job_pptr == NULL)
-			error("job array, task ID hash error");
-		else
-			*job_pptr = job_ptr->job_array_next_t;
-	}
+	_remove_job_array_hash(job_ptr);
 
 	delete_job_details(job_ptr);
 	xfree(job_ptr->account);
@@ -7058,6 +7667,7 @@ static void _list_delete_job(void *job_entry)
 	FREE_NULL_BITMAP(job_ptr->node_bitmap);
 	FREE_NULL_BITMAP(job_ptr->node_bitmap_cg);
 	xfree(job_ptr->nodes);
+	xfree(job_ptr->nodes_cg);
 	xfree(job_ptr->nodes_completing);
 	xfree(job_ptr->partition);
 	FREE_NULL_LIST(job_ptr->part_ptr_list);
@@ -7165,8 +7775,8 @@ static int _list_find_job_old(void *job_entry, void *key)
 	return 1;		/* Purge the job */
 }
 
-/* Determine if ALL partitions associated with a job are hidden */
-static bool _all_parts_hidden(struct job_record *job_ptr)
+/* Determine if ALL partitions associated with a job are hidden from a user */
+static bool _all_parts_hidden(struct job_record *job_ptr, uid_t uid)
 {
 	bool rc;
 	ListIterator part_iterator;
@@ -7177,7 +7787,7 @@ static bool _all_parts_hidden(struct job_record *job_ptr)
 		part_iterator = list_iterator_create(job_ptr->part_ptr_list);
 		while ((part_ptr = (struct part_record *)
 				   list_next(part_iterator))) {
-			if (!(part_ptr->flags & PART_FLAG_HIDDEN)) {
+			if (part_is_visible(part_ptr, uid)) {
 				rc = false;
 				break;
 			}
@@ -7186,8 +7796,7 @@ static bool _all_parts_hidden(struct job_record *job_ptr)
 		return rc;
 	}
 
-	if ((job_ptr->part_ptr) &&
-	    (job_ptr->part_ptr->flags & PART_FLAG_HIDDEN))
+	if ((job_ptr->part_ptr) && !part_is_visible(job_ptr->part_ptr, uid))
 		return true;
 	return false;
 }
@@ -7211,9 +7820,15 @@ static bool _hide_job(struct job_record *job_ptr, uid_t uid)
  * IN uid - uid of user making request (for partition filtering)
  * IN filter_uid - pack only jobs belonging to this user if not NO_VAL
  * global: job_list - global list of job records
- * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
+ * NOTE: the buffer at *buffer_ptr must be released by the caller with
+ *	pack_all_jobs_free()
  * NOTE: change _unpack_job_desc_msg() in common/slurm_protocol_pack.c
  *	whenever the data format changes
+ * NOTE: The packed buffer is cached and returned for identical requests
+ *	until the job, partition or configuration records change, a pending
+ *	job's begin time passes or job_pack_cache_clear() is called. A client
+ *	receives the same data it would have been told is unchanged had it
+ *	passed the buffer's update time to slurm_load_jobs().
  */
 extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 			  uint16_t show_flags, uid_t uid, uint32_t filter_uid,
@@ -7222,12 +7837,17 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 	ListIterator job_iterator;
 	struct job_record *job_ptr;
 	uint32_t jobs_packed = 0, tmp_offset;
+	job_pack_buf_t *buf;
 	Buf buffer;
-	time_t now = time(NULL);
+	time_t now = time(NULL), expire = (time_t) 0;
 
 	buffer_ptr[0] = NULL;
 	*buffer_size = 0;
 
+	if (_job_pack_cache_get(buffer_ptr, buffer_size, show_flags, uid,
+				filter_uid, protocol_version))
+		return;
+
 	buffer = init_buf(BUF_SIZE);
 
 	/* write message body header : size and time */
@@ -7236,13 +7856,12 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 	pack_time(now, buffer);
 
 	/* write individual job records */
-	part_filter_set(uid);
 	job_iterator = list_iterator_create(job_list);
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		xassert (job_ptr->magic == JOB_MAGIC);
 
 		if (((show_flags & SHOW_ALL) == 0) && (uid != 0) &&
-		    _all_parts_hidden(job_ptr))
+		    _all_parts_hidden(job_ptr, uid))
 			continue;
 
 		if (_hide_job(job_ptr, uid))
@@ -7252,8 +7871,14 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 
 		pack_job(job_ptr, show_flags, buffer, protocol_version, uid);
 		jobs_packed++;
+
+		/* pack_job() reports the begin time as the expected start
+		 * time until it passes */
+		if ((job_ptr->start_time == 0) && job_ptr->details &&
+		    (job_ptr->details->begin_time > now) &&
+		    ((expire == 0) || (job_ptr->details->begin_time < expire)))
+			expire = job_ptr->details->begin_time;
 	}
-	part_filter_clear();
 	list_iterator_destroy(job_iterator);
 
 	/* put the real record count in the message body header */
@@ -7262,8 +7887,181 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 	pack32(jobs_packed, buffer);
 	set_buf_offset(buffer, tmp_offset);
 
-	*buffer_size = get_buf_offset(buffer);
-	buffer_ptr[0] = xfer_buf_data(buffer);
+	buf = xmalloc(sizeof(job_pack_buf_t) + tmp_offset);
+	buf->buffer_size = tmp_offset;
+	buf->ref_cnt = 1;
+	memcpy(buf + 1, get_buf_data(buffer), tmp_offset);
+	free_buf(buffer);
+
+	*buffer_size = buf->buffer_size;
+	buffer_ptr[0] = (char *) (buf + 1);
+
+	_job_pack_cache_put(buf, show_flags, uid, filter_uid,
+			    protocol_version, now, expire);
+}
+
+/* Release a buffer returned by pack_all_jobs() */
+extern void pack_all_jobs_free(char *buffer)
+{
+	job_pack_buf_t *buf;
+
+	if (!buffer)
+		return;
+
+	buf = ((job_pack_buf_t *) buffer) - 1;
+	slurm_mutex_lock(&job_pack_cache_mutex);
+	if (--buf->ref_cnt == 0)
+		xfree(buf);
+	slurm_mutex_unlock(&job_pack_cache_mutex);
+}
+
+/* Discard all cached job information buffers. Call after changing job
+ * fields reported by pack_job() without updating last_job_update, such as
+ * the expected start time of pending jobs. */
+extern void job_pack_cache_clear(void)
+{
+	slurm_mutex_lock(&job_pack_cache_mutex);
+	_job_pack_cache_purge();
+	slurm_mutex_unlock(&job_pack_cache_mutex);
+}
+
+/* Drop the cache's reference to one cached buffer
+ * NOTE: Caller must hold job_pack_cache_mutex */
+static void _job_pack_cache_rm(job_pack_cache_t *cache_ptr)
+{
+	if (!cache_ptr->buf)
+		return;
+	job_pack_cache_bytes -= cache_ptr->buf->buffer_size;
+	if (--cache_ptr->buf->ref_cnt == 0)
+		xfree(cache_ptr->buf);
+	cache_ptr->buf = NULL;
+}
+
+/* Drop all cached job information buffers
+ * NOTE: Caller must hold job_pack_cache_mutex */
+static void _job_pack_cache_purge(void)
+{
+	int i;
+
+	for (i = 0; i < JOB_PACK_CACHE_SIZE; i++)
+		_job_pack_cache_rm(&job_pack_cache[i]);
+}
+
+/* Return a reference to a cached job information buffer matching the
+ * request. Purge the cache if job, partition or configuration records have
+ * changed.
+ * RET true if found
+ * NOTE: Caller must hold a job read lock */
+static bool _job_pack_cache_get(char **buffer_ptr, int *buffer_size,
+				uint16_t show_flags, uid_t uid,
+				uint32_t filter_uid, uint16_t protocol_version)
+{
+	job_pack_cache_t *cache_ptr;
+	bool found = false;
+	time_t now = time(NULL);
+	int i;
+
+	if (show_flags & SHOW_DETAIL2)	/* Includes batch scripts */
+		return false;
+
+	slurm_mutex_lock(&job_pack_cache_mutex);
+	if ((job_pack_cache_job_update  != last_job_update)  ||
+	    (job_pack_cache_part_update != last_part_update) ||
+	    (job_pack_cache_conf_update != slurmctld_conf.last_update)) {
+		_job_pack_cache_purge();
+		job_pack_cache_job_update  = last_job_update;
+		job_pack_cache_part_update = last_part_update;
+		job_pack_cache_conf_update = slurmctld_conf.last_update;
+	}
+	for (i = 0, cache_ptr = job_pack_cache; i < JOB_PACK_CACHE_SIZE;
+	     i++, cache_ptr++) {
+		if (!cache_ptr->buf ||
+		    (cache_ptr->uid != uid) ||
+		    (cache_ptr->filter_uid != filter_uid) ||
+		    (cache_ptr->show_flags != show_flags) ||
+		    (cache_ptr->protocol_version != protocol_version))
+			continue;
+		if (cache_ptr->expire && (cache_ptr->expire <= now)) {
+			_job_pack_cache_rm(cache_ptr);
+			break;
+		}
+		cache_ptr->last_use = ++job_pack_cache_use;
+		cache_ptr->buf->ref_cnt++;
+		buffer_ptr[0] = (char *) (cache_ptr->buf + 1);
+		*buffer_size = cache_ptr->buf->buffer_size;
+		found = true;
+		break;
+	}
+	slurm_mutex_unlock(&job_pack_cache_mutex);
+
+	return found;
+}
+
+/* Keep a reference to a packed job information buffer for reuse by
+ * _job_pack_cache_get(), replacing least recently used records to stay
+ * within JOB_PACK_CACHE_SIZE records and JOB_PACK_CACHE_MAX_BYTES.
+ * IN expire - time at which the buffer's contents become stale, 0 if never
+ * NOTE: Caller must hold a job read lock */
+static void _job_pack_cache_put(job_pack_buf_t *buf, uint16_t show_flags,
+				uid_t uid, uint32_t filter_uid,
+				uint16_t protocol_version, time_t pack_time,
+				time_t expire)
+{
+	job_pack_cache_t *cache_ptr;
+	int i;
+
+	if (show_flags & SHOW_DETAIL2)	/* Includes batch scripts */
+		return;
+	if (buf->buffer_size > JOB_PACK_CACHE_MAX_BYTES)
+		return;
+	/* Records may change later within the same second without changing
+	 * the update times, so only cache buffers packed after that second */
+	if ((pack_time <= last_job_update)  ||
+	    (pack_time <= last_part_update) ||
+	    (pack_time <= slurmctld_conf.last_update))
+		return;
+
+	slurm_mutex_lock(&job_pack_cache_mutex);
+	if ((job_pack_cache_job_update  != last_job_update)  ||
+	    (job_pack_cache_part_update != last_part_update) ||
+	    (job_pack_cache_conf_update != slurmctld_conf.last_update)) {
+		slurm_mutex_unlock(&job_pack_cache_mutex);
+		return;
+	}
+	/* Evict least recently used records until the buffer fits */
+	while ((job_pack_cache_bytes + buf->buffer_size) >
+	       JOB_PACK_CACHE_MAX_BYTES) {
+		cache_ptr = NULL;
+		for (i = 0; i < JOB_PACK_CACHE_SIZE; i++) {
+			if (job_pack_cache[i].buf &&
+			    (!cache_ptr ||
+			     (job_pack_cache[i].last_use < cache_ptr->last_use)))
+				cache_ptr = &job_pack_cache[i];
+		}
+		if (!cache_ptr)
+			break;
+		_job_pack_cache_rm(cache_ptr);
+	}
+	/* Use an unused record, else the least recently used one */
+	cache_ptr = job_pack_cache;
+	for (i = 1; i < JOB_PACK_CACHE_SIZE; i++) {
+		if (!cache_ptr->buf)
+			break;
+		if (!job_pack_cache[i].buf ||
+		    (job_pack_cache[i].last_use < cache_ptr->last_use))
+			cache_ptr = &job_pack_cache[i];
+	}
+	_job_pack_cache_rm(cache_ptr);
+	buf->ref_cnt++;
+	job_pack_cache_bytes += buf->buffer_size;
+	cache_ptr->buf = buf;
+	cache_ptr->expire = expire;
+	cache_ptr->filter_uid = filter_uid;
+	cache_ptr->last_use = ++job_pack_cache_use;
+	cache_ptr->protocol_version = protocol_version;
+	cache_ptr->show_flags = show_flags;
+	cache_ptr->uid = uid;
+	slurm_mutex_unlock(&job_pack_cache_mutex);
 }
 
 /*
@@ -7317,7 +8115,7 @@ extern int pack_one_job(char **buffer_ptr, int *buffer_size,
 			}
 		}
 
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
+		job_ptr = _job_array_head(job_id);
 		while (job_ptr) {
 			if ((job_ptr->job_id == job_id) && packed_head) {
 				;	/* Already packed */
@@ -7349,6 +8147,28 @@ extern int pack_one_job(char **buffer_ptr, int *buffer_size,
 	return SLURM_SUCCESS;
 }
 
+/* Pack the names of the nodes still completing a job. The string is kept
+ * in the job record and only rebuilt after node_bitmap_cg changes. Nodes
+ * are only ever cleared from that bitmap, so its set count identifies its
+ * contents; nodes_cg is discarded wherever the bitmap is replaced. Jobs are
+ * packed under a job read lock, so updates to the cache need a mutex. */
+static void _pack_nodes_cg(struct job_record *job_ptr, Buf buffer)
+{
+	int32_t node_cnt = -1;
+
+	if (job_ptr->node_bitmap_cg)
+		node_cnt = bit_set_count(job_ptr->node_bitmap_cg);
+
+	slurm_mutex_lock(&nodes_cg_mutex);
+	if (!job_ptr->nodes_cg || (job_ptr->nodes_cg_cnt != node_cnt)) {
+		xfree(job_ptr->nodes_cg);
+		job_ptr->nodes_cg = bitmap2node_name(job_ptr->node_bitmap_cg);
+		job_ptr->nodes_cg_cnt = node_cnt;
+	}
+	packstr(job_ptr->nodes_cg, buffer);
+	slurm_mutex_unlock(&nodes_cg_mutex);
+}
+
 /*
  * pack_job - dump all configuration information about a specific job in
  *	machine independent form (for network transmission)
@@ -7365,7 +8185,6 @@ void pack_job(struct job_record *dump_job_ptr, uint16_t show_flags, Buf buffer,
 {
 	struct job_details *detail_ptr;
 	time_t begin_time = 0;
-	char *nodelist = NULL;
 	assoc_mgr_lock_t locks = { NO_LOCK, NO_LOCK,
 				   READ_LOCK, NO_LOCK, NO_LOCK };
 
@@ -7430,12 +8249,8 @@ void pack_job(struct job_record *dump_job_ptr, uint16_t show_flags, Buf buffer,
 		 * the number of cpus and nodes that are currently allocated. */
 		if (!IS_JOB_COMPLETING(dump_job_ptr))
 			packstr(dump_job_ptr->nodes, buffer);
-		else {
-			nodelist =
-				bitmap2node_name(dump_job_ptr->node_bitmap_cg);
-			packstr(nodelist, buffer);
-			xfree(nodelist);
-		}
+		else
+			_pack_nodes_cg(dump_job_ptr, buffer);
 
 		packstr(dump_job_ptr->sched_nodes, buffer);
 
@@ -7514,8 +8329,15 @@ void pack_job(struct job_record *dump_job_ptr, uint16_t show_flags, Buf buffer,
 		pack32(dump_job_ptr->array_job_id, buffer);
 		pack32(dump_job_ptr->array_task_id, buffer);
 		if (dump_job_ptr->array_recs) {
-			build_array_str(dump_job_ptr);
-			packstr(dump_job_ptr->array_recs->task_id_str, buffer);
+			/* Older clients expect a hex mask */
+			char *task_id_hex = NULL;
+			if (dump_job_ptr->array_recs->task_cnt) {
+				task_id_hex = bit_fmt_hexmask(
+					dump_job_ptr->array_recs->
+					task_id_bitmap);
+			}
+			packstr(task_id_hex, buffer);
+			xfree(task_id_hex);
 			pack32(dump_job_ptr->array_recs->max_run_tasks, buffer);
 		} else {
 			packnull(buffer);
@@ -7570,12 +8392,8 @@ void pack_job(struct job_record *dump_job_ptr, uint16_t show_flags, Buf buffer,
 		 * the number of cpus and nodes that are currently allocated. */
 		if (!IS_JOB_COMPLETING(dump_job_ptr))
 			packstr(dump_job_ptr->nodes, buffer);
-		else {
-			nodelist =
-				bitmap2node_name(dump_job_ptr->node_bitmap_cg);
-			packstr(nodelist, buffer);
-			xfree(nodelist);
-		}
+		else
+			_pack_nodes_cg(dump_job_ptr, buffer);
 
 		packstr(dump_job_ptr->sched_nodes, buffer);
 
@@ -7700,12 +8518,8 @@ void pack_job(struct job_record *dump_job_ptr, uint16_t show_flags, Buf buffer,
 		 * the number of cpus and nodes that are currently allocated. */
 		if (!IS_JOB_COMPLETING(dump_job_ptr))
 			packstr(dump_job_ptr->nodes, buffer);
-		else {
-			nodelist =
-				bitmap2node_name(dump_job_ptr->node_bitmap_cg);
-			packstr(nodelist, buffer);
-			xfree(nodelist);
-		}
+		else
+			_pack_nodes_cg(dump_job_ptr, buffer);
 
 		if (!IS_JOB_PENDING(dump_job_ptr) && dump_job_ptr->part_ptr)
 			packstr(dump_job_ptr->part_ptr->name, buffer);
@@ -8162,6 +8976,7 @@ void reset_job_bitmaps(void)
 		}
 
 		FREE_NULL_BITMAP(job_ptr->node_bitmap_cg);
+		xfree(job_ptr->nodes_cg);
 		if (job_ptr->nodes_completing &&
 		    node_name2bitmap(job_ptr->nodes_completing,
 				     false,  &job_ptr->node_bitmap_cg)) {
@@ -10372,7 +11187,7 @@ extern int update_job_str(slurm_msg_t *msg, uid_t uid)
 		}
 
 		/* Update all tasks of this job array */
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
+		job_ptr = _job_array_head(job_id);
 		if (!job_ptr && !job_ptr_done) {
 			info("update_job_str: invalid job id %u", job_id);
 			rc = ESLURM_INVALID_JOB_ID;
@@ -11036,31 +11851,86 @@ job_alloc_info(uint32_t uid, uint32_t job_id, struct job_record **job_pptr)
  */
 int sync_job_files(void)
 {
-	List batch_dirs;
+	batch_dir_ids_t batch_dirs;
+	bitstr_t *keep_dirs;
 
 	if (!slurmctld_primary)	/* Don't purge files from backup slurmctld */
 		return SLURM_SUCCESS;
 
-	batch_dirs = list_create(_del_batch_list_rec);
-	_get_batch_job_dir_ids(batch_dirs);
-	_validate_job_files(batch_dirs);
-	_remove_defunct_batch_dirs(batch_dirs);
-	list_destroy(batch_dirs);
+	memset(&batch_dirs, 0, sizeof(batch_dir_ids_t));
+	_get_batch_job_dir_ids(&batch_dirs);
+	keep_dirs = bit_alloc(MAX(batch_dirs.job_id_cnt, 1));
+	_validate_job_files(&batch_dirs, keep_dirs);
+	_remove_defunct_batch_dirs(&batch_dirs, keep_dirs);
+	FREE_NULL_BITMAP(keep_dirs);
+	xfree(batch_dirs.job_ids);
 	return SLURM_SUCCESS;
 }
 
-/* Append to the batch_dirs list the job_id's associated with
- *	every batch job directory in existence
- * NOTE: READ lock_slurmctld config before entry
- */
-static void _get_batch_job_dir_ids(List batch_dirs)
+/* Add the job_id of a batch job directory named "job.#" to batch_dirs */
+static void _add_batch_dir_id(batch_dir_ids_t *batch_dirs, char *dir_name)
 {
-	DIR *f_dir, *h_dir;
-	struct dirent *dir_ent, *hash_ent;
 	long long_job_id;
-	uint32_t *job_id_ptr;
 	char *endptr;
 
+	if (strncmp("job.#", dir_name, 4))
+		return;
+	long_job_id = strtol(&dir_name[4], &endptr, 10);
+	if ((long_job_id == 0) || (endptr[0] != '\0'))
+		return;
+	debug3("Found batch directory for job_id %ld", long_job_id);
+	if (batch_dirs->job_id_cnt >= batch_dirs->job_id_size) {
+		batch_dirs->job_id_size = MAX(batch_dirs->job_id_size * 2,
+					      1024);
+		xrealloc(batch_dirs->job_ids,
+			 sizeof(uint32_t) * batch_dirs->job_id_size);
+	}
+	batch_dirs->job_ids[batch_dirs->job_id_cnt++] = long_job_id;
+}
+
+/* Thread to collect the job_ids of every batch job directory in one
+ * hash.# directory */
+static void *_scan_batch_hash_dir(void *arg)
+{
+	batch_dir_ids_t *batch_dirs = (batch_dir_ids_t *) arg;
+	struct dirent *hash_ent;
+	DIR *h_dir;
+
+	h_dir = opendir(batch_dirs->dir_name);
+	if (!h_dir)
+		return NULL;
+	while ((hash_ent = readdir(h_dir)))
+		_add_batch_dir_id(batch_dirs, hash_ent->d_name);
+	closedir(h_dir);
+	return NULL;
+}
+
+static int _batch_dir_id_cmp(const void *x, const void *y)
+{
+	uint32_t id1 = *(const uint32_t *) x;
+	uint32_t id2 = *(const uint32_t *) y;
+
+	if (id1 < id2)
+		return -1;
+	if (id1 > id2)
+		return 1;
+	return 0;
+}
+
+/* Collect in batch_dirs the job_id's associated with every batch job
+ *	directory in existence, sorted by job_id. The hash.# directories
+ *	are each scanned by a separate thread.
+ * NOTE: READ lock_slurmctld config before entry
+ */
+static void _get_batch_job_dir_ids(batch_dir_ids_t *batch_dirs)
+{
+	DIR *f_dir;
+	struct dirent *dir_ent;
+	batch_dir_ids_t *hash_dirs = NULL;
+	pthread_t *thread_id = NULL;
+	pthread_attr_t attr;
+	int hash_cnt = 0, i;
+
 	xassert(slurmctld_conf.state_save_location);
 	f_dir = opendir(slurmctld_conf.state_save_location);
 	if (!f_dir) {
@@ -11072,61 +11942,92 @@ static void _get_batch_job_dir_ids(List batch_dirs)
 	while ((dir_ent = readdir(f_dir))) {
 		if (!strncmp("job.#", dir_ent->d_name, 4)) {
 			/* Read version 14.03 or earlier format state */
-			long_job_id = strtol(&dir_ent->d_name[4], &endptr, 10);
-			if ((long_job_id == 0) || (endptr[0] != '\0'))
-				continue;
-			debug3("found batch directory for job_id %ld",
-			      long_job_id);
-			job_id_ptr = xmalloc(sizeof(uint32_t));
-			*job_id_ptr = long_job_id;
-			list_append(batch_dirs, job_id_ptr);
+			_add_batch_dir_id(batch_dirs, dir_ent->d_name);
 		} else if (!strncmp("hash.#", dir_ent->d_name, 5)) {
-			char *h_path = NULL;
-			xstrfmtcat(h_path, "%s/%s",
+			xrealloc(hash_dirs,
+				 sizeof(batch_dir_ids_t) * (hash_cnt + 1));
+			xrealloc(thread_id, sizeof(pthread_t) * (hash_cnt + 1));
+			xstrfmtcat(hash_dirs[hash_cnt].dir_name, "%s/%s",
 				   slurmctld_conf.state_save_location,
 				   dir_ent->d_name);
-			h_dir = opendir(h_path);
-			xfree(h_path);
-			if (!h_dir)
-				continue;
-			while ((hash_ent = readdir(h_dir))) {
-				if (strncmp("job.#", hash_ent->d_name, 4))
-					continue;
-				long_job_id = strtol(&hash_ent->d_name[4],
-						     &endptr, 10);
-				if ((long_job_id == 0) || (endptr[0] != '\0'))
-					continue;
-				debug3("Found batch directory for job_id %ld",
-				      long_job_id);
-				job_id_ptr = xmalloc(sizeof(uint32_t));
-				*job_id_ptr = long_job_id;
-				list_append(batch_dirs, job_id_ptr);
-			}
-			closedir(h_dir);
+			hash_cnt++;
 		}
 	}
-
 	closedir(f_dir);
+
+	slurm_attr_init(&attr);
+	for (i = 0; i < hash_cnt; i++) {
+		if (pthread_create(&thread_id[i], &attr, _scan_batch_hash_dir,
+				   &hash_dirs[i])) {
+			error("pthread_create: %m");
+			(void) _scan_batch_hash_dir(&hash_dirs[i]);
+			thread_id[i] = 0;
+		}
+	}
+	slurm_attr_destroy(&attr);
+
+	for (i = 0; i < hash_cnt; i++) {
+		if (thread_id[i])
+			pthread_join(thread_id[i], NULL);
+		if (hash_dirs[i].job_id_cnt) {
+			xrealloc(batch_dirs->job_ids, sizeof(uint32_t) *
+				 (batch_dirs->job_id_cnt +
+				  hash_dirs[i].job_id_cnt));
+			memcpy(batch_dirs->job_ids + batch_dirs->job_id_cnt,
+			       hash_dirs[i].job_ids,
+			       sizeof(uint32_t) * hash_dirs[i].job_id_cnt);
+			batch_dirs->job_id_cnt += hash_dirs[i].job_id_cnt;
+			batch_dirs->job_id_size = batch_dirs->job_id_cnt;
+		}
+		xfree(hash_dirs[i].dir_name);
+		xfree(hash_dirs[i].job_ids);
+	}
+	xfree(hash_dirs);
+	xfree(thread_id);
+
+	if (batch_dirs->job_id_cnt) {
+		qsort(batch_dirs->job_ids, batch_dirs->job_id_cnt,
+		      sizeof(uint32_t), _batch_dir_id_cmp);
+	}
 }
 
 /* All pending batch jobs must have a batch_dir entry,
  *	otherwise we flag it as FAILED and don't schedule
  * If the batch_dir entry exists for a PENDING or RUNNING batch job,
- *	remove it the list (of directories to be deleted) */
-static void _validate_job_files(List batch_dirs)
+ *	set its bit in keep_dirs (otherwise the directory is deleted) */
+static void _validate_job_files(batch_dir_ids_t *batch_dirs,
+				bitstr_t *keep_dirs)
 {
 	ListIterator job_iterator;
 	struct job_record *job_ptr;
-	int del_cnt;
+	uint32_t *id_ptr;
+	int inx, found;
 
 	job_iterator = list_iterator_create(job_list);
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		if (!job_ptr->batch_flag)
 			continue;
 		/* Want to keep this job's files */
-		del_cnt = list_delete_all(batch_dirs, _find_batch_dir,
-					  &(job_ptr->job_id));
-		if ((del_cnt == 0) && IS_JOB_PENDING(job_ptr)) {
+		found = 0;
+		id_ptr = NULL;
+		if (batch_dirs->job_id_cnt) {
+			id_ptr = bsearch(&job_ptr->job_id, batch_dirs->job_ids,
+					 batch_dirs->job_id_cnt,
+					 sizeof(uint32_t), _batch_dir_id_cmp);
+		}
+		if (id_ptr) {
+			/* Directory could exist in old and new formats */
+			inx = id_ptr - batch_dirs->job_ids;
+			while ((inx > 0) &&
+			       (batch_dirs->job_ids[inx - 1] == *id_ptr))
+				inx--;
+			while ((inx < batch_dirs->job_id_cnt) &&
+			       (batch_dirs->job_ids[inx] == *id_ptr)) {
+				bit_set(keep_dirs, inx++);
+				found++;
+			}
+		}
+		if ((found == 0) && IS_JOB_PENDING(job_ptr)) {
 			error("Script for job %u lost, state set to FAILED",
 			      job_ptr->job_id);
 			job_ptr->job_state = JOB_FAILED;
@@ -11140,33 +12041,20 @@ static void _validate_job_files(List batch_dirs)
 	list_iterator_destroy(job_iterator);
 }
 
-/* List matching function, see common/list.h */
-static int _find_batch_dir(void *x, void *key)
-{
-	uint32_t *key1 = x;
-	uint32_t *key2 = key;
-	return (int)(*key1 == *key2);
-}
-/* List entry deletion function, see common/list.h */
-static void _del_batch_list_rec(void *x)
-{
-	xfree(x);
-}
-
-/* Remove all batch_dir entries in the list
+/* Remove all batch_dir entries not flagged in keep_dirs
  * NOTE: READ lock_slurmctld config before entry */
-static void _remove_defunct_batch_dirs(List batch_dirs)
+static void _remove_defunct_batch_dirs(batch_dir_ids_t *batch_dirs,
+				       bitstr_t *keep_dirs)
 {
-	ListIterator batch_dir_inx;
-	uint32_t *job_id_ptr;
+	int i;
 
-	batch_dir_inx = list_iterator_create(batch_dirs);
-	while ((job_id_ptr = list_next(batch_dir_inx))) {
+	for (i = 0; i < batch_dirs->job_id_cnt; i++) {
+		if (bit_test(keep_dirs, i))
+			continue;
 		info("Purging files for defunct batch job %u",
-		     *job_id_ptr);
-		_delete_job_desc_files(*job_id_ptr);
+		     batch_dirs->job_ids[i]);
+		_delete_job_desc_files(batch_dirs->job_ids[i]);
 	}
-	list_iterator_destroy(batch_dir_inx);
 }
 
 /*
@@ -11387,6 +12275,7 @@ void batch_requeue_fini(struct job_record  *job_ptr)
 #endif
 	xfree(job_ptr->nodes);
 	xfree(job_ptr->nodes_completing);
+	xfree(job_ptr->nodes_cg);
 	FREE_NULL_BITMAP(job_ptr->node_bitmap);
 	FREE_NULL_BITMAP(job_ptr->node_bitmap_cg);
 	if (job_ptr->details) {
@@ -11421,9 +12310,15 @@ void job_fini (void)
 		list_destroy(job_list);
 		job_list = NULL;
 	}
-	xfree(job_hash);
-	xfree(job_array_hash_j);
-	xfree(job_array_hash_t);
+	id_hash_free(job_hash);
+	job_hash = NULL;
+	id_hash_free(job_array_hash_j);
+	job_array_hash_j = NULL;
+	id_hash_free(job_array_hash_t);
+	job_array_hash_t = NULL;
+	slurm_mutex_lock(&job_pack_cache_mutex);
+	_job_pack_cache_purge();
+	slurm_mutex_unlock(&job_pack_cache_mutex);
 }
 
 /* Record the start of one job array task */
@@ -12240,7 +13135,7 @@ extern int job_suspend2(suspend_msg_t *sus_ptr, uid_t uid,
 		}
 
 		/* Suspend all tasks of this job array */
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
+		job_ptr = _job_array_head(job_id);
 		if (!job_ptr && !job_ptr_done) {
 			rc = ESLURM_INVALID_JOB_ID;
 			goto reply;
@@ -12558,7 +13453,7 @@ extern int job_requeue2(uid_t uid, requeue_msg_t *req_ptr,
 		}
 
 		/* Requeue all tasks of this job array */
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
+		job_ptr = _job_array_head(job_id);
 		if (!job_ptr && !job_ptr_done) {
 			rc = ESLURM_INVALID_JOB_ID;
 			goto reply;
@@ -13580,6 +14475,7 @@ _read_job_ckpt_file(char *ckpt_file, int *size_ptr)
 extern void build_cg_bitmap(struct job_record *job_ptr)
 {
 	FREE_NULL_BITMAP(job_ptr->node_bitmap_cg);
+	xfree(job_ptr->nodes_cg);
 	if (job_ptr->node_bitmap) {
 		job_ptr->node_bitmap_cg = bit_copy(job_ptr->node_bitmap);
 		if (bit_set_count(job_ptr->node_bitmap_cg) == 0)
@@ -93,11 +93,23 @@ typedef struct epilog_arg {
 	char **my_env;
 } epilog_arg_t;
 
+/* Binary heap of job queue records ordered by sort_job_queue2(). Used by
+ * schedule() to extract records in priority order without sorting the full
+ * queue, since it typically only tests the first default_queue_depth jobs */
+typedef struct job_queue_heap {
+	job_queue_rec_t **rec;
+	int rec_cnt;
+} job_queue_heap_t;
+
 static char **	_build_env(struct job_record *job_ptr);
 static void	_depend_list_del(void *dep_ptr);
 static void	_feature_list_delete(void *x);
 static void	_job_queue_append(List job_queue, struct job_record *job_ptr,
 				  struct part_record *part_ptr, uint32_t priority);
+static void	_job_queue_heap_build(job_queue_heap_t *heap, List job_queue);
+static void	_job_queue_heap_free(job_queue_heap_t *heap);
+static job_queue_rec_t *_job_queue_heap_pop(job_queue_heap_t *heap);
+static void	_job_queue_heap_sift(job_queue_heap_t *heap, int inx);
 static void	_job_queue_rec_del(void *x);
 static bool	_job_runnable_test1(struct job_record *job_ptr,
 				    bool clear_start);
@@ -164,6 +176,66 @@ static void _job_queue_rec_del(void *x)
 	xfree(x);
 }
 
+/* Move an element down the heap until its children are of lower priority */
+static void _job_queue_heap_sift(job_queue_heap_t *heap, int inx)
+{
+	job_queue_rec_t *tmp_rec;
+	int child;
+
+	while ((child = (inx * 2) + 1) < heap->rec_cnt) {
+		if (((child + 1) < heap->rec_cnt) &&
+		    (sort_job_queue2(&heap->rec[child + 1],
+				     &heap->rec[child]) < 0))
+			child++;
+		if (sort_job_queue2(&heap->rec[child], &heap->rec[inx]) >= 0)
+			break;
+		tmp_rec = heap->rec[inx];
+		heap->rec[inx] = heap->rec[child];
+		heap->rec[child] = tmp_rec;
+		inx = child;
+	}
+}
+
+/* Move all records from a job queue into a heap in O(n) time. The records
+ * are then owned by the heap and job_queue is left empty. */
+static void _job_queue_heap_build(job_queue_heap_t *heap, List job_queue)
+{
+	job_queue_rec_t *job_queue_rec;
+	int i;
+
+	heap->rec_cnt = 0;
+	heap->rec = xmalloc(sizeof(job_queue_rec_t *) *
+			    (list_count(job_queue) + 1));
+	while ((job_queue_rec = list_pop(job_queue)))
+		heap->rec[heap->rec_cnt++] = job_queue_rec;
+	for (i = (heap->rec_cnt / 2) - 1; i >= 0; i--)
+		_job_queue_heap_sift(heap, i);
+}
+
+static void _job_queue_heap_free(job_queue_heap_t *heap)
+{
+	int i;
+
+	for (i = 0; i < heap->rec_cnt; i++)
+		xfree(heap->rec[i]);
+	xfree(heap->rec);
+	heap->rec_cnt = 0;
+}
+
+/* Remove and return the highest priority record, caller must xfree it.
+ * RET NULL if the heap is empty */
+static job_queue_rec_t *_job_queue_heap_pop(job_queue_heap_t *heap)
+{
+	job_queue_rec_t *job_queue_rec;
+
+	if (heap->rec_cnt == 0)
+		return NULL;
+	job_queue_rec = heap->rec[0];
+	heap->rec[0] = heap->rec[--heap->rec_cnt];
+	_job_queue_heap_sift(heap, 0);
+	return job_queue_rec;
+}
+
 /* Job test for ability to run now, excludes partition specific tests */
 static bool _job_runnable_test1(struct job_record *job_ptr, bool clear_start)
 {
@@ -634,8 +706,8 @@ next_part:		part_ptr = (struct part_record *)
 			continue;
 		}
 
-		if (bit_overlap(avail_node_bitmap,
-				job_ptr->part_ptr->node_bitmap) == 0) {
+		if (!bit_overlap_any(avail_node_bitmap,
+				     job_ptr->part_ptr->node_bitmap)) {
 			/* This node DRAIN or DOWN */
 			continue;
 		}
@@ -667,8 +739,8 @@ next_part:		part_ptr = (struct part_record *)
 		else
 			have_node_bitmaps = false;
 		if (have_node_bitmaps &&
-		    (bit_overlap(job_ptr->details->exc_node_bitmap,
-				 fini_job_ptr->job_resrcs->node_bitmap) != 0))
+		    bit_overlap_any(job_ptr->details->exc_node_bitmap,
+				    fini_job_ptr->job_resrcs->node_bitmap))
 			continue;
 
 		if (!job_ptr->batch_flag) {  /* Can't pull interactive jobs */
@@ -705,6 +777,11 @@ next_part:		part_ptr = (struct part_record *)
 		list_iterator_destroy(part_iterator);
 
 send_reply:
+	if (launch_msg &&
+	    sign_batch_job_cred(launch_msg, msg->protocol_version)) {
+		slurmctld_free_batch_job_launch_msg(launch_msg);
+		launch_msg = NULL;
+	}
 	if (launch_msg) {
 		slurm_msg_t response_msg;
 		slurm_msg_t_init(&response_msg);
@@ -755,13 +832,15 @@ static bool _all_partition_priorities_same(void)
  * RET count of jobs scheduled
  * Note: We re-build the queue every time. Jobs can not only be added
  *	or removed from the queue, but have their priority or partition
- *	changed with the update_job RPC. In general nodes will be in priority
- *	order (by submit time), so the sorting should be pretty fast.
+ *	changed with the update_job RPC. Rather than sorting the full queue,
+ *	it is arranged as a heap so that only the records actually tested
+ *	are put in priority order, at O(log n) each.
  */
 extern int schedule(uint32_t job_limit)
 {
 	ListIterator job_iterator = NULL, part_iterator = NULL;
 	List job_queue = NULL;
+	job_queue_heap_t job_heap = { NULL, 0 };
 	int failed_part_cnt = 0, failed_resv_cnt = 0, job_cnt = 0;
 	int bb, error_code, i, j, part_cnt, time_limit;
 	uint32_t job_depth = 0;
@@ -1013,7 +1092,8 @@ extern int schedule(uint32_t job_limit)
 	} else {
 		job_queue = build_job_queue(false, false);
 		slurmctld_diag_stats.schedule_queue_len = list_count(job_queue);
-		sort_job_queue(job_queue);
+		_job_queue_heap_build(&job_heap, job_queue);
+		FREE_NULL_LIST(job_queue);
 	}
 	while (1) {
 		if (fifo_sched) {
@@ -1051,7 +1131,7 @@ next_part:			part_ptr = (struct part_record *)
 					continue;
 			}
 		} else {
-			job_queue_rec = list_pop(job_queue);
+			job_queue_rec = _job_queue_heap_pop(&job_heap);
 			if (!job_queue_rec)
 				break;
 			job_ptr  = job_queue_rec->job_ptr;
@@ -1465,8 +1545,8 @@ next_task:
 			list_iterator_destroy(job_iterator);
 		if (part_iterator)
 			list_iterator_destroy(part_iterator);
-	} else if (job_queue) {
-		FREE_NULL_LIST(job_queue);
+	} else {
+		_job_queue_heap_free(&job_heap);
 	}
 	xfree(sched_part_ptr);
 	xfree(sched_part_jobs);
@@ -1753,8 +1833,8 @@ extern int make_batch_job_cred(batch_job_launch_msg_t *launch_msg_ptr,
 	cred_arg.sockets_per_node    = job_resrcs_ptr->sockets_per_node;
 	cred_arg.sock_core_rep_count = job_resrcs_ptr->sock_core_rep_count;
 
-	launch_msg_ptr->cred = slurm_cred_create(slurmctld_config.cred_ctx,
-						 &cred_arg, protocol_version);
+	launch_msg_ptr->cred = slurm_cred_create_unsigned(
+				slurmctld_config.cred_ctx, &cred_arg);
 
 	if (launch_msg_ptr->cred)
 		return SLURM_SUCCESS;
@@ -1762,6 +1842,42 @@ extern int make_batch_job_cred(batch_job_launch_msg_t *launch_msg_ptr,
 	return SLURM_ERROR;
 }
 
+/*
+ * sign_batch_job_cred - sign the job credential of a batch_job_launch_msg
+ *	built by make_batch_job_cred(). If the credential can not be signed,
+ *	the batch job is requeued.
+ * IN launch_msg_ptr - batch_job_launch_msg to be sent
+ * IN protocol_version - protocol version of the message's recipient
+ * RET 0 or error code
+ * NOTE: Call without holding slurmctld locks, this sets its own
+ */
+extern int sign_batch_job_cred(batch_job_launch_msg_t *launch_msg_ptr,
+			       uint16_t protocol_version)
+{
+	/* Locks: Read config, write job, write node */
+	slurmctld_lock_t job_write_lock =
+	    { READ_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK };
+	struct job_record *job_ptr;
+
+	if (launch_msg_ptr->cred &&
+	    (slurm_cred_sign(slurmctld_config.cred_ctx, &launch_msg_ptr->cred,
+			     1, protocol_version) == SLURM_SUCCESS))
+		return SLURM_SUCCESS;
+
+	error("Can not sign job credential, attempting to requeue "
+	      "batch job %u", launch_msg_ptr->job_id);
+	lock_slurmctld(job_write_lock);
+	job_ptr = find_job_record(launch_msg_ptr->job_id);
+	if (job_ptr && job_ptr->details && IS_JOB_RUNNING(job_ptr) &&
+	    (launch_msg_ptr->step_id == NO_VAL)) {
+		job_ptr->batch_flag = 1;	/* Allow repeated requeue */
+		job_ptr->details->begin_time = time(NULL) + 120;
+		(void) job_complete(job_ptr->job_id, getuid(), true, false, 0);
+	}
+	unlock_slurmctld(job_write_lock);
+	return SLURM_ERROR;
+}
+
 static void _depend_list_del(void *dep_ptr)
 {
 	xfree(dep_ptr);
@@ -109,6 +109,7 @@ extern void launch_job(struct job_record *job_ptr);
  *                         uid and nodes have already been set
  * IN job_ptr - pointer to job record
  * RET 0 or error code
+ * NOTE: The credential is not signed, see sign_batch_job_cred()
  */
 extern int make_batch_job_cred(batch_job_launch_msg_t *launch_msg_ptr,
 			       struct job_record *job_ptr,
@@ -125,6 +126,18 @@ extern void print_job_dependency(struct job_record *job_ptr);
  */
 extern int prolog_slurmctld(struct job_record *job_ptr);
 
+/*
+ * sign_batch_job_cred - sign the job credential of a batch_job_launch_msg
+ *	built by make_batch_job_cred(). If the credential can not be signed,
+ *	the batch job is requeued.
+ * IN launch_msg_ptr - batch_job_launch_msg to be sent
+ * IN protocol_version - protocol version of the message's recipient
+ * RET 0 or error code
+ * NOTE: Call without holding slurmctld locks, this sets its own
+ */
+extern int sign_batch_job_cred(batch_job_launch_msg_t *launch_msg_ptr,
+			       uint16_t protocol_version);
+
 /*
  * reboot_job_nodes - Reboot the compute nodes allocated to a job.
  * IN job_ptr - pointer to job that will be initiated
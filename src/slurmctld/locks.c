@@ -47,18 +47,35 @@
 
 #include <errno.h>
 #include <string.h>
+#include <sys/time.h>
 #include <sys/types.h>
 
+#include "src/common/pack.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
 
-static pthread_mutex_t locks_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t locks_cond = PTHREAD_COND_INITIALIZER;
+/* Each data type has its own mutex and condition variable so that releasing
+ * a lock only wakes threads waiting on that same data type. The fixed
+ * config/job/node/partition ordering in lock_slurmctld() prevents deadlock */
+static pthread_mutex_t locks_mutex[ENTITY_COUNT] = {
+	PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER,
+	PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER };
+static pthread_cond_t locks_cond[ENTITY_COUNT] = {
+	PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER,
+	PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER };
 static pthread_mutex_t state_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static slurmctld_lock_flags_t slurmctld_locks;
 static int kill_thread = 0;
 
+/* Lock wait time statistics, indexed by lock_stat_inx(), each protected by
+ * the locks_mutex of its data type */
+static uint32_t lock_cnt[LOCK_STAT_CNT];
+static uint64_t lock_wait_time[LOCK_STAT_CNT];	/* usec */
+static uint32_t lock_wait_max[LOCK_STAT_CNT];	/* usec */
+static uint32_t lock_wait_hist[LOCK_STAT_CNT * LOCK_HIST_CNT];
+
+static void _lock_stat_rec(int stat_inx, struct timeval *wait_start);
 static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock);
 static void _wr_rdunlock(lock_datatype_t datatype);
 static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock);
@@ -196,8 +213,10 @@ extern void unlock_slurmctld(slurmctld_lock_t lock_levels)
 static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock)
 {
 	bool success = true;
+	struct timeval wait_start;
 
-	slurm_mutex_lock(&locks_mutex);
+	wait_start.tv_sec = 0;
+	slurm_mutex_lock(&locks_mutex[datatype]);
 	while (1) {
 #if 1
 		if ((slurmctld_locks.entity[write_lock(datatype)] == 0) &&
@@ -210,35 +229,44 @@ static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock)
 #endif
 			slurmctld_locks.entity[read_lock(datatype)]++;
 			slurmctld_locks.entity[write_cnt_lock(datatype)] = 0;
+			_lock_stat_rec(lock_stat_inx(datatype, READ_LOCK),
+				       &wait_start);
 			break;
 		} else if (!wait_lock) {
 			success = false;
 			break;
 		} else {	/* wait for state change and retry */
-			pthread_cond_wait(&locks_cond, &locks_mutex);
+			if (wait_start.tv_sec == 0)
+				gettimeofday(&wait_start, NULL);
+			pthread_cond_wait(&locks_cond[datatype],
+					  &locks_mutex[datatype]);
 			if (kill_thread)
 				pthread_exit(NULL);
 		}
 	}
-	slurm_mutex_unlock(&locks_mutex);
+	slurm_mutex_unlock(&locks_mutex[datatype]);
 	return success;
 }
 
 /* _wr_rdunlock - Issue a read unlock on the specified data type */
 static void _wr_rdunlock(lock_datatype_t datatype)
 {
-	slurm_mutex_lock(&locks_mutex);
+	slurm_mutex_lock(&locks_mutex[datatype]);
 	slurmctld_locks.entity[read_lock(datatype)]--;
-	pthread_cond_broadcast(&locks_cond);
-	slurm_mutex_unlock(&locks_mutex);
+	/* Only a pending write lock can be waiting for the readers to drain */
+	if (slurmctld_locks.entity[read_lock(datatype)] == 0)
+		pthread_cond_broadcast(&locks_cond[datatype]);
+	slurm_mutex_unlock(&locks_mutex[datatype]);
 }
 
 /* _wr_wrlock - Issue a write lock on the specified data type */
 static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock)
 {
 	bool success = true;
+	struct timeval wait_start;
 
-	slurm_mutex_lock(&locks_mutex);
+	wait_start.tv_sec = 0;
+	slurm_mutex_lock(&locks_mutex[datatype]);
 	slurmctld_locks.entity[write_wait_lock(datatype)]++;
 
 	while (1) {
@@ -247,28 +275,63 @@ static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock)
 			slurmctld_locks.entity[write_lock(datatype)]++;
 			slurmctld_locks.entity[write_wait_lock(datatype)]--;
 			slurmctld_locks.entity[write_cnt_lock(datatype)]++;
+			_lock_stat_rec(lock_stat_inx(datatype, WRITE_LOCK),
+				       &wait_start);
 			break;
 		} else if (!wait_lock) {
 			slurmctld_locks.entity[write_wait_lock(datatype)]--;
+			/* Readers may have been held off by this request */
+			pthread_cond_broadcast(&locks_cond[datatype]);
 			success = false;
 			break;
 		} else {	/* wait for state change and retry */
-			pthread_cond_wait(&locks_cond, &locks_mutex);
+			if (wait_start.tv_sec == 0)
+				gettimeofday(&wait_start, NULL);
+			pthread_cond_wait(&locks_cond[datatype],
+					  &locks_mutex[datatype]);
 			if (kill_thread)
 				pthread_exit(NULL);
 		}
 	}
-	slurm_mutex_unlock(&locks_mutex);
+	slurm_mutex_unlock(&locks_mutex[datatype]);
 	return success;
 }
 
 /* _wr_wrunlock - Issue a write unlock on the specified data type */
 static void _wr_wrunlock(lock_datatype_t datatype)
 {
-	slurm_mutex_lock(&locks_mutex);
+	slurm_mutex_lock(&locks_mutex[datatype]);
 	slurmctld_locks.entity[write_lock(datatype)]--;
-	pthread_cond_broadcast(&locks_cond);
-	slurm_mutex_unlock(&locks_mutex);
+	pthread_cond_broadcast(&locks_cond[datatype]);
+	slurm_mutex_unlock(&locks_mutex[datatype]);
+}
+
+/* _lock_stat_rec - Record the time spent waiting for a lock
+ * IN stat_inx - lock_stat_inx() of the lock just acquired
+ * IN wait_start - time the thread first blocked, tv_sec is zero if the lock
+ *	was granted without waiting
+ * NOTE: Caller must hold the locks_mutex for the data type */
+static void _lock_stat_rec(int stat_inx, struct timeval *wait_start)
+{
+	struct timeval now;
+	uint32_t delta_t = 0, bucket_max = 10;
+	int i;
+
+	if (wait_start->tv_sec) {
+		gettimeofday(&now, NULL);
+		delta_t  = (now.tv_sec  - wait_start->tv_sec) * 1000000;
+		delta_t +=  now.tv_usec - wait_start->tv_usec;
+	}
+
+	lock_cnt[stat_inx]++;
+	lock_wait_time[stat_inx] += delta_t;
+	if (lock_wait_max[stat_inx] < delta_t)
+		lock_wait_max[stat_inx] = delta_t;
+	for (i = 0; i < (LOCK_HIST_CNT - 1); i++, bucket_max *= 10) {
+		if (delta_t < bucket_max)
+			break;
+	}
+	lock_wait_hist[stat_inx * LOCK_HIST_CNT + i]++;
 }
 
 /* get_lock_values - Get the current value of all locks
@@ -283,8 +346,78 @@ void get_lock_values(slurmctld_lock_flags_t * lock_flags)
 /* kill_locked_threads - Kill all threads waiting on semaphores */
 extern void kill_locked_threads(void)
 {
+	int i;
+
 	kill_thread = 1;
-	pthread_cond_broadcast(&locks_cond);
+	for (i = 0; i < ENTITY_COUNT; i++)
+		pthread_cond_broadcast(&locks_cond[i]);
+}
+
+/* reset_lock_stats - Clear lock wait time statistics */
+extern void reset_lock_stats(void)
+{
+	int i;
+
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		slurm_mutex_lock(&locks_mutex[i]);
+		memset(&lock_cnt[lock_stat_inx(i, READ_LOCK)], 0,
+		       sizeof(uint32_t) * 2);
+		memset(&lock_wait_time[lock_stat_inx(i, READ_LOCK)], 0,
+		       sizeof(uint64_t) * 2);
+		memset(&lock_wait_max[lock_stat_inx(i, READ_LOCK)], 0,
+		       sizeof(uint32_t) * 2);
+		memset(&lock_wait_hist[lock_stat_inx(i, READ_LOCK) *
+				       LOCK_HIST_CNT], 0,
+		       sizeof(uint32_t) * 2 * LOCK_HIST_CNT);
+		slurm_mutex_unlock(&locks_mutex[i]);
+	}
+}
+
+/* pack_lock_stats - Append lock wait time statistics to a buffer
+ * IN/OUT buffer_ptr - buffer built by pack_all_stat()
+ * IN/OUT buffer_size - size of buffer_ptr
+ * IN protocol_version - slurm protocol version of client */
+extern void pack_lock_stats(char **buffer_ptr, int *buffer_size,
+			    uint16_t protocol_version)
+{
+	uint32_t cnt[LOCK_STAT_CNT], max[LOCK_STAT_CNT];
+	uint32_t hist[LOCK_STAT_CNT * LOCK_HIST_CNT];
+	uint64_t wait[LOCK_STAT_CNT];
+	Buf buffer;
+	int i;
+
+	if (protocol_version < SLURM_15_08_PROTOCOL_VERSION)
+		return;
+
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		slurm_mutex_lock(&locks_mutex[i]);
+		memcpy(&cnt[lock_stat_inx(i, READ_LOCK)],
+		       &lock_cnt[lock_stat_inx(i, READ_LOCK)],
+		       sizeof(uint32_t) * 2);
+		memcpy(&wait[lock_stat_inx(i, READ_LOCK)],
+		       &lock_wait_time[lock_stat_inx(i, READ_LOCK)],
+		       sizeof(uint64_t) * 2);
+		memcpy(&max[lock_stat_inx(i, READ_LOCK)],
+		       &lock_wait_max[lock_stat_inx(i, READ_LOCK)],
+		       sizeof(uint32_t) * 2);
+		memcpy(&hist[lock_stat_inx(i, READ_LOCK) * LOCK_HIST_CNT],
+		       &lock_wait_hist[lock_stat_inx(i, READ_LOCK) *
+				       LOCK_HIST_CNT],
+		       sizeof(uint32_t) * 2 * LOCK_HIST_CNT);
+		slurm_mutex_unlock(&locks_mutex[i]);
+	}
+
+	buffer = create_buf(*buffer_ptr, *buffer_size);
+	set_buf_offset(buffer, *buffer_size);
+	pack32(LOCK_STAT_CNT, buffer);
+	pack32(LOCK_HIST_CNT, buffer);
+	pack32_array(cnt,  LOCK_STAT_CNT, buffer);
+	pack64_array(wait, LOCK_STAT_CNT, buffer);
+	pack32_array(max,  LOCK_STAT_CNT, buffer);
+	pack32_array(hist, LOCK_STAT_CNT * LOCK_HIST_CNT, buffer);
+
+	*buffer_size = get_buf_offset(buffer);
+	buffer_ptr[0] = xfer_buf_data(buffer);
 }
 
 /* un/lock semaphore used for saving state of slurmctld */
@@ -128,6 +128,14 @@ typedef struct {
 	int entity[ENTITY_COUNT * 4];
 }	slurmctld_lock_flags_t;
 
+/* Lock wait time statistics are kept for read and write locks of each data
+ * type, with a histogram of wait times in decades: <10us, <100us, <1ms,
+ * <10ms, <100ms, <1s and >=1s */
+#define LOCK_STAT_CNT			(ENTITY_COUNT * 2)
+#define LOCK_HIST_CNT			7
+#define lock_stat_inx(data_type, level)	\
+	(data_type * 2 + ((level == WRITE_LOCK) ? 1 : 0))
+
 
 /* get_lock_values - Get the current value of all locks
  * OUT lock_flags - a copy of the current lock values */
@@ -151,6 +159,16 @@ extern int try_lock_slurmctld (slurmctld_lock_t lock_levels);
  *	defined order */
 extern void unlock_slurmctld (slurmctld_lock_t lock_levels);
 
+/* pack_lock_stats - Append lock wait time statistics to a buffer
+ * IN/OUT buffer_ptr - buffer built by pack_all_stat()
+ * IN/OUT buffer_size - size of buffer_ptr
+ * IN protocol_version - slurm protocol version of client */
+extern void pack_lock_stats(char **buffer_ptr, int *buffer_size,
+			    uint16_t protocol_version);
+
+/* reset_lock_stats - Clear lock wait time statistics */
+extern void reset_lock_stats(void);
+
 /* un/lock semaphore used for saving state of slurmctld */
 extern void lock_state_files ( void );
 extern void unlock_state_files ( void );
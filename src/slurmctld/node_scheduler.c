@@ -85,6 +85,9 @@
 #define MAX_FEATURES  32	/* max exclusive features "[fs1|fs2]"=2 */
 #define MAX_RETRIES   10
 
+/* Number of node_set tables to retain, see _build_node_list() */
+#define NODE_SET_CACHE_SIZE 64
+
 struct node_set {		/* set of nodes with same configuration */
 	uint16_t cpus_per_node;	/* NOTE: This is the minimum count,
 				 * if FastSchedule==0 then individual
@@ -99,6 +102,31 @@ struct node_set {		/* set of nodes with same configuration */
 	bitstr_t *my_bitmap;		/* node bitmap */
 };
 
+typedef struct {			/* node_set table for a job shape */
+	struct part_record *part_ptr;	/* NULL if record is unused */
+	char     *features;
+	uint32_t pn_min_cpus;
+	uint32_t pn_min_memory;
+	uint32_t pn_min_tmp_disk;
+	uint16_t ntasks_per_core;
+	bool     have_mc;
+	uint16_t sockets_per_node;
+	uint16_t cores_per_socket;
+	uint16_t threads_per_core;
+	char     *err_msg;		/* set by _set_err_msg() while built */
+	uint32_t last_use;		/* for least recently used replacement */
+	uint32_t max_weight;
+	struct node_set *node_set_ptr;
+	int      node_set_size;
+} node_set_cache_t;
+
+/* The node_set cache is protected by the slurmctld node write lock, which
+ * is held by all callers of select_nodes() and by every update to node
+ * configuration records. Partition changes are detected by time. */
+static node_set_cache_t node_set_cache[NODE_SET_CACHE_SIZE];
+static time_t   node_set_cache_part_update = (time_t) 0;
+static uint32_t node_set_cache_use = 0;
+
 static int  _build_node_list(struct job_record *job_ptr,
 			     struct node_set **node_set_pptr,
 			     int *node_set_size, char **err_msg);
@@ -108,6 +136,17 @@ static void _filter_nodes_in_set(struct node_set *node_set_ptr,
 				 char **err_msg);
 static void _launch_prolog(struct job_record *job_ptr);
 static int  _match_feature(char *seek, struct node_set *node_set_ptr);
+static struct node_set *_node_set_copy(struct node_set *node_set_ptr,
+				       int node_set_size);
+static void _node_set_free(struct node_set *node_set_ptr,
+			   int node_set_size);
+static node_set_cache_t *_node_set_cache_get(struct job_record *job_ptr);
+static bool _node_set_cache_match(node_set_cache_t *cache_ptr,
+				  struct job_record *job_ptr);
+static void _node_set_cache_put(struct job_record *job_ptr,
+				struct node_set *node_set_ptr,
+				int node_set_size, uint32_t max_weight,
+				char *err_msg, time_t build_time);
 static int _nodes_in_sets(bitstr_t *req_bitmap,
 			  struct node_set * node_set_ptr,
 			  int node_set_size);
@@ -1139,9 +1178,9 @@ _pick_best_nodes(struct node_set *node_set_ptr, int node_set_size,
 					return ESLURM_NODES_BUSY;
 				}
 #ifndef HAVE_BG
-				if (bit_overlap(job_ptr->details->
-						req_node_bitmap,
-						cg_node_bitmap)) {
+				if (bit_overlap_any(job_ptr->details->
+						    req_node_bitmap,
+						    cg_node_bitmap)) {
 					return ESLURM_NODES_BUSY;
 				}
 #endif
@@ -1154,8 +1193,8 @@ _pick_best_nodes(struct node_set *node_set_ptr, int node_set_size,
 				/* Note: IDLE nodes are not COMPLETING */
 			}
 #ifndef HAVE_BG
-		} else if (bit_overlap(job_ptr->details->req_node_bitmap,
-				       cg_node_bitmap)) {
+		} else if (bit_overlap_any(job_ptr->details->req_node_bitmap,
+					   cg_node_bitmap)) {
 			return ESLURM_NODES_BUSY;
 #endif
 		}
@@ -1844,7 +1883,7 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 		(nonstop_ops.job_begin)(job_ptr);
 
 	if (configuring
-	    || bit_overlap(job_ptr->node_bitmap, power_node_bitmap))
+	    || bit_overlap_any(job_ptr->node_bitmap, power_node_bitmap))
 		job_ptr->job_state |= JOB_CONFIGURING;
 	/* Clear any vestigial GRES in case job was requeued */
 	gres_plugin_job_clear(job_ptr->gres_list);
@@ -1895,14 +1934,7 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 		*select_node_bitmap = select_bitmap;
 	else
 		FREE_NULL_BITMAP(select_bitmap);
-	if (node_set_ptr) {
-		for (i = 0; i < node_set_size; i++) {
-			xfree(node_set_ptr[i].features);
-			FREE_NULL_BITMAP(node_set_ptr[i].my_bitmap);
-			FREE_NULL_BITMAP(node_set_ptr[i].feature_bits);
-		}
-		xfree(node_set_ptr);
-	}
+	_node_set_free(node_set_ptr, node_set_size);
 
 #ifdef HAVE_BG
 	if (error_code != SLURM_SUCCESS)
@@ -2107,7 +2139,7 @@ static bool _valid_feature_counts(struct job_details *detail_ptr,
 	struct feature_record *job_feat_ptr;
 	struct features_record *feat_ptr;
 	int have_count = false, last_op = FEATURE_OP_AND;
-	bitstr_t *feature_bitmap, *tmp_bitmap;
+	bitstr_t *feature_bitmap;
 	bool rc = true;
 
 	xassert(detail_ptr);
@@ -2159,13 +2191,11 @@ static bool _valid_feature_counts(struct job_details *detail_ptr,
 				rc = false;
 				break;
 			}
-			tmp_bitmap = bit_copy(feature_bitmap);
-			bit_and(tmp_bitmap, feat_ptr->node_bitmap);
-			if (bit_set_count(tmp_bitmap) < job_feat_ptr->count)
+			if (bit_overlap(feature_bitmap, feat_ptr->node_bitmap) <
+			    job_feat_ptr->count) {
 				rc = false;
-			FREE_NULL_BITMAP(tmp_bitmap);
-			if (!rc)
 				break;
+			}
 		}
 		list_iterator_destroy(job_feat_iter);
 		FREE_NULL_BITMAP(feature_bitmap);
@@ -2293,6 +2323,9 @@ static int _no_reg_nodes(void)
  * OUT node_set_size - number of node_set entries
  * OUT err_msg - error message for job, caller must xfree
  * RET error code
+ * NOTE: Tables built without a reservation or excluded nodes are cached
+ *	by partition, feature expression and per-node resource requirements
+ *	until node configuration or partition records change
  */
 static int _build_node_list(struct job_record *job_ptr,
 			    struct node_set **node_set_pptr,
@@ -2311,6 +2344,9 @@ static int _build_node_list(struct job_record *job_ptr,
 	uint32_t max_weight = 0;
 	bool has_xor = false;
 	bool resv_overlap = false;
+	node_set_cache_t *cache_ptr;
+	char *set_err_msg = NULL;
+	time_t build_time;
 
 	if (job_ptr->resv_name) {
 		/* Limit node selection to those in selected reservation */
@@ -2353,6 +2389,23 @@ static int _build_node_list(struct job_record *job_ptr,
 		return SLURM_SUCCESS;
 	}
 
+	/* Nodes registering with more resources than configured are only
+	 * considered with FastSchedule=0, so those tables are not cached */
+	if (!job_ptr->resv_name && !detail_ptr->exc_node_bitmap &&
+	    slurmctld_conf.fast_schedule &&
+	    (cache_ptr = _node_set_cache_get(job_ptr))) {
+		node_set_inx = cache_ptr->node_set_size;
+		node_set_ptr = _node_set_copy(cache_ptr->node_set_ptr,
+					      node_set_inx);
+		max_weight = cache_ptr->max_weight;
+		if (err_msg && cache_ptr->err_msg) {
+			xfree(*err_msg);
+			*err_msg = xstrdup(cache_ptr->err_msg);
+		}
+		goto power_split;
+	}
+	build_time = time(NULL);
+
 	node_set_inx = 0;
 	node_set_ptr = (struct node_set *)
 			xmalloc(sizeof(struct node_set) * 2);
@@ -2418,7 +2471,7 @@ static int _build_node_list(struct job_record *job_ptr,
 		if (slurmctld_conf.fast_schedule) {
 			if (config_filter) {
 				_set_err_msg(cpus_ok, mem_ok, disk_ok,
-					     job_mc_ok, err_msg);
+					     job_mc_ok, &set_err_msg);
 				continue;
 			}
 			check_node_config = 0;
@@ -2432,11 +2485,13 @@ static int _build_node_list(struct job_record *job_ptr,
 		bit_and(node_set_ptr[node_set_inx].my_bitmap,
 			part_ptr->node_bitmap);
 		if (usable_node_mask) {
-			bit_and(node_set_ptr[node_set_inx].my_bitmap,
+			node_set_ptr[node_set_inx].nodes = bit_and_set_count(
+				node_set_ptr[node_set_inx].my_bitmap,
 				usable_node_mask);
+		} else {
+			node_set_ptr[node_set_inx].nodes = bit_set_count(
+				node_set_ptr[node_set_inx].my_bitmap);
 		}
-		node_set_ptr[node_set_inx].nodes =
-			bit_set_count(node_set_ptr[node_set_inx].my_bitmap);
 		if (check_node_config &&
 		    (node_set_ptr[node_set_inx].nodes != 0)) {
 			_filter_nodes_in_set(&node_set_ptr[node_set_inx],
@@ -2486,8 +2541,13 @@ static int _build_node_list(struct job_record *job_ptr,
 	FREE_NULL_BITMAP(node_set_ptr[node_set_inx].my_bitmap);
 	FREE_NULL_BITMAP(node_set_ptr[node_set_inx].feature_bits);
 	FREE_NULL_BITMAP(usable_node_mask);
+	if (err_msg && set_err_msg) {
+		xfree(*err_msg);
+		*err_msg = xstrdup(set_err_msg);
+	}
 
 	if (node_set_inx == 0) {
+		xfree(set_err_msg);
 		rc = ESLURM_REQUESTED_NODE_CONFIG_UNAVAILABLE;
 		info("No nodes satisfy job %u requirements in partition %s",
 		     job_ptr->job_id, job_ptr->part_ptr->name);
@@ -2501,10 +2561,19 @@ static int _build_node_list(struct job_record *job_ptr,
 		}
 		return rc;
 	}
+	if (!job_ptr->resv_name && !detail_ptr->exc_node_bitmap &&
+	    slurmctld_conf.fast_schedule) {
+		_node_set_cache_put(job_ptr, node_set_ptr, node_set_inx,
+				    max_weight, set_err_msg, build_time);
+	}
+	xfree(set_err_msg);
 
+power_split:
 	/* If any nodes are powered down, put them into a new node_set
 	 * record with a higher scheduling weight. This means we avoid
-	 * scheduling jobs on powered down nodes where possible. */
+	 * scheduling jobs on powered down nodes where possible.
+	 * Power state is not part of the cached tables, so this is done
+	 * for every job. */
 	for (i = (node_set_inx-1); i >= 0; i--) {
 		power_cnt = bit_overlap(node_set_ptr[i].my_bitmap,
 					power_node_bitmap);
@@ -2550,6 +2619,166 @@ static int _build_node_list(struct job_record *job_ptr,
 	return SLURM_SUCCESS;
 }
 
+/* Return a copy of a node_set table with two extra records for
+ * _build_node_list() to split off powered down nodes */
+static struct node_set *_node_set_copy(struct node_set *node_set_ptr,
+				       int node_set_size)
+{
+	struct node_set *new_set_ptr;
+	int i;
+
+	new_set_ptr = xmalloc(sizeof(struct node_set) * (node_set_size + 2));
+	for (i = 0; i < node_set_size; i++) {
+		new_set_ptr[i].cpus_per_node = node_set_ptr[i].cpus_per_node;
+		new_set_ptr[i].real_memory   = node_set_ptr[i].real_memory;
+		new_set_ptr[i].nodes         = node_set_ptr[i].nodes;
+		new_set_ptr[i].weight        = node_set_ptr[i].weight;
+		new_set_ptr[i].features  = xstrdup(node_set_ptr[i].features);
+		new_set_ptr[i].feature_bits =
+			bit_copy(node_set_ptr[i].feature_bits);
+		new_set_ptr[i].my_bitmap = bit_copy(node_set_ptr[i].my_bitmap);
+	}
+
+	return new_set_ptr;
+}
+
+/* Free a node_set table and its records */
+static void _node_set_free(struct node_set *node_set_ptr, int node_set_size)
+{
+	int i;
+
+	if (!node_set_ptr)
+		return;
+	for (i = 0; i < node_set_size; i++) {
+		xfree(node_set_ptr[i].features);
+		FREE_NULL_BITMAP(node_set_ptr[i].my_bitmap);
+		FREE_NULL_BITMAP(node_set_ptr[i].feature_bits);
+	}
+	xfree(node_set_ptr);
+}
+
+/* Return true if a cached node_set table was built for a job with the
+ * same partition, feature expression and per-node requirements */
+static bool _node_set_cache_match(node_set_cache_t *cache_ptr,
+				  struct job_record *job_ptr)
+{
+	struct job_details *detail_ptr = job_ptr->details;
+	multi_core_data_t *mc_ptr = detail_ptr->mc_ptr;
+
+	if ((cache_ptr->part_ptr != job_ptr->part_ptr) ||
+	    (cache_ptr->pn_min_cpus != detail_ptr->pn_min_cpus) ||
+	    (cache_ptr->pn_min_memory != detail_ptr->pn_min_memory) ||
+	    (cache_ptr->pn_min_tmp_disk != detail_ptr->pn_min_tmp_disk) ||
+	    (cache_ptr->ntasks_per_core != _get_ntasks_per_core(detail_ptr)) ||
+	    (cache_ptr->have_mc != (mc_ptr != NULL)))
+		return false;
+	if (mc_ptr &&
+	    ((cache_ptr->sockets_per_node != mc_ptr->sockets_per_node) ||
+	     (cache_ptr->cores_per_socket != mc_ptr->cores_per_socket) ||
+	     (cache_ptr->threads_per_core != mc_ptr->threads_per_core)))
+		return false;
+	if (xstrcmp(cache_ptr->features, detail_ptr->features))
+		return false;
+	return true;
+}
+
+/* Return the cached node_set table matching a job or NULL if none.
+ * Purge the cache if partition records have changed. */
+static node_set_cache_t *_node_set_cache_get(struct job_record *job_ptr)
+{
+	node_set_cache_t *cache_ptr;
+	int i;
+
+	if (node_set_cache_part_update != last_part_update) {
+		purge_node_set_cache();
+		node_set_cache_part_update = last_part_update;
+	}
+	for (i = 0, cache_ptr = node_set_cache; i < NODE_SET_CACHE_SIZE;
+	     i++, cache_ptr++) {
+		if (!cache_ptr->part_ptr ||
+		    !_node_set_cache_match(cache_ptr, job_ptr))
+			continue;
+		cache_ptr->last_use = ++node_set_cache_use;
+		return cache_ptr;
+	}
+
+	return NULL;
+}
+
+/* Save a copy of a node_set table for reuse by _node_set_cache_get(),
+ * replacing the least recently used record */
+static void _node_set_cache_put(struct job_record *job_ptr,
+				struct node_set *node_set_ptr,
+				int node_set_size, uint32_t max_weight,
+				char *err_msg, time_t build_time)
+{
+	struct job_details *detail_ptr = job_ptr->details;
+	multi_core_data_t *mc_ptr = detail_ptr->mc_ptr;
+	node_set_cache_t *cache_ptr = node_set_cache;
+	int i;
+
+	/* Partitions may change later within the same second without
+	 * changing last_part_update, so only cache tables built after that
+	 * second */
+	if ((build_time <= last_part_update) ||
+	    (node_set_cache_part_update != last_part_update))
+		return;
+
+	for (i = 1; i < NODE_SET_CACHE_SIZE; i++) {
+		if (!cache_ptr->part_ptr)
+			break;
+		if (!node_set_cache[i].part_ptr ||
+		    (node_set_cache[i].last_use < cache_ptr->last_use))
+			cache_ptr = &node_set_cache[i];
+	}
+	xfree(cache_ptr->features);
+	xfree(cache_ptr->err_msg);
+	_node_set_free(cache_ptr->node_set_ptr, cache_ptr->node_set_size);
+
+	cache_ptr->part_ptr = job_ptr->part_ptr;
+	cache_ptr->features = xstrdup(detail_ptr->features);
+	cache_ptr->pn_min_cpus = detail_ptr->pn_min_cpus;
+	cache_ptr->pn_min_memory = detail_ptr->pn_min_memory;
+	cache_ptr->pn_min_tmp_disk = detail_ptr->pn_min_tmp_disk;
+	cache_ptr->ntasks_per_core = _get_ntasks_per_core(detail_ptr);
+	cache_ptr->have_mc = (mc_ptr != NULL);
+	if (mc_ptr) {
+		cache_ptr->sockets_per_node = mc_ptr->sockets_per_node;
+		cache_ptr->cores_per_socket = mc_ptr->cores_per_socket;
+		cache_ptr->threads_per_core = mc_ptr->threads_per_core;
+	}
+	cache_ptr->err_msg = xstrdup(err_msg);
+	cache_ptr->last_use = ++node_set_cache_use;
+	cache_ptr->max_weight = max_weight;
+	cache_ptr->node_set_ptr = _node_set_copy(node_set_ptr, node_set_size);
+	cache_ptr->node_set_size = node_set_size;
+}
+
+/*
+ * purge_node_set_cache - discard the node_set tables cached by
+ *	select_nodes(), to be called whenever node configuration records
+ *	or their features change
+ * NOTE: Caller must hold the slurmctld node write lock
+ */
+extern void purge_node_set_cache(void)
+{
+	node_set_cache_t *cache_ptr;
+	int i;
+
+	for (i = 0, cache_ptr = node_set_cache; i < NODE_SET_CACHE_SIZE;
+	     i++, cache_ptr++) {
+		if (!cache_ptr->part_ptr)
+			continue;
+		xfree(cache_ptr->features);
+		xfree(cache_ptr->err_msg);
+		_node_set_free(cache_ptr->node_set_ptr,
+			       cache_ptr->node_set_size);
+		cache_ptr->node_set_ptr = NULL;
+		cache_ptr->node_set_size = 0;
+		cache_ptr->part_ptr = NULL;
+	}
+}
+
 static void _set_err_msg(bool cpus_ok, bool mem_ok, bool disk_ok,
 			 bool job_mc_ok, char **err_msg)
 {
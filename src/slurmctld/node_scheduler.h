@@ -68,6 +68,14 @@ extern void build_node_details(struct job_record *job_ptr, bool new_alloc);
 extern void deallocate_nodes(struct job_record *job_ptr, bool timeout,
 		bool suspended, bool preempted);
 
+/*
+ * purge_node_set_cache - discard the node_set tables cached by
+ *	select_nodes(), to be called whenever node configuration records
+ *	or their features change
+ * NOTE: Caller must hold the slurmctld node write lock
+ */
+extern void purge_node_set_cache(void);
+
 /*
  * re_kill_job - for a given job, deallocate its nodes for a second time,
  *	basically a cleanup for failed deallocate() calls
@@ -890,40 +890,17 @@ int list_find_part(void *part_entry, void *key)
 	return 0;
 }
 
-/* part_filter_set - Set the partition's hidden flag based upon a user's
- * group access. This must be followed by a call to part_filter_clear() */
-extern void part_filter_set(uid_t uid)
+/* part_is_visible - determine if a partition is visible to a user, i.e. it
+ * is not hidden and the user has group access to it */
+extern bool part_is_visible(struct part_record *part_ptr, uid_t uid)
 {
-	struct part_record *part_ptr;
-	ListIterator part_iterator;
-
-	part_iterator = list_iterator_create(part_list);
-	while ((part_ptr = (struct part_record *) list_next(part_iterator))) {
-		if (part_ptr->flags & PART_FLAG_HIDDEN)
-			continue;
-		if (validate_group (part_ptr, uid) == 0) {
-			part_ptr->flags |= PART_FLAG_HIDDEN;
-			part_ptr->flags |= PART_FLAG_HIDDEN_CLR;
-		}
-	}
-	list_iterator_destroy(part_iterator);
-}
-
-/* part_filter_clear - Clear the partition's hidden flag based upon a user's
- * group access. This must follow a call to part_filter_set() */
-extern void part_filter_clear(void)
-{
-	struct part_record *part_ptr;
-	ListIterator part_iterator;
+	xassert(part_ptr);
 
-	part_iterator = list_iterator_create(part_list);
-	while ((part_ptr = (struct part_record *) list_next(part_iterator))) {
-		if (part_ptr->flags & PART_FLAG_HIDDEN_CLR) {
-			part_ptr->flags &= (~PART_FLAG_HIDDEN);
-			part_ptr->flags &= (~PART_FLAG_HIDDEN_CLR);
-		}
-	}
-	list_iterator_destroy(part_iterator);
+	if (part_ptr->flags & PART_FLAG_HIDDEN)
+		return false;
+	if (validate_group(part_ptr, uid) == 0)
+		return false;
+	return true;
 }
 
 /*
@@ -963,8 +940,7 @@ extern void pack_all_part(char **buffer_ptr, int *buffer_size,
 	while ((part_ptr = (struct part_record *) list_next(part_iterator))) {
 		xassert (part_ptr->magic == PART_MAGIC);
 		if (((show_flags & SHOW_ALL) == 0) && (uid != 0) &&
-		    ((part_ptr->flags & PART_FLAG_HIDDEN)
-		     || (validate_group (part_ptr, uid) == 0)))
+		    !part_is_visible(part_ptr, uid))
 			continue;
 		pack_part(part_ptr, buffer, protocol_version);
 		parts_packed++;
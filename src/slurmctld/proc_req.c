@@ -104,6 +104,9 @@ static uint32_t *rpc_user_id = NULL;
 static uint32_t *rpc_user_cnt = NULL;
 static uint64_t *rpc_user_time = NULL;
 
+/* Job steps created per job write lock hold by REQUEST_JOB_STEP_CREATE_BULK */
+#define STEP_BULK_LOCK_CNT 64
+
 static pthread_mutex_t throttle_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t throttle_cond = PTHREAD_COND_INITIALIZER;
 
@@ -114,8 +117,10 @@ static int 	    _launch_batch_step(job_desc_msg_t *job_desc_msg,
 				       uid_t uid, uint32_t *step_id,
 				       uint16_t protocol_version);
 static int          _make_step_cred(struct step_record *step_rec,
-				    slurm_cred_t **slurm_cred,
-				    uint16_t protocol_version);
+				    slurm_cred_t **slurm_cred);
+static job_step_create_response_msg_t *_make_step_resp(
+				    struct step_record *step_ptr);
+static void         _step_cred_fail(uint32_t job_id, uint32_t step_id);
 static void         _throttle_fini(int *active_rpc_cnt);
 static void         _throttle_start(int *active_rpc_cnt);
 
@@ -153,6 +158,7 @@ inline static void  _slurm_rpc_job_ready(slurm_msg_t * msg);
 inline static void  _slurm_rpc_job_sbcast_cred(slurm_msg_t * msg);
 inline static void  _slurm_rpc_job_step_kill(slurm_msg_t * msg);
 inline static void  _slurm_rpc_job_step_create(slurm_msg_t * msg);
+inline static void  _slurm_rpc_job_step_create_bulk(slurm_msg_t * msg);
 inline static void  _slurm_rpc_job_step_get_info(slurm_msg_t * msg);
 inline static void  _slurm_rpc_job_will_run(slurm_msg_t * msg);
 inline static void  _slurm_rpc_job_alloc_info(slurm_msg_t * msg);
@@ -330,6 +336,10 @@ void slurmctld_req(slurm_msg_t *msg, connection_arg_t *arg)
 		_slurm_rpc_job_step_create(msg);
 		slurm_free_job_step_create_request_msg(msg->data);
 		break;
+	case REQUEST_JOB_STEP_CREATE_BULK:
+		_slurm_rpc_job_step_create_bulk(msg);
+		slurm_free_job_step_create_bulk_request_msg(msg->data);
+		break;
 	case REQUEST_JOB_STEP_INFO:
 		_slurm_rpc_job_step_get_info(msg);
 		slurm_free_job_step_info_request_msg(msg->data);
@@ -901,9 +911,11 @@ static void _kill_job_on_msg_fail(uint32_t job_id)
 	unlock_slurmctld(job_write_lock);
 }
 
-/* create a credential for a given job step, return error code */
+/* create a credential for a given job step, return error code
+ * NOTE: The credential is not signed, sign it using slurm_cred_sign() once
+ * the slurmctld locks have been released */
 static int _make_step_cred(struct step_record *step_ptr,
-			   slurm_cred_t **slurm_cred, uint16_t protocol_version)
+			   slurm_cred_t **slurm_cred)
 {
 	slurm_cred_arg_t cred_arg;
 	struct job_record* job_ptr = step_ptr->job_ptr;
@@ -939,8 +951,8 @@ static int _make_step_cred(struct step_record *step_ptr,
 	cred_arg.sockets_per_node    = job_resrcs_ptr->sockets_per_node;
 	cred_arg.sock_core_rep_count = job_resrcs_ptr->sock_core_rep_count;
 
-	*slurm_cred = slurm_cred_create(slurmctld_config.cred_ctx, &cred_arg,
-					protocol_version);
+	*slurm_cred = slurm_cred_create_unsigned(slurmctld_config.cred_ctx,
+						 &cred_arg);
 	if (*slurm_cred == NULL) {
 		error("slurm_cred_create error");
 		return ESLURM_INVALID_JOB_CREDENTIAL;
@@ -949,6 +961,65 @@ static int _make_step_cred(struct step_record *step_ptr,
 	return SLURM_SUCCESS;
 }
 
+/* Build a job step create response from copies of the step record's
+ * fields, so it remains valid once the job lock is released and the step
+ * record possibly freed. The credential is added by the caller.
+ * NOTE: free using slurm_free_job_step_create_response_msg() */
+static job_step_create_response_msg_t *_make_step_resp(
+				struct step_record *step_ptr)
+{
+	job_step_create_response_msg_t *resp;
+	Buf buffer;
+
+	resp = xmalloc(sizeof(job_step_create_response_msg_t));
+	resp->job_step_id = step_ptr->step_id;
+	resp->resv_ports  = xstrdup(step_ptr->resv_ports);
+	resp->step_layout = slurm_step_layout_copy(step_ptr->step_layout);
+#ifdef HAVE_FRONT_END
+	if (step_ptr->job_ptr->batch_host) {
+		xfree(resp->step_layout->front_end);
+		resp->step_layout->front_end =
+			xstrdup(step_ptr->job_ptr->batch_host);
+	}
+#endif
+	resp->select_jobinfo =
+		select_g_select_jobinfo_copy(step_ptr->select_jobinfo);
+
+	/* The switch plugins have no copy operation */
+	if (step_ptr->switch_job) {
+		buffer = init_buf(BUF_SIZE);
+		switch_g_pack_jobinfo(step_ptr->switch_job, buffer,
+				      SLURM_PROTOCOL_VERSION);
+		set_buf_offset(buffer, 0);
+		switch_g_alloc_jobinfo(&resp->switch_job,
+				       step_ptr->job_ptr->job_id,
+				       step_ptr->step_id);
+		if (switch_g_unpack_jobinfo(resp->switch_job, buffer,
+					    SLURM_PROTOCOL_VERSION)) {
+			error("switch_g_unpack_jobinfo: %m");
+			switch_g_free_jobinfo(resp->switch_job);
+			resp->switch_job = NULL;
+		}
+		free_buf(buffer);
+	}
+
+	return resp;
+}
+
+/* Remove a job step created by step_create() whose credential could not be
+ * signed. Nothing can run it, so release its resources now.
+ * NOTE: Caller must hold the job and node write locks */
+static void _step_cred_fail(uint32_t job_id, uint32_t step_id)
+{
+	int rc;
+
+	rc = job_step_complete(job_id, step_id, getuid(), false, 0);
+	if (rc != SLURM_SUCCESS) {
+		error("unable to remove step %u.%u: %s",
+		      job_id, step_id, slurm_strerror(rc));
+	}
+}
+
 /* _slurm_rpc_allocate_resources:  process RPC to allocate resources for
  *	a job */
 static void _slurm_rpc_allocate_resources(slurm_msg_t * msg)
@@ -1167,9 +1238,9 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 	slurm_msg_t response_msg;
 	job_info_request_msg_t *job_info_request_msg =
 		(job_info_request_msg_t *) msg->data;
-	/* Locks: Read config job, write node (for hiding) */
+	/* Locks: Read config, job and partition (for filtering) */
 	slurmctld_lock_t job_read_lock = {
-		READ_LOCK, READ_LOCK, NO_LOCK, WRITE_LOCK };
+		READ_LOCK, READ_LOCK, NO_LOCK, READ_LOCK };
 	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
 
 	START_TIMER;
@@ -1202,7 +1273,7 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 
 		/* send message */
 		slurm_send_node_msg(msg->conn_fd, &response_msg);
-		xfree(dump);
+		pack_all_jobs_free(dump);
 	}
 }
 
@@ -1215,9 +1286,9 @@ static void _slurm_rpc_dump_jobs_user(slurm_msg_t * msg)
 	slurm_msg_t response_msg;
 	job_user_id_msg_t *job_info_request_msg =
 		(job_user_id_msg_t *) msg->data;
-	/* Locks: Read config job, write node (for hiding) */
+	/* Locks: Read config, job and partition (for filtering) */
 	slurmctld_lock_t job_read_lock = {
-		READ_LOCK, READ_LOCK, NO_LOCK, WRITE_LOCK };
+		READ_LOCK, READ_LOCK, NO_LOCK, READ_LOCK };
 	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
 
 	START_TIMER;
@@ -1244,7 +1315,7 @@ static void _slurm_rpc_dump_jobs_user(slurm_msg_t * msg)
 
 	/* send message */
 	slurm_send_node_msg(msg->conn_fd, &response_msg);
-	xfree(dump);
+	pack_all_jobs_free(dump);
 }
 
 /* _slurm_rpc_dump_job_single - process RPC for one job's state information */
@@ -1436,9 +1507,9 @@ static void _slurm_rpc_dump_nodes(slurm_msg_t * msg)
 	node_info_request_msg_t *node_req_msg =
 		(node_info_request_msg_t *) msg->data;
 	/* Locks: Read config, write node (reset allocated CPU count in some
-	 * select plugins) */
+	 * select plugins), read partition (for filtering) */
 	slurmctld_lock_t node_write_lock = {
-		READ_LOCK, NO_LOCK, WRITE_LOCK, NO_LOCK };
+		READ_LOCK, NO_LOCK, WRITE_LOCK, READ_LOCK };
 	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
 
 	START_TIMER;
@@ -1493,9 +1564,9 @@ static void _slurm_rpc_dump_node_single(slurm_msg_t * msg)
 	slurm_msg_t response_msg;
 	node_info_single_msg_t *node_req_msg =
 		(node_info_single_msg_t *) msg->data;
-	/* Locks: Read config, read node */
+	/* Locks: Read config, node and partition (for filtering) */
 	slurmctld_lock_t node_read_lock = {
-		READ_LOCK, NO_LOCK, READ_LOCK, NO_LOCK };
+		READ_LOCK, NO_LOCK, READ_LOCK, READ_LOCK };
 	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
 
 	START_TIMER;
@@ -2069,13 +2140,16 @@ static void _slurm_rpc_job_step_create(slurm_msg_t * msg)
 	DEF_TIMERS;
 	slurm_msg_t resp;
 	struct step_record *step_rec;
-	job_step_create_response_msg_t job_step_resp;
+	job_step_create_response_msg_t *job_step_resp;
 	job_step_create_request_msg_t *req_step_msg =
 		(job_step_create_request_msg_t *) msg->data;
 	slurm_cred_t *slurm_cred = (slurm_cred_t *) NULL;
 	/* Locks: Write jobs, read nodes */
 	slurmctld_lock_t job_write_lock = {
 		NO_LOCK, WRITE_LOCK, READ_LOCK, NO_LOCK };
+	/* Locks: Write jobs, write nodes (to remove unsigned steps) */
+	slurmctld_lock_t step_fail_lock = {
+		NO_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK };
 	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
 
 	START_TIMER;
@@ -2106,8 +2180,7 @@ static void _slurm_rpc_job_step_create(slurm_msg_t * msg)
 	error_code = step_create(req_step_msg, &step_rec, false);
 
 	if (error_code == SLURM_SUCCESS) {
-		error_code = _make_step_cred(step_rec, &slurm_cred,
-					     msg->protocol_version);
+		error_code = _make_step_cred(step_rec, &slurm_cred);
 		ext_sensors_g_get_stepstartdata(step_rec);
 	}
 	END_TIMER2("_slurm_rpc_job_step_create");
@@ -2126,40 +2199,198 @@ static void _slurm_rpc_job_step_create(slurm_msg_t * msg)
 		}
 		slurm_send_rc_msg(msg, error_code);
 	} else {
-		slurm_step_layout_t *layout = step_rec->step_layout;
-
 		info("sched: _slurm_rpc_job_step_create: StepId=%u.%u %s %s",
 		     step_rec->job_ptr->job_id, step_rec->step_id,
 		     req_step_msg->node_list, TIME_STR);
 
-		job_step_resp.job_step_id = step_rec->step_id;
-		job_step_resp.resv_ports  = step_rec->resv_ports;
-		job_step_resp.step_layout = layout;
-#ifdef HAVE_FRONT_END
-		if (step_rec->job_ptr->batch_host) {
-			job_step_resp.step_layout->front_end =
-				xstrdup(step_rec->job_ptr->batch_host);
-		}
-#endif
-		job_step_resp.cred           = slurm_cred;
-		job_step_resp.select_jobinfo = step_rec->select_jobinfo;
-		job_step_resp.switch_job     = step_rec->switch_job;
+		/* The step record may change or be freed once the job lock
+		 * is released, so respond with copies of its fields */
+		job_step_resp = _make_step_resp(step_rec);
 
 		unlock_slurmctld(job_write_lock);
 		_throttle_fini(&active_rpc_cnt);
+		if (slurm_cred_sign(slurmctld_config.cred_ctx, &slurm_cred, 1,
+				    msg->protocol_version)) {
+			error("_slurm_rpc_job_step_create for job %u: "
+			      "credential sign failure",
+			      req_step_msg->job_id);
+			lock_slurmctld(step_fail_lock);
+			_step_cred_fail(req_step_msg->job_id,
+					job_step_resp->job_step_id);
+			unlock_slurmctld(step_fail_lock);
+			slurm_free_job_step_create_response_msg(job_step_resp);
+			slurm_send_rc_msg(msg, ESLURM_INVALID_JOB_CREDENTIAL);
+			return;
+		}
+		job_step_resp->cred = slurm_cred;
+
 		slurm_msg_t_init(&resp);
 		resp.flags = msg->flags;
 		resp.protocol_version = msg->protocol_version;
 		resp.address = msg->address;
 		resp.msg_type = RESPONSE_JOB_STEP_CREATE;
-		resp.data = &job_step_resp;
+		resp.data = job_step_resp;
 
 		slurm_send_node_msg(msg->conn_fd, &resp);
-		slurm_cred_destroy(slurm_cred);
+		slurm_free_job_step_create_response_msg(job_step_resp);
 		schedule_job_save();	/* Sets own locks */
 	}
 }
 
+/* _slurm_rpc_job_step_create_bulk - process RPC to create/register several
+ *	job steps with the step_mgr. The job write lock is released after
+ *	every STEP_BULK_LOCK_CNT steps. All steps are returned in a single
+ *	response with a return code for each step. */
+static void _slurm_rpc_job_step_create_bulk(slurm_msg_t * msg)
+{
+	static int active_rpc_cnt = 0;
+	int error_code = SLURM_SUCCESS;
+	uint32_t i, step_cnt, success_cnt = 0;
+	DEF_TIMERS;
+	slurm_msg_t resp;
+	struct step_record *step_rec;
+	job_step_create_bulk_response_msg_t bulk_resp;
+	job_step_create_bulk_request_msg_t *req_bulk_msg =
+		(job_step_create_bulk_request_msg_t *) msg->data;
+	job_step_create_request_msg_t *req_step_msg;
+	slurm_cred_t *slurm_cred, **step_cred;
+	/* Locks: Write jobs, read nodes */
+	slurmctld_lock_t job_write_lock = {
+		NO_LOCK, WRITE_LOCK, READ_LOCK, NO_LOCK };
+	/* Locks: Write jobs, write nodes (to remove unsigned steps) */
+	slurmctld_lock_t step_fail_lock = {
+		NO_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK };
+	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
+
+	START_TIMER;
+	debug2("Processing RPC: REQUEST_JOB_STEP_CREATE_BULK from uid=%d", uid);
+
+	step_cnt = req_bulk_msg->step_cnt;
+	for (i = 0; i < step_cnt; i++) {
+		req_step_msg = req_bulk_msg->step_req[i];
+		dump_step_desc(req_step_msg);
+		if (uid && (uid != req_step_msg->user_id)) {
+			error("Security violation, JOB_STEP_CREATE_BULK RPC "
+			      "from uid=%d to run as uid %u",
+			      uid, req_step_msg->user_id);
+			slurm_send_rc_msg(msg, ESLURM_USER_ID_MISSING);
+			return;
+		}
+	}
+
+#if defined HAVE_FRONT_END && !defined HAVE_BGQ	&& !defined HAVE_ALPS_CRAY
+	/* Limited job step support */
+	/* Non-super users not permitted to run job steps on front-end.
+	 * A single slurmd can not handle a heavy load. */
+	if (!validate_slurm_user(uid)) {
+		info("Attempt to execute job step by uid=%d", uid);
+		slurm_send_rc_msg(msg, ESLURM_NO_STEPS);
+		return;
+	}
+#endif
+
+	memset(&bulk_resp, 0, sizeof(job_step_create_bulk_response_msg_t));
+	bulk_resp.step_cnt   = step_cnt;
+	bulk_resp.error_code = xmalloc(sizeof(uint32_t) * step_cnt);
+	bulk_resp.step_resp  = xmalloc(sizeof(job_step_create_response_msg_t *)
+				       * step_cnt);
+	step_cred = xmalloc(sizeof(slurm_cred_t *) * step_cnt);
+
+	_throttle_start(&active_rpc_cnt);
+	lock_slurmctld(job_write_lock);
+	step_slot_cache_begin();
+	for (i = 0; i < step_cnt; i++) {
+		if (i && ((i % STEP_BULK_LOCK_CNT) == 0)) {
+			/* Let other RPCs in between groups of steps */
+			step_slot_cache_end();
+			unlock_slurmctld(job_write_lock);
+			lock_slurmctld(job_write_lock);
+			step_slot_cache_begin();
+		}
+		req_step_msg = req_bulk_msg->step_req[i];
+		slurm_cred = NULL;
+		error_code = step_create(req_step_msg, &step_rec, false);
+		if (error_code == SLURM_SUCCESS) {
+			error_code = _make_step_cred(step_rec, &slurm_cred);
+			ext_sensors_g_get_stepstartdata(step_rec);
+		}
+		bulk_resp.error_code[i] = error_code;
+		if (error_code) {
+			if ((error_code == ESLURM_PROLOG_RUNNING) ||
+			    (error_code == ESLURM_DISABLED)) {
+				debug("_slurm_rpc_job_step_create_bulk for "
+				      "job %u: %s", req_step_msg->job_id,
+				      slurm_strerror(error_code));
+			} else {
+				info("_slurm_rpc_job_step_create_bulk for "
+				     "job %u: %s", req_step_msg->job_id,
+				     slurm_strerror(error_code));
+			}
+			continue;
+		}
+
+		info("sched: _slurm_rpc_job_step_create_bulk: StepId=%u.%u %s",
+		     step_rec->job_ptr->job_id, step_rec->step_id,
+		     req_step_msg->node_list);
+
+		bulk_resp.step_resp[i] = _make_step_resp(step_rec);
+		step_cred[i] = slurm_cred;
+		success_cnt++;
+	}
+	step_slot_cache_end();
+	unlock_slurmctld(job_write_lock);
+	_throttle_fini(&active_rpc_cnt);
+
+	/* Sign all of the credentials at once, outside of the locks */
+	if (success_cnt &&
+	    slurm_cred_sign(slurmctld_config.cred_ctx, step_cred, step_cnt,
+			    msg->protocol_version)) {
+		error("_slurm_rpc_job_step_create_bulk: "
+		      "credential sign failure");
+		lock_slurmctld(step_fail_lock);
+		for (i = 0; i < step_cnt; i++) {
+			if (bulk_resp.step_resp[i] && !step_cred[i]) {
+				_step_cred_fail(
+					req_bulk_msg->step_req[i]->job_id,
+					bulk_resp.step_resp[i]->job_step_id);
+			}
+		}
+		unlock_slurmctld(step_fail_lock);
+	}
+	for (i = 0; i < step_cnt; i++) {
+		if (!bulk_resp.step_resp[i])
+			continue;
+		if (!step_cred[i]) {
+			slurm_free_job_step_create_response_msg(
+				bulk_resp.step_resp[i]);
+			bulk_resp.step_resp[i] = NULL;
+			bulk_resp.error_code[i] = ESLURM_INVALID_JOB_CREDENTIAL;
+			success_cnt--;
+			continue;
+		}
+		bulk_resp.step_resp[i]->cred = step_cred[i];
+	}
+	xfree(step_cred);
+	END_TIMER2("_slurm_rpc_job_step_create_bulk");
+	debug("_slurm_rpc_job_step_create_bulk: created %u of %u steps %s",
+	      success_cnt, step_cnt, TIME_STR);
+
+	slurm_msg_t_init(&resp);
+	resp.flags = msg->flags;
+	resp.protocol_version = msg->protocol_version;
+	resp.address = msg->address;
+	resp.msg_type = RESPONSE_JOB_STEP_CREATE_BULK;
+	resp.data = &bulk_resp;
+	slurm_send_node_msg(msg->conn_fd, &resp);
+
+	for (i = 0; i < step_cnt; i++)
+		slurm_free_job_step_create_response_msg(bulk_resp.step_resp[i]);
+	xfree(bulk_resp.step_resp);
+	xfree(bulk_resp.error_code);
+	if (success_cnt)
+		schedule_job_save();	/* Sets own locks */
+}
+
 /* _slurm_rpc_job_step_get_info - process request for job step info */
 static void _slurm_rpc_job_step_get_info(slurm_msg_t * msg)
 {
@@ -2169,9 +2400,9 @@ static void _slurm_rpc_job_step_get_info(slurm_msg_t * msg)
 	int error_code = SLURM_SUCCESS;
 	job_step_info_request_msg_t *request =
 		(job_step_info_request_msg_t *) msg->data;
-	/* Locks: Read config, job, write partition (for filtering) */
+	/* Locks: Read config, job and partition (for filtering) */
 	slurmctld_lock_t job_read_lock = {
-		READ_LOCK, READ_LOCK, NO_LOCK, WRITE_LOCK };
+		READ_LOCK, READ_LOCK, NO_LOCK, READ_LOCK };
 	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
 
 	START_TIMER;
@@ -4302,7 +4533,9 @@ static int _launch_batch_step(job_desc_msg_t *job_desc_msg, uid_t uid,
 						pn_min_memory;
 	}
 
-	if (make_batch_job_cred(launch_msg_ptr, job_ptr, protocol_version)) {
+	if (make_batch_job_cred(launch_msg_ptr, job_ptr, protocol_version) ||
+	    slurm_cred_sign(slurmctld_config.cred_ctx, &launch_msg_ptr->cred, 1,
+			    protocol_version)) {
 		error("aborting batch step %u.%u", job_ptr->job_id,
 		      job_ptr->group_id);
 		xfree(launch_msg_ptr->nodes);
@@ -4978,13 +5211,21 @@ inline static void _slurm_rpc_dump_stats(slurm_msg_t * msg)
 	if (request_msg->command_id == STAT_COMMAND_RESET) {
 		reset_stats(1);
 		_clear_rpc_stats();
+		reset_lock_stats();
+		reset_rpc_queue_stats();
 		pack_all_stat(0, &dump, &dump_size, msg->protocol_version);
 		_pack_rpc_stats(0, &dump, &dump_size, msg->protocol_version);
+		pack_lock_stats(&dump, &dump_size, msg->protocol_version);
+		pack_rpc_queue_stats(&dump, &dump_size,
+				     msg->protocol_version);
 		response_msg.data = dump;
 		response_msg.data_size = dump_size;
 	} else {
 		pack_all_stat(1, &dump, &dump_size, msg->protocol_version);
 		_pack_rpc_stats(1, &dump, &dump_size, msg->protocol_version);
+		pack_lock_stats(&dump, &dump_size, msg->protocol_version);
+		pack_rpc_queue_stats(&dump, &dump_size,
+				     msg->protocol_version);
 		response_msg.data = dump;
 		response_msg.data_size = dump_size;
 	}
@@ -108,6 +108,7 @@ static int  _preserve_plugins(slurm_ctl_conf_t * ctl_conf_ptr,
 			      char *old_crypto_type, char *old_sched_type,
 			      char *old_select_type, char *old_switch_type,
 			      char *old_bb_type);
+static void _phase_time(struct timeval *tv, char **phase_str, char *phase);
 static void _purge_old_node_state(struct node_record *old_node_table_ptr,
 				int old_node_record_count);
 static void _purge_old_part_state(List old_part_list, char *old_def_part_name);
@@ -861,11 +862,14 @@ int read_slurm_conf(int recover, bool reconfig)
 	char *old_select_type     = xstrdup(slurmctld_conf.select_type);
 	char *old_switch_type     = xstrdup(slurmctld_conf.switch_type);
 	char *state_save_dir      = xstrdup(slurmctld_conf.state_save_location);
-	char *mpi_params;
+	char *mpi_params, *phase_str = NULL;
 	uint16_t old_select_type_p = slurmctld_conf.select_type_param;
+	struct timeval phase_tv;
 
 	/* initialization */
 	START_TIMER;
+	gettimeofday(&phase_tv, NULL);
+	purge_node_set_cache();	/* config records are rebuilt below */
 
 	if (reconfig) {
 		/* in order to re-use job state information,
@@ -977,6 +981,7 @@ int read_slurm_conf(int recover, bool reconfig)
 	 */
 	if (!reconfig && (slurm_layouts_load_config() != SLURM_SUCCESS))
 		fatal("Failed to load the layouts framework configuration");
+	_phase_time(&phase_tv, &phase_str, "config");
 
 	if (reconfig) {		/* Preserve state from memory */
 		if (old_node_table_ptr) {
@@ -1019,6 +1024,7 @@ int read_slurm_conf(int recover, bool reconfig)
 		load_job_ret = load_all_job_state();
 		sync_job_priorities();
 	}
+	_phase_time(&phase_tv, &phase_str, "state_files");
 
 	_sync_part_prio();
 	_build_bitmaps_pre_select();
@@ -1033,9 +1039,12 @@ int read_slurm_conf(int recover, bool reconfig)
 	xfree(state_save_dir);
 	_gres_reconfig(reconfig);
 	reset_job_bitmaps();		/* must follow select_g_job_init() */
+	_phase_time(&phase_tv, &phase_str, "select_init");
 
 	(void) _sync_nodes_to_jobs();
+	_phase_time(&phase_tv, &phase_str, "sync_nodes");
 	(void) sync_job_files();
+	_phase_time(&phase_tv, &phase_str, "job_files");
 	_purge_old_node_state(old_node_table_ptr, old_node_record_count);
 	_purge_old_part_state(old_part_list, old_def_part_name);
 
@@ -1052,7 +1061,9 @@ int read_slurm_conf(int recover, bool reconfig)
 
 	/* NOTE: Run restore_node_features before _restore_job_dependencies */
 	restore_node_features(recover);
+	_phase_time(&phase_tv, &phase_str, "bitmaps");
 	_restore_job_dependencies();
+	_phase_time(&phase_tv, &phase_str, "dependencies");
 #ifdef 	HAVE_ELAN
 	_validate_node_proc_count();
 #endif
@@ -1069,6 +1080,8 @@ int read_slurm_conf(int recover, bool reconfig)
 		}
 	}
 
+	_phase_time(&phase_tv, &phase_str, "resv_triggers");
+
 	/* sort config_list by weight for scheduling */
 	list_sort(config_list, &list_compare_config);
 
@@ -1110,12 +1123,33 @@ int read_slurm_conf(int recover, bool reconfig)
 
 	/* Sync select plugin with synchronized job/node/part data */
 	select_g_reconfigure();
+	_phase_time(&phase_tv, &phase_str, "plugins");
 
 	slurmctld_conf.last_update = time(NULL);
 	END_TIMER2("read_slurm_conf");
+	if (reconfig)
+		debug("read_slurm_conf: %s %s", TIME_STR, phase_str);
+	else
+		info("read_slurm_conf: %s %s", TIME_STR, phase_str);
+	xfree(phase_str);
 	return error_code;
 }
 
+/* Append the time elapsed since tv to phase_str as "phase=usec" and
+ * reset tv to the current time, for a breakdown of read_slurm_conf() */
+static void _phase_time(struct timeval *tv, char **phase_str, char *phase)
+{
+	struct timeval now;
+	long delta_t;
+
+	gettimeofday(&now, NULL);
+	delta_t  = (now.tv_sec - tv->tv_sec) * 1000000;
+	delta_t += now.tv_usec - tv->tv_usec;
+	xstrfmtcat(*phase_str, "%s%s=%ld", *phase_str ? " " : "", phase,
+		   delta_t);
+	*tv = now;
+}
+
 static void _gres_reconfig(bool reconfig)
 {
 	struct node_record *node_ptr;
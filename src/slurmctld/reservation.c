@@ -94,11 +94,35 @@ typedef struct resv_thread_args {
 	char *resv_name;
 } resv_thread_args_t;
 
+/* Reservation time window in the index used by job_test_resv(). Records are
+ * sorted by start time and form an implicit balanced binary tree (the root
+ * of each range of records is its middle one), each recording the latest
+ * end time in its subtree, so the reservations overlapping some time window
+ * are found in O(log n + m) time. */
+typedef struct resv_index_rec {
+	slurmctld_resv_t *resv_ptr;
+	time_t start_time;
+	time_t end_time;
+	time_t max_end_time;	/* latest end_time in subtree */
+	int list_inx;		/* position in resv_list */
+} resv_index_rec_t;
+
 time_t    last_resv_update = (time_t) 0;
 List      resv_list = (List) NULL;
 uint32_t  resv_over_run;
 uint32_t  top_suffix = 0;
 
+static resv_index_rec_t *resv_index = NULL;
+static int		resv_index_cnt = 0;
+static slurmctld_resv_t **resv_index_list = NULL; /* resv_list order */
+static int		resv_index_list_cnt = 0;
+static int		*resv_index_float = NULL; /* list_inx of TIME_FLOAT */
+static int		resv_index_float_cnt = 0;
+static time_t		resv_index_time = (time_t) 0;	/* build time */
+static time_t		resv_index_advance = (time_t) 0; /* next recurring
+							  * reservation end */
+static pthread_mutex_t	resv_index_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 #ifdef HAVE_BG
 uint32_t  cpu_mult = 0;
 uint32_t  cnodes_per_mp = 0;
@@ -144,6 +168,13 @@ static int  _post_resv_update(slurmctld_resv_t *resv_ptr,
 static int  _resize_resv(slurmctld_resv_t *resv_ptr, uint32_t node_cnt);
 static void _restore_resv(slurmctld_resv_t *dest_resv,
 			  slurmctld_resv_t *src_resv);
+static void _resv_index_build(time_t now);
+static int  _resv_index_find(time_t start_time, time_t end_time,
+			     slurmctld_resv_t ***resv_array);
+static time_t _resv_index_max(int first, int last);
+static void _resv_index_purge(void);
+static void _resv_index_scan(int first, int last, time_t start_time,
+			     time_t end_time, bitstr_t *hits);
 static bool _resv_overlap(time_t start_time, time_t end_time,
 			  uint32_t flags, bitstr_t *node_bitmap,
 			  slurmctld_resv_t *this_resv_ptr);
@@ -355,6 +386,7 @@ static void _del_resv_rec(void *x)
 
 	if (resv_ptr) {
 		xassert(resv_ptr->magic == RESV_MAGIC);
+		_resv_index_purge();
 		resv_ptr->magic = 0;
 		xfree(resv_ptr->accounts);
 		for (i=0; i<resv_ptr->account_cnt; i++)
@@ -2038,6 +2070,12 @@ extern void resv_fini(void)
 		list_destroy(resv_list);
 		resv_list = (List) NULL;
 	}
+	slurm_mutex_lock(&resv_index_mutex);
+	xfree(resv_index);
+	xfree(resv_index_list);
+	xfree(resv_index_float);
+	resv_index_cnt = resv_index_list_cnt = resv_index_float_cnt = 0;
+	slurm_mutex_unlock(&resv_index_mutex);
 }
 
 /* Update an exiting resource reservation */
@@ -3604,10 +3642,12 @@ static bitstr_t *_pick_idle_node_cnt(bitstr_t *avail_bitmap,
 				continue;
 			if (job_ptr->end_time < resv_desc_ptr->start_time)
 				continue;
-			tmp_bitmap = bit_copy(orig_bitmap);
-			bit_and(tmp_bitmap, job_ptr->node_bitmap);
-			if (bit_set_count(tmp_bitmap) > 0)
+			if (bit_overlap_any(orig_bitmap,
+					    job_ptr->node_bitmap)) {
+				tmp_bitmap = bit_copy(orig_bitmap);
+				bit_and(tmp_bitmap, job_ptr->node_bitmap);
 				bit_or(avail_bitmap, tmp_bitmap);
+			}
 			total_node_cnt = bit_set_count(avail_bitmap);
 			if (total_node_cnt >= node_cnt) {
 				save_bitmap = bit_copy(avail_bitmap);
@@ -3923,6 +3963,158 @@ extern int job_test_lic_resv(struct job_record *job_ptr, char *lic_name,
 	return resv_cnt;
 }
 
+/* Discard the reservation index, it is rebuilt when next needed */
+static void _resv_index_purge(void)
+{
+	resv_index_time = (time_t) 0;
+}
+
+static int _resv_index_sort(const void *x, const void *y)
+{
+	const resv_index_rec_t *rec1 = (const resv_index_rec_t *) x;
+	const resv_index_rec_t *rec2 = (const resv_index_rec_t *) y;
+
+	if (rec1->start_time < rec2->start_time)
+		return -1;
+	if (rec1->start_time > rec2->start_time)
+		return 1;
+	return 0;
+}
+
+/* Set max_end_time for the subtree of index records first through last-1,
+ * RET its value */
+static time_t _resv_index_max(int first, int last)
+{
+	int mid;
+	time_t max_end_time, sub_end_time;
+
+	if (first >= last)
+		return (time_t) 0;
+	mid = (first + last) / 2;
+	max_end_time = resv_index[mid].end_time;
+	sub_end_time = _resv_index_max(first, mid);
+	max_end_time = MAX(max_end_time, sub_end_time);
+	sub_end_time = _resv_index_max(mid + 1, last);
+	max_end_time = MAX(max_end_time, sub_end_time);
+	resv_index[mid].max_end_time = max_end_time;
+
+	return max_end_time;
+}
+
+/* Rebuild the reservation index. Recurring reservations which have ended
+ * are advanced first, as job_test_resv() would do when testing them.
+ * NOTE: Caller must hold resv_index_mutex */
+static void _resv_index_build(time_t now)
+{
+	ListIterator iter;
+	slurmctld_resv_t *resv_ptr;
+	resv_index_rec_t *rec;
+	int list_inx = 0;
+
+	resv_index_cnt = 0;
+	resv_index_float_cnt = 0;
+	resv_index_advance = (time_t) 0;
+	resv_index_list_cnt = list_count(resv_list);
+	xrealloc(resv_index, sizeof(resv_index_rec_t) *
+		 MAX(resv_index_list_cnt, 1));
+	xrealloc(resv_index_list, sizeof(slurmctld_resv_t *) *
+		 MAX(resv_index_list_cnt, 1));
+	xrealloc(resv_index_float, sizeof(int) * MAX(resv_index_list_cnt, 1));
+
+	iter = list_iterator_create(resv_list);
+	while ((resv_ptr = (slurmctld_resv_t *) list_next(iter))) {
+		resv_index_list[list_inx] = resv_ptr;
+		if (resv_ptr->flags & RESERVE_FLAG_TIME_FLOAT) {
+			/* times are relative to now, always test these */
+			resv_index_float[resv_index_float_cnt++] = list_inx++;
+			continue;
+		}
+		if (resv_ptr->end_time <= now)
+			_advance_resv_time(resv_ptr);
+		if ((resv_ptr->flags & (RESERVE_FLAG_DAILY |
+					RESERVE_FLAG_WEEKLY)) &&
+		    ((resv_index_advance == 0) ||
+		     (resv_ptr->end_time < resv_index_advance)))
+			resv_index_advance = resv_ptr->end_time;
+		rec = &resv_index[resv_index_cnt++];
+		rec->resv_ptr   = resv_ptr;
+		rec->start_time = MIN(resv_ptr->start_time,
+				      resv_ptr->start_time_first);
+		rec->end_time   = resv_ptr->end_time;
+		rec->list_inx   = list_inx++;
+	}
+	list_iterator_destroy(iter);
+
+	qsort(resv_index, resv_index_cnt, sizeof(resv_index_rec_t),
+	      _resv_index_sort);
+	(void) _resv_index_max(0, resv_index_cnt);
+	resv_index_time = now;
+}
+
+/* Set in hits the list_inx of index records first through last-1 which
+ * overlap the time window start_time to end_time */
+static void _resv_index_scan(int first, int last, time_t start_time,
+			     time_t end_time, bitstr_t *hits)
+{
+	int mid;
+
+	while (first < last) {
+		mid = (first + last) / 2;
+		if (resv_index[mid].max_end_time <= start_time)
+			return;		/* whole subtree ends earlier */
+		_resv_index_scan(first, mid, start_time, end_time, hits);
+		if (resv_index[mid].start_time >= end_time)
+			return;		/* this and later records start later */
+		if (resv_index[mid].end_time > start_time)
+			bit_set(hits, resv_index[mid].list_inx);
+		first = mid + 1;
+	}
+}
+
+/*
+ * _resv_index_find - find the reservations which may overlap a time window,
+ *	rebuilding the reservation index if reservations have changed
+ * IN start_time, end_time - time window
+ * OUT resv_array - reservations in resv_list order, xfree when done
+ * RET count of reservations in resv_array
+ * NOTE: Floating reservations are always returned, the caller must test
+ *	each reservation's actual times
+ */
+static int _resv_index_find(time_t start_time, time_t end_time,
+			    slurmctld_resv_t ***resv_array)
+{
+	time_t now = time(NULL);
+	bitstr_t *hits;
+	int i, resv_cnt = 0;
+
+	*resv_array = NULL;
+	slurm_mutex_lock(&resv_index_mutex);
+	/* A change in the same second as the last build does not change
+	 * last_resv_update, so only trust an index built after that */
+	if ((resv_index_time <= last_resv_update) ||
+	    (resv_index_advance && (resv_index_advance <= now)) ||
+	    (resv_index_list_cnt != list_count(resv_list)))
+		_resv_index_build(now);
+
+	if (resv_index_list_cnt) {
+		hits = bit_alloc(resv_index_list_cnt);
+		for (i = 0; i < resv_index_float_cnt; i++)
+			bit_set(hits, resv_index_float[i]);
+		_resv_index_scan(0, resv_index_cnt, start_time, end_time,
+				 hits);
+		*resv_array = xmalloc(sizeof(slurmctld_resv_t *) *
+				      resv_index_list_cnt);
+		for (i = 0; i < resv_index_list_cnt; i++) {
+			if (bit_test(hits, i))
+				(*resv_array)[resv_cnt++] = resv_index_list[i];
+		}
+		bit_free(hits);
+	}
+	slurm_mutex_unlock(&resv_index_mutex);
+
+	return resv_cnt;
+}
+
 /*
  * Determine which nodes a job can use based upon reservations
  * IN job_ptr      - job to test
@@ -3944,12 +4136,11 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
 			 bool move_time, bitstr_t **node_bitmap,
 			 bitstr_t **exc_core_bitmap, bool *resv_overlap)
 {
-	slurmctld_resv_t * resv_ptr, *res2_ptr;
+	slurmctld_resv_t * resv_ptr, *res2_ptr, **resv_array = NULL;
 	time_t job_start_time, job_end_time, lic_resv_time;
 	time_t start_relative, end_relative;
 	time_t now = time(NULL);
-	ListIterator iter;
-	int i, rc = SLURM_SUCCESS, rc2;
+	int i, j, resv_cnt, rc = SLURM_SUCCESS, rc2;
 
 	job_start_time = *when;
 	job_end_time   = *when + _get_job_duration(job_ptr);
@@ -3999,11 +4190,16 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
 
 		/* if there are any overlapping reservations, we need to
 		 * prevent the job from using those nodes (e.g. MAINT nodes) */
-		iter = list_iterator_create(resv_list);
-		while ((res2_ptr = (slurmctld_resv_t *) list_next(iter))) {
-			if ((resv_ptr->flags & RESERVE_FLAG_MAINT) ||
-			    (resv_ptr->flags & RESERVE_FLAG_OVERLAP) ||
-			    (res2_ptr == resv_ptr) ||
+		if ((resv_ptr->flags & RESERVE_FLAG_MAINT) ||
+		    (resv_ptr->flags & RESERVE_FLAG_OVERLAP))
+			resv_cnt = 0;
+		else {
+			resv_cnt = _resv_index_find(job_start_time,
+						    job_end_time, &resv_array);
+		}
+		for (j = 0; j < resv_cnt; j++) {
+			res2_ptr = resv_array[j];
+			if ((res2_ptr == resv_ptr) ||
 			    (res2_ptr->node_bitmap == NULL) ||
 			    (res2_ptr->start_time >= job_end_time) ||
 			    (res2_ptr->end_time   <= job_start_time) ||
@@ -4011,12 +4207,11 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
 				continue;
 			if (bit_overlap(*node_bitmap, res2_ptr->node_bitmap)) {
 				*resv_overlap = true;
-				bit_not(res2_ptr->node_bitmap);
-				bit_and(*node_bitmap, res2_ptr->node_bitmap);
-				bit_not(res2_ptr->node_bitmap);
+				bit_and_not(*node_bitmap,
+					    res2_ptr->node_bitmap);
 			}
 		}
-		list_iterator_destroy(iter);
+		xfree(resv_array);
 
 		if (slurmctld_conf.debug_flags & DEBUG_FLAG_RESERVATION) {
 			char *nodes = bitmap2node_name(*node_bitmap);
@@ -4060,11 +4255,12 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
 
 	/* Job has no reservation, try to find time when this can
 	 * run and get it's required nodes (if any) */
+	resv_cnt = _resv_index_find(job_start_time, job_end_time, &resv_array);
 	for (i = 0; ; i++) {
 		lic_resv_time = (time_t) 0;
 
-		iter = list_iterator_create(resv_list);
-		while ((resv_ptr = (slurmctld_resv_t *) list_next(iter))) {
+		for (j = 0; j < resv_cnt; j++) {
+			resv_ptr = resv_array[j];
 			if (resv_ptr->flags & RESERVE_FLAG_TIME_FLOAT) {
 				start_relative = resv_ptr->start_time + now;
 				if (resv_ptr->duration == INFINITE)
@@ -4115,9 +4311,8 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
 				     "will not share nodes",
 				     resv_ptr->name, job_ptr->job_id);
 #endif
-				bit_not(resv_ptr->node_bitmap);
-				bit_and(*node_bitmap, resv_ptr->node_bitmap);
-				bit_not(resv_ptr->node_bitmap);
+				bit_and_not(*node_bitmap,
+					    resv_ptr->node_bitmap);
 			} else {
 #if _DEBUG
 				info("job_test_resv: reservation %s uses "
@@ -4132,7 +4327,6 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
 				}
 			}
 		}
-		list_iterator_destroy(iter);
 
 		if ((rc == SLURM_SUCCESS) && move_time) {
 			if (license_job_test(job_ptr, job_start_time)
@@ -4155,6 +4349,7 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
 		FREE_NULL_BITMAP(*node_bitmap);
 		break;	/* Give up */
 	}
+	xfree(resv_array);
 
 	return rc;
 }
@@ -97,6 +97,11 @@
 #define MAX_SERVER_THREADS 256
 #endif
 
+/* Maximum number of accepted RPC connections, queued or being processed */
+#ifndef MAX_SERVER_CONNS
+#define MAX_SERVER_CONNS (MAX_SERVER_THREADS * 4)
+#endif
+
 /* Perform full slurmctld's state every PERIODIC_CHECKPOINT seconds */
 #ifndef PERIODIC_CHECKPOINT
 #define	PERIODIC_CHECKPOINT	300
@@ -586,9 +591,8 @@ struct job_record {
 					 * to be passed to slurmdbd */
 	uint32_t group_id;		/* group submitted under */
 	uint32_t job_id;		/* job ID */
-	struct job_record *job_next;	/* next entry with same hash index */
 	struct job_record *job_array_next_j; /* job array linked list by job_id */
-	struct job_record *job_array_next_t; /* job array linked list by task_id */
+	struct job_record *job_array_prev_j; /* job array linked list by job_id */
 	job_resources_t *job_resrcs;	/* details of allocated cores */
 	uint16_t job_state;		/* state of the job */
 	uint16_t kill_on_node_fail;	/* 1 if job should be killed on
@@ -634,6 +638,10 @@ struct job_record {
 	char *nodes_completing;		/* nodes still in completing state
 					 * for this job, used to insure
 					 * epilog is not re-run for job */
+	char *nodes_cg;			/* cached names of the nodes in
+					 * node_bitmap_cg, for job info RPCs */
+	int32_t nodes_cg_cnt;		/* node_bitmap_cg set count when
+					 * nodes_cg was built */
 	uint16_t other_port;		/* port for client communications */
 	char *partition;		/* name of job partition(s) */
 	List part_ptr_list;		/* list of pointers to partition recs */
@@ -1600,7 +1608,8 @@ extern void node_no_resp_msg(void);
  * IN filter_uid - pack only jobs belonging to this user if not NO_VAL
  * IN protocol_version - slurm protocol version of client
  * global: job_list - global list of job records
- * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
+ * NOTE: the buffer at *buffer_ptr must be released by the caller with
+ *	pack_all_jobs_free()
  * NOTE: change _unpack_job_desc_msg() in common/slurm_protocol_pack.c
  *	whenever the data format changes
  */
@@ -1608,6 +1617,14 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 			  uint16_t show_flags, uid_t uid, uint32_t filter_uid,
 			  uint16_t protocol_version);
 
+/* Release a buffer returned by pack_all_jobs() */
+extern void pack_all_jobs_free(char *buffer);
+
+/* Discard all job information buffers cached by pack_all_jobs(). Call after
+ * changing job fields reported by pack_job() without updating
+ * last_job_update, such as the expected start time of pending jobs. */
+extern void job_pack_cache_clear(void);
+
 /*
  * pack_all_node - dump all configuration and node information for all nodes
  *	in machine independent form (for network transmission)
@@ -1722,17 +1739,26 @@ extern void pack_one_node (char **buffer_ptr, int *buffer_size,
 			   uint16_t show_flags, uid_t uid, char *node_name,
 			   uint16_t protocol_version);
 
-/* part_filter_clear - Clear the partition's hidden flag based upon a user's
- * group access. This must follow a call to part_filter_set() */
-extern void part_filter_clear(void);
-
-/* part_filter_set - Set the partition's hidden flag based upon a user's
- * group access. This must be followed by a call to part_filter_clear() */
-extern void part_filter_set(uid_t uid);
+/* pack_rpc_queue_stats - Append RPC queue statistics to a buffer
+ * IN/OUT buffer_ptr - buffer built by pack_all_stat()
+ * IN/OUT buffer_size - size of buffer_ptr
+ * IN protocol_version - slurm protocol version of client */
+extern void pack_rpc_queue_stats(char **buffer_ptr, int *buffer_size,
+				 uint16_t protocol_version);
 
 /* part_fini - free all memory associated with partition records */
 extern void part_fini (void);
 
+/*
+ * part_is_visible - determine if a partition is visible to a user, i.e. it
+ *	is not hidden and the user has group access to it. The partition
+ *	record is not modified, so a partition read lock is sufficient.
+ * IN part_ptr - pointer to the partition
+ * IN uid - uid of user making request
+ * RET true if the partition should be shown to the user
+ */
+extern bool part_is_visible(struct part_record *part_ptr, uid_t uid);
+
 /*
  * Create a copy of a job's part_list *partition list
  * IN part_list_src - a job's part_list
@@ -1825,6 +1851,9 @@ extern void reset_job_bitmaps (void);
 /* Reset a node's CPU load value */
 extern void reset_node_load(char *node_name, uint32_t cpu_load);
 
+/* reset_rpc_queue_stats - Clear RPC queue statistics */
+extern void reset_rpc_queue_stats(void);
+
 /* Reset all scheduling statistics
  * level IN - clear backfilled_jobs count if set */
 extern void reset_stats(int level);
@@ -1972,6 +2001,16 @@ extern slurm_step_layout_t *step_layout_create(struct step_record *step_ptr,
 					       uint16_t task_dist,
 					       uint16_t plane_size);
 
+/*
+ * step_slot_cache_begin - start caching the nodes used by a job's running
+ *	steps across subsequent step_create() calls
+ * NOTE: the caller must hold the job write lock until step_slot_cache_end()
+ */
+extern void step_slot_cache_begin(void);
+
+/* step_slot_cache_end - stop caching and release the step slot cache */
+extern void step_slot_cache_end(void);
+
 /*
  * step_list_purge - Simple purge of a job's step list records.
  * IN job_ptr - pointer to job table entry to have step records removed
@@ -2010,8 +2049,7 @@ extern int step_partial_comp(step_complete_msg_t *req, uid_t uid,
 extern void suspend_job_step(struct job_record *job_ptr);
 
 /* For the job array data structure, build the string representation of the
- * bitmap.
- * NOTE: bit_fmt_hexmask() is far more scalable than bit_fmt(). */
+ * bitmap as a list of task ID ranges or a hex mask, whichever is shorter. */
 extern void build_array_str(struct job_record *job_ptr);
 
 /* Return true if ALL tasks of specific array job ID are complete */
@@ -78,6 +78,22 @@
 
 #define MAX_RETRIES 10
 
+/* Step slot cache: while enabled through step_slot_cache_begin(), remember
+ * the nodes used by one job's running steps so that a series of step
+ * creations for that job under a single job write lock (e.g. a bulk step
+ * create RPC) need not walk the job's entire step list for every step.
+ * The cache is valid only while the job's step count matches, so a step
+ * record added or removed other than by step_create() invalidates it.
+ * Only this busy node bitmap is cached, not the node placement made by
+ * _pick_step_nodes_cpus(). Every step created changes the idle nodes and
+ * usable CPU counts that placement is computed from, so a placement can
+ * not be reused by the next step even if its geometry is identical. */
+static bool       step_slot_cache_active = false;
+static bitstr_t  *step_slot_cache_busy   = NULL;
+static struct job_record *step_slot_cache_job_ptr = NULL;
+static uint32_t   step_slot_cache_job_id  = 0;
+static int        step_slot_cache_step_cnt = 0;
+
 static void _build_pending_step(struct job_record  *job_ptr,
 				job_step_create_request_msg_t *step_specs);
 static int  _count_cpus(struct job_record *job_ptr, bitstr_t *bitmap,
@@ -101,6 +117,8 @@ static bitstr_t * _pick_step_nodes(struct job_record *job_ptr,
 static bitstr_t *_pick_step_nodes_cpus(struct job_record *job_ptr,
 				       bitstr_t *nodes_bitmap, int node_cnt,
 				       int cpu_cnt, uint32_t *usable_cpu_cnt);
+static bitstr_t *_step_busy_nodes(struct job_record *job_ptr);
+static void _step_slot_cache_add(struct step_record *step_ptr);
 static hostlist_t _step_range_to_hostlist(struct step_record *step_ptr,
 				uint32_t range_first, uint32_t range_last);
 static int _step_hostname_to_inx(struct step_record *step_ptr,
@@ -843,6 +861,90 @@ static bitstr_t *_pick_step_nodes_cpus(struct job_record *job_ptr,
 	return NULL;
 }
 
+/*
+ * _step_busy_nodes - identify the nodes used by a job's running steps
+ * IN job_ptr - pointer to job whose steps are examined
+ * RET bitmap of nodes, free using FREE_NULL_BITMAP()
+ * NOTE: uses the step slot cache when enabled and valid for this job
+ */
+static bitstr_t *_step_busy_nodes(struct job_record *job_ptr)
+{
+	ListIterator step_iterator;
+	struct step_record *step_p;
+	bitstr_t *busy_nodes;
+
+	if (step_slot_cache_active && step_slot_cache_busy &&
+	    (step_slot_cache_job_ptr == job_ptr) &&
+	    (step_slot_cache_job_id == job_ptr->job_id) &&
+	    (step_slot_cache_step_cnt == list_count(job_ptr->step_list)))
+		return bit_copy(step_slot_cache_busy);
+
+	busy_nodes = bit_alloc(node_record_count);
+	step_iterator = list_iterator_create(job_ptr->step_list);
+	while ((step_p = (struct step_record *) list_next(step_iterator))) {
+		if (step_p->state < JOB_RUNNING)
+			continue;
+		bit_or(busy_nodes, step_p->step_node_bitmap);
+		if (slurmctld_conf.debug_flags & DEBUG_FLAG_STEPS) {
+			char *temp;
+			temp = bitmap2node_name(step_p->step_node_bitmap);
+			info("step %u.%u has nodes %s",
+			     job_ptr->job_id, step_p->step_id, temp);
+			xfree(temp);
+		}
+	}
+	list_iterator_destroy(step_iterator);
+
+	if (step_slot_cache_active) {
+		FREE_NULL_BITMAP(step_slot_cache_busy);
+		step_slot_cache_busy = bit_copy(busy_nodes);
+		step_slot_cache_job_ptr  = job_ptr;
+		step_slot_cache_job_id   = job_ptr->job_id;
+		step_slot_cache_step_cnt = list_count(job_ptr->step_list);
+	}
+
+	return busy_nodes;
+}
+
+/* Record a newly created step's nodes in the step slot cache */
+static void _step_slot_cache_add(struct step_record *step_ptr)
+{
+	struct job_record *job_ptr = step_ptr->job_ptr;
+
+	if (!step_slot_cache_active || !step_slot_cache_busy ||
+	    (step_slot_cache_job_ptr != job_ptr) ||
+	    (step_slot_cache_job_id != job_ptr->job_id))
+		return;
+	if ((step_slot_cache_step_cnt + 1) !=
+	    list_count(job_ptr->step_list)) {
+		FREE_NULL_BITMAP(step_slot_cache_busy);
+		return;
+	}
+	if (step_ptr->step_node_bitmap)
+		bit_or(step_slot_cache_busy, step_ptr->step_node_bitmap);
+	step_slot_cache_step_cnt++;
+}
+
+/*
+ * step_slot_cache_begin - start caching the nodes used by a job's running
+ *	steps across subsequent step_create() calls
+ * NOTE: the caller must hold the job write lock until step_slot_cache_end()
+ */
+extern void step_slot_cache_begin(void)
+{
+	step_slot_cache_active = true;
+}
+
+/* step_slot_cache_end - stop caching and release the step slot cache */
+extern void step_slot_cache_end(void)
+{
+	step_slot_cache_active = false;
+	FREE_NULL_BITMAP(step_slot_cache_busy);
+	step_slot_cache_job_ptr  = NULL;
+	step_slot_cache_job_id   = 0;
+	step_slot_cache_step_cnt = 0;
+}
+
 /*
  * _pick_step_nodes - select nodes for a job step that satisfy its requirements
  *	we satisfy the super-set of constraints.
@@ -870,8 +972,6 @@ _pick_step_nodes (struct job_record  *job_ptr,
 	int error_code, nodes_picked_cnt = 0, cpus_picked_cnt = 0;
 	int cpu_cnt, i, task_cnt;
 	int mem_blocked_nodes = 0, mem_blocked_cpus = 0;
-	ListIterator step_iterator;
-	struct step_record *step_p;
 	job_resources_t *job_resrcs_ptr = job_ptr->job_resrcs;
 	uint32_t *usable_cpu_cnt = NULL;
 
@@ -1390,23 +1490,7 @@ _pick_step_nodes (struct job_record  *job_ptr,
 		bit_and (nodes_avail, relative_nodes);
 		FREE_NULL_BITMAP (relative_nodes);
 	} else {
-		nodes_idle = bit_alloc (bit_size (nodes_avail) );
-		step_iterator = list_iterator_create(job_ptr->step_list);
-		while ((step_p = (struct step_record *)
-			list_next(step_iterator))) {
-			if (step_p->state < JOB_RUNNING)
-				continue;
-			bit_or(nodes_idle, step_p->step_node_bitmap);
-			if (slurmctld_conf.debug_flags & DEBUG_FLAG_STEPS) {
-				char *temp;
-				temp = bitmap2node_name(step_p->
-							step_node_bitmap);
-				info("step %u.%u has nodes %s",
-				     job_ptr->job_id, step_p->step_id, temp);
-				xfree(temp);
-			}
-		}
-		list_iterator_destroy (step_iterator);
+		nodes_idle = _step_busy_nodes(job_ptr);
 		bit_not(nodes_idle);
 		bit_and(nodes_idle, nodes_avail);
 	}
@@ -2435,6 +2519,7 @@ step_create(job_step_create_request_msg_t *step_specs,
 		jobacct_storage_g_job_start(acct_db_conn, job_ptr);
 
 	select_g_step_start(step_ptr);
+	_step_slot_cache_add(step_ptr);
 
 	jobacct_storage_g_step_start(acct_db_conn, step_ptr);
 	return SLURM_SUCCESS;
@@ -2690,8 +2775,6 @@ extern int pack_ctld_job_step_info_response_msg(
 	pack_time(now, buffer);
 	pack32(steps_packed, buffer);	/* steps_packed placeholder */
 
-	part_filter_set(uid);
-
 	job_iterator = list_iterator_create(job_list);
 	while ((job_ptr = list_next(job_iterator))) {
 		if ((job_id != NO_VAL) && (job_id != job_ptr->job_id) &&
@@ -2700,7 +2783,7 @@ extern int pack_ctld_job_step_info_response_msg(
 
 		if (((show_flags & SHOW_ALL) == 0) &&
 		    (job_ptr->part_ptr) &&
-		    (job_ptr->part_ptr->flags & PART_FLAG_HIDDEN))
+		    !part_is_visible(job_ptr->part_ptr, uid))
 			continue;
 
 		if ((slurmctld_conf.private_data & PRIVATE_DATA_JOBS) &&
@@ -2727,8 +2810,6 @@ extern int pack_ctld_job_step_info_response_msg(
 	if (list_count(job_list) && !valid_job && !steps_packed)
 		error_code = ESLURM_INVALID_JOB_ID;
 
-	part_filter_clear();
-
 	/* put the real record count in the message body header */
 	tmp_offset = get_buf_offset(buffer);
 	set_buf_offset(buffer, 0);
@@ -89,6 +89,8 @@ static int   _get_events(slurmdbd_conn_t *slurmdbd_conn,
 			 Buf in_buffer, Buf *out_buffer, uint32_t *uid);
 static int   _get_jobs_cond(slurmdbd_conn_t *slurmdbd_conn,
 			    Buf in_buffer, Buf *out_buffer, uint32_t *uid);
+static int   _get_jobs_stream(slurmdbd_conn_t *slurmdbd_conn,
+			      Buf in_buffer, Buf *out_buffer, uint32_t *uid);
 static int   _get_probs(slurmdbd_conn_t *slurmdbd_conn,
 			Buf in_buffer, Buf *out_buffer, uint32_t *uid);
 static int   _get_qos(slurmdbd_conn_t *slurmdbd_conn,
@@ -176,6 +178,8 @@ static int   _step_complete(slurmdbd_conn_t *slurmdbd_conn,
 			    Buf in_buffer, Buf *out_buffer, uint32_t *uid);
 static int   _step_start(slurmdbd_conn_t *slurmdbd_conn,
 			 Buf in_buffer, Buf *out_buffer, uint32_t *uid);
+static int   _sync_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
+			    Buf in_buffer, Buf *out_buffer, uint32_t *uid);
 
 /* Process an incoming RPC
  * slurmdbd_conn IN/OUT - in will that the newsockfd set before
@@ -286,6 +290,10 @@ proc_req(slurmdbd_conn_t *slurmdbd_conn,
 			rc = _get_jobs_cond(slurmdbd_conn,
 					    in_buffer, out_buffer, uid);
 			break;
+		case DBD_GET_JOBS_STREAM:
+			rc = _get_jobs_stream(slurmdbd_conn,
+					      in_buffer, out_buffer, uid);
+			break;
 		case DBD_GET_PROBS:
 			rc = _get_probs(slurmdbd_conn,
 					in_buffer, out_buffer, uid);
@@ -452,6 +460,10 @@ proc_req(slurmdbd_conn_t *slurmdbd_conn,
 			rc = _step_start(slurmdbd_conn,
 					 in_buffer, out_buffer, uid);
 			break;
+		case DBD_SYNC_MULT_MSG:
+			rc = _sync_mult_msg(slurmdbd_conn,
+					    in_buffer, out_buffer, uid);
+			break;
 		default:
 			comment = "Invalid RPC";
 			error("CONN:%u %s msg_type=%d",
@@ -467,11 +479,15 @@ proc_req(slurmdbd_conn_t *slurmdbd_conn,
 			      slurmdbd_conn->newsockfd,
 			      slurmdbd_msg_type_2_str(msg_type, 1));
 		else if (slurmdbd_conn->ctld_port
+			 && !slurmdbd_conn->in_mult_msg
+			 && (msg_type != DBD_SEND_MULT_MSG)
 			 && !slurmdbd_conf->commit_delay) {
 			/* If we are dealing with the slurmctld do the
 			   commit (SUCCESS or NOT) afterwards since we
 			   do transactions for performance reasons.
 			   (don't ever use autocommit with innodb)
+			   The messages of a DBD_SEND_MULT_MSG are all
+			   committed together by _send_mult_msg().
 			*/
 			acct_storage_g_commit(slurmdbd_conn->db_conn, 1);
 		}
@@ -1397,6 +1413,65 @@ static int _get_jobs_cond(slurmdbd_conn_t *slurmdbd_conn,
 	return rc;
 }
 
+/* Send one chunk of a DBD_GET_JOBS_STREAM as a DBD_GOT_JOBS message */
+static int _send_jobs_chunk(List job_list, void *arg)
+{
+	slurmdbd_conn_t *slurmdbd_conn = (slurmdbd_conn_t *)arg;
+	dbd_list_msg_t list_msg;
+	Buf buffer = init_buf(1024);
+
+	list_msg.my_list = job_list;
+	pack16((uint16_t) DBD_GOT_JOBS, buffer);
+	slurmdbd_pack_list_msg(&list_msg, slurmdbd_conn->rpc_version,
+			       DBD_GOT_JOBS, buffer);
+
+	/* The client reads the chunks as it goes, possibly through a pager,
+	 * so give it as long as it gives the SlurmDBD to respond */
+	if (send_dbd_resp_timeout(slurmdbd_conn->newsockfd, buffer,
+				  SLURMDBD_TIMEOUT * 1000) != SLURM_SUCCESS) {
+		error("CONN:%u Unable to send DBD_GOT_JOBS chunk",
+		      slurmdbd_conn->newsockfd);
+		return SLURM_ERROR;
+	}
+
+	return SLURM_SUCCESS;
+}
+
+/* Same as _get_jobs_cond() except the jobs are sent back as they are
+ * read from the database in as many DBD_GOT_JOBS messages as it takes,
+ * ending with a DBD_RC so only one chunk is ever held in memory. */
+static int _get_jobs_stream(slurmdbd_conn_t *slurmdbd_conn,
+			    Buf in_buffer, Buf *out_buffer, uint32_t *uid)
+{
+	dbd_cond_msg_t *cond_msg = NULL;
+	char *comment = NULL;
+	int rc = SLURM_SUCCESS;
+
+	debug2("DBD_GET_JOBS_STREAM: called");
+	if (slurmdbd_unpack_cond_msg(&cond_msg, slurmdbd_conn->rpc_version,
+				     DBD_GET_JOBS_STREAM, in_buffer) !=
+	    SLURM_SUCCESS) {
+		comment = "Failed to unpack DBD_GET_JOBS_STREAM message";
+		error("CONN:%u %s", slurmdbd_conn->newsockfd, comment);
+		*out_buffer = make_dbd_rc_msg(slurmdbd_conn->rpc_version,
+					      SLURM_ERROR, comment,
+					      DBD_GET_JOBS_STREAM);
+		return SLURM_ERROR;
+	}
+
+	rc = jobacct_storage_g_get_jobs_cb(slurmdbd_conn->db_conn, *uid,
+					   cond_msg->cond, _send_jobs_chunk,
+					   slurmdbd_conn);
+	if (rc != SLURM_SUCCESS)
+		comment = slurm_strerror(rc);
+	*out_buffer = make_dbd_rc_msg(slurmdbd_conn->rpc_version,
+				      rc, comment, DBD_GET_JOBS_STREAM);
+
+	slurmdbd_free_cond_msg(cond_msg, DBD_GET_JOBS_STREAM);
+
+	return rc;
+}
+
 static int _get_probs(slurmdbd_conn_t *slurmdbd_conn,
 		      Buf in_buffer, Buf *out_buffer, uint32_t *uid)
 {
@@ -3724,6 +3799,36 @@ static int   _send_mult_job_start(slurmdbd_conn_t *slurmdbd_conn,
 	return SLURM_SUCCESS;
 }
 
+/* Return code a DBD_SEND_MULT_MSG sender finds in ret_buf, the reply to
+ * one of its messages. Handlers report most failures only there. */
+static int _mult_msg_ret_rc(slurmdbd_conn_t *slurmdbd_conn, Buf ret_buf)
+{
+	uint32_t offset = get_buf_offset(ret_buf);
+	uint16_t msg_type;
+	dbd_rc_msg_t *msg = NULL;
+	dbd_id_rc_msg_t *id_msg = NULL;
+	int rc = SLURM_ERROR;
+
+	set_buf_offset(ret_buf, 0);
+	safe_unpack16(&msg_type, ret_buf);
+	if ((msg_type == DBD_RC) &&
+	    (slurmdbd_unpack_rc_msg(&msg, slurmdbd_conn->rpc_version,
+				    ret_buf) == SLURM_SUCCESS)) {
+		rc = msg->return_code;
+		slurmdbd_free_rc_msg(msg);
+	} else if ((msg_type == DBD_ID_RC) &&
+		   (slurmdbd_unpack_id_rc_msg((void **)&id_msg,
+					      slurmdbd_conn->rpc_version,
+					      ret_buf) == SLURM_SUCCESS)) {
+		rc = id_msg->return_code;
+		slurmdbd_free_id_rc_msg(id_msg);
+	}
+
+unpack_error:
+	set_buf_offset(ret_buf, offset);
+	return rc;
+}
+
 static int   _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
 			    Buf in_buffer, Buf *out_buffer,
 			    uint32_t *uid)
@@ -3734,7 +3839,7 @@ static int   _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
 	ListIterator itr = NULL;
 	Buf req_buf = NULL, ret_buf = NULL;
 	int rc = SLURM_SUCCESS;
-	/* DEF_TIMERS; */
+	DEF_TIMERS;
 
 	if (*uid != slurmdbd_conf->slurm_user_id && *uid != 0) {
 		comment = "DBD_SEND_MULT_MSG message from invalid uid";
@@ -3750,6 +3855,8 @@ static int   _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
 				     in_buffer) != SLURM_SUCCESS) {
 		comment = "Failed to unpack DBD_SEND_MULT_MSG message";
 		error("CONN:%u %s", slurmdbd_conn->newsockfd, comment);
+		if (slurmdbd_conn->mult_msg_pipe)
+			slurmdbd_conn->mult_msg_failed = true;
 		*out_buffer = make_dbd_rc_msg(slurmdbd_conn->rpc_version,
 					      SLURM_ERROR, comment,
 					      DBD_SEND_MULT_MSG);
@@ -3757,20 +3864,48 @@ static int   _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
 	}
 
 	list_msg.my_list = list_create(slurmdbd_free_buffer);
-	/* START_TIMER; */
+	START_TIMER;
+	/* Frames pipelined after a failed one must not be applied ahead of
+	 * the messages the peer is going to send again. Answer them with
+	 * no return codes so all of them are sent again, in order. */
+	slurmdbd_conn->in_mult_msg = true;
 	itr = list_iterator_create(get_msg->my_list);
-	while ((req_buf = list_next(itr))) {
+	while (!slurmdbd_conn->mult_msg_failed &&
+	       (req_buf = list_next(itr))) {
 		ret_buf = NULL;
 		rc = proc_req(slurmdbd_conn, get_buf_data(req_buf),
 			      size_buf(req_buf), 0, &ret_buf, uid);
-		if (ret_buf)
+		if (ret_buf) {
 			list_append(list_msg.my_list, ret_buf);
-		if (rc != SLURM_SUCCESS)
+			if (rc == SLURM_SUCCESS)
+				rc = _mult_msg_ret_rc(slurmdbd_conn, ret_buf);
+		}
+		if (rc != SLURM_SUCCESS) {
+			if (slurmdbd_conn->mult_msg_pipe)
+				slurmdbd_conn->mult_msg_failed = true;
 			break;
+		}
 	}
 	list_iterator_destroy(itr);
-	/* END_TIMER; */
-	/* info("%d multi took %s", list_count(get_msg->my_list), TIME_STR); */
+	slurmdbd_conn->in_mult_msg = false;
+	/* Commit before answering, statements the storage plugin queued
+	 * only go to the database now. If that fails none of the messages
+	 * are acknowledged, so they are all sent again. */
+	if (slurmdbd_conn->ctld_port && !slurmdbd_conf->commit_delay &&
+	    list_count(list_msg.my_list) &&
+	    (acct_storage_g_commit(slurmdbd_conn->db_conn, 1)
+	     != SLURM_SUCCESS)) {
+		error("CONN:%u DBD_SEND_MULT_MSG: commit of %d messages "
+		      "failed", slurmdbd_conn->newsockfd,
+		      list_count(list_msg.my_list));
+		list_flush(list_msg.my_list);
+		if (slurmdbd_conn->mult_msg_pipe)
+			slurmdbd_conn->mult_msg_failed = true;
+	}
+	END_TIMER;
+	debug2("DBD_SEND_MULT_MSG: %d of %d messages took %s",
+	       list_count(list_msg.my_list), list_count(get_msg->my_list),
+	       TIME_STR);
 
 	slurmdbd_free_list_msg(get_msg);
 
@@ -3939,3 +4074,28 @@ end_it:
 	return rc;
 }
 
+/* The peer is about to (re)start sending pipelined DBD_SEND_MULT_MSG
+ * frames. Replying success also tells it that frames after a failed one
+ * are refused here, which it needs before keeping several in flight. */
+static int   _sync_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
+			    Buf in_buffer, Buf *out_buffer, uint32_t *uid)
+{
+	int rc = SLURM_SUCCESS;
+	char *comment = NULL;
+
+	if (*uid != slurmdbd_conf->slurm_user_id && *uid != 0) {
+		comment = "DBD_SYNC_MULT_MSG message from invalid uid";
+		error("%s %u", comment, *uid);
+		rc = ESLURM_ACCESS_DENIED;
+		goto end_it;
+	}
+
+	debug2("DBD_SYNC_MULT_MSG: called");
+	slurmdbd_conn->mult_msg_pipe = true;
+	slurmdbd_conn->mult_msg_failed = false;
+
+end_it:
+	*out_buffer = make_dbd_rc_msg(slurmdbd_conn->rpc_version,
+				      rc, comment, DBD_SYNC_MULT_MSG);
+	return rc;
+}
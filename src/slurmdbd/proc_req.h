@@ -48,6 +48,10 @@ typedef struct {
 	uint32_t cluster_cpus;
 	uint16_t ctld_port; /* slurmctld_port */
 	void *db_conn; /* database connection */
+	bool in_mult_msg; /* processing a DBD_SEND_MULT_MSG, commit at end */
+	bool mult_msg_failed; /* a pipelined DBD_SEND_MULT_MSG failed, refuse
+			       * the frames after it until DBD_SYNC_MULT_MSG */
+	bool mult_msg_pipe; /* peer pipelines DBD_SEND_MULT_MSG frames */
 	char ip[32];
 	slurm_fd_t newsockfd; /* socket connection descriptor */
 	uint16_t orig_port;
@@ -69,10 +69,13 @@
  */
 #define MAX_MSG_SIZE     (16*1024*1024)
 
+/* Default msec to wait for a connection to become writeable */
+#define DBD_WRITE_TIMEOUT 5000
+
 /* Local functions */
 static bool   _fd_readable(slurm_fd_t fd);
+static bool   _fd_writeable(slurm_fd_t fd, int msg_timeout);
 static void   _free_server_thread(pthread_t my_tid);
-static int    _send_resp(slurm_fd_t fd, Buf buffer);
 static void * _service_connection(void *arg);
 static void   _sig_handler(int signal);
 static int    _tot_wait (struct timeval *start_time);
@@ -246,7 +249,7 @@ static void * _service_connection(void *arg)
 			fini = true;
 		}
 
-		(void) _send_resp(conn->newsockfd, buffer);
+		(void) send_dbd_resp(conn->newsockfd, buffer);
 		xfree(msg);
 	}
 
@@ -310,18 +313,26 @@ extern Buf make_dbd_rc_msg(uint16_t rpc_version,
 	return buffer;
 }
 
-static int _send_resp(slurm_fd_t fd, Buf buffer)
+/* Send a response message, the buffer is freed */
+extern int send_dbd_resp(slurm_fd_t fd, Buf buffer)
+{
+	return send_dbd_resp_timeout(fd, buffer, DBD_WRITE_TIMEOUT);
+}
+
+/* Send a response message waiting up to "timeout" msec each time the
+ * connection is not writeable, the buffer is freed */
+extern int send_dbd_resp_timeout(slurm_fd_t fd, Buf buffer, int timeout)
 {
 	uint32_t msg_size, nw_size;
 	ssize_t msg_wrote;
 	char *out_buf;
 
-	if ((fd < 0) || (!fd_writeable(fd)))
+	if ((fd < 0) || (!_fd_writeable(fd, timeout)))
 		goto io_err;
 
 	msg_size = get_buf_offset(buffer);
 	nw_size = htonl(msg_size);
-	if (!fd_writeable(fd))
+	if (!_fd_writeable(fd, timeout))
 		goto io_err;
 	msg_wrote = write(fd, &nw_size, sizeof(nw_size));
 	if (msg_wrote != sizeof(nw_size))
@@ -329,7 +340,7 @@ static int _send_resp(slurm_fd_t fd, Buf buffer)
 
 	out_buf = get_buf_data(buffer);
 	while (msg_size > 0) {
-		if (!fd_writeable(fd))
+		if (!_fd_writeable(fd, timeout))
 			goto io_err;
 		msg_wrote = write(fd, out_buf, msg_size);
 		if (msg_wrote <= 0)
@@ -401,9 +412,15 @@ static bool _fd_readable(slurm_fd_t fd)
 /* Wait until a file is writeable,
  * RET false if can not be written to within 5 seconds */
 extern bool fd_writeable(slurm_fd_t fd)
+{
+	return _fd_writeable(fd, DBD_WRITE_TIMEOUT);
+}
+
+/* Wait until a file is writeable,
+ * RET false if can not be written to within msg_timeout msec */
+static bool _fd_writeable(slurm_fd_t fd, int msg_timeout)
 {
 	struct pollfd ufds;
-	int msg_timeout = 5000;
 	int rc, time_left;
 	struct timeval tstart;
 	char temp[2];
@@ -432,9 +449,11 @@ extern bool fd_writeable(slurm_fd_t fd)
 		 * If not then exit out and notify the sender.  This
  		 * is here since a write doesn't always tell you the
 		 * socket is gone, but getting 0 back from a
-		 * nonblocking read means just that.
+		 * nonblocking read means just that. Only peek, the
+		 * slurmctld may have already sent its next message.
 		 */
-		if (ufds.revents & POLLHUP || (recv(fd, &temp, 1, 0) == 0)) {
+		if (ufds.revents & POLLHUP ||
+		    (recv(fd, &temp, 1, MSG_PEEK) == 0)) {
 			debug3("Write connection %d closed", fd);
 			return false;
 		}
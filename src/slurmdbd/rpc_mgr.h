@@ -49,6 +49,15 @@ extern bool fd_writeable(slurm_fd_t fd);
 extern Buf make_dbd_rc_msg(uint16_t rpc_version,
 			   int rc, char *comment, uint16_t sent_type);
 
+/* Send a response message to the connection "fd", the buffer is
+ * freed whether the send works or not */
+extern int send_dbd_resp(slurm_fd_t fd, Buf buffer);
+
+/* Same as send_dbd_resp() but wait up to "timeout" msec for the connection
+ * to become writeable rather than 5 seconds, for a client reading a stream
+ * of messages at its own pace */
+extern int send_dbd_resp_timeout(slurm_fd_t fd, Buf buffer, int timeout);
+
 /* Process incoming RPCs. Meant to execute as a pthread */
 extern void *rpc_mgr(void *no_data);
 
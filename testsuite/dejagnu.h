@@ -34,9 +34,9 @@ static int tests = 0;
 static char buffer[ _BUFFER_SIZE_ ];
 
 
-inline void
+static inline void
 pass (const char* fmt, ... ) __attribute__ ((format (printf, 1, 2)));
-inline void
+static inline void
 pass (const char* fmt, ... ) {
 	va_list ap;
 
@@ -49,9 +49,9 @@ pass (const char* fmt, ... ) {
 	fflush( stdout );
 }
 
-inline void
+static inline void
 fail (const char* fmt, ... ) __attribute__ ((format (printf, 1, 2)));
-inline void
+static inline void
 fail (const char* fmt, ... ) {
 	va_list ap;
 
@@ -64,9 +64,9 @@ fail (const char* fmt, ... ) {
 	fflush( stdout );
 }
 
-inline void
+static inline void
 untested (const char* fmt, ... ) __attribute__ ((format (printf, 1, 2)));
-inline void
+static inline void
 untested (const char* fmt, ... ) {
 	va_list ap;
 
@@ -79,9 +79,9 @@ untested (const char* fmt, ... ) {
 	fflush( stdout );
 }
 
-inline void
+static inline void
 unresolved (const char* fmt, ... ) __attribute__ ((format (printf, 1, 2)));
-inline void
+static inline void
 unresolved (const char* fmt, ... ) {
 	va_list ap;
 
@@ -94,9 +94,9 @@ unresolved (const char* fmt, ... ) {
 	fflush( stdout );
 }
 
-inline void
+static inline void
 note (const char* fmt, ... ) __attribute__ ((format (printf, 1, 2)));
-inline void
+static inline void
 note (const char* fmt, ... ) {
 	va_list ap;
 
@@ -107,7 +107,7 @@ note (const char* fmt, ... ) {
 	fflush( stdout );
 }
 
-inline void
+static inline void
 totals (void) {
 	printf ("\nTotals:\n");
 	printf ("\t#passed:\t\t%d\n", passed);
@@ -2,6 +2,8 @@
  */
 #include <stdlib.h>
 #include <src/common/bitstring.h>
+#include <src/common/slurm_protocol_defs.h>
+#include <src/common/xmalloc.h>
 #include <sys/time.h>
 #include <testsuite/dejagnu.h>
 
@@ -20,6 +22,51 @@
 		pass( _msg );		\
 } while (0)
 
+/* Bit by bit versions of the word kernels, for comparison */
+static int _ref_overlap(bitstr_t *b1, bitstr_t *b2)
+{
+	int i, cnt = 0;
+
+	for (i = 0; i < bit_size(b1); i++) {
+		if (bit_test(b1, i) && (!b2 || bit_test(b2, i)))
+			cnt++;
+	}
+	return cnt;
+}
+
+static int _ref_ff(bitstr_t *b, int set, int last)
+{
+	int i, pos = -1;
+
+	for (i = 0; i < bit_size(b); i++) {
+		if (bit_test(b, i) == set) {
+			pos = i;
+			if (!last)
+				break;
+		}
+	}
+	return pos;
+}
+
+static int _ref_nff(bitstr_t *b, int n, int set)
+{
+	int i, cnt = 0;
+
+	for (i = 0; i < bit_size(b); i++) {
+		if (bit_test(b, i) != set)
+			cnt = 0;
+		else if (++cnt >= n)
+			return i - (cnt - 1);
+	}
+	return -1;
+}
+
+static long _usec(struct timeval *tv1, struct timeval *tv2)
+{
+	return (tv2->tv_sec - tv1->tv_sec) * 1000000 +
+	       (tv2->tv_usec - tv1->tv_usec);
+}
+
 
 int
 main(int argc, char *argv[])
@@ -104,6 +151,11 @@ main(int argc, char *argv[])
 		TEST(!bit_test(bs1, 100), "not");
 		TEST(bit_test(bs1, 12), "not");
 
+		bit_and_not(bs1, bs2);
+		TEST(bit_test(bs1, 12), "and_not");
+		TEST(!bit_test(bs1, 110), "and_not");
+		TEST(bit_test(bs2, 110), "and_not");
+
 		bit_free(bs1);
 		bit_free(bs2);
 	}
@@ -202,6 +254,262 @@ main(int argc, char *argv[])
 		TEST(bit_equal(bs, bs2), "bitstring");
 	}
 
+	note("Testing bit_fmt_full");
+	{
+		bitstr_t *bs = bit_alloc(1000), *bs2;
+		char tmpstr[4096], *str;
+
+		str = bit_fmt_full(bs);
+		TEST(!strcmp(str, ""), "bit_fmt_full empty");
+		xfree(str);
+		bit_set(bs, 0);
+		bit_nset(bs, 62, 65);
+		bit_nset(bs, 127, 320);
+		bit_set(bs, 999);
+		str = bit_fmt_full(bs);
+		bit_fmt(tmpstr, sizeof(tmpstr), bs);
+		TEST(!strcmp(str, tmpstr), "bit_fmt_full matches bit_fmt");
+		TEST(!strcmp(str, "0,62-65,127-320,999"), "bit_fmt_full");
+		bs2 = slurm_array_str2bitmap(str);
+		TEST(bs2 && (bit_size(bs2) == 1000) && bit_equal(bs, bs2),
+		     "range string to bitmap");
+		FREE_NULL_BITMAP(bs2);
+		xfree(str);
+		str = bit_fmt_hexmask(bs);
+		bs2 = slurm_array_str2bitmap(str);
+		xfree(str);
+		if (bs2)
+			str = bit_fmt_full(bs2);
+		TEST(bs2 && !strcmp(str, "0,62-65,127-320,999"),
+		     "hex mask to bitmap");
+		FREE_NULL_BITMAP(bs2);
+		xfree(str);
+		bit_set_all(bs);
+		str = bit_fmt_full(bs);
+		TEST(!strcmp(str, "0-999"), "bit_fmt_full all set");
+		xfree(str);
+		bit_free(bs);
+	}
+
+	note("Testing word kernels against bit by bit results");
+	{
+		int sizes[] = { 1, 31, 32, 33, 63, 64, 65, 100, 1000, 4097 };
+		int density[] = { 0, 2, 50, 98, 100 };
+		bool count_ok = true, overlap_ok = true, any_ok = true;
+		bool and_ok = true, ff_ok = true, nff_ok = true;
+		bool super_ok = true;
+		bitstr_t *b1, *b2, *b3;
+		int i, j, k, n;
+
+		srand(1);
+		for (i = 0; i < 10; i++) {
+			for (j = 0; j < 25; j++) {
+				b1 = bit_alloc(sizes[i]);
+				b2 = bit_alloc(sizes[i]);
+				/* Fill clear bits so bit_not() sets the
+				 * unused bits of the last word */
+				for (k = 0; k < sizes[i]; k++) {
+					if ((rand() % 100) >= density[j / 5])
+						bit_set(b1, k);
+					if ((rand() % 100) >= density[j % 5])
+						bit_set(b2, k);
+				}
+				bit_not(b1);
+				bit_not(b2);
+
+				if (bit_set_count(b1) != _ref_overlap(b1, NULL))
+					count_ok = false;
+				n = _ref_overlap(b1, b2);
+				if (bit_overlap(b1, b2) != n)
+					overlap_ok = false;
+				if (bit_overlap_any(b1, b2) != (n > 0))
+					any_ok = false;
+				if (bit_super_set(b1, b2) !=
+				    (n == _ref_overlap(b1, NULL)))
+					super_ok = false;
+				if ((bit_ffs(b1) != _ref_ff(b1, 1, 0)) ||
+				    (bit_ffc(b1) != _ref_ff(b1, 0, 0)) ||
+				    (bit_fls(b1) != _ref_ff(b1, 1, 1)))
+					ff_ok = false;
+				for (k = 1; k < sizes[i]; k += (k / 4) + 1) {
+					if ((bit_nffs(b1, k) !=
+					     _ref_nff(b1, k, 1)) ||
+					    (bit_nffc(b1, k) !=
+					     _ref_nff(b1, k, 0)))
+						nff_ok = false;
+				}
+				b3 = bit_copy(b1);
+				if ((bit_and_set_count(b3, b2) != n) ||
+				    (_ref_overlap(b3, NULL) != n))
+					and_ok = false;
+				bit_free(b1);
+				bit_free(b2);
+				bit_free(b3);
+			}
+		}
+		TEST(count_ok, "bit_set_count matches bit by bit count");
+		TEST(overlap_ok, "bit_overlap matches bit by bit count");
+		TEST(any_ok, "bit_overlap_any matches bit_overlap");
+		TEST(and_ok, "bit_and_set_count matches bit by bit count");
+		TEST(super_ok, "bit_super_set matches bit by bit test");
+		TEST(ff_ok, "bit_ffs/bit_ffc/bit_fls match bit by bit scan");
+		TEST(nff_ok, "bit_nffs/bit_nffc match bit by bit scan");
+	}
+
+	note("Testing scratch bitmaps");
+	{
+		bitstr_t *bs1 = bit_alloc(1000), *bs2, *bs3;
+
+		bit_set(bs1, 7);
+		bit_set(bs1, 999);
+		bs2 = bit_scratch_copy(bs1);
+		TEST(bit_equal(bs1, bs2), "scratch copy");
+		bit_scratch_free(bs2);
+		bs3 = bit_scratch_alloc(1000);
+		TEST(bs3 == bs2, "scratch bitmap reused");
+		TEST((bit_size(bs3) == 1000) && (bit_set_count(bs3) == 0),
+		     "reused scratch bitmap cleared");
+		bs2 = bit_scratch_alloc(1001);
+		TEST((bs2 != bs3) && (bit_size(bs2) == 1001),
+		     "scratch bitmap size matched");
+		FREE_NULL_SCRATCH_BITMAP(bs2);
+		FREE_NULL_SCRATCH_BITMAP(bs3);
+		TEST(bs3 == NULL, "FREE_NULL_SCRATCH_BITMAP");
+		bit_scratch_purge();
+		bit_free(bs1);
+	}
+
+	note("Timing bitmap word kernels");
+	{
+		int sizes[] = { 10000, 100000 };
+		struct timeval tv1, tv2;
+		bitstr_t *b1, *b2, *b3, *b4;
+		int i, k, loops, sum = 0;
+
+		for (i = 0; i < 2; i++) {
+			b1 = bit_alloc(sizes[i]);
+			b2 = bit_alloc(sizes[i]);
+			for (k = 0; k < sizes[i]; k++) {
+				if (rand() % 2)
+					bit_set(b1, k);
+				if (rand() % 2)
+					bit_set(b2, k);
+			}
+			bit_nclear(b1, 0, sizes[i] / 2);
+			b3 = bit_copy(b1);
+			loops = 10000000 / sizes[i];
+
+			gettimeofday(&tv1, NULL);
+			for (k = 0; k < loops; k++)
+				sum += _ref_overlap(b1, NULL);
+			gettimeofday(&tv2, NULL);
+			note("%d bits: bit by bit count usec=%ld",
+			     sizes[i], _usec(&tv1, &tv2) / loops);
+
+			gettimeofday(&tv1, NULL);
+			for (k = 0; k < loops * 100; k++)
+				sum += bit_set_count(b1);
+			gettimeofday(&tv2, NULL);
+			note("%d bits: bit_set_count nsec=%ld",
+			     sizes[i], _usec(&tv1, &tv2) * 10 / loops);
+
+			gettimeofday(&tv1, NULL);
+			for (k = 0; k < loops * 100; k++)
+				sum += bit_overlap(b1, b2);
+			gettimeofday(&tv2, NULL);
+			note("%d bits: bit_overlap nsec=%ld",
+			     sizes[i], _usec(&tv1, &tv2) * 10 / loops);
+
+			gettimeofday(&tv1, NULL);
+			for (k = 0; k < loops * 100; k++) {
+				bit_copybits(b3, b1);
+				sum += bit_and_set_count(b3, b2);
+			}
+			gettimeofday(&tv2, NULL);
+			note("%d bits: bit_copybits+bit_and_set_count nsec=%ld",
+			     sizes[i], _usec(&tv1, &tv2) * 10 / loops);
+
+			gettimeofday(&tv1, NULL);
+			for (k = 0; k < loops * 100; k++) {
+				sum += bit_ffs(b1);
+				sum += bit_nffc(b1, 3);
+			}
+			gettimeofday(&tv2, NULL);
+			note("%d bits: bit_ffs+bit_nffc nsec=%ld",
+			     sizes[i], _usec(&tv1, &tv2) * 10 / loops);
+
+			gettimeofday(&tv1, NULL);
+			for (k = 0; k < loops * 100; k++) {
+				b4 = bit_copy(b1);
+				sum += bit_ffs(b4);
+				bit_free(b4);
+			}
+			gettimeofday(&tv2, NULL);
+			note("%d bits: bit_copy+bit_free nsec=%ld",
+			     sizes[i], _usec(&tv1, &tv2) * 10 / loops);
+
+			gettimeofday(&tv1, NULL);
+			for (k = 0; k < loops * 100; k++) {
+				b4 = bit_scratch_copy(b1);
+				sum += bit_ffs(b4);
+				bit_scratch_free(b4);
+			}
+			gettimeofday(&tv2, NULL);
+			note("%d bits: bit_scratch_copy+bit_scratch_free nsec=%ld",
+			     sizes[i], _usec(&tv1, &tv2) * 10 / loops);
+			bit_scratch_purge();
+
+			bit_free(b1);
+			bit_free(b2);
+			bit_free(b3);
+		}
+		if (sum == 0)	/* keep the loops from being optimized out */
+			note("no bits set");
+	}
+
+	note("Timing job array task strings");
+	{
+		int sizes[] = { 10000, 100000, 1000000 };
+		struct timeval tv1, tv2, tv3;
+		char *hex_str, *range_str;
+		bitstr_t *bs;
+		int i, j;
+
+		for (i = 0; i < 3; i++) {
+			bs = bit_alloc(sizes[i]);
+			for (j = 0; j < 2; j++) {
+				/* All tasks pending, then every tenth
+				 * task started */
+				if (j == 0) {
+					bit_set_all(bs);
+				} else {
+					int k;
+					for (k = 0; k < sizes[i]; k += 10)
+						bit_clear(bs, k);
+				}
+				gettimeofday(&tv1, NULL);
+				hex_str = bit_fmt_hexmask(bs);
+				gettimeofday(&tv2, NULL);
+				range_str = bit_fmt_full(bs);
+				gettimeofday(&tv3, NULL);
+				note("%d tasks %s: bitmap %d bytes, "
+				     "hex mask %d bytes usec=%ld, "
+				     "ranges %d bytes usec=%ld",
+				     sizes[i], j ? "90% pending" : "pending",
+				     (int) (bit_size(bs) / 8),
+				     (int) strlen(hex_str),
+				     (tv2.tv_sec - tv1.tv_sec) * 1000000 +
+				     (tv2.tv_usec - tv1.tv_usec),
+				     (int) strlen(range_str),
+				     (tv3.tv_sec - tv2.tv_sec) * 1000000 +
+				     (tv3.tv_usec - tv2.tv_usec));
+				xfree(hex_str);
+				xfree(range_str);
+			}
+			bit_free(bs);
+		}
+	}
+
 	totals();
 	return failed;
 }
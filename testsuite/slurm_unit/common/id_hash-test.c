@@ -0,0 +1,121 @@
+/* Test of src/common/id_hash.c
+ */
+#include <stdlib.h>
+#include <sys/time.h>
+#include <src/common/id_hash.h>
+#include <src/common/xmalloc.h>
+#include <testsuite/dejagnu.h>
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+#define ARRAY_KEY(_job_id, _task_id) (((uint64_t) (_job_id) << 32) | (_task_id))
+#define BENCH_CNT 200000
+
+static long _delta_usec(struct timeval *tv1, struct timeval *tv2)
+{
+	return (tv2->tv_sec - tv1->tv_sec) * 1000000 +
+	       (tv2->tv_usec - tv1->tv_usec);
+}
+
+int
+main(int argc, char *argv[])
+{
+	note("Testing add/find/remove");
+	{
+		id_hash_t *table = id_hash_init(0);
+		int a = 1, b = 2;
+
+		TEST(id_hash_find(table, 10) == NULL, "find in empty table");
+		TEST(id_hash_add(table, 10, &a) == NULL, "add new key");
+		TEST(id_hash_find(table, 10) == &a, "find added key");
+		TEST(id_hash_add(table, 10, &b) == &a, "replace returns old");
+		TEST(id_hash_find(table, 10) == &b, "find replaced key");
+		TEST(id_hash_count(table) == 1, "count after replace");
+		TEST(id_hash_remove(table, 11) == NULL, "remove missing key");
+		TEST(id_hash_remove(table, 10) == &b, "remove key");
+		TEST(id_hash_find(table, 10) == NULL, "find removed key");
+		TEST(id_hash_count(table) == 0, "count after remove");
+		id_hash_free(table);
+	}
+	note("Testing growth and removal across resizes");
+	{
+		id_hash_t *table = id_hash_init(0);
+		uint32_t *vals = xmalloc(sizeof(uint32_t) * 10000);
+		char *removed = xmalloc(10000);
+		int i, bad = 0;
+
+		for (i = 0; i < 10000; i++) {
+			vals[i] = i;
+			id_hash_add(table, i * 7, &vals[i]);
+			/* Remove every third item while tables migrate */
+			if ((i % 3) == 0) {
+				id_hash_remove(table, (i / 2) * 7);
+				removed[i / 2] = 1;
+			}
+		}
+		for (i = 0; i < 10000; i++) {
+			void *item = id_hash_find(table, i * 7);
+			if (removed[i] && item)
+				bad++;
+			else if (!removed[i] && (item != &vals[i]))
+				bad++;
+		}
+		TEST(bad == 0, "items found after growth");
+		for (i = 0; i < 10000; i++)
+			id_hash_remove(table, i * 7);
+		TEST(id_hash_count(table) == 0, "all items removed");
+		id_hash_free(table);
+		xfree(removed);
+		xfree(vals);
+	}
+	note("Testing job array keys");
+	{
+		id_hash_t *table = id_hash_init(0);
+		int a = 1, b = 2;
+
+		/* Keys that collided with the old (job_id + task_id) index */
+		id_hash_add(table, ARRAY_KEY(100, 5), &a);
+		id_hash_add(table, ARRAY_KEY(101, 4), &b);
+		TEST(id_hash_find(table, ARRAY_KEY(100, 5)) == &a,
+		     "array task 100_5");
+		TEST(id_hash_find(table, ARRAY_KEY(101, 4)) == &b,
+		     "array task 101_4");
+		TEST(id_hash_find(table, ARRAY_KEY(100, 4)) == NULL,
+		     "array task 100_4 absent");
+		id_hash_free(table);
+	}
+	note("Timing array task lookups");
+	{
+		id_hash_t *table = id_hash_init(0);
+		struct timeval tv1, tv2, tv3;
+		int i, hits = 0;
+
+		gettimeofday(&tv1, NULL);
+		for (i = 0; i < BENCH_CNT; i++) {
+			id_hash_add(table, ARRAY_KEY(1000 + i / 1000, i % 1000),
+				    table);
+		}
+		gettimeofday(&tv2, NULL);
+		for (i = 0; i < BENCH_CNT; i++) {
+			if (id_hash_find(table,
+					 ARRAY_KEY(1000 + i / 1000, i % 1000)))
+				hits++;
+		}
+		gettimeofday(&tv3, NULL);
+		TEST(hits == BENCH_CNT, "array task lookups");
+		note("%d adds usec=%ld, %d lookups usec=%ld",
+		     BENCH_CNT, _delta_usec(&tv1, &tv2),
+		     BENCH_CNT, _delta_usec(&tv2, &tv3));
+		id_hash_free(table);
+	}
+
+	totals();
+	return failed;
+}
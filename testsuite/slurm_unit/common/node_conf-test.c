@@ -0,0 +1,320 @@
+/* Test of node_name2bitmap() and bitmap2node_name() in
+ * src/common/node_conf.c. Both work from the node name runs built by
+ * rehash_node() where possible, which must give the same result as
+ * resolving each name of the expanded hostlist and printing a hostlist of
+ * the nodes in a bitmap.
+ */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <src/common/bitstring.h>
+#include <src/common/hostlist.h>
+#include <src/common/log.h>
+#include <src/common/node_conf.h>
+#include <src/common/slurm_protocol_api.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+#include <testsuite/dejagnu.h>
+
+/* Free the node table built by _build_nodes(). The records have no
+ * plugin data, so purge_node_rec() and node_fini2() are not used. */
+static void _free_nodes(void)
+{
+	int i;
+
+	for (i = 0; i < node_record_count; i++)
+		xfree(node_record_table_ptr[i].name);
+	xfree(node_record_table_ptr);
+	node_record_count = 0;
+}
+
+/* Replace the node table with nodes named by the hostlist expressions in
+ * conf, in that order, as NodeName lines of slurm.conf would */
+static void _build_nodes(char **conf)
+{
+	hostlist_t hl;
+	char *name;
+	int i, cnt = 0;
+
+	_free_nodes();
+	for (i = 0; conf[i]; i++) {
+		hl = hostlist_create(conf[i]);
+		cnt += hostlist_count(hl);
+		hostlist_destroy(hl);
+	}
+	node_record_table_ptr = xmalloc(sizeof(struct node_record) * cnt);
+	for (i = 0; conf[i]; i++) {
+		hl = hostlist_create(conf[i]);
+		while ((name = hostlist_shift(hl))) {
+			node_record_table_ptr[node_record_count].name =
+				xstrdup(name);
+			node_record_table_ptr[node_record_count].magic =
+				NODE_MAGIC;
+			node_record_count++;
+			free(name);
+		}
+		hostlist_destroy(hl);
+	}
+	rehash_node();
+}
+
+/* Resolve node_names with node_name2bitmap() and by expanding it into a
+ * hostlist, return true if both give the same bitmap and return code */
+static bool _same_as_hostlist(char *node_names)
+{
+	bitstr_t *fast_bitmap = NULL, *hl_bitmap = NULL;
+	hostlist_t hl;
+	int fast_rc, hl_rc;
+	bool rc;
+
+	fast_rc = node_name2bitmap(node_names, false, &fast_bitmap);
+	hl = hostlist_create(node_names);
+	if (hl) {
+		hl_rc = hostlist2bitmap(hl, false, &hl_bitmap);
+		hostlist_destroy(hl);
+	} else {
+		hl_rc = EINVAL;
+		hl_bitmap = bit_alloc(node_record_count);
+	}
+	rc = (fast_rc == hl_rc) && bit_equal(fast_bitmap, hl_bitmap);
+	if (!rc) {
+		char *fast_str = bit_fmt_hexmask(fast_bitmap);
+		char *hl_str = bit_fmt_hexmask(hl_bitmap);
+		note("%s: node_name2bitmap rc=%d %s, hostlist rc=%d %s",
+		     node_names, fast_rc, fast_str, hl_rc, hl_str);
+		xfree(fast_str);
+		xfree(hl_str);
+	}
+	FREE_NULL_BITMAP(fast_bitmap);
+	FREE_NULL_BITMAP(hl_bitmap);
+	return rc;
+}
+
+/* Test every expression in names against the hostlist resolution */
+static void _test_names(char *test, char **names)
+{
+	int i, bad = 0;
+
+	for (i = 0; names[i]; i++) {
+		if (!_same_as_hostlist(names[i]))
+			bad++;
+	}
+	if (bad)
+		fail("%s", test);
+	else
+		pass("%s", test);
+}
+
+/* Print the nodes in bitmap as the hostlist of the node names would */
+static char *_hostlist_string(bitstr_t *bitmap, bool sort)
+{
+	hostlist_t hl = bitmap2hostlist(bitmap);
+	char *buf;
+
+	if (sort)
+		hostlist_sort(hl);
+	buf = hostlist_ranged_string_xmalloc(hl);
+	hostlist_destroy(hl);
+	return buf;
+}
+
+/* Encode bitmap with bitmap2node_name_sortable(), compare the string with
+ * the hostlist's byte for byte and decode it again with node_name2bitmap(),
+ * return true if both match */
+static bool _encode_bitmap(bitstr_t *bitmap, bool sort)
+{
+	bitstr_t *out_bitmap = NULL;
+	char *node_str, *hl_str;
+	bool rc = true;
+
+	node_str = bitmap2node_name_sortable(bitmap, sort);
+	hl_str = _hostlist_string(bitmap, sort);
+	if (strcmp(node_str, hl_str)) {
+		note("bitmap2node_name_sortable(%d) gave %s, hostlist %s",
+		     (int) sort, node_str, hl_str);
+		rc = false;
+	}
+	if ((node_name2bitmap(node_str, false, &out_bitmap) != SLURM_SUCCESS)
+	    || !bit_equal(bitmap, out_bitmap)) {
+		note("%s does not decode to the encoded nodes", node_str);
+		rc = false;
+	}
+	FREE_NULL_BITMAP(out_bitmap);
+	xfree(node_str);
+	xfree(hl_str);
+	return rc;
+}
+
+/* Encode the full node table, each single node and random subsets of the
+ * nodes, both sorted and in node table order */
+static void _test_encode(char *test)
+{
+	bitstr_t *bitmap = bit_alloc(node_record_count);
+	int density[] = { 1, 10, 50, 90, 99 };
+	int i, j, k, bad = 0;
+
+	bit_nset(bitmap, 0, node_record_count - 1);
+	if (!_encode_bitmap(bitmap, true) || !_encode_bitmap(bitmap, false))
+		bad++;
+	for (i = 0; i < node_record_count; i++) {
+		bit_nclear(bitmap, 0, node_record_count - 1);
+		bit_set(bitmap, i);
+		if (!_encode_bitmap(bitmap, true) ||
+		    !_encode_bitmap(bitmap, false))
+			bad++;
+	}
+	for (i = 0; i < (sizeof(density) / sizeof(int)); i++) {
+		for (j = 0; j < 20; j++) {
+			bit_nclear(bitmap, 0, node_record_count - 1);
+			for (k = 0; k < node_record_count; k++) {
+				if ((rand() % 100) < density[i])
+					bit_set(bitmap, k);
+			}
+			if (bit_ffs(bitmap) == -1)
+				continue;
+			if (!_encode_bitmap(bitmap, true) ||
+			    !_encode_bitmap(bitmap, false))
+				bad++;
+		}
+	}
+	FREE_NULL_BITMAP(bitmap);
+	if (bad)
+		fail("%s", test);
+	else
+		pass("%s", test);
+}
+
+int
+main(int argc, char *argv[])
+{
+	log_options_t log_opts = LOG_OPTS_STDERR_ONLY;
+
+	/* unknown names are expected to log errors */
+	log_opts.stderr_level = LOG_LEVEL_QUIET;
+	log_init("node_conf-test", log_opts, 0, NULL);
+
+	note("Testing node_name2bitmap with zero padded names");
+	{
+		char *conf[] = { "tux[001-100]", "tux[0101-0120]", NULL };
+		char *names[] = {
+			"tux001", "tux[001-100]", "tux[010-020,050,099-100]",
+			"tux[001-100],tux[0101-0120]", "tux[0101-0110]",
+			"tux[099-100],tux0101", "tux[100-101]",
+			"tux[1-10]", "tux[01-10]", "tux[0001-0010]",
+			"tux[0100]", "tux100", "tux1", NULL };
+		_build_nodes(conf);
+		_test_names("zero padded names", names);
+	}
+
+	note("Testing node_name2bitmap with mixed suffix widths");
+	{
+		char *conf[] = { "n[1-20]", "n[01-09]", "n[001-005]",
+				 "n[100-120]", "n[0121-0125]", NULL };
+		char *names[] = {
+			"n[1-20]", "n[01-20]", "n[001-005]", "n[5-15]",
+			"n[05-15]", "n[1-9],n[01-09],n[001-005]",
+			"n[9-11]", "n[09-11]", "n[005-006]", "n[099-101]",
+			"n[99-101]", "n[100-120]", "n[0100-0101]",
+			"n[1-120]", "n[001-120]", "n[120-121]",
+			"n[0120-0125]", "n0121", "n121", "n010", "n0010",
+			NULL };
+		_build_nodes(conf);
+		_test_names("mixed suffix widths", names);
+	}
+
+	note("Testing node_name2bitmap with nested and multiple brackets");
+	{
+		char *conf[] = { "rack[1-4]", "rack1n[1-4]", "rack2n[1-4]",
+				 "tux[1-8]", NULL };
+		char *names[] = {
+			"tux[1-[2-3]]", "tux[[1-2]]", "tux[1-2]]", "tux[1-2",
+			"rack[1-2]n[1-4]", "rack[1-2]n1", "rack1n[1-2,4]",
+			"tux[1-2][3]", "tux[1,[3]]", "tux[]", "[1-2]",
+			"tux[1-3]x", "tux[3-1]", "tux[1--2]", "tux[-1]",
+			NULL };
+		_build_nodes(conf);
+		_test_names("nested and multiple brackets", names);
+	}
+
+	note("Testing node_name2bitmap with unknown names");
+	{
+		char *conf[] = { "tux[0-127]", "login", "io[1-4]", NULL };
+		char *names[] = {
+			"bogus", "tux128", "tux[120-130]", "tux[0-3],bogus1",
+			"bogus[1-3]", "tu[1-3]", "tuxx1", "tux01", "io0",
+			"io[0-4]", "login1", "login", "login,io[1-4]",
+			"tux[0-127],io[1-5]", "io1,", ",io1", "io1,,io2",
+			"tux1 tux2", "", NULL };
+		_build_nodes(conf);
+		_test_names("unknown names", names);
+	}
+
+	note("Testing node_name2bitmap with nodes out of name order");
+	{
+		char *conf[] = { "c[5-8]", "c[1-4]", "b3", "a[10-12]",
+				 "b[1-2]", "a[1-9]", NULL };
+		char *names[] = {
+			"c[1-8]", "c[3-6]", "b[1-3]", "a[1-12]", "a[9-10]",
+			"a[1-12],b[1-3],c[1-8]", "c[4-5],a[9-10],b[2-3]",
+			NULL };
+		_build_nodes(conf);
+		_test_names("nodes out of name order", names);
+	}
+
+	srand(1);
+
+	note("Testing bitmap2node_name with zero padded names");
+	{
+		char *conf[] = { "tux[001-100]", NULL };
+		_build_nodes(conf);
+		_test_encode("zero padded names");
+	}
+	{
+		char *conf[] = { "n[01-09]", "n[10-120]", "m[1-20]", NULL };
+		_build_nodes(conf);
+		_test_encode("padded names followed by wider names");
+	}
+	{
+		char *conf[] = { "n[1-20]", "n[01-09]", "n[001-005]",
+				 "n[100-120]", "n[0121-0125]", NULL };
+		_build_nodes(conf);
+		_test_encode("mixed padding widths");
+	}
+
+	note("Testing bitmap2node_name prefix ordering");
+	{
+		char *conf[] = { "rack10n[1-4]", "rack2n[1-4]", "rack1n[1-4]",
+				 "ab[1-3]", "a[1-3]", "a1b[1-2]", "X[1-2]",
+				 "x-[1-3]", "rack01n[5-6]", NULL };
+		_build_nodes(conf);
+		_test_encode("prefix ordering");
+	}
+	{
+		char *conf[] = { "tux[1-8]", "login", "io[1-4]", NULL };
+		_build_nodes(conf);
+		_test_encode("names without numeric suffix");
+	}
+
+	note("Testing bitmap2node_name with nodes out of name order");
+	{
+		char *conf[] = { "c[5-8]", "c[1-4]", "b3", "a[10-12]",
+				 "b[1-2]", "a[1-9]", "c[10-20]", "c9", NULL };
+		_build_nodes(conf);
+		_test_encode("nodes out of name order");
+	}
+	{
+		char *conf[] = { "tux[2048-4095]", "tux[0-2047]", NULL };
+		_build_nodes(conf);
+		_test_encode("large node table");
+	}
+
+	_free_nodes();
+	xhash_free(node_hash_table);
+	node_hash_table = NULL;
+	totals();
+	return failed;
+}
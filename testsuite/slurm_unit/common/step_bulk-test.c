@@ -0,0 +1,144 @@
+/* Test of REQUEST_JOB_STEP_CREATE_BULK and RESPONSE_JOB_STEP_CREATE_BULK
+ * message packing in src/common/slurm_protocol_pack.c
+ */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+
+#include <src/common/pack.h>
+#include <src/common/slurm_protocol_api.h>
+#include <src/common/slurm_protocol_defs.h>
+#include <src/common/slurm_protocol_pack.h>
+#include <src/common/xmalloc.h>
+#include <src/common/xstring.h>
+#include <testsuite/dejagnu.h>
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+#define STEP_CNT 5
+
+/* Unpack a message of the given type from the data packed into buffer,
+ * sized to the packed data as a received message would be */
+static int _unpack(uint16_t msg_type, Buf buffer, slurm_msg_t *msg)
+{
+	uint32_t size = get_buf_offset(buffer);
+	char *data = xmalloc(size);
+	Buf in_buf;
+	int rc;
+
+	memcpy(data, get_buf_data(buffer), size);
+	in_buf = create_buf(data, size);
+	slurm_msg_t_init(msg);
+	msg->msg_type = msg_type;
+	msg->protocol_version = SLURM_PROTOCOL_VERSION;
+	rc = unpack_msg(msg, in_buf);
+	free_buf(in_buf);
+	return rc;
+}
+
+int
+main(int argc, char *argv[])
+{
+	note("Testing bulk step create request pack/unpack");
+	{
+		job_step_create_bulk_request_msg_t req, *out;
+		slurm_msg_t msg;
+		Buf buffer = init_buf(1024);
+		uint32_t i;
+		int bad = 0;
+
+		req.step_cnt = STEP_CNT;
+		req.step_req = xmalloc(sizeof(job_step_create_request_msg_t *) *
+				       STEP_CNT);
+		for (i = 0; i < STEP_CNT; i++) {
+			req.step_req[i] =
+				xmalloc(sizeof(job_step_create_request_msg_t));
+			req.step_req[i]->job_id = 1234;
+			req.step_req[i]->user_id = 500 + i;
+			req.step_req[i]->num_tasks = i + 1;
+			req.step_req[i]->name = xstrdup_printf("step%u", i);
+		}
+
+		slurm_msg_t_init(&msg);
+		msg.msg_type = REQUEST_JOB_STEP_CREATE_BULK;
+		msg.protocol_version = SLURM_PROTOCOL_VERSION;
+		msg.data = &req;
+		pack_msg(&msg, buffer);
+
+		TEST(_unpack(REQUEST_JOB_STEP_CREATE_BULK, buffer, &msg) ==
+		     SLURM_SUCCESS, "unpack request");
+		out = (job_step_create_bulk_request_msg_t *) msg.data;
+		TEST(out && (out->step_cnt == STEP_CNT), "request step count");
+		for (i = 0; out && (i < out->step_cnt); i++) {
+			if ((out->step_req[i]->job_id != 1234) ||
+			    (out->step_req[i]->user_id != 500 + i) ||
+			    (out->step_req[i]->num_tasks != i + 1) ||
+			    strcmp(out->step_req[i]->name,
+				   req.step_req[i]->name))
+				bad++;
+		}
+		TEST(bad == 0, "request step contents in order");
+		slurm_free_job_step_create_bulk_request_msg(out);
+
+		for (i = 0; i < STEP_CNT; i++)
+			slurm_free_job_step_create_request_msg(req.step_req[i]);
+		xfree(req.step_req);
+		free_buf(buffer);
+	}
+	note("Testing bulk step create message count limits");
+	{
+		slurm_msg_t msg;
+		Buf buffer = init_buf(1024);
+		uint32_t i;
+
+		/* Count larger than the rest of the message */
+		pack32(1000, buffer);
+		pack32(0, buffer);
+		TEST(_unpack(REQUEST_JOB_STEP_CREATE_BULK, buffer, &msg) !=
+		     SLURM_SUCCESS, "reject request count beyond buffer");
+		TEST(msg.data == NULL, "no request returned on error");
+		TEST(_unpack(RESPONSE_JOB_STEP_CREATE_BULK, buffer, &msg) !=
+		     SLURM_SUCCESS, "reject response count beyond buffer");
+		TEST(msg.data == NULL, "no response returned on error");
+
+		/* Count above MAX_STEP_BULK with enough data to follow */
+		set_buf_offset(buffer, 0);
+		pack32(MAX_STEP_BULK + 1, buffer);
+		for (i = 0; i <= MAX_STEP_BULK; i++)
+			pack32(ESLURM_DISABLED, buffer);
+		TEST(_unpack(REQUEST_JOB_STEP_CREATE_BULK, buffer, &msg) !=
+		     SLURM_SUCCESS, "reject request count above MAX_STEP_BULK");
+		TEST(_unpack(RESPONSE_JOB_STEP_CREATE_BULK, buffer, &msg) !=
+		     SLURM_SUCCESS, "reject response count above MAX_STEP_BULK");
+
+		/* Response with every step failed carries no step data */
+		set_buf_offset(buffer, 0);
+		pack32(2, buffer);
+		pack32(ESLURM_DISABLED, buffer);
+		pack32(ESLURM_NODES_BUSY, buffer);
+		TEST(_unpack(RESPONSE_JOB_STEP_CREATE_BULK, buffer, &msg) ==
+		     SLURM_SUCCESS, "unpack failed step response");
+		if (msg.data) {
+			job_step_create_bulk_response_msg_t *resp = msg.data;
+			TEST((resp->step_cnt == 2) &&
+			     (resp->error_code[0] == ESLURM_DISABLED) &&
+			     (resp->error_code[1] == ESLURM_NODES_BUSY) &&
+			     !resp->step_resp[0] && !resp->step_resp[1],
+			     "failed step response contents");
+			slurm_free_job_step_create_bulk_response_msg(resp);
+		}
+		free_buf(buffer);
+	}
+
+	totals();
+	return failed;
+}